@@ -0,0 +1,161 @@
+/* CPU time per frame of display_refresh on a 300x100 screen, drawing a
+ * highlighted C file. Curses writes to /dev/null, so this is the cost of
+ * building the frame and of curses working out what to send, not of the
+ * terminal. Highlighting jobs finish between frames and are not counted.
+ *   redraw  the same view again, as for a status bar update
+ *   line    scrolled down one line
+ *   page    scrolled down a page, every row new
+ * Usage: frame_bench [file] */
+#include "smashedit.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#define FRAME_ROWS "100"
+#define FRAME_COLS "300"
+#define FRAME_COUNT 300
+#define FRAME_CORPUS_LINES 50000
+
+typedef enum {
+    STEP_REDRAW,
+    STEP_LINE,
+    STEP_PAGE
+} FrameStep;
+
+static const char *g_step_names[] = {"redraw", "line", "page"};
+
+static FILE *g_report = NULL;
+
+static double thread_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* C-like lines of mixed length, some running past the right edge */
+static bool write_corpus(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+
+    unsigned int seed = 1;
+    for (int i = 0; i < FRAME_CORPUS_LINES; i++) {
+        switch (rand_r(&seed) % 6) {
+            case 0:
+                fprintf(f, "static int step_%d(const char *s, size_t len) {\n", i);
+                break;
+            case 1:
+                fprintf(f, "    total += values[%d] * 0x%x;  /* running sum */\n", i % 97, i);
+                break;
+            case 2:
+                fprintf(f, "    printf(\"%%s: %%d items in line %d\\n\", name, count);\n", i);
+                break;
+            case 3:
+                fprintf(f, "    // ");
+                for (int w = rand_r(&seed) % 60; w > 0; w--) {
+                    fprintf(f, "word%d ", rand_r(&seed) % 1000);
+                }
+                fprintf(f, "\n");
+                break;
+            case 4:
+                fprintf(f, "}\n\n");
+                break;
+            default:
+                fprintf(f, "    if (len > %d && s[%d] == '\\t') return -1;\n", i % 300, i % 40);
+                break;
+        }
+    }
+    return fclose(f) == 0;
+}
+
+/* Let the highlighting requested by the last frame arrive */
+static void frame_settle(Editor *ed) {
+    while (ed->hl_cache->pending || ed->hl_cache->scan) {
+        if (event_wait() & EVENT_WAKE) jobs_drain();
+    }
+}
+
+static void frame_step(Editor *ed, FrameStep step) {
+    if (step == STEP_LINE) {
+        editor_scroll_down(ed, 1);
+    } else if (step == STEP_PAGE) {
+        editor_scroll_down(ed, ed->edit_height);
+    }
+}
+
+static void bench_step(Editor *ed, FrameStep step) {
+    editor_move_doc_start(ed);
+    display_refresh(ed);
+    frame_settle(ed);
+    display_refresh(ed);
+
+    double total = 0, worst = 0;
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        frame_step(ed, step);
+
+        double start = thread_us();
+        display_refresh(ed);
+        double spent = thread_us() - start;
+
+        total += spent;
+        if (spent > worst) worst = spent;
+        frame_settle(ed);
+    }
+
+    fprintf(g_report, "%-8s %9.1f us/frame  max %9.1f us\n", g_step_names[step],
+            total / FRAME_COUNT, worst);
+}
+
+int main(int argc, char **argv) {
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !dir[0]) dir = "/tmp";
+
+    char path[MAX_FILENAME];
+    if (argc > 1) {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    } else {
+        snprintf(path, sizeof(path), "%s/smashedit-frame.c", dir);
+        if (!write_corpus(path)) {
+            fprintf(stderr, "%s: cannot write\n", path);
+            return 1;
+        }
+    }
+
+    /* Results go to the real stdout, curses to /dev/null at a fixed size */
+    g_report = fdopen(dup(STDOUT_FILENO), "w");
+    int null_fd = open("/dev/null", O_RDWR);
+    if (!g_report || null_fd < 0) return 1;
+    setvbuf(g_report, NULL, _IONBF, 0);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    setenv("TERM", "xterm-256color", 1);
+    setenv("LINES", FRAME_ROWS, 1);
+    setenv("COLUMNS", FRAME_COLS, 1);
+
+    if (!event_init()) return 1;
+    jobs_init(0);
+    Editor *ed = editor_create();
+    if (!ed) return 1;
+    editor_init_screen(ed);
+
+    bool loaded = file_load(ed, path);
+    while (ed->loading) {
+        if (event_wait() & EVENT_WAKE) jobs_drain();
+    }
+    if (loaded) {
+        fprintf(g_report, "%s: %zu lines on %dx%d\n", path, buffer_count_lines(ed->buffer),
+                ed->screen_cols, ed->screen_rows);
+        bench_step(ed, STEP_REDRAW);
+        bench_step(ed, STEP_LINE);
+        bench_step(ed, STEP_PAGE);
+    }
+
+    file_new(ed);
+    jobs_shutdown();
+    editor_destroy(ed);
+    display_shutdown();
+    event_shutdown();
+    if (argc <= 1) remove(path);
+
+    if (!loaded) fprintf(g_report, "%s: cannot load\n", path);
+    return loaded ? 0 : 1;
+}
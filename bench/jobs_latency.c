@@ -0,0 +1,67 @@
+/* Submit-to-completion latency of the job pool: one empty job at a time,
+ * timed from jobs_submit until its completion runs on the main thread after
+ * the self-pipe wakes event_wait. Usage: jobs_latency [iterations] */
+#include "smashedit.h"
+#include <time.h>
+
+#define LATENCY_ITERATIONS 20000
+
+static bool g_done = false;
+
+static void latency_run(void *arg, const JobToken *token) {
+    (void)arg;
+    (void)token;
+}
+
+static void latency_done(void *arg, bool cancelled) {
+    (void)arg;
+    (void)cancelled;
+    g_done = true;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void latency_measure(int threads, int iterations, double *samples) {
+    jobs_init(threads);
+
+    for (int i = 0; i < iterations; i++) {
+        g_done = false;
+        double start = now_us();
+        if (!jobs_submit(latency_run, latency_done, NULL, NULL)) break;
+        while (!g_done) {
+            if (event_wait() & EVENT_WAKE) jobs_drain();
+        }
+        samples[i] = now_us() - start;
+    }
+
+    printf("%2d workers: ", jobs_worker_count());
+    jobs_shutdown();
+
+    qsort(samples, iterations, sizeof(double), compare_double);
+    printf("median %7.1f us  p99 %7.1f us  max %8.1f us\n",
+           samples[iterations / 2], samples[iterations * 99 / 100], samples[iterations - 1]);
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : LATENCY_ITERATIONS;
+    if (iterations <= 0) iterations = LATENCY_ITERATIONS;
+
+    double *samples = calloc(iterations, sizeof(double));
+    if (!samples || !event_init()) return 1;
+
+    latency_measure(1, iterations, samples);
+    latency_measure(0, iterations, samples);
+
+    event_shutdown();
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* Stress test for the job pool: jobs fanned out from the main thread and from
+ * inside other jobs, tokens cancelled mid-flight, and the pool shut down with
+ * work still queued. Every completion must run exactly once.
+ * Exits non-zero on failure. */
+#include "smashedit.h"
+#include <stdatomic.h>
+
+#define STRESS_ROUNDS 24
+#define STRESS_ROOTS 2000
+#define STRESS_CHILDREN 4
+#define STRESS_TIMEOUT_MS 60000
+
+typedef struct StressJob {
+    bool root;
+    unsigned long work;
+} StressJob;
+
+static atomic_ulong g_submitted;
+static unsigned long g_completed = 0;
+static unsigned long g_roots_completed = 0;
+static unsigned long g_cancelled = 0;
+
+static bool stress_submit(bool root, JobToken *token);
+
+static void stress_run(void *arg, const JobToken *token) {
+    StressJob *job = arg;
+
+    /* A little busy work so workers overlap and steal from each other */
+    volatile unsigned long sum = 0;
+    for (unsigned long i = 0; i < job->work; i++) {
+        sum += i;
+    }
+
+    if (job->root) {
+        for (int i = 0; i < STRESS_CHILDREN && !job_token_cancelled(token); i++) {
+            stress_submit(false, (JobToken *)token);
+        }
+    }
+}
+
+static void stress_done(void *arg, bool cancelled) {
+    StressJob *job = arg;
+    g_completed++;
+    if (job->root) g_roots_completed++;
+    if (cancelled) g_cancelled++;
+    free(job);
+}
+
+static bool stress_submit(bool root, JobToken *token) {
+    StressJob *job = malloc(sizeof(StressJob));
+    if (!job) return false;
+    job->root = root;
+    job->work = root ? 2000 : 500;
+
+    atomic_fetch_add(&g_submitted, 1);
+    if (!jobs_submit(stress_run, stress_done, job, token)) {
+        atomic_fetch_sub(&g_submitted, 1);
+        free(job);
+        return false;
+    }
+    return true;
+}
+
+/* Drain completions until every submitted job has come back */
+static bool stress_wait(unsigned long roots) {
+    long deadline = event_now_ms() + STRESS_TIMEOUT_MS;
+
+    while (g_roots_completed < roots || g_completed < atomic_load(&g_submitted)) {
+        if (event_now_ms() > deadline) return false;
+        if (event_wait() & EVENT_WAKE) {
+            jobs_drain();
+        }
+    }
+    return true;
+}
+
+static bool stress_round(int round) {
+    int threads = round % (JOBS_MAX_WORKERS + 1);
+    jobs_init(threads);
+
+    atomic_store(&g_submitted, 0);
+    g_completed = g_roots_completed = g_cancelled = 0;
+
+    JobToken *token = job_token_create();
+    if (!token) return false;
+
+    unsigned long roots = 0;
+    for (int i = 0; i < STRESS_ROOTS; i++) {
+        if (stress_submit(true, token)) roots++;
+        if (round % 3 == 1 && i == STRESS_ROOTS / 2) {
+            job_token_cancel(token);
+        }
+    }
+    job_token_release(token);
+
+    bool ok;
+    if (round % 3 == 2) {
+        /* Shut down with work queued - the rest completes as cancelled */
+        jobs_shutdown();
+        ok = g_roots_completed == roots && g_completed == atomic_load(&g_submitted);
+    } else {
+        ok = stress_wait(roots);
+        jobs_shutdown();
+    }
+
+    printf("round %2d: %d workers, %lu jobs, %lu cancelled%s\n", round, threads,
+           g_completed, g_cancelled, ok ? "" : " - FAILED");
+    if (round % 3 == 0 && g_cancelled != 0) {
+        printf("round %2d: jobs cancelled without a cancel\n", round);
+        ok = false;
+    }
+    return ok;
+}
+
+int main(void) {
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if (!event_init()) {
+        fprintf(stderr, "event_init failed\n");
+        return 1;
+    }
+
+    /* Submitting to a pool that was never started fails without keeping a reference */
+    JobToken *token = job_token_create();
+    if (jobs_submit(stress_run, stress_done, NULL, token)) {
+        printf("jobs_submit succeeded before jobs_init\n");
+        return 1;
+    }
+    job_token_release(token);
+
+    bool ok = true;
+    for (int round = 0; round < STRESS_ROUNDS; round++) {
+        ok = stress_round(round) && ok;
+    }
+
+    event_shutdown();
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/* Load time versus file size. For each size a file of random lines is
+ * written to $TMPDIR (or /tmp) and loaded with file_load several times from
+ * a warm page cache. "shown" is when file_load returns and the first screen
+ * can be drawn; "complete" is when a background load has read the whole file
+ * or a paged file has finished its line index.
+ * Usage: load_bench [size_mb...] */
+#include "smashedit.h"
+#include <time.h>
+
+#define LOAD_RUNS 3
+
+static const size_t g_default_sizes_mb[] = {1, 16, 64, 256};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Lines of 0-99 random lowercase letters */
+static bool write_corpus(const char *path, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    char line[128];
+    unsigned int seed = 1;
+    size_t written = 0;
+    while (written < size) {
+        int len = rand_r(&seed) % 100;
+        for (int i = 0; i < len; i++) {
+            line[i] = 'a' + rand_r(&seed) % 26;
+        }
+        line[len++] = '\n';
+        if (fwrite(line, 1, len, f) != (size_t)len) break;
+        written += len;
+    }
+    return fclose(f) == 0 && written >= size;
+}
+
+static bool load_complete(Editor *ed) {
+    if (ed->loading) return false;
+    return !ed->buffer->paged || paged_index_complete(ed->buffer->paged);
+}
+
+static void bench_size(Editor *ed, const char *dir, size_t size_mb) {
+    char path[MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/smashedit-load-%zu.txt", dir, size_mb);
+    if (!write_corpus(path, size_mb * 1024 * 1024)) {
+        fprintf(stderr, "%s: cannot write\n", path);
+        remove(path);
+        return;
+    }
+
+    double best_shown = -1, best_complete = -1;
+    for (int run = 0; run < LOAD_RUNS; run++) {
+        double start = now_ms();
+        if (!file_load(ed, path)) break;
+        double shown = now_ms() - start;
+
+        while (!load_complete(ed)) {
+            if (event_wait() & EVENT_WAKE) jobs_drain();
+        }
+        double complete = now_ms() - start;
+
+        if (best_shown < 0 || shown < best_shown) best_shown = shown;
+        if (best_complete < 0 || complete < best_complete) best_complete = complete;
+    }
+
+    const char *mode = ed->buffer->paged ? "paged" : size_mb * 1024 * 1024 >= FILE_ASYNC_MIN ? "background" : "mapped";
+    printf("%6zu MB  %-10s  shown %9.1f ms  complete %9.1f ms  %7.1f MB/s\n", size_mb, mode,
+           best_shown, best_complete, best_complete > 0 ? size_mb * 1e3 / best_complete : 0.0);
+
+    file_new(ed);
+    remove(path);
+}
+
+int main(int argc, char **argv) {
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !dir[0]) dir = "/tmp";
+
+    if (!event_init()) return 1;
+    jobs_init(0);
+    Editor *ed = editor_create();
+    if (!ed) return 1;
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            long size_mb = atol(argv[i]);
+            if (size_mb > 0) bench_size(ed, dir, (size_t)size_mb);
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(g_default_sizes_mb) / sizeof(g_default_sizes_mb[0]); i++) {
+            bench_size(ed, dir, g_default_sizes_mb[i]);
+        }
+    }
+
+    editor_destroy(ed);
+    jobs_shutdown();
+    event_shutdown();
+    return 0;
+}
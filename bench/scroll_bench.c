@@ -0,0 +1,129 @@
+/* Bytes the editor writes to its terminal per one-line scroll. smashedit
+ * runs on a 120x40 pty with TERM=xterm-256color; the cursor is taken to the
+ * bottom (then top) row and Down (then Up) pressed one key at a time, each
+ * step counted until the output goes quiet. A step also redraws the cursor
+ * position in the status bar. For comparison, one row of the screen is
+ * about 120 bytes of text and the first screen is a full repaint.
+ * Usage: scroll_bench [file] */
+#include "smashedit.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+#define SCROLL_ROWS 40
+#define SCROLL_COLS 120
+#define SCROLL_STEPS 60
+#define SCROLL_LINES 2000
+#define SCROLL_QUIET_MS 60
+#define SCROLL_START_MS 1000
+
+/* Numbered lines of different lengths, so no two rows look alike */
+static bool write_corpus(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+
+    unsigned int seed = 1;
+    for (int i = 1; i <= SCROLL_LINES; i++) {
+        fprintf(f, "%5d:", i);
+        for (int w = 1 + rand_r(&seed) % 14; w > 0; w--) {
+            fprintf(f, " word%d", rand_r(&seed) % 1000);
+        }
+        fprintf(f, "\n");
+    }
+    return fclose(f) == 0;
+}
+
+/* Read until nothing arrives for quiet_ms; returns the bytes read */
+static size_t read_quiet(int fd, int quiet_ms) {
+    size_t total = 0;
+    char chunk[4096];
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    while (poll(&pfd, 1, quiet_ms) > 0) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) break;
+        total += (size_t)n;
+    }
+    return total;
+}
+
+static size_t press(int fd, const char *key, int quiet_ms) {
+    if (write(fd, key, strlen(key)) < 0) return 0;
+    return read_quiet(fd, quiet_ms);
+}
+
+static int compare_size(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* One-line scroll steps in one direction, after moving the cursor to the edge */
+static void bench_direction(int fd, const char *name, const char *key) {
+    for (int i = 0; i < SCROLL_ROWS; i++) {
+        press(fd, key, 0);
+    }
+    read_quiet(fd, SCROLL_QUIET_MS * 4);
+
+    size_t steps[SCROLL_STEPS];
+    size_t total = 0;
+    for (int i = 0; i < SCROLL_STEPS; i++) {
+        steps[i] = press(fd, key, SCROLL_QUIET_MS);
+        total += steps[i];
+    }
+
+    qsort(steps, SCROLL_STEPS, sizeof(size_t), compare_size);
+    printf("%-5s  median %5zu  mean %7.1f  max %5zu bytes/step\n", name,
+           steps[SCROLL_STEPS / 2], (double)total / SCROLL_STEPS, steps[SCROLL_STEPS - 1]);
+}
+
+int main(int argc, char **argv) {
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !dir[0]) dir = "/tmp";
+
+    char path[MAX_FILENAME];
+    if (argc > 1) {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    } else {
+        snprintf(path, sizeof(path), "%s/smashedit-scroll.txt", dir);
+        if (!write_corpus(path)) {
+            fprintf(stderr, "%s: cannot write\n", path);
+            return 1;
+        }
+    }
+
+    struct winsize size = {SCROLL_ROWS, SCROLL_COLS, 0, 0};
+    int fd;
+    pid_t pid = forkpty(&fd, NULL, NULL, &size);
+    if (pid < 0) {
+        perror("forkpty");
+        return 1;
+    }
+    if (pid == 0) {
+        setenv("TERM", "xterm-256color", 1);
+        setenv("SMASHEDIT_FRAME_MS", "0", 1);
+        execl(SMASHEDIT_PATH, "smashedit", path, (char *)NULL);
+        _exit(127);
+    }
+
+    size_t first = read_quiet(fd, SCROLL_START_MS);
+    printf("%s on %dx%d: first screen %zu bytes\n", path, SCROLL_COLS, SCROLL_ROWS, first);
+    if (first > 0) {
+        bench_direction(fd, "down", "\033OB");
+        bench_direction(fd, "up", "\033OA");
+    }
+
+    kill(pid, SIGTERM);
+    read_quiet(fd, SCROLL_QUIET_MS);
+    waitpid(pid, NULL, 0);
+    close(fd);
+    if (argc <= 1) remove(path);
+    return first > 0 ? 0 : 1;
+}
@@ -0,0 +1,661 @@
+/* Highlighter throughput per language: syntax_highlight_line over every line
+ * of a corpus, carrying the multi-line state as the renderer does.
+ * With no arguments a built-in sample of each language is repeated to
+ * about 4 MB; files given on the command line are benchmarked as their
+ * detected language.
+ * Usage: syntax_bench [file...] */
+#include "smashedit.h"
+#include <time.h>
+
+#define BENCH_CORPUS_SIZE (4 * 1024 * 1024)
+#define BENCH_MIN_SECONDS 0.5
+
+typedef struct BenchSample {
+    const char *name;
+    LanguageType lang;
+    const char *text;
+} BenchSample;
+
+static const BenchSample g_samples[] = {
+    {"C", LANG_C,
+     "#include <stdio.h>\n"
+     "/* Count the words in a line,\n * skipping blanks */\n"
+     "static int count_words(const char *s, size_t len) {\n"
+     "    int words = 0; bool in_word = false;\n"
+     "    for (size_t i = 0; i < len; i++) {\n"
+     "        if (s[i] == ' ' || s[i] == '\\t') in_word = false;  // blank\n"
+     "        else if (!in_word) { in_word = true; words++; }\n"
+     "    }\n"
+     "    printf(\"%d words in %zu bytes\\n\", words, len);\n"
+     "    return words * 0x10 + 42;\n"
+     "}\n"},
+    {"Shell", LANG_SHELL,
+     "#!/bin/sh\n"
+     "# Rotate the logs in $LOG_DIR\n"
+     "for f in \"$LOG_DIR\"/*.log; do\n"
+     "    if [ -s \"$f\" ]; then mv \"$f\" \"${f%.log}.$(date +%s).old\"; fi\n"
+     "done\n"
+     "echo 'rotated' >> /tmp/rotate.out 2>&1 || exit 1\n"},
+    {"Python", LANG_PYTHON,
+     "import os\n"
+     "class Walker(object):\n"
+     "    \"\"\"Walk a tree,\n    yielding file sizes.\"\"\"\n"
+     "    def walk(self, root='.', depth=3):\n"
+     "        for name in os.listdir(root):  # entries\n"
+     "            path = os.path.join(root, name)\n"
+     "            if os.path.isdir(path) and depth > 0:\n"
+     "                yield from self.walk(path, depth - 1)\n"
+     "            else:\n"
+     "                yield path, os.path.getsize(path) * 1.5\n"},
+    {"Markdown", LANG_MARKDOWN,
+     "# Release notes\n"
+     "Some **bold** and *italic* text with `inline code` in it.\n"
+     "- first item\n- second [link](http://example.com)\n"
+     "```\nmake build && make install\n```\n"
+     "> quoted line\n\n"},
+    {"JavaScript", LANG_JAVASCRIPT,
+     "// Debounce a callback\n"
+     "export function debounce(fn, ms = 250) {\n"
+     "    let timer = null;\n"
+     "    return (...args) => {\n"
+     "        clearTimeout(timer);\n"
+     "        timer = setTimeout(() => fn.apply(this, args), ms);  /* restart */\n"
+     "        console.log(`waiting ${ms} ms`, 'debounced', 0.5);\n"
+     "    };\n"
+     "}\n"},
+    {"Go", LANG_GO,
+     "package main\n"
+     "import \"fmt\"\n"
+     "// Sum adds the values\n"
+     "func Sum(values []int) (total int) {\n"
+     "    for _, v := range values {\n"
+     "        total += v * 0x2\n"
+     "    }\n"
+     "    fmt.Printf(\"%d\\n\", total)\n"
+     "    return\n"
+     "}\n"},
+    {"Rust", LANG_RUST,
+     "use std::collections::HashMap;\n"
+     "/// Count the words\n"
+     "pub fn count(text: &str) -> HashMap<&str, usize> {\n"
+     "    let mut map = HashMap::new();\n"
+     "    for word in text.split_whitespace() {\n"
+     "        *map.entry(word).or_insert(0) += 1; // tally\n"
+     "    }\n"
+     "    println!(\"{} words\", map.len());\n"
+     "    map\n"
+     "}\n"},
+    {"Java", LANG_JAVA,
+     "package demo;\n"
+     "/** A simple counter. */\n"
+     "public final class Counter {\n"
+     "    private long value = 0L;\n"
+     "    @Override public String toString() { return \"Counter(\" + value + \")\"; }\n"
+     "    public synchronized void add(int n) { value += n * 3; }\n"
+     "}\n"},
+    {"Ruby", LANG_RUBY,
+     "# Greets people\n"
+     "class Greeter\n"
+     "  def initialize(name = 'world')\n"
+     "    @name = name\n"
+     "  end\n"
+     "  def greet = puts(\"Hello, #{@name}! #{42 * 2}\")\n"
+     "end\n"},
+    {"Lua", LANG_LUA,
+     "-- Fibonacci\n"
+     "local function fib(n)\n"
+     "    if n < 2 then return n end\n"
+     "    return fib(n - 1) + fib(n - 2)\n"
+     "end\n"
+     "print(\"fib\", fib(20), [[long\nstring]])\n"},
+    {"YAML", LANG_YAML,
+     "# Service config\n"
+     "service:\n"
+     "  name: \"web\"\n"
+     "  replicas: 3\n"
+     "  ports: [80, 443]\n"
+     "  enabled: true\n"},
+    {"TOML", LANG_TOML,
+     "# Build settings\n"
+     "[package]\n"
+     "name = \"widget\"\n"
+     "version = \"1.2.0\"\n"
+     "authors = [\"dev <dev@example.com>\"]\n"
+     "[dependencies]\n"
+     "serde = { version = \"1.0\", features = [\"derive\"], optional = true }\n"},
+    {"Makefile", LANG_MAKEFILE,
+     "# Build the tool\n"
+     "CC ?= cc\n"
+     "CFLAGS := -O2 -Wall\n"
+     "SRCS = $(wildcard src/*.c)\n"
+     ".PHONY: all clean\n"
+     "all: tool\n"
+     "tool: $(SRCS:.c=.o)\n"
+     "\t$(CC) $(CFLAGS) -o $@ $^\n"
+     "ifeq ($(DEBUG),1)\n"
+     "CFLAGS += -g\n"
+     "endif\n"
+     "clean:\n"
+     "\trm -f tool src/*.o\n"},
+    {"SQL", LANG_SQL,
+     "-- Top customers\n"
+     "SELECT c.name, SUM(o.total) AS spent\n"
+     "FROM customers c JOIN orders o ON o.customer_id = c.id\n"
+     "WHERE o.created_at > '2024-01-01' /* this year */\n"
+     "GROUP BY c.name ORDER BY spent DESC LIMIT 10;\n"},
+    {"CSS", LANG_CSS,
+     "/* Layout */\n"
+     ".page > .header, #main {\n"
+     "    margin: 0 auto; padding: 12px 1.5em;\n"
+     "    color: #336699; font-family: \"Sans\", serif;\n"
+     "}\n"},
+    {"Perl", LANG_PERL,
+     "#!/usr/bin/perl\n"
+     "use strict; use warnings;\n"
+     "# Count words per file\n"
+     "my %count;\n"
+     "foreach my $file (@ARGV) {\n"
+     "    open(my $fh, '<', $file) or die \"cannot open $file: $!\";\n"
+     "    while (my $line = <$fh>) { $count{$_}++ for split /\\s+/, $line; }\n"
+     "    close($fh);\n"
+     "}\n"
+     "print \"$_: $count{$_}\\n\" for sort keys %count;\n"},
+    {"Haskell", LANG_HASKELL,
+     "module Main where\n"
+     "import qualified Data.Map as Map\n"
+     "-- Count the words\n"
+     "countWords :: String -> Map.Map String Int\n"
+     "countWords text = foldr (\\w m -> Map.insertWith (+) w 1 m) Map.empty (words text)\n"
+     "{- entry point -}\n"
+     "main :: IO ()\n"
+     "main = do\n"
+     "  let counts = countWords \"a b a\"\n"
+     "  case Map.lookup \"a\" counts of\n"
+     "    Just n -> print (n * 2)\n"
+     "    Nothing -> putStrLn \"none\"\n"},
+    {"Lisp", LANG_LISP,
+     ";; Factorial and a list walk\n"
+     "(defun factorial (n)\n"
+     "  (if (<= n 1) 1 (* n (factorial (- n 1)))))\n"
+     "(defvar *names* '(\"ann\" \"bob\"))\n"
+     "(let ((total 0))\n"
+     "  (dolist (name *names*)\n"
+     "    (when (stringp name) (setq total (+ total (length name)))))\n"
+     "  (format t \"~a chars~%\" total))\n"},
+    {"C#", LANG_CSHARP,
+     "using System;\n"
+     "using System.Collections.Generic;\n"
+     "namespace Demo {\n"
+     "    /// <summary>Keeps a running total.</summary>\n"
+     "    public sealed class Totals {\n"
+     "        private readonly List<int> values = new List<int>();\n"
+     "        public void Add(int value) { if (value > 0) values.Add(value * 2); }\n"
+     "        public override string ToString() => $\"Total {values.Count}\"; // summary\n"
+     "        public static async Task<bool> SaveAsync(string path) { await Task.Delay(10); return true; }\n"
+     "    }\n"
+     "}\n"},
+    {"Fortran", LANG_FORTRAN,
+     "! Sum an array\n"
+     "program sum_array\n"
+     "  implicit none\n"
+     "  integer :: i, n\n"
+     "  real(kind=8) :: total\n"
+     "  real(kind=8), dimension(100) :: values\n"
+     "  n = 100\n"
+     "  total = 0.0d0\n"
+     "  do i = 1, n\n"
+     "    values(i) = i * 1.5d0\n"
+     "    if (values(i) > 50.0d0) then\n"
+     "      total = total + values(i)\n"
+     "    end if\n"
+     "  end do\n"
+     "  print *, 'total = ', total\n"
+     "end program sum_array\n"},
+    {"Pascal", LANG_PASCAL,
+     "program Totals;\n"
+     "{ Add up the numbers }\n"
+     "var\n"
+     "  i, total: Integer;\n"
+     "  name: String;\n"
+     "begin\n"
+     "  total := 0;\n"
+     "  for i := 1 to 10 do\n"
+     "  begin\n"
+     "    if i mod 2 = 0 then total := total + i\n"
+     "    else total := total - 1;\n"
+     "  end;\n"
+     "  name := 'sum'; // label\n"
+     "  WriteLn(name, ' = ', total);\n"
+     "end.\n"},
+    {"Ada", LANG_ADA,
+     "with Ada.Text_IO; use Ada.Text_IO;\n"
+     "-- Sum the squares\n"
+     "procedure Squares is\n"
+     "   Total : Integer := 0;\n"
+     "begin\n"
+     "   for I in 1 .. 10 loop\n"
+     "      if I mod 2 = 0 then\n"
+     "         Total := Total + I * I;\n"
+     "      end if;\n"
+     "   end loop;\n"
+     "   Put_Line (\"Total:\" & Integer'Image (Total));\n"
+     "end Squares;\n"},
+    {"PowerShell", LANG_POWERSHELL,
+     "# Report large files\n"
+     "param([string]$Path = \".\", [int]$MinSize = 1024)\n"
+     "function Get-Large {\n"
+     "    foreach ($file in Get-ChildItem -Path $Path -Recurse) {\n"
+     "        if ($file.Length -gt $MinSize) { Write-Output \"$($file.Name) $($file.Length)\" }\n"
+     "    }\n"
+     "}\n"
+     "<# main #>\n"
+     "try { Get-Large } catch { Write-Error $_ } finally { return $true }\n"},
+    {"JSON", LANG_JSON,
+     "{\"id\": 1042, \"name\": \"widget\", \"tags\": [\"a\", \"b\"],\n"
+     " \"price\": 12.50, \"active\": true, \"parent\": null},\n"},
+    {"Dockerfile", LANG_DOCKER,
+     "# Build stage\n"
+     "FROM golang:1.22 AS build\n"
+     "WORKDIR /src\n"
+     "COPY go.mod go.sum ./\n"
+     "RUN go mod download && go build -o /out/app ./cmd/app\n"
+     "FROM alpine:3.19\n"
+     "ENV PORT=8080\n"
+     "EXPOSE 8080\n"
+     "COPY --from=build /out/app /usr/local/bin/app\n"
+     "ENTRYPOINT [\"/usr/local/bin/app\", \"--port\", \"8080\"]\n"},
+    {"Git config", LANG_GITCONFIG,
+     "# User settings\n"
+     "[user]\n"
+     "    name = Dev Example\n"
+     "    email = dev@example.com\n"
+     "[core]\n"
+     "    editor = smashedit\n"
+     "    autocrlf = false\n"
+     "[alias]\n"
+     "    st = status -sb\n"
+     "[remote \"origin\"]\n"
+     "    url = https://example.com/repo.git\n"
+     "    fetch = +refs/heads/*:refs/remotes/origin/*\n"},
+    {"HTML", LANG_HTML,
+     "<!-- Page -->\n"
+     "<div class=\"card\" id='main'>\n"
+     "  <p>Some <b>text</b> &amp; more</p>\n"
+     "  <a href=\"/next\">next</a>\n"
+     "</div>\n"},
+    {"TypeScript", LANG_TYPESCRIPT,
+     "// A typed cache\n"
+     "interface Entry<T> { value: T; expires: number; }\n"
+     "export class Cache<T> {\n"
+     "    private entries = new Map<string, Entry<T>>();\n"
+     "    constructor(private readonly ttl: number = 1000) {}\n"
+     "    get(key: string): T | undefined {\n"
+     "        const entry = this.entries.get(key);\n"
+     "        return entry && entry.expires > Date.now() ? entry.value : undefined; /* fresh */\n"
+     "    }\n"
+     "    set(key: string, value: T): void { this.entries.set(key, { value, expires: Date.now() + this.ttl }); }\n"
+     "}\n"},
+    {"Terraform", LANG_TERRAFORM,
+     "# Web server\n"
+     "variable \"instance_type\" {\n"
+     "  type    = string\n"
+     "  default = \"t3.micro\"\n"
+     "}\n"
+     "resource \"aws_instance\" \"web\" {\n"
+     "  ami           = data.aws_ami.ubuntu.id\n"
+     "  instance_type = var.instance_type\n"
+     "  count         = 2\n"
+     "  tags = { Name = \"web-${count.index}\" }\n"
+     "}\n"
+     "output \"ip\" { value = aws_instance.web[0].public_ip }\n"},
+    {"PHP", LANG_PHP,
+     "<?php\n"
+     "// Render a list\n"
+     "function render(array $items): string {\n"
+     "    $out = '';\n"
+     "    foreach ($items as $i => $item) { $out .= \"<li>$i: {$item}</li>\"; }\n"
+     "    return $out;\n"
+     "}\n"},
+    {"Kotlin", LANG_KOTLIN,
+     "package demo\n"
+     "// A small repository\n"
+     "data class User(val id: Int, val name: String)\n"
+     "class Users(private val items: MutableList<User> = mutableListOf()) {\n"
+     "    fun add(user: User) { if (user.id > 0) items.add(user) }\n"
+     "    fun find(name: String): User? = items.firstOrNull { it.name == name }\n"
+     "    override fun toString() = \"Users(${items.size})\" /* count */\n"
+     "}\n"
+     "suspend fun load(): List<User> = listOf(User(1, \"ann\"), User(2, \"bob\"))\n"},
+    {"Swift", LANG_SWIFT,
+     "import Foundation\n"
+     "// A counter\n"
+     "struct Counter {\n"
+     "    private(set) var value: Int = 0\n"
+     "    mutating func add(_ n: Int) { value += n * 2 }\n"
+     "}\n"
+     "final class Store {\n"
+     "    var counters: [String: Counter] = [:]\n"
+     "    func bump(_ key: String) -> Int {\n"
+     "        guard var c = counters[key] else { return 0 }\n"
+     "        c.add(1); counters[key] = c\n"
+     "        print(\"bumped \\(key)\") /* log */\n"
+     "        return c.value\n"
+     "    }\n"
+     "}\n"},
+    {"Scala", LANG_SCALA,
+     "package demo\n"
+     "// Word counts\n"
+     "object WordCount {\n"
+     "  case class Count(word: String, n: Int)\n"
+     "  def count(text: String): Seq[Count] =\n"
+     "    text.split(\"\\\\s+\").groupBy(identity).map { case (w, ws) => Count(w, ws.length) }.toSeq\n"
+     "  def main(args: Array[String]): Unit = {\n"
+     "    val counts = count(\"a b a\")\n"
+     "    for (c <- counts if c.n > 1) println(s\"${c.word}: ${c.n}\") /* repeated */\n"
+     "  }\n"
+     "}\n"},
+    {"Elixir", LANG_ELIXIR,
+     "# Word counts\n"
+     "defmodule WordCount do\n"
+     "  @moduledoc \"Counts words\"\n"
+     "  def count(text) when is_binary(text) do\n"
+     "    text\n"
+     "    |> String.split()\n"
+     "    |> Enum.reduce(%{}, fn word, acc -> Map.update(acc, word, 1, &(&1 + 1)) end)\n"
+     "  end\n"
+     "  defp log(msg), do: IO.puts(\"count: #{msg}\")\n"
+     "end\n"},
+    {"Erlang", LANG_ERLANG,
+     "%% Word counts\n"
+     "-module(word_count).\n"
+     "-export([count/1]).\n"
+     "count(Text) when is_list(Text) ->\n"
+     "    Words = string:tokens(Text, \" \"),\n"
+     "    lists:foldl(fun(W, Acc) ->\n"
+     "        case maps:find(W, Acc) of\n"
+     "            {ok, N} -> maps:put(W, N + 1, Acc);\n"
+     "            error -> maps:put(W, 1, Acc)\n"
+     "        end\n"
+     "    end, #{}, Words).\n"},
+    {"R", LANG_R,
+     "# Summarise a data frame\n"
+     "library(stats)\n"
+     "summarise <- function(df, column = \"value\") {\n"
+     "  if (is.null(df[[column]])) return(NA)\n"
+     "  values <- df[[column]]\n"
+     "  for (i in seq_along(values)) {\n"
+     "    if (values[i] > 10) values[i] <- 10\n"
+     "  }\n"
+     "  list(mean = mean(values), n = length(values), ok = TRUE)\n"
+     "}\n"
+     "print(summarise(data.frame(value = c(1, 5, 20))))\n"},
+    {"Julia", LANG_JULIA,
+     "# Mean of the positive values\n"
+     "module Stats\n"
+     "export posmean\n"
+     "function posmean(xs::Vector{Float64})::Float64\n"
+     "    total = 0.0; n = 0\n"
+     "    for x in xs\n"
+     "        if x > 0\n"
+     "            total += x; n += 1\n"
+     "        end\n"
+     "    end\n"
+     "    return n == 0 ? NaN : total / n\n"
+     "end\n"
+     "end\n"
+     "println(\"mean: $(Stats.posmean([1.0, -2.0, 3.5]))\")\n"},
+    {"Zig", LANG_ZIG,
+     "const std = @import(\"std\");\n"
+     "// Sum a slice\n"
+     "pub fn sum(values: []const u32) u64 {\n"
+     "    var total: u64 = 0;\n"
+     "    for (values) |v| {\n"
+     "        if (v > 10) continue;\n"
+     "        total += v;\n"
+     "    }\n"
+     "    return total;\n"
+     "}\n"
+     "pub fn main() !void {\n"
+     "    const stdout = std.io.getStdOut().writer();\n"
+     "    try stdout.print(\"{d}\\n\", .{sum(&[_]u32{ 1, 2, 30 })});\n"
+     "}\n"},
+    {"Nim", LANG_NIM,
+     "# Word counts\n"
+     "import std/[strutils, tables]\n"
+     "proc countWords(text: string): CountTable[string] =\n"
+     "  result = initCountTable[string]()\n"
+     "  for word in text.splitWhitespace():\n"
+     "    if word.len > 0:\n"
+     "      result.inc(word)\n"
+     "let counts = countWords(\"a b a\")\n"
+     "for word, n in counts:\n"
+     "  echo word, \": \", n\n"},
+    {"Dart", LANG_DART,
+     "import 'dart:async';\n"
+     "// A simple counter\n"
+     "class Counter {\n"
+     "  int _value = 0;\n"
+     "  final String name;\n"
+     "  Counter(this.name);\n"
+     "  void add(int n) { if (n > 0) _value += n; }\n"
+     "  Future<int> load() async { await Future.delayed(const Duration(milliseconds: 10)); return _value; }\n"
+     "  @override\n"
+     "  String toString() => 'Counter($name, $_value)'; /* summary */\n"
+     "}\n"},
+    {"OCaml", LANG_OCAML,
+     "(* Word counts *)\n"
+     "let count_words text =\n"
+     "  let table = Hashtbl.create 16 in\n"
+     "  List.iter (fun w ->\n"
+     "    match Hashtbl.find_opt table w with\n"
+     "    | Some n -> Hashtbl.replace table w (n + 1)\n"
+     "    | None -> Hashtbl.add table w 1)\n"
+     "    (String.split_on_char ' ' text);\n"
+     "  table\n"
+     "let () = Printf.printf \"%d words\\n\" (Hashtbl.length (count_words \"a b a\"))\n"},
+    {"F#", LANG_FSHARP,
+     "module WordCount\n"
+     "open System\n"
+     "// Word counts\n"
+     "let countWords (text: string) =\n"
+     "    text.Split([|' '|], StringSplitOptions.RemoveEmptyEntries)\n"
+     "    |> Array.countBy id\n"
+     "    |> Map.ofArray\n"
+     "[<EntryPoint>]\n"
+     "let main argv =\n"
+     "    for KeyValue(word, n) in countWords \"a b a\" do\n"
+     "        if n > 1 then printfn \"%s: %d\" word n (* repeated *)\n"
+     "    0\n"},
+    {"Groovy", LANG_GROOVY,
+     "// Build helpers\n"
+     "class Version implements Comparable<Version> {\n"
+     "    int major, minor\n"
+     "    static Version parse(String s) {\n"
+     "        def parts = s.tokenize('.')\n"
+     "        return new Version(major: parts[0] as int, minor: parts[1] as int)\n"
+     "    }\n"
+     "    int compareTo(Version o) { major <=> o.major ?: minor <=> o.minor }\n"
+     "    String toString() { \"${major}.${minor}\" } /* text */\n"
+     "}\n"
+     "println Version.parse('1.2')\n"},
+    {"Prolog", LANG_PROLOG,
+     "% Family relations\n"
+     "parent(tom, bob).\n"
+     "parent(bob, ann).\n"
+     "grandparent(X, Z) :- parent(X, Y), parent(Y, Z).\n"
+     "count_children(P, N) :-\n"
+     "    findall(C, parent(P, C), Cs),\n"
+     "    length(Cs, N).\n"
+     "/* query */\n"
+     "main :- grandparent(tom, Who), format(\"~w~n\", [Who]), !.\n"},
+    {"Verilog", LANG_VERILOG,
+     "// Eight bit counter\n"
+     "module counter #(parameter WIDTH = 8) (\n"
+     "    input  wire             clk,\n"
+     "    input  wire             reset,\n"
+     "    output reg [WIDTH-1:0]  count\n"
+     ");\n"
+     "    always @(posedge clk or posedge reset) begin\n"
+     "        if (reset)\n"
+     "            count <= {WIDTH{1'b0}};\n"
+     "        else\n"
+     "            count <= count + 8'h01; /* wraps */\n"
+     "    end\n"
+     "endmodule\n"},
+    {"VHDL", LANG_VHDL,
+     "-- Eight bit counter\n"
+     "library ieee;\n"
+     "use ieee.std_logic_1164.all;\n"
+     "use ieee.numeric_std.all;\n"
+     "entity counter is\n"
+     "    port (clk, reset : in std_logic; count : out unsigned(7 downto 0));\n"
+     "end entity counter;\n"
+     "architecture rtl of counter is\n"
+     "    signal value : unsigned(7 downto 0) := (others => '0');\n"
+     "begin\n"
+     "    process (clk, reset)\n"
+     "    begin\n"
+     "        if reset = '1' then value <= (others => '0');\n"
+     "        elsif rising_edge(clk) then value <= value + 1;\n"
+     "        end if;\n"
+     "    end process;\n"
+     "    count <= value;\n"
+     "end architecture rtl;\n"},
+    {"LaTeX", LANG_LATEX,
+     "\\documentclass{article}\n"
+     "\\usepackage{amsmath}\n"
+     "% Notes on sums\n"
+     "\\begin{document}\n"
+     "\\section{Sums}\n"
+     "The sum $\\sum_{i=1}^{n} i = \\frac{n(n+1)}{2}$ holds for \\textbf{every} $n \\geq 1$.\n"
+     "\\begin{itemize}\n"
+     "  \\item see \\cite{knuth} and Section~\\ref{sec:proof}\n"
+     "\\end{itemize}\n"
+     "\\end{document}\n"},
+    {"Nginx", LANG_NGINX,
+     "# Reverse proxy\n"
+     "server {\n"
+     "    listen 443 ssl;\n"
+     "    server_name example.com;\n"
+     "    ssl_certificate /etc/ssl/example.crt;\n"
+     "    root /var/www/html;\n"
+     "    location /api/ {\n"
+     "        proxy_pass http://127.0.0.1:8080;\n"
+     "        proxy_set_header Host $host;\n"
+     "    }\n"
+     "    location / { try_files $uri $uri/ /index.html; }\n"
+     "}\n"},
+    {"Apache", LANG_APACHE,
+     "# Virtual host\n"
+     "<VirtualHost *:80>\n"
+     "    ServerName example.com\n"
+     "    DocumentRoot \"/var/www/html\"\n"
+     "    <Directory \"/var/www/html\">\n"
+     "        Options -Indexes +FollowSymLinks\n"
+     "        AllowOverride All\n"
+     "        Require all granted\n"
+     "    </Directory>\n"
+     "    RewriteEngine On\n"
+     "    RewriteRule ^/old/(.*)$ /new/$1 [R=301,L]\n"
+     "    ErrorLog ${APACHE_LOG_DIR}/error.log\n"
+     "</VirtualHost>\n"},
+    {"INI", LANG_INI,
+     "; Application settings\n"
+     "[server]\n"
+     "host = 127.0.0.1\n"
+     "port = 8080\n"
+     "debug = false\n"
+     "[database]\n"
+     "name = \"app\"\n"
+     "timeout = 30\n"},
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Highlight every line once; returns the line count */
+static size_t bench_pass(Buffer *buf, LanguageType lang, TokenRuns *runs) {
+    size_t length = buffer_get_length(buf);
+    size_t lines = 0;
+    HighlightState state = HL_STATE_NORMAL;
+
+    for (size_t pos = 0; pos < length; lines++) {
+        size_t end = buffer_line_end(buf, pos);
+        syntax_highlight_line(buf, pos, end, lang, &state, runs);
+        pos = end + 1;
+    }
+    return lines;
+}
+
+static void bench_run(const char *name, LanguageType lang, Buffer *buf) {
+    TokenRuns runs;
+    token_runs_init(&runs);
+
+    size_t bytes = buffer_get_length(buf);
+    size_t lines = 0;
+    int passes = 0;
+    double start = now_seconds();
+    double elapsed;
+    do {
+        lines += bench_pass(buf, lang, &runs);
+        passes++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    token_runs_free(&runs);
+
+    printf("%-24s %8.1f MB/s %8.1f ns/line\n", name,
+           bytes * (double)passes / elapsed / 1e6, elapsed * 1e9 / lines);
+}
+
+/* A buffer holding the sample repeated to about BENCH_CORPUS_SIZE bytes */
+static Buffer *bench_corpus(const char *text) {
+    Buffer *buf = buffer_create();
+    if (!buf) return NULL;
+
+    size_t len = strlen(text);
+    while (buffer_get_length(buf) < BENCH_CORPUS_SIZE) {
+        if (!buffer_insert_string(buf, buffer_get_length(buf), text, len)) break;
+    }
+    return buf;
+}
+
+static Buffer *bench_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    Buffer *buf = buffer_create();
+    char chunk[65536];
+    size_t n;
+    while (buf && (n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        buffer_insert_string(buf, buffer_get_length(buf), chunk, n);
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            Buffer *buf = bench_file(argv[i]);
+            if (!buf) {
+                fprintf(stderr, "%s: cannot read\n", argv[i]);
+                continue;
+            }
+            bench_run(argv[i], syntax_detect_language(argv[i]), buf);
+            buffer_destroy(buf);
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(g_samples) / sizeof(g_samples[0]); i++) {
+        Buffer *buf = bench_corpus(g_samples[i].text);
+        if (!buf) return 1;
+        bench_run(g_samples[i].name, g_samples[i].lang, buf);
+        buffer_destroy(buf);
+    }
+    return 0;
+}
@@ -30,6 +30,22 @@
 #define MAX_FILENAME 4096
 #define TAB_WIDTH 2
 #define PANEL_WIDTH 30
+#define MIN_GUTTER_DIGITS 3
+#define MAX_ROW_CELLS 1024     /* Widest screen row the renderer draws */
+#define DEFAULT_FRAME_INTERVAL_MS 16  /* Minimum time between redraws while keys arrive */
+#define STATUS_MESSAGE_SECONDS 3      /* How long status bar messages stay visible */
+#define JOBS_MAX_WORKERS 8            /* Upper bound on background worker threads */
+#define FILE_READ_CHUNK (64 * 1024)   /* Bytes read per call from files that can't be mapped */
+#define FILE_ASYNC_MIN (32 * 1024 * 1024)   /* Files this large load in the background */
+#define FILE_LOAD_CHUNK (4 * 1024 * 1024)   /* Bytes a background load adds per step */
+#define SEARCH_CHUNK (64 * 1024)      /* Bytes of text a search scans per step */
+#define SEARCH_JOB_CHUNK (4 * 1024 * 1024)  /* Bytes a background search reads per step */
+
+/* Flush saved files to disk before they replace the original; build with
+ * -DSAVE_FSYNC=0 to trade crash safety for speed */
+#ifndef SAVE_FSYNC
+#define SAVE_FSYNC 1
+#endif
 
 /* Undo stack size */
 #define MAX_UNDO_LEVELS 16384
@@ -98,9 +114,14 @@ struct Dialog;
 
 /* Include component headers - order matters for dependencies */
 #include "buffer.h"
+#include "paged.h"
 #include "undo.h"
 #include "clipboard.h"
 #include "syntax.h"
+#include "highlight.h"
+#include "column.h"
+#include "unicode.h"
+#include "wrap.h"
 #include "editor.h"
 #include "smenu.h"
 #include "display.h"
@@ -109,5 +130,7 @@ struct Dialog;
 #include "file.h"
 #include "input.h"
 #include "explorer.h"
+#include "event.h"
+#include "jobs.h"
 
 #endif /* SMASHEDIT_H */
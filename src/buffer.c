@@ -14,26 +14,160 @@ Buffer *buffer_create(void) {
     buf->gap_start = 0;
     buf->gap_end = buf->size;
     buf->length = 0;
+    buf->line_count = 1;
+    buf->version = 0;
+    buf->paged = NULL;
+    buf->listener_count = 0;
 
     return buf;
 }
 
 void buffer_destroy(Buffer *buf) {
     if (buf) {
+        paged_close(buf->paged);
         free(buf->data);
         free(buf);
     }
 }
 
+bool buffer_add_listener(Buffer *buf, BufferChangeFn fn, void *ctx) {
+    if (!buf || !fn || buf->listener_count >= MAX_BUFFER_LISTENERS) return false;
+
+    buf->listeners[buf->listener_count].fn = fn;
+    buf->listeners[buf->listener_count].ctx = ctx;
+    buf->listener_count++;
+    return true;
+}
+
+void buffer_remove_listener(Buffer *buf, BufferChangeFn fn, void *ctx) {
+    if (!buf) return;
+
+    for (int i = 0; i < buf->listener_count; i++) {
+        if (buf->listeners[i].fn == fn && buf->listeners[i].ctx == ctx) {
+            buf->listeners[i] = buf->listeners[buf->listener_count - 1];
+            buf->listener_count--;
+            return;
+        }
+    }
+}
+
+/* Bump the version and tell listeners about an edit */
+static void notify_change(Buffer *buf, size_t pos, size_t removed, size_t inserted,
+                          size_t lines_removed, size_t lines_inserted) {
+    buf->version++;
+    if (buf->listener_count == 0) return;
+
+    BufferChange change = {pos, removed, inserted, lines_removed, lines_inserted};
+    for (int i = 0; i < buf->listener_count; i++) {
+        buf->listeners[i].fn(buf->listeners[i].ctx, &change);
+    }
+}
+
 void buffer_clear(Buffer *buf) {
     if (!buf) return;
+
+    size_t old_length = buf->length;
+    size_t old_lines = buffer_count_lines(buf) - 1;
+
+    paged_close(buf->paged);
+    buf->paged = NULL;
     buf->gap_start = 0;
     buf->gap_end = buf->size;
     buf->length = 0;
+    buf->line_count = 1;
+
+    notify_change(buf, 0, old_length, 0, old_lines, 0);
+}
+
+/* Count newlines in raw memory */
+static size_t count_newlines_raw(const char *p, size_t len) {
+    size_t count = 0;
+    const char *end = p + len;
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        count++;
+        p++;
+    }
+    return count;
+}
+
+/* Count newlines in [start, end) by scanning the segments on either side of the gap */
+static size_t count_newlines(Buffer *buf, size_t start, size_t end) {
+    size_t count = 0;
+    if (start < buf->gap_start) {
+        size_t seg_end = end < buf->gap_start ? end : buf->gap_start;
+        count += count_newlines_raw(buf->data + start, seg_end - start);
+        start = seg_end;
+    }
+    if (start < end) {
+        size_t offset = buf->gap_end - buf->gap_start;
+        count += count_newlines_raw(buf->data + start + offset, end - start);
+    }
+    return count;
+}
+
+/* Copy [start, end) to dst */
+static void buffer_copy_out(Buffer *buf, size_t start, size_t end, char *dst) {
+    if (buf->paged) {
+        while (start < end) {
+            size_t len;
+            const char *p = paged_span(buf->paged, start, &len);
+            if (!p) {
+                memset(dst, 0, end - start);
+                return;
+            }
+            if (len > end - start) len = end - start;
+            memcpy(dst, p, len);
+            dst += len;
+            start += len;
+        }
+        return;
+    }
+
+    /* The parts before and after the gap */
+    size_t len = end - start;
+    size_t copied = 0;
+    if (start < buf->gap_start) {
+        size_t before = (end < buf->gap_start ? end : buf->gap_start) - start;
+        memcpy(dst, buf->data + start, before);
+        copied = before;
+    }
+    if (copied < len) {
+        size_t from = start + copied - buf->gap_start;
+        memcpy(dst + copied, buf->data + buf->gap_end + from, len - copied);
+    }
+}
+
+/* Read-only copy of [start, end) that other threads can read while the
+ * original keeps changing; offsets in the copy are relative to start */
+Buffer *buffer_snapshot(Buffer *buf, size_t start, size_t end) {
+    if (!buf || start > end || end > buf->length) return NULL;
+
+    Buffer *snap = malloc(sizeof(Buffer));
+    if (!snap) return NULL;
+
+    size_t len = end - start;
+    snap->data = malloc(len + 1);
+    if (!snap->data) {
+        free(snap);
+        return NULL;
+    }
+
+    buffer_copy_out(buf, start, end, snap->data);
+
+    snap->size = len;
+    snap->gap_start = len;
+    snap->gap_end = len;
+    snap->length = len;
+    snap->line_count = count_newlines_raw(snap->data, len) + 1;
+    snap->version = buf->version;
+    snap->paged = NULL;
+    snap->listener_count = 0;
+
+    return snap;
 }
 
 void buffer_move_gap(Buffer *buf, size_t pos) {
-    if (!buf || pos > buf->length) return;
+    if (!buf || buf->paged || pos > buf->length) return;
 
     size_t gap_size = buf->gap_end - buf->gap_start;
 
@@ -53,7 +187,7 @@ void buffer_move_gap(Buffer *buf, size_t pos) {
 }
 
 bool buffer_expand(Buffer *buf, size_t needed) {
-    if (!buf) return false;
+    if (!buf || buf->paged) return false;
 
     size_t gap_size = buf->gap_end - buf->gap_start;
     if (gap_size >= needed) return true;
@@ -82,12 +216,16 @@ bool buffer_expand(Buffer *buf, size_t needed) {
 
 bool buffer_insert_char(Buffer *buf, size_t pos, char c) {
     if (!buf || pos > buf->length) return false;
+    if (buf->paged) return buffer_insert_string(buf, pos, &c, 1);
 
     if (!buffer_expand(buf, 1)) return false;
 
     buffer_move_gap(buf, pos);
     buf->data[buf->gap_start++] = c;
     buf->length++;
+    if (c == '\n') buf->line_count++;
+
+    notify_change(buf, pos, 0, 1, 0, c == '\n' ? 1 : 0);
 
     return true;
 }
@@ -95,6 +233,14 @@ bool buffer_insert_char(Buffer *buf, size_t pos, char c) {
 bool buffer_insert_string(Buffer *buf, size_t pos, const char *str, size_t len) {
     if (!buf || !str || pos > buf->length) return false;
 
+    if (buf->paged) {
+        if (!paged_insert(buf->paged, pos, str, len)) return false;
+        size_t lines = count_newlines_raw(str, len);
+        buf->length += len;
+        notify_change(buf, pos, 0, len, 0, lines);
+        return true;
+    }
+
     if (!buffer_expand(buf, len)) return false;
 
     buffer_move_gap(buf, pos);
@@ -102,16 +248,49 @@ bool buffer_insert_string(Buffer *buf, size_t pos, const char *str, size_t len)
     buf->gap_start += len;
     buf->length += len;
 
+    size_t lines = count_newlines_raw(str, len);
+    buf->line_count += lines;
+
+    notify_change(buf, pos, 0, len, 0, lines);
+
+    return true;
+}
+
+char *buffer_reserve(Buffer *buf, size_t pos, size_t len) {
+    if (!buf || pos > buf->length) return NULL;
+
+    if (!buffer_expand(buf, len)) return NULL;
+
+    buffer_move_gap(buf, pos);
+    return buf->data + buf->gap_start;
+}
+
+bool buffer_commit(Buffer *buf, size_t len) {
+    if (!buf || buf->paged || len > buf->gap_end - buf->gap_start) return false;
+
+    size_t pos = buf->gap_start;
+    size_t lines = count_newlines_raw(buf->data + pos, len);
+    buf->gap_start += len;
+    buf->length += len;
+    buf->line_count += lines;
+
+    notify_change(buf, pos, 0, len, 0, lines);
+
     return true;
 }
 
 bool buffer_delete_char(Buffer *buf, size_t pos) {
     if (!buf || pos >= buf->length) return false;
+    if (buf->paged) return buffer_delete_range(buf, pos, pos + 1);
 
     buffer_move_gap(buf, pos);
+    bool newline = buf->data[buf->gap_end] == '\n';
+    if (newline) buf->line_count--;
     buf->gap_end++;
     buf->length--;
 
+    notify_change(buf, pos, 1, 0, newline ? 1 : 0, 0);
+
     return true;
 }
 
@@ -120,15 +299,37 @@ bool buffer_delete_range(Buffer *buf, size_t start, size_t end) {
         return false;
     }
 
+    if (buf->paged) {
+        size_t lines;
+        if (!paged_delete(buf->paged, start, end, &lines)) return false;
+        buf->length -= end - start;
+        notify_change(buf, start, end - start, 0, lines, 0);
+        return true;
+    }
+
+    size_t lines = count_newlines(buf, start, end);
+    buf->line_count -= lines;
     buffer_move_gap(buf, start);
     buf->gap_end += (end - start);
     buf->length -= (end - start);
 
+    notify_change(buf, start, end - start, 0, lines, 0);
+
     return true;
 }
 
+void buffer_attach_paged(Buffer *buf, PagedFile *pf) {
+    if (!buf || !pf) return;
+
+    buffer_clear(buf);
+    buf->paged = pf;
+    buf->length = paged_length(pf);
+    notify_change(buf, 0, 0, buf->length, 0, buffer_count_lines(buf) - 1);
+}
+
 char buffer_get_char(Buffer *buf, size_t pos) {
     if (!buf || pos >= buf->length) return '\0';
+    if (buf->paged) return paged_get_char(buf->paged, pos);
 
     if (pos < buf->gap_start) {
         return buf->data[pos];
@@ -148,19 +349,60 @@ char *buffer_get_range(Buffer *buf, size_t start, size_t end) {
     char *result = malloc(len + 1);
     if (!result) return NULL;
 
-    for (size_t i = 0; i < len; i++) {
-        result[i] = buffer_get_char(buf, start + i);
-    }
+    buffer_copy_out(buf, start, end, result);
     result[len] = '\0';
 
     return result;
 }
 
+/* Contiguous view of [start, end): points into the buffer unless the range
+ * straddles the gap, in which case it is copied into scratch (end - start bytes).
+ * With a NULL scratch a straddling range returns NULL. */
+const char *buffer_get_span(Buffer *buf, size_t start, size_t end, char *scratch) {
+    if (!buf || start >= end || end > buf->length) return NULL;
+
+    if (buf->paged) {
+        size_t len;
+        const char *p = paged_span(buf->paged, start, &len);
+        if (p && len >= end - start) return p;
+        if (!scratch) return NULL;
+        buffer_copy_out(buf, start, end, scratch);
+        return scratch;
+    }
+
+    if (end <= buf->gap_start) {
+        return buf->data + start;
+    }
+    size_t gap = buf->gap_end - buf->gap_start;
+    if (start >= buf->gap_start) {
+        return buf->data + start + gap;
+    }
+
+    if (!scratch) return NULL;
+    size_t before = buf->gap_start - start;
+    memcpy(scratch, buf->data + start, before);
+    memcpy(scratch + before, buf->data + buf->gap_end, end - buf->gap_start);
+    return scratch;
+}
+
 char *buffer_to_string(Buffer *buf) {
     if (!buf) return NULL;
     return buffer_get_range(buf, 0, buf->length);
 }
 
+void buffer_get_segments(Buffer *buf, const char **first, size_t *first_len,
+                         const char **second, size_t *second_len) {
+    if (buf->paged) {
+        *first = *second = NULL;
+        *first_len = *second_len = 0;
+        return;
+    }
+    *first = buf->data;
+    *first_len = buf->gap_start;
+    *second = buf->data + buf->gap_end;
+    *second_len = buf->size - buf->gap_end;
+}
+
 size_t buffer_line_start(Buffer *buf, size_t pos) {
     if (!buf || buf->length == 0) return 0;
     if (pos > buf->length) pos = buf->length;
@@ -201,20 +443,14 @@ size_t buffer_prev_line(Buffer *buf, size_t pos) {
 }
 
 size_t buffer_count_lines(Buffer *buf) {
-    if (!buf || buf->length == 0) return 1;
-
-    size_t count = 1;
-    for (size_t i = 0; i < buf->length; i++) {
-        if (buffer_get_char(buf, i) == '\n') {
-            count++;
-        }
-    }
-    return count;
+    if (buf && buf->paged) return paged_line_count(buf->paged);
+    return buf ? buf->line_count : 1;
 }
 
 size_t buffer_get_line_number(Buffer *buf, size_t pos) {
     if (!buf) return 1;
     if (pos > buf->length) pos = buf->length;
+    if (buf->paged) return paged_newlines_before(buf->paged, pos) + 1;
 
     size_t line = 1;
     for (size_t i = 0; i < pos; i++) {
@@ -227,6 +463,7 @@ size_t buffer_get_line_number(Buffer *buf, size_t pos) {
 
 size_t buffer_get_line_start(Buffer *buf, size_t line) {
     if (!buf || line < 1) return 0;
+    if (buf->paged) return paged_newline_end(buf->paged, line - 1);
 
     size_t current_line = 1;
     size_t pos = 0;
@@ -4,6 +4,28 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+/* Forward declarations */
+typedef struct PagedFile PagedFile;
+
+/* Description of a single edit, passed to change listeners */
+typedef struct BufferChange {
+    size_t pos;             /* Offset where the edit happened */
+    size_t removed;         /* Bytes removed at pos */
+    size_t inserted;        /* Bytes inserted at pos */
+    size_t lines_removed;   /* Newlines among the removed bytes */
+    size_t lines_inserted;  /* Newlines among the inserted bytes */
+} BufferChange;
+
+/* Change listener - called after every edit */
+typedef void (*BufferChangeFn)(void *ctx, const BufferChange *change);
+
+#define MAX_BUFFER_LISTENERS 8
+
+typedef struct BufferListener {
+    BufferChangeFn fn;
+    void *ctx;
+} BufferListener;
+
 /* Gap buffer for efficient text editing */
 typedef struct Buffer {
     char *data;           /* Buffer data */
@@ -11,12 +33,24 @@ typedef struct Buffer {
     size_t gap_start;     /* Start of gap */
     size_t gap_end;       /* End of gap (exclusive) */
     size_t length;        /* Actual text length (size - gap_size) */
+    size_t line_count;    /* Number of lines (newlines + 1), maintained on edit */
+    unsigned long version; /* Incremented on every edit */
+    PagedFile *paged;     /* Large file read in place; the gap fields are unused */
+
+    /* Change notification */
+    BufferListener listeners[MAX_BUFFER_LISTENERS];
+    int listener_count;
 } Buffer;
 
 /* Buffer operations */
 Buffer *buffer_create(void);
 void buffer_destroy(Buffer *buf);
 void buffer_clear(Buffer *buf);
+Buffer *buffer_snapshot(Buffer *buf, size_t start, size_t end);
+
+/* Change notification */
+bool buffer_add_listener(Buffer *buf, BufferChangeFn fn, void *ctx);
+void buffer_remove_listener(Buffer *buf, BufferChangeFn fn, void *ctx);
 
 /* Text operations */
 bool buffer_insert_char(Buffer *buf, size_t pos, char c);
@@ -24,11 +58,22 @@ bool buffer_insert_string(Buffer *buf, size_t pos, const char *str, size_t len);
 bool buffer_delete_char(Buffer *buf, size_t pos);
 bool buffer_delete_range(Buffer *buf, size_t start, size_t end);
 
+/* Room for len bytes at pos, written in place and then added with buffer_commit */
+char *buffer_reserve(Buffer *buf, size_t pos, size_t len);
+bool buffer_commit(Buffer *buf, size_t len);
+
+/* Show a large file in place of the contents; the buffer owns it from then on */
+void buffer_attach_paged(Buffer *buf, PagedFile *pf);
+
 /* Access */
 char buffer_get_char(Buffer *buf, size_t pos);
 size_t buffer_get_length(Buffer *buf);
 char *buffer_get_range(Buffer *buf, size_t start, size_t end);
+const char *buffer_get_span(Buffer *buf, size_t start, size_t end, char *scratch);
 char *buffer_to_string(Buffer *buf);
+/* The text as it is stored: [0, first_len) then the rest, either side of the gap */
+void buffer_get_segments(Buffer *buf, const char **first, size_t *first_len,
+                         const char **second, size_t *second_len);
 
 /* Line operations */
 size_t buffer_line_start(Buffer *buf, size_t pos);
@@ -0,0 +1,269 @@
+#include "smashedit.h"
+#include <stdint.h>
+
+/* Indexed lines */
+
+static void column_line_drop(ColumnIndex *index, int i) {
+    free(index->lines[i].points);
+    index->lines[i] = index->lines[index->count - 1];
+    index->count--;
+}
+
+static ColumnLine *column_line_find(ColumnIndex *index, size_t line_start) {
+    for (int i = 0; i < index->count; i++) {
+        if (index->lines[i].start == line_start) {
+            index->lines[i].used = ++index->clock;
+            return &index->lines[i];
+        }
+    }
+    return NULL;
+}
+
+/* Indexed line containing pos, if any */
+static ColumnLine *column_line_containing(ColumnIndex *index, size_t pos) {
+    for (int i = 0; i < index->count; i++) {
+        if (index->lines[i].start <= pos && pos <= index->lines[i].end) {
+            index->lines[i].used = ++index->clock;
+            return &index->lines[i];
+        }
+    }
+    return NULL;
+}
+
+/* Start indexing a line, replacing the least recently used one when full;
+ * pos is any offset on the line to scan for its end from */
+static ColumnLine *column_line_add(ColumnIndex *index, size_t line_start, size_t pos) {
+    ColumnPoint *points = malloc(64 * sizeof(ColumnPoint));
+    if (!points) return NULL;
+
+    if (index->count == COLUMN_INDEX_LINES) {
+        int oldest = 0;
+        for (int i = 1; i < index->count; i++) {
+            if (index->lines[i].used < index->lines[oldest].used) oldest = i;
+        }
+        column_line_drop(index, oldest);
+    }
+
+    ColumnLine *line = &index->lines[index->count++];
+    line->start = line_start;
+    line->end = buffer_line_end(index->buffer, pos);
+    line->points = points;
+    line->points[0].offset = 0;
+    line->points[0].col = 1;
+    line->count = 1;
+    line->capacity = 64;
+    line->used = ++index->clock;
+    return line;
+}
+
+/* Keep a checkpoint once the walk is an interval past the last one */
+static void column_line_record(ColumnLine *line, const ColumnPoint *at) {
+    if (at->offset < line->points[line->count - 1].offset + COLUMN_INTERVAL) return;
+
+    if (line->count == line->capacity) {
+        size_t new_capacity = line->capacity * 2;
+        ColumnPoint *grown = realloc(line->points, new_capacity * sizeof(ColumnPoint));
+        if (!grown) return;  /* Lookups just walk further */
+        line->points = grown;
+        line->capacity = new_capacity;
+    }
+    line->points[line->count++] = *at;
+}
+
+/* Walk a line from at, expanding tabs and decoding UTF-8, until the offset
+ * reaches stop_offset, the column reaches stop_col or the line ends.
+ * Checkpoints are recorded when line is given. */
+static void column_walk(ColumnIndex *index, ColumnLine *line, size_t line_start,
+                        ColumnPoint *at, size_t stop_offset, size_t stop_col) {
+    Buffer *buf = index->buffer;
+    size_t buf_len = buffer_get_length(buf);
+
+    while (at->offset < stop_offset && at->col < stop_col) {
+        size_t i = line_start + at->offset;
+        if (i >= buf_len) break;
+
+        char c = buffer_get_char(buf, i);
+        if (c == '\n') break;
+
+        /* Printable ASCII is one column per byte - count it in bulk */
+        if (c >= 0x20 && c < 0x7F) {
+            size_t want = stop_offset - at->offset;
+            if (stop_col - at->col < want) want = stop_col - at->col;
+            if (want > COLUMN_ASCII_CHUNK) want = COLUMN_ASCII_CHUNK;
+            if (want > buf_len - i) want = buf_len - i;
+
+            char scratch[COLUMN_ASCII_CHUNK];
+            const char *span = want > 1 ? buffer_get_span(buf, i, i + want, scratch) : NULL;
+            size_t n = span ? unicode_ascii_run(span, want) : 1;
+
+            at->col += n;
+            at->offset += n;
+            if (line) column_line_record(line, at);
+            continue;
+        }
+
+        if (c == '\t') {
+            at->col += TAB_WIDTH - ((at->col - 1) % TAB_WIDTH);
+            at->offset++;
+        } else {
+            wchar_t wc;
+            int char_bytes = unicode_decode(buf, i, buf_len, &wc);
+            at->col += unicode_width(wc);
+            at->offset += char_bytes;
+        }
+
+        if (line) column_line_record(line, at);
+    }
+}
+
+/* Last checkpoint at or before a line offset */
+static ColumnPoint column_point_by_offset(const ColumnLine *line, size_t offset) {
+    size_t lo = 0, hi = line->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (line->points[mid].offset <= offset) lo = mid;
+        else hi = mid;
+    }
+    return line->points[lo];
+}
+
+/* Last checkpoint before a column. Zero-width characters can share a column,
+ * so a checkpoint exactly at col may not be the first position reaching it. */
+static ColumnPoint column_point_by_col(const ColumnLine *line, size_t col) {
+    size_t lo = 0, hi = line->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (line->points[mid].col < col) lo = mid;
+        else hi = mid;
+    }
+    return line->points[lo];
+}
+
+/* Buffer change listener: edits inside a line keep the checkpoints before the
+ * edit, edits before it shift it, and anything touching a newline drops it */
+static void column_on_change(void *ctx, const BufferChange *change) {
+    ColumnIndex *index = ctx;
+    size_t edit_end = change->pos + change->removed;
+    bool lines_changed = change->lines_removed > 0 || change->lines_inserted > 0;
+
+    for (int i = index->count - 1; i >= 0; i--) {
+        ColumnLine *line = &index->lines[i];
+
+        if (change->pos > line->end) continue;
+
+        if (change->pos < line->start) {
+            if (edit_end >= line->start) {
+                column_line_drop(index, i);  /* Joined with the previous line */
+            } else {
+                line->start = line->start - change->removed + change->inserted;
+                line->end = line->end - change->removed + change->inserted;
+            }
+            continue;
+        }
+
+        if (lines_changed) {
+            column_line_drop(index, i);
+            continue;
+        }
+
+        /* A checkpoint depends on the bytes before it plus the tail of the
+         * UTF-8 sequence that may straddle it */
+        size_t rel = change->pos - line->start;
+        size_t kept = 1;
+        while (kept < line->count && line->points[kept].offset + 4 <= rel) {
+            kept++;
+        }
+        line->count = kept;
+        line->end = line->end - change->removed + change->inserted;
+    }
+}
+
+/* Lifecycle */
+
+ColumnIndex *column_index_create(Buffer *buf) {
+    ColumnIndex *index = malloc(sizeof(ColumnIndex));
+    if (!index) return NULL;
+
+    index->buffer = buf;
+    index->count = 0;
+    index->clock = 0;
+
+    buffer_add_listener(buf, column_on_change, index);
+
+    return index;
+}
+
+void column_index_destroy(ColumnIndex *index) {
+    if (index) {
+        buffer_remove_listener(index->buffer, column_on_change, index);
+        for (int i = 0; i < index->count; i++) {
+            free(index->lines[i].points);
+        }
+        free(index);
+    }
+}
+
+/* Queries */
+
+size_t column_from_pos(ColumnIndex *index, size_t pos) {
+    if (!index) return 1;
+
+    size_t buf_len = buffer_get_length(index->buffer);
+    if (pos > buf_len) pos = buf_len;
+
+    ColumnLine *line = column_line_containing(index, pos);
+    size_t line_start = line ? line->start : buffer_line_start(index->buffer, pos);
+
+    if (!line && pos - line_start >= COLUMN_MIN_LINE) {
+        line = column_line_add(index, line_start, pos);
+    }
+
+    ColumnPoint at = {0, 1};
+    if (line) {
+        at = column_point_by_offset(line, pos - line_start);
+    }
+    column_walk(index, line, line_start, &at, pos - line_start, SIZE_MAX);
+
+    return at.col;
+}
+
+size_t column_to_pos(ColumnIndex *index, size_t line_start, size_t col, size_t *found_col) {
+    ColumnPoint at = {0, 1};
+    if (!index) {
+        if (found_col) *found_col = at.col;
+        return line_start;
+    }
+
+    ColumnLine *line = column_line_find(index, line_start);
+
+    /* Short lines never get indexed; a walk that runs past the limit does */
+    if (!line) {
+        column_walk(index, NULL, line_start, &at, COLUMN_MIN_LINE, col);
+        if (at.offset >= COLUMN_MIN_LINE && at.col < col) {
+            line = column_line_add(index, line_start, line_start + at.offset);
+        }
+    }
+
+    if (line) {
+        at = column_point_by_col(line, col);
+        column_walk(index, line, line_start, &at, SIZE_MAX, col);
+    }
+
+    /* Never stop between a character and the marks drawn on it */
+    size_t buf_len = buffer_get_length(index->buffer);
+    while (at.offset > 0) {
+        wchar_t wc;
+        int len = unicode_decode(index->buffer, line_start + at.offset, buf_len, &wc);
+        if (len == 0 || !unicode_is_mark(wc)) break;
+        at.offset += len;
+    }
+
+    if (found_col) *found_col = at.col;
+    return line_start + at.offset;
+}
+
+size_t column_line_end(ColumnIndex *index, size_t line_start, size_t pos) {
+    ColumnLine *line = index ? column_line_find(index, line_start) : NULL;
+    if (line) return line->end;
+    return index ? buffer_line_end(index->buffer, pos) : pos;
+}
@@ -0,0 +1,61 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Forward declarations */
+typedef struct Buffer Buffer;
+
+/* Lines shorter than this are walked from the line start every time */
+#define COLUMN_MIN_LINE (16 * 1024)
+
+/* Bytes between sampled checkpoints on an indexed line */
+#define COLUMN_INTERVAL 4096
+
+/* Bytes of printable ASCII counted per step of a walk */
+#define COLUMN_ASCII_CHUNK 256
+
+/* Long lines indexed at once (about a screenful) */
+#define COLUMN_INDEX_LINES 64
+
+/* Visual column (1-based) at a character boundary of a line */
+typedef struct ColumnPoint {
+    size_t offset;          /* Byte offset from the line start */
+    size_t col;             /* Column of the character starting there */
+} ColumnPoint;
+
+/* Sampled checkpoints of one long line, extended lazily as far as asked */
+typedef struct ColumnLine {
+    size_t start;           /* Offset of the line start */
+    size_t end;             /* Offset of the newline or buffer end */
+    ColumnPoint *points;    /* Ascending; points[0] is always {0, 1} */
+    size_t count;
+    size_t capacity;
+    unsigned long used;     /* Last lookup, for replacement */
+} ColumnLine;
+
+/* Per-buffer column index. Edits inside a line keep the checkpoints before
+ * the edit; edits that split or join lines drop the line. */
+typedef struct ColumnIndex {
+    Buffer *buffer;
+    ColumnLine lines[COLUMN_INDEX_LINES];
+    int count;
+    unsigned long clock;
+} ColumnIndex;
+
+/* Lifecycle */
+ColumnIndex *column_index_create(Buffer *buf);
+void column_index_destroy(ColumnIndex *index);
+
+/* Visual column (1-based) of a buffer position */
+size_t column_from_pos(ColumnIndex *index, size_t pos);
+
+/* First position on the line starting at line_start whose column is at least
+ * col, or the line end; optionally returns the column found there */
+size_t column_to_pos(ColumnIndex *index, size_t line_start, size_t col, size_t *found_col);
+
+/* End of the line starting at line_start, scanning from pos when the line is not indexed */
+size_t column_line_end(ColumnIndex *index, size_t line_start, size_t pos);
+
+#endif /* COLUMN_H */
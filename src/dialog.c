@@ -22,6 +22,7 @@ static void draw_box_char_dialog(int y, int x, chtype acs_char, wchar_t unicode_
 }
 
 void dialog_draw_box(int y, int x, int height, int width, const char *title) {
+    display_invalidate();
     attron(COLOR_PAIR(COLOR_DIALOG));
 
     /* Fill background */
@@ -74,6 +75,54 @@ static void draw_button(int y, int x, const char *label, bool selected) {
     }
 }
 
+/* Input fields hold UTF-8 - move the cursor by whole characters */
+static int field_prev_char(const char *text, int pos) {
+    if (pos <= 0) return 0;
+    pos--;
+    while (pos > 0 && ((unsigned char)text[pos] & 0xC0) == 0x80) pos--;
+    return pos;
+}
+
+static int field_next_char(const char *text, int pos) {
+    int len = strlen(text);
+    if (pos >= len) return len;
+    pos++;
+    while (pos < len && ((unsigned char)text[pos] & 0xC0) == 0x80) pos++;
+    return pos;
+}
+
+/* Screen columns used by text[from..to) - wide characters take two,
+ * combining marks none */
+static int field_columns(const char *text, int from, int to) {
+    int cols = 0;
+    mbstate_t state;
+    memset(&state, 0, sizeof(state));
+
+    int i = from;
+    while (i < to) {
+        wchar_t wc;
+        size_t n = mbrtowc(&wc, text + i, to - i, &state);
+        if (n == (size_t)-1 || n == (size_t)-2 || n == 0) {
+            wc = L'?';
+            n = 1;
+            memset(&state, 0, sizeof(state));
+        }
+
+        cols += wc < 32 ? 1 : unicode_width(wc);
+        i += (int)n;
+    }
+    return cols;
+}
+
+/* First byte shown so the cursor stays inside a field of the given width */
+static int field_scroll_start(const char *text, int cursor_pos, int width) {
+    int start = 0;
+    while (start < cursor_pos && field_columns(text, start, cursor_pos) >= width - 1) {
+        start = field_next_char(text, start);
+    }
+    return start;
+}
+
 static void draw_input_field(int y, int x, int width, const char *text, int cursor_pos, bool active) {
     if (active) {
         attron(COLOR_PAIR(COLOR_MENUSEL));
@@ -86,16 +135,12 @@ static void draw_input_field(int y, int x, int width, const char *text, int curs
         addch(' ');
     }
 
-    int start = 0;
-    if (cursor_pos >= width - 1) {
-        start = cursor_pos - width + 2;
-    }
-    (void)strlen(text);  /* Text length used implicitly via mvprintw */
+    int start = field_scroll_start(text, cursor_pos, width);
 
     mvprintw(y, x, "%s", text + start);
 
     if (active) {
-        int screen_cursor = cursor_pos - start;
+        int screen_cursor = field_columns(text, start, cursor_pos);
         move(y, x + screen_cursor);
         curs_set(1);
     }
@@ -145,11 +190,8 @@ DialogResult dialog_input(Editor *ed, const char *title, const char *prompt,
 
         if (in_input) {
             /* Reposition cursor in input field after drawing buttons */
-            int start = 0;
-            if (cursor_pos >= input_width - 1) {
-                start = cursor_pos - input_width + 2;
-            }
-            int screen_cursor = cursor_pos - start;
+            int start = field_scroll_start(buffer, cursor_pos, input_width);
+            int screen_cursor = field_columns(buffer, start, cursor_pos);
             move(dialog_y + 3, dialog_x + 3 + screen_cursor);
             curs_set(2);
         } else {
@@ -158,7 +200,7 @@ DialogResult dialog_input(Editor *ed, const char *title, const char *prompt,
 
         refresh();
 
-        int key = getch();
+        int key = input_get_key();
 
         if (in_input) {
             if (key == '\t' || key == KEY_DOWN) {
@@ -170,31 +212,36 @@ DialogResult dialog_input(Editor *ed, const char *title, const char *prompt,
                 return DIALOG_CANCEL;
             } else if (key == KEY_BACKSPACE || key == 127 || key == 8) {
                 if (cursor_pos > 0) {
-                    memmove(buffer + cursor_pos - 1, buffer + cursor_pos,
+                    int prev = field_prev_char(buffer, cursor_pos);
+                    memmove(buffer + prev, buffer + cursor_pos,
                             strlen(buffer) - cursor_pos + 1);
-                    cursor_pos--;
+                    cursor_pos = prev;
                 }
             } else if (key == KEY_DC) {
                 int len = strlen(buffer);
                 if (cursor_pos < len) {
-                    memmove(buffer + cursor_pos, buffer + cursor_pos + 1,
-                            len - cursor_pos);
+                    int next = field_next_char(buffer, cursor_pos);
+                    memmove(buffer + cursor_pos, buffer + next,
+                            len - next + 1);
                 }
             } else if (key == KEY_LEFT) {
-                if (cursor_pos > 0) cursor_pos--;
+                cursor_pos = field_prev_char(buffer, cursor_pos);
             } else if (key == KEY_RIGHT) {
-                if ((size_t)cursor_pos < strlen(buffer)) cursor_pos++;
+                cursor_pos = field_next_char(buffer, cursor_pos);
             } else if (key == KEY_HOME) {
                 cursor_pos = 0;
             } else if (key == KEY_END) {
                 cursor_pos = strlen(buffer);
-            } else if (key >= 32 && key < 127) {
+            } else if ((key >= 32 && key < 127) || (key >= 0x80 && key <= 0xFF)) {
+                /* Insert a whole character - UTF-8 sequences are read in one go */
+                char utf8[4] = {(char)key};
+                int char_len = key < 0x80 ? 1 : input_read_utf8(key, utf8);
                 int len = strlen(buffer);
-                if ((size_t)len < buffer_size - 1) {
-                    memmove(buffer + cursor_pos + 1, buffer + cursor_pos,
+                if (char_len > 0 && (size_t)(len + char_len) < buffer_size) {
+                    memmove(buffer + cursor_pos + char_len, buffer + cursor_pos,
                             len - cursor_pos + 1);
-                    buffer[cursor_pos] = key;
-                    cursor_pos++;
+                    memcpy(buffer + cursor_pos, utf8, char_len);
+                    cursor_pos += char_len;
                 }
             }
         } else {
@@ -253,7 +300,7 @@ DialogResult dialog_confirm(Editor *ed, const char *title, const char *message)
 
         refresh();
 
-        int key = getch();
+        int key = input_get_key();
 
         if (key == KEY_LEFT) {
             if (button_selected > 0) button_selected--;
@@ -308,7 +355,7 @@ void dialog_message(Editor *ed, const char *title, const char *message) {
 
     /* Wait for key */
     while (1) {
-        int key = getch();
+        int key = input_get_key();
         if (key == '\n' || key == '\r' || key == KEY_ENTER || key == 27 || key == ' ') {
             break;
         }
@@ -384,11 +431,9 @@ DialogResult dialog_replace(Editor *ed, char *search_term, size_t search_size,
             /* Reposition cursor in active input field after drawing buttons */
             int *current_cursor = (active_field == 0) ? &search_cursor : &replace_cursor;
             int field_y = (active_field == 0) ? dialog_y + 2 : dialog_y + 4;
-            int start = 0;
-            if (*current_cursor >= input_width - 1) {
-                start = *current_cursor - input_width + 2;
-            }
-            int screen_cursor = *current_cursor - start;
+            char *current_buffer = (active_field == 0) ? search_term : replace_term;
+            int start = field_scroll_start(current_buffer, *current_cursor, input_width);
+            int screen_cursor = field_columns(current_buffer, start, *current_cursor);
             move(field_y, dialog_x + 15 + screen_cursor);
             curs_set(2);
         } else {
@@ -397,7 +442,7 @@ DialogResult dialog_replace(Editor *ed, char *search_term, size_t search_size,
 
         refresh();
 
-        int key = getch();
+        int key = input_get_key();
         char *current_buffer = (active_field == 0) ? search_term : replace_term;
         int *current_cursor = (active_field == 0) ? &search_cursor : &replace_cursor;
         size_t current_size = (active_field == 0) ? search_size : replace_size;
@@ -416,15 +461,16 @@ DialogResult dialog_replace(Editor *ed, char *search_term, size_t search_size,
         } else if (active_field < 2) {
             if (key == KEY_BACKSPACE || key == 127 || key == 8) {
                 if (*current_cursor > 0) {
-                    memmove(current_buffer + *current_cursor - 1,
+                    int prev = field_prev_char(current_buffer, *current_cursor);
+                    memmove(current_buffer + prev,
                             current_buffer + *current_cursor,
                             strlen(current_buffer) - *current_cursor + 1);
-                    (*current_cursor)--;
+                    *current_cursor = prev;
                 }
             } else if (key == KEY_LEFT) {
-                if (*current_cursor > 0) (*current_cursor)--;
+                *current_cursor = field_prev_char(current_buffer, *current_cursor);
             } else if (key == KEY_RIGHT) {
-                if ((size_t)*current_cursor < strlen(current_buffer)) (*current_cursor)++;
+                *current_cursor = field_next_char(current_buffer, *current_cursor);
             } else if (key == KEY_HOME) {
                 *current_cursor = 0;
             } else if (key == KEY_END) {
@@ -433,14 +479,17 @@ DialogResult dialog_replace(Editor *ed, char *search_term, size_t search_size,
                 active_field = (active_field + 1) % 3;
             } else if (key == KEY_UP) {
                 active_field = (active_field + 2) % 3;
-            } else if (key >= 32 && key < 127) {
+            } else if ((key >= 32 && key < 127) || (key >= 0x80 && key <= 0xFF)) {
+                /* Insert a whole character - UTF-8 sequences are read in one go */
+                char utf8[4] = {(char)key};
+                int char_len = key < 0x80 ? 1 : input_read_utf8(key, utf8);
                 int len = strlen(current_buffer);
-                if ((size_t)len < current_size - 1) {
-                    memmove(current_buffer + *current_cursor + 1,
+                if (char_len > 0 && (size_t)(len + char_len) < current_size) {
+                    memmove(current_buffer + *current_cursor + char_len,
                             current_buffer + *current_cursor,
                             len - *current_cursor + 1);
-                    current_buffer[*current_cursor] = key;
-                    (*current_cursor)++;
+                    memcpy(current_buffer + *current_cursor, utf8, char_len);
+                    *current_cursor += char_len;
                 }
             }
         } else {
@@ -482,7 +531,7 @@ void dialog_about(Editor *ed) {
     attroff(COLOR_PAIR(COLOR_DIALOG));
 
     refresh();
-    getch();
+    input_get_key();
 }
 
 void dialog_shortcuts(Editor *ed) {
@@ -613,7 +662,7 @@ void dialog_shortcuts(Editor *ed) {
 
         refresh();
 
-        int key = getch();
+        int key = input_get_key();
 
         if (key == '\n' || key == '\r' || key == KEY_ENTER || key == 27 || key == ' ') {
             break;
@@ -14,106 +14,209 @@ bool display_get_acs_mode(void) {
     return g_use_acs_mode;
 }
 
-/* Get the number of bytes in a UTF-8 character based on the first byte */
-static int utf8_char_length(unsigned char c) {
-    if ((c & 0x80) == 0) return 1;        /* 0xxxxxxx - ASCII */
-    if ((c & 0xE0) == 0xC0) return 2;     /* 110xxxxx */
-    if ((c & 0xF0) == 0xE0) return 3;     /* 1110xxxx */
-    if ((c & 0xF8) == 0xF0) return 4;     /* 11110xxx */
-    return 1; /* Invalid, treat as single byte */
-}
-
-/* Check if byte is a UTF-8 continuation byte */
-static bool is_utf8_continuation(unsigned char c) {
-    return (c & 0xC0) == 0x80;  /* 10xxxxxx */
-}
-
-/* Decode a UTF-8 sequence to a wide character. Returns bytes consumed, or 0 on error */
-static int utf8_decode(Buffer *buf, size_t pos, size_t buf_len, wchar_t *wc) {
-    if (pos >= buf_len) return 0;
-
-    unsigned char c = (unsigned char)buffer_get_char(buf, pos);
-    int len = utf8_char_length(c);
-
-    /* Check if we have enough bytes */
-    if (pos + len > buf_len) {
-        *wc = L'?';
-        return 1;
-    }
-
-    /* Validate continuation bytes and decode */
-    wchar_t result = 0;
-    if (len == 1) {
-        result = c;
-    } else if (len == 2) {
-        unsigned char c1 = (unsigned char)buffer_get_char(buf, pos + 1);
-        if (!is_utf8_continuation(c1)) {
-            *wc = L'?';
-            return 1;
-        }
-        result = ((c & 0x1F) << 6) | (c1 & 0x3F);
-    } else if (len == 3) {
-        unsigned char c1 = (unsigned char)buffer_get_char(buf, pos + 1);
-        unsigned char c2 = (unsigned char)buffer_get_char(buf, pos + 2);
-        if (!is_utf8_continuation(c1) || !is_utf8_continuation(c2)) {
-            *wc = L'?';
-            return 1;
-        }
-        result = ((c & 0x0F) << 12) | ((c1 & 0x3F) << 6) | (c2 & 0x3F);
-    } else if (len == 4) {
-        unsigned char c1 = (unsigned char)buffer_get_char(buf, pos + 1);
-        unsigned char c2 = (unsigned char)buffer_get_char(buf, pos + 2);
-        unsigned char c3 = (unsigned char)buffer_get_char(buf, pos + 3);
-        if (!is_utf8_continuation(c1) || !is_utf8_continuation(c2) || !is_utf8_continuation(c3)) {
-            *wc = L'?';
-            return 1;
-        }
-        result = ((c & 0x07) << 18) | ((c1 & 0x3F) << 12) | ((c2 & 0x3F) << 6) | (c3 & 0x3F);
+void display_init(void) {
+    /* ncurses initialization is done in editor_init_screen */
+}
+
+void display_shutdown(void) {
+    endwin();
+}
+
+static void draw_wchar(int y, int x, wchar_t wc) {
+    cchar_t cc;
+    wchar_t wstr[2] = {wc, L'\0'};
+    setcchar(&cc, wstr, A_NORMAL, 0, NULL);
+    mvadd_wch(y, x, &cc);
+}
+
+/* Screen row assembled in memory and written with a single mvadd_wchnstr.
+ * Cells are indexed by column; the right half of a wide character is a
+ * zero-width placeholder that is dropped when the row is emitted. */
+typedef struct RowBuilder {
+    cchar_t cells[MAX_ROW_CELLS];
+    unsigned char widths[MAX_ROW_CELLS];    /* Columns per cell, 0 for wide char halves */
+    int max_width;
+    int col;                                /* Next column to write */
+    attr_t attr;                            /* Attributes of the current run */
+    short pair;
+} RowBuilder;
+
+static RowBuilder g_row;
+
+/* Editor text that straddles the buffer gap is copied here */
+static char g_span_scratch[MAX_ROW_CELLS];
+
+/* Cursor cell in the edit area found while drawing wrapped rows, -1 if off screen */
+static int g_wrap_cursor_row = -1;
+static int g_wrap_cursor_col = -1;
+
+/* Set the attributes used for following cells */
+static void row_set_attr(RowBuilder *row, short pair, attr_t attr) {
+    row->pair = pair;
+    row->attr = attr;
+}
+
+/* Start a row of width columns filled with blanks in the given color pair */
+static void row_begin(RowBuilder *row, int width, short pair) {
+    if (width > MAX_ROW_CELLS) width = MAX_ROW_CELLS;
+    if (width < 0) width = 0;
+
+    row->max_width = width;
+    row->col = 0;
+    row_set_attr(row, pair, A_NORMAL);
+
+    cchar_t blank;
+    wchar_t wstr[2] = {L' ', L'\0'};
+    setcchar(&blank, wstr, A_NORMAL, pair, NULL);
+    for (int i = 0; i < width; i++) {
+        row->cells[i] = blank;
+        row->widths[i] = 1;
     }
+}
 
-    *wc = result;
-    return len;
+static void row_move(RowBuilder *row, int col) {
+    if (col < 0) col = 0;
+    if (col > row->max_width) col = row->max_width;
+    row->col = col;
 }
 
-/* Get the display width of a wide character (1 or 2 columns) */
-static int wchar_width(wchar_t wc) {
-    if (wc == L'\0') return 0;
-    if (wc < 32) return 0;  /* Control characters */
+/* Blank a cell that is about to be partly overwritten, keeping its attributes */
+static void row_blank_cell(RowBuilder *row, int col) {
+    wchar_t wch[CCHARW_MAX];
+    attr_t attr;
+    short pair;
+    getcchar(&row->cells[col], wch, &attr, &pair, NULL);
+    wchar_t wstr[2] = {L' ', L'\0'};
+    setcchar(&row->cells[col], wstr, attr, pair, NULL);
+    row->widths[col] = 1;
+}
 
-    /* Use wcwidth if available (POSIX only, not on Windows) */
-#if defined(_XOPEN_SOURCE) && !defined(PDCURSES) && !defined(_WIN32)
-    int w = wcwidth(wc);
-    if (w >= 0) return w;
+/* Write one character at the current column; returns false once the row is full */
+static bool row_put_attr(RowBuilder *row, wchar_t wc, int width, attr_t attr) {
+    if (width < 1) width = 1;
+    int col = row->col;
+    if (col + width > row->max_width) return false;
+
+    /* Don't leave half of an overwritten wide character behind */
+    if (row->widths[col] == 0 && col > 0) {
+        row_blank_cell(row, col - 1);
+    }
+    int end = col + width;
+    if (end < row->max_width && row->widths[end] == 0) {
+        row_blank_cell(row, end);
+    }
+
+    wchar_t wstr[2] = {wc, L'\0'};
+    setcchar(&row->cells[col], wstr, attr, row->pair, NULL);
+    row->widths[col] = (unsigned char)width;
+    for (int i = col + 1; i < end; i++) {
+        row->widths[i] = 0;
+    }
+
+    row->col = end;
+    return true;
+}
+
+static bool row_put(RowBuilder *row, wchar_t wc, int width) {
+    return row_put_attr(row, wc, width, row->attr);
+}
+
+/* Add a combining mark to the character already in a cell */
+static void row_add_mark(RowBuilder *row, int col, wchar_t mark) {
+    if (col < 0 || col >= row->max_width || row->widths[col] == 0) return;
+
+    wchar_t wch[CCHARW_MAX + 1];
+    attr_t attr;
+    short pair;
+    getcchar(&row->cells[col], wch, &attr, &pair, NULL);
+
+    size_t len = wcslen(wch);
+    if (len + 1 >= CCHARW_MAX) return;  /* No room for another mark */
+    wch[len] = mark;
+    wch[len + 1] = L'\0';
+    setcchar(&row->cells[col], wch, attr, pair, NULL);
+}
+
+/* Write a run of printable ASCII bytes, one column each */
+static void row_put_ascii(RowBuilder *row, const char *s, int count) {
+    int col = row->col;
+    if (count > row->max_width - col) count = row->max_width - col;
+    if (count <= 0) return;
+
+    if (row->widths[col] == 0 && col > 0) {
+        row_blank_cell(row, col - 1);
+    }
+    int end = col + count;
+    if (end < row->max_width && row->widths[end] == 0) {
+        row_blank_cell(row, end);
+    }
+
+    /* One cell is built, the rest are copies with the character swapped in */
+    cchar_t cell;
+    wchar_t wstr[2] = {L' ', L'\0'};
+    setcchar(&cell, wstr, row->attr, row->pair, NULL);
+    for (int i = 0; i < count; i++) {
+#ifdef NCURSES_VERSION
+        cell.chars[0] = (wchar_t)(unsigned char)s[i];
+        row->cells[col + i] = cell;
+#else
+        wstr[0] = (wchar_t)(unsigned char)s[i];
+        setcchar(&row->cells[col + i], wstr, row->attr, row->pair, NULL);
 #endif
+        row->widths[col + i] = 1;
+    }
 
-    /* Fallback: CJK and other wide characters are typically > U+1100 */
-    /* Common wide character ranges */
-    if (wc >= 0x1100 && wc <= 0x115F) return 2;  /* Hangul Jamo */
-    if (wc >= 0x2E80 && wc <= 0x9FFF) return 2;  /* CJK */
-    if (wc >= 0xAC00 && wc <= 0xD7AF) return 2;  /* Hangul Syllables */
-    if (wc >= 0xF900 && wc <= 0xFAFF) return 2;  /* CJK Compatibility */
-    if (wc >= 0xFE10 && wc <= 0xFE1F) return 2;  /* Vertical Forms */
-    if (wc >= 0xFE30 && wc <= 0xFE6F) return 2;  /* CJK Compatibility Forms */
-    if (wc >= 0xFF00 && wc <= 0xFF60) return 2;  /* Fullwidth Forms */
-    if (wc >= 0xFFE0 && wc <= 0xFFE6) return 2;  /* Fullwidth Signs */
-    if (wc >= 0x20000 && wc <= 0x2FFFF) return 2; /* CJK Extension B+ */
+    row->col = end;
+}
 
-    return 1;
+static void row_fill(RowBuilder *row, wchar_t wc, int count) {
+    for (int i = 0; i < count && row_put(row, wc, 1); i++) {
+    }
 }
 
-void display_init(void) {
-    /* ncurses initialization is done in editor_init_screen */
+/* Write a box character - uses ACS or Unicode based on mode */
+static void row_put_box(RowBuilder *row, chtype acs_char, wchar_t unicode_char) {
+    if (g_use_acs_mode) {
+        row_put_attr(row, (wchar_t)(acs_char & A_CHARTEXT), 1,
+                     row->attr | (acs_char & A_ATTRIBUTES));
+    } else {
+        row_put(row, unicode_char, 1);
+    }
 }
 
-void display_shutdown(void) {
-    endwin();
+/* Write a multibyte string using at most max_cols columns */
+static void row_put_str(RowBuilder *row, const char *s, int max_cols) {
+    int limit = row->col + max_cols;
+    mbstate_t state;
+    memset(&state, 0, sizeof(state));
+
+    while (*s && row->col < limit) {
+        wchar_t wc;
+        size_t n = mbrtowc(&wc, s, MB_CUR_MAX, &state);
+        if (n == (size_t)-1 || n == (size_t)-2) {
+            wc = L'?';
+            n = 1;
+            memset(&state, 0, sizeof(state));
+        }
+
+        int width = (wc >= 32 && iswprint(wc)) ? unicode_width(wc) : 1;
+        if (wc < 32 || !iswprint(wc)) wc = L'?';
+        if (row->col + width > limit || !row_put(row, wc, width)) break;
+        s += n;
+    }
 }
 
-static void draw_wchar(int y, int x, wchar_t wc) {
-    cchar_t cc;
-    wchar_t wstr[2] = {wc, L'\0'};
-    setcchar(&cc, wstr, A_NORMAL, 0, NULL);
-    mvadd_wch(y, x, &cc);
+/* Write the row at y, x */
+static void row_emit(RowBuilder *row, int y, int x) {
+    int count = 0;
+    for (int col = 0; col < row->max_width; col++) {
+        if (row->widths[col] != 0) {
+            row->cells[count++] = row->cells[col];
+        }
+    }
+    if (count > 0) {
+        mvadd_wchnstr(y, x, row->cells, count);
+    }
 }
 
 /* Draw a box character - uses ACS or Unicode based on mode */
@@ -249,89 +352,242 @@ void display_draw_statusbar(Editor *ed) {
     if (!ed || !ed->show_status_bar) return;
 
     int status_y = ed->screen_rows - 1;
+    RowBuilder *row = &g_row;
+    char text[64];
 
-    attron(COLOR_PAIR(COLOR_STATUS));
-    move(status_y, 0);
-    for (int i = 0; i < ed->screen_cols; i++) {
-        addch(' ');
-    }
+    row_begin(row, ed->screen_cols, COLOR_STATUS);
 
     /* Line and column */
-    mvprintw(status_y, 1, " Line: %-5zu Col: %-4zu", ed->cursor_row, ed->cursor_col);
+    snprintf(text, sizeof(text), " Line: %-5zu Col: %-4zu", ed->cursor_row, ed->cursor_col);
+    row_move(row, 1);
+    row_put_str(row, text, row->max_width);
 
-    /* Hex mode indicator */
+    /* Hex mode or soft wrap indicator */
     if (ed->hex_mode) {
-        mvprintw(status_y, 24, "[HEX]");
+        row_move(row, 24);
+        row_put_str(row, "[HEX]", row->max_width);
+    } else if (ed->soft_wrap) {
+        row_move(row, 24);
+        row_put_str(row, "[WRAP]", row->max_width);
     }
 
     /* Filename in center */
     const char *fname = ed->filename[0] ? ed->filename : "[Untitled]";
     int fname_len = strlen(fname);
     int fname_x = (ed->screen_cols - fname_len) / 2;
-    if (fname_x < 30) fname_x = 30;
+    if (fname_x < 32) fname_x = 32;  /* Clear of the line, column and mode indicators */
 
-    draw_box_char(status_y, fname_x - 2, ACS_VLINE, BOX_VERT);
-    mvprintw(status_y, fname_x, "%s", fname);
-    draw_box_char(status_y, fname_x + fname_len + 1, ACS_VLINE, BOX_VERT);
+    row_move(row, fname_x - 2);
+    row_put_box(row, ACS_VLINE, BOX_VERT);
+    row_move(row, fname_x);
+    row_put_str(row, fname, row->max_width);
+    row_move(row, fname_x + fname_len + 1);
+    row_put_box(row, ACS_VLINE, BOX_VERT);
 
     /* Status message or modified indicator on the right */
     time_t now = time(NULL);
     /* Key debug mode - show key code */
     if (input_is_debug_mode()) {
         int key_code = input_get_last_key_code();
-        mvprintw(status_y, ed->screen_cols - 30, " Key: 0x%03X (%d) ", key_code, key_code);
-    } else if (ed->status_message[0] && (now - ed->status_message_time) < 3) {
+        const JobStats *jobs = jobs_get_stats();
+        const HighlightScanStats *scan = highlight_scan_stats(ed->syntax_lang);
+        HighlightLineCacheStats lines = highlight_line_cache_stats();
+        char scan_rate[48] = "";
+        if (scan && scan->scans > 0) {
+            snprintf(scan_rate, sizeof(scan_rate), " Scan: %.1f MB/s (%zu/%zu fixed) |",
+                     scan->bytes / 1048576.0 / ((scan->ms > 0 ? scan->ms : 1) / 1000.0),
+                     scan->chunks_fixed, scan->chunks);
+        }
+        char debug[256];
+        snprintf(debug, sizeof(debug),
+                 "%s Lines: %lu hit/%lu miss | Jobs: %lu (avg %ldms, max %ldms) | "
+                 "Keys/frame: %d (peak %d) | Key: 0x%03X (%d) ",
+                 scan_rate, lines.hits, lines.misses, jobs->completed,
+                 jobs->completed ? jobs->total_ms / (long)jobs->completed : 0L,
+                 jobs->max_ms, ed->keys_per_frame, ed->keys_per_frame_peak, key_code, key_code);
+        row_move(row, ed->screen_cols - (int)strlen(debug) - 1);
+        row_put_str(row, debug, row->max_width);
+    } else if (ed->status_message[0] && (now - ed->status_message_time) < STATUS_MESSAGE_SECONDS) {
         /* Show status message for 3 seconds */
         int msg_len = strlen(ed->status_message);
-        mvprintw(status_y, ed->screen_cols - msg_len - 2, " %s ", ed->status_message);
+        int msg_x = ed->screen_cols - msg_len - 2;
+        if (msg_x >= 0) {
+            row_move(row, msg_x);
+            row_put(row, L' ', 1);
+            row_put_str(row, ed->status_message, row->max_width);
+            row_put(row, L' ', 1);
+        }
     } else {
         /* Clear expired message */
-        if (ed->status_message[0] && (now - ed->status_message_time) >= 3) {
+        if (ed->status_message[0] && (now - ed->status_message_time) >= STATUS_MESSAGE_SECONDS) {
             ed->status_message[0] = '\0';
         }
-        /* Modified indicator */
-        if (ed->modified) {
-            mvprintw(status_y, ed->screen_cols - 12, " Modified ");
+        /* Background load, search or line index progress, else the modified indicator */
+        int percent = file_load_percent(ed);
+        int searched = search_percent(ed);
+        int indexed = ed->buffer->paged ? paged_index_percent(ed->buffer->paged) : -1;
+        if (percent >= 0 || searched >= 0 || indexed >= 0) {
+            char progress[48];
+            if (percent >= 0) {
+                snprintf(progress, sizeof(progress), " Loading %d%% (Esc stops) ", percent);
+            } else if (searched >= 0) {
+                snprintf(progress, sizeof(progress), " Searching %d%% (Esc stops) ", searched);
+            } else {
+                snprintf(progress, sizeof(progress), " Indexing lines %d%% ", indexed);
+            }
+            row_move(row, ed->screen_cols - (int)strlen(progress) - 2);
+            row_put_str(row, progress, row->max_width);
+        } else if (ed->modified) {
+            row_move(row, ed->screen_cols - 12);
+            row_put_str(row, " Modified ", row->max_width);
         }
     }
 
-    attroff(COLOR_PAIR(COLOR_STATUS));
+    row_emit(row, status_y, 0);
 }
 
-/* Helper to check if position is in any selection */
-static bool pos_in_selection(Editor *ed, size_t pos) {
-    if (!ed) return false;
+/* Selection ranges to highlight this frame, sorted and non-overlapping */
+typedef struct SelectionView {
+    const SelectionRange *ranges;
+    int count;
+    SelectionRange single;      /* Storage for the plain (non multi-select) selection */
+} SelectionView;
+
+static void selection_view_init(Editor *ed, SelectionView *view) {
+    view->ranges = NULL;
+    view->count = 0;
 
-    /* Check multi-selections first */
     if (ed->selection.count > 0) {
-        for (int i = 0; i < ed->selection.count; i++) {
-            size_t start = ed->selection.ranges[i].start;
-            size_t end = ed->selection.ranges[i].end;
-            if (start > end) {
-                size_t tmp = start;
-                start = end;
-                end = tmp;
-            }
-            if (pos >= start && pos < end) {
-                return true;
-            }
+        /* Multi-select ranges are kept normalized by the editor */
+        view->ranges = ed->selection.ranges;
+        view->count = ed->selection.count;
+    } else if (editor_has_selection(ed)) {
+        size_t start = ed->selection.start;
+        size_t end = ed->selection.end;
+        view->single.start = start < end ? start : end;
+        view->single.end = start < end ? end : start;
+        view->single.cursor = ed->cursor_pos;
+        view->ranges = &view->single;
+        view->count = 1;
+    }
+}
+
+/* Index of the first range ending after pos */
+static int selection_view_seek(const SelectionView *view, size_t pos) {
+    int lo = 0, hi = view->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (view->ranges[mid].end <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-        return false;
     }
+    return lo;
+}
 
-    /* Check single selection */
-    if (ed->selection.active) {
-        size_t start = ed->selection.start;
-        size_t end = ed->selection.end;
-        if (start > end) {
-            size_t tmp = start;
-            start = end;
-            end = tmp;
+/* What the edit area showed last frame. When a frame differs from it only
+ * in scroll_row, the rows still on screen are moved with a scroll region
+ * and only the exposed ones are drawn; curses then scrolls the terminal
+ * rather than repainting it. A frame that changes nothing there (the
+ * cursor moved, the status bar updated) keeps every row. */
+typedef struct EditView {
+    bool valid;
+    const Buffer *buffer;
+    unsigned long version;
+    size_t total_lines;
+    size_t scroll_row;
+    size_t scroll_col;
+    int top, left, height, width;       /* Text area, left of it the gutter */
+    int gutter_width;
+    bool syntax;
+    LanguageType lang;
+    unsigned long highlight_generation;
+    SelectionRange ranges[MAX_SELECTIONS];
+    int range_count;
+    bool keep;                          /* This frame keeps the rows on screen */
+    int shift;                          /* Rows they were scrolled by */
+} EditView;
+
+static EditView g_edit_view;
+
+void display_invalidate(void) {
+    g_edit_view.valid = false;
+}
+
+/* Whether the edit area shows the same text as last frame, scroll_row aside */
+static bool edit_view_same_text(Editor *ed, const SelectionView *sel) {
+    const EditView *v = &g_edit_view;
+    if (!v->valid || ed->hex_mode || ed->soft_wrap) return false;
+
+    bool syntax = ed->syntax_enabled && ed->syntax_lang != LANG_NONE;
+    if (v->buffer != ed->buffer || v->version != ed->buffer->version ||
+        v->total_lines != buffer_count_lines(ed->buffer) || v->scroll_col != ed->scroll_col ||
+        v->top != ed->edit_top || v->left != ed->edit_left || v->height != ed->edit_height ||
+        v->width != ed->edit_width || v->gutter_width != ed->gutter_width ||
+        v->syntax != syntax || v->lang != ed->syntax_lang ||
+        v->highlight_generation != ed->hl_cache->generation || v->range_count != sel->count) {
+        return false;
+    }
+    for (int i = 0; i < sel->count; i++) {
+        if (v->ranges[i].start != sel->ranges[i].start || v->ranges[i].end != sel->ranges[i].end) {
+            return false;
         }
-        return pos >= start && pos < end;
+    }
+    return true;
+}
+
+/* Remember the view being drawn; highlighting it starts may change it again */
+static void edit_view_record(Editor *ed, const SelectionView *sel) {
+    EditView *v = &g_edit_view;
+    v->valid = !ed->hex_mode && !ed->soft_wrap && sel->count <= MAX_SELECTIONS;
+    v->buffer = ed->buffer;
+    v->version = ed->buffer->version;
+    v->total_lines = buffer_count_lines(ed->buffer);
+    v->scroll_row = ed->scroll_row;
+    v->scroll_col = ed->scroll_col;
+    v->top = ed->edit_top;
+    v->left = ed->edit_left;
+    v->height = ed->edit_height;
+    v->width = ed->edit_width;
+    v->gutter_width = ed->gutter_width;
+    v->syntax = ed->syntax_enabled && ed->syntax_lang != LANG_NONE;
+    v->lang = ed->syntax_lang;
+    v->highlight_generation = ed->hl_cache->generation;
+    v->range_count = v->valid ? sel->count : 0;
+    for (int i = 0; i < v->range_count; i++) {
+        v->ranges[i] = sel->ranges[i];
+    }
+}
+
+/* Keep the rows already in the edit area, scrolled if need be, when that
+ * is all this frame changes there; false to draw them all */
+static bool edit_view_scroll(Editor *ed) {
+    g_edit_view.keep = false;
+    g_edit_view.shift = 0;
+    if (!ed->buffer) return false;
+
+    SelectionView sel;
+    selection_view_init(ed, &sel);
+    if (!edit_view_same_text(ed, &sel)) return false;
+
+    size_t from = g_edit_view.scroll_row;
+    size_t to = ed->scroll_row;
+    size_t distance = to > from ? to - from : from - to;
+    if (distance >= (size_t)ed->edit_height) return false;
+
+    int shift = to > from ? (int)distance : -(int)distance;
+    if (shift != 0) {
+        scrollok(stdscr, TRUE);
+        wsetscrreg(stdscr, ed->edit_top, ed->edit_top + ed->edit_height - 1);
+        wscrl(stdscr, shift);
+        wsetscrreg(stdscr, 0, ed->screen_rows - 1);
+        scrollok(stdscr, FALSE);
     }
 
-    return false;
+    g_edit_view.keep = true;
+    g_edit_view.shift = shift;
+    return true;
 }
 
 /* Draw hex editor view */
@@ -339,63 +595,48 @@ static void display_draw_hex_editor(Editor *ed) {
     if (!ed || !ed->buffer) return;
 
     size_t buf_len = buffer_get_length(ed->buffer);
-
-    /* Fill background */
-    attron(COLOR_PAIR(COLOR_EDITOR));
-    for (int row = 0; row < ed->edit_height; row++) {
-        move(ed->edit_top + row, ed->edit_left);
-        for (int col = 0; col < ed->edit_width; col++) {
-            addch(' ');
-        }
-    }
+    RowBuilder *row = &g_row;
+    char text[16];
 
     /* Draw header */
-    attron(COLOR_PAIR(COLOR_STATUS));
-    move(ed->edit_top, ed->edit_left);
-    printw("Offset   ");
+    row_begin(row, ed->edit_width, COLOR_STATUS);
+    row_put_str(row, "Offset   ", row->max_width);
     for (int i = 0; i < 16; i++) {
-        if (i == 8) printw(" ");
-        printw("%02X ", i);
+        if (i == 8) row_put(row, L' ', 1);
+        snprintf(text, sizeof(text), "%02X ", i);
+        row_put_str(row, text, row->max_width);
     }
-    printw("| ASCII");
-
-    /* Clear to end of line */
-    int header_len = 9 + (16 * 3) + 1 + 7;
-    for (int i = header_len; i < ed->edit_width; i++) {
-        addch(' ');
-    }
-    attroff(COLOR_PAIR(COLOR_STATUS));
+    row_put_str(row, "| ASCII", row->max_width);
+    row_emit(row, ed->edit_top, ed->edit_left);
 
     /* Calculate visible rows */
     int data_rows = ed->edit_height - 1;  /* Minus header row */
     size_t scroll_row = ed->hex_scroll / 16;
 
     /* Draw hex data */
-    for (int row = 0; row < data_rows; row++) {
-        size_t offset = (scroll_row + (size_t)row) * 16;
+    for (int r = 0; r < data_rows; r++) {
+        size_t offset = (scroll_row + (size_t)r) * 16;
 
-        move(ed->edit_top + 1 + row, ed->edit_left);
+        row_begin(row, ed->edit_width, COLOR_EDITOR);
 
         if (offset >= buf_len && buf_len > 0) {
             /* Empty row below data */
-            attron(COLOR_PAIR(COLOR_EDITOR));
-            for (int col = 0; col < ed->edit_width; col++) {
-                addch(' ');
-            }
+            row_emit(row, ed->edit_top + 1 + r, ed->edit_left);
             continue;
         }
 
         /* Draw offset */
-        attron(COLOR_PAIR(COLOR_SYN_NUMBER));
-        printw("%08zX ", offset);
+        row_set_attr(row, COLOR_SYN_NUMBER, A_NORMAL);
+        snprintf(text, sizeof(text), "%08zX ", offset);
+        row_put_str(row, text, row->max_width);
 
         /* Draw hex bytes */
         for (int col = 0; col < 16; col++) {
             size_t pos = offset + (size_t)col;
 
             if (col == 8) {
-                attron(COLOR_PAIR(COLOR_EDITOR));
-                addch(' ');
+                row_set_attr(row, COLOR_EDITOR, A_NORMAL);
+                row_put(row, L' ', 1);
             }
 
             if (pos < buf_len) {
@@ -404,46 +645,24 @@ static void display_draw_hex_editor(Editor *ed) {
                 /* Check if this is the cursor position */
                 bool is_cursor = (pos == ed->cursor_pos) && !ed->hex_cursor_in_ascii;
 
-                if (is_cursor) {
-                    attron(COLOR_PAIR(COLOR_MENUSEL));
-                } else {
-                    attron(COLOR_PAIR(COLOR_EDITOR));
-                }
-
                 /* Draw hex digits with nibble highlighting */
-                char hex[3];
-                snprintf(hex, sizeof(hex), "%02X", byte);
-
-                if (is_cursor && ed->hex_nibble == 0) {
-                    attron(A_REVERSE);
-                    addch(hex[0]);
-                    attroff(A_REVERSE);
-                    addch(hex[1]);
-                } else if (is_cursor && ed->hex_nibble == 1) {
-                    addch(hex[0]);
-                    attron(A_REVERSE);
-                    addch(hex[1]);
-                    attroff(A_REVERSE);
-                } else {
-                    addch(hex[0]);
-                    addch(hex[1]);
-                }
+                snprintf(text, sizeof(text), "%02X", byte);
 
-                if (is_cursor) {
-                    attroff(COLOR_PAIR(COLOR_MENUSEL));
-                }
+                row_set_attr(row, is_cursor ? COLOR_MENUSEL : COLOR_EDITOR, A_NORMAL);
+                row_put_attr(row, text[0], 1, (is_cursor && ed->hex_nibble == 0) ? A_REVERSE : A_NORMAL);
+                row_put_attr(row, text[1], 1, (is_cursor && ed->hex_nibble == 1) ? A_REVERSE : A_NORMAL);
 
-                attron(COLOR_PAIR(COLOR_EDITOR));
-                addch(' ');
+                row_set_attr(row, COLOR_EDITOR, A_NORMAL);
+                row_put(row, L' ', 1);
             } else {
-                attron(COLOR_PAIR(COLOR_EDITOR));
-                printw("   ");
+                row_set_attr(row, COLOR_EDITOR, A_NORMAL);
+                row_fill(row, L' ', 3);
             }
         }
 
         /* Draw separator */
-        attron(COLOR_PAIR(COLOR_EDITOR));
-        printw("| ");
+        row_set_attr(row, COLOR_EDITOR, A_NORMAL);
+        row_put_str(row, "| ", row->max_width);
 
         /* Draw ASCII representation */
         for (int col = 0; col < 16; col++) {
@@ -454,35 +673,21 @@ static void display_draw_hex_editor(Editor *ed) {
                 bool is_cursor = (pos == ed->cursor_pos) && ed->hex_cursor_in_ascii;
 
                 if (is_cursor) {
-                    attron(COLOR_PAIR(COLOR_MENUSEL) | A_REVERSE);
+                    row_set_attr(row, COLOR_MENUSEL, A_REVERSE);
                 } else {
-                    attron(COLOR_PAIR(COLOR_SYN_STRING));
+                    row_set_attr(row, COLOR_SYN_STRING, A_NORMAL);
                 }
 
                 /* Print printable char or dot for non-printable */
-                if (byte >= 32 && byte < 127) {
-                    addch(byte);
-                } else {
-                    addch('.');
-                }
-
-                if (is_cursor) {
-                    attroff(COLOR_PAIR(COLOR_MENUSEL) | A_REVERSE);
-                } else {
-                    attroff(COLOR_PAIR(COLOR_SYN_STRING));
-                }
+                row_put(row, (byte >= 32 && byte < 127) ? byte : '.', 1);
             } else {
-                attron(COLOR_PAIR(COLOR_EDITOR));
-                addch(' ');
+                row_set_attr(row, COLOR_EDITOR, A_NORMAL);
+                row_put(row, L' ', 1);
             }
         }
 
-        /* Clear rest of line */
-        attron(COLOR_PAIR(COLOR_EDITOR));
+        row_emit(row, ed->edit_top + 1 + r, ed->edit_left);
     }
-
-    attrset(A_NORMAL);
-    attroff(COLOR_PAIR(COLOR_EDITOR));
 }
 
 void display_draw_editor(Editor *ed) {
@@ -490,78 +695,128 @@ void display_draw_editor(Editor *ed) {
 
     /* Check for hex mode */
     if (ed->hex_mode) {
+        display_invalidate();
         display_draw_hex_editor(ed);
         return;
     }
 
     size_t buf_len = buffer_get_length(ed->buffer);
-    bool has_sel = editor_has_selection(ed) || editor_has_multi_selection(ed);
+    SelectionView sel;
+    selection_view_init(ed, &sel);
+
+    /* Rows kept on screen need no drawing */
+    int draw_from = 0, draw_to = ed->edit_height;
+    if (g_edit_view.keep && g_edit_view.shift >= 0) {
+        draw_from = ed->edit_height - g_edit_view.shift;
+    } else if (g_edit_view.keep) {
+        draw_to = -g_edit_view.shift;
+    }
+    g_edit_view.keep = false;
+    edit_view_record(ed, &sel);
 
-    /* Syntax highlighting state */
+    /* Syntax highlighting comes from background jobs; lines without results draw plain */
     bool use_syntax = ed->syntax_enabled && ed->syntax_lang != LANG_NONE;
-    HighlightState hl_state = HL_STATE_NORMAL;
-    TokenType line_tokens[MAX_LINE_LENGTH];
-    memset(line_tokens, TOKEN_NORMAL, sizeof(line_tokens));
-
-    /* Fill background */
-    attron(COLOR_PAIR(COLOR_EDITOR));
-    for (int row = 0; row < ed->edit_height; row++) {
-        move(ed->edit_top + row, ed->edit_left);
-        for (int col = 0; col < ed->edit_width; col++) {
-            addch(' ');
-        }
-    }
+    const TokenRun *line_runs = NULL;
+    size_t run_count = 0;
 
-    /* Draw line numbers if enabled */
-    if (ed->show_line_numbers) {
-        attron(COLOR_PAIR(COLOR_STATUS));
-        for (int row = 0; row < ed->edit_height; row++) {
-            size_t line_num = ed->scroll_row + row + 1;
-            size_t total_lines = buffer_count_lines(ed->buffer);
-            if (line_num <= total_lines) {
-                mvprintw(ed->edit_top + row, 1, "%5zu ", line_num);
-            } else {
-                mvprintw(ed->edit_top + row, 1, "      ");
-            }
-        }
-        attron(COLOR_PAIR(COLOR_EDITOR));
-    }
+    /* Each row covers the line number gutter followed by the text area */
+    RowBuilder *row = &g_row;
+    int row_x = ed->edit_left - ed->gutter_width;
+    int digits = ed->gutter_width - 1;
+    size_t total_lines = buffer_count_lines(ed->buffer);
 
     /* Draw text */
     size_t pos = 0;
-    size_t current_line = 1;
-
-    /* Skip to first visible line, tracking highlight state for multi-line constructs */
-    while (pos < buf_len && current_line <= ed->scroll_row) {
-        if (use_syntax) {
-            /* Process line for highlight state (for block comments, etc.) */
-            size_t line_end = buffer_line_end(ed->buffer, pos);
-            syntax_highlight_line(ed->buffer, pos, line_end, ed->syntax_lang,
-                                  &hl_state, line_tokens, MAX_LINE_LENGTH);
-        }
-        if (buffer_get_char(ed->buffer, pos) == '\n') {
-            current_line++;
-        }
-        pos++;
+
+    /* Find the first line drawn */
+    size_t line_num = ed->scroll_row + 1 + (size_t)draw_from;
+    if (draw_from >= draw_to) {
+        /* Every row was kept */
+    } else if (use_syntax) {
+        pos = highlight_line_offset(ed->hl_cache, ed->syntax_lang, line_num);
+    } else {
+        pos = buffer_get_line_start(ed->buffer, line_num);
     }
 
+    /* With soft wrap each screen row is one wrapped row of a line */
+    size_t line_start = pos;
+    size_t line_length = 0;
+    size_t wrap_row = ed->soft_wrap ? ed->scroll_subrow : 0;
+    size_t last_line = line_num;
+    g_wrap_cursor_row = -1;
+    g_wrap_cursor_col = -1;
+
     /* Draw visible lines */
-    for (int screen_row = 0; screen_row < ed->edit_height && pos <= buf_len; screen_row++) {
+    for (int screen_row = draw_from; screen_row < draw_to; screen_row++) {
+        row_begin(row, ed->gutter_width + ed->edit_width, COLOR_EDITOR);
+
+        /* Draw line number if enabled; wrapped rows after the first leave it blank */
+        if (ed->gutter_width > 0) {
+            row_set_attr(row, COLOR_STATUS, A_NORMAL);
+            if (line_num <= total_lines && wrap_row == 0) {
+                char num[32];
+                snprintf(num, sizeof(num), "%*zu ", digits, line_num);
+                row_put_str(row, num, ed->gutter_width);
+            } else {
+                row_fill(row, L' ', ed->gutter_width);
+            }
+        }
+        row_set_attr(row, COLOR_EDITOR, A_NORMAL);
+
         int screen_col = 0;
         size_t visual_col = 1;
+        size_t first_col = ed->scroll_col;  /* Columns left of the row */
+        size_t row_end = buf_len;
+        bool more_rows = false;             /* The line continues on the next row */
+        int last_cell = -1;     /* Text column of the last character drawn, for marks */
+
+        if (ed->soft_wrap && line_num <= total_lines) {
+            size_t row_start, row_col;
+            if (!wrap_row_span(ed->wrap_layout, line_start, wrap_row, &row_start, &row_end, &row_col)) {
+                /* The top row went away with an edit - show the line's last row */
+                wrap_row = wrap_row_count(ed->wrap_layout, line_start) - 1;
+                wrap_row_span(ed->wrap_layout, line_start, wrap_row, &row_start, &row_end, &row_col);
+            }
+            more_rows = wrap_row_span(ed->wrap_layout, line_start, wrap_row + 1, NULL, NULL, NULL);
+            pos = row_start;
+            visual_col = row_col;
+            first_col = row_col - 1;
+
+            if (ed->cursor_pos >= row_start &&
+                (ed->cursor_pos < row_end || (ed->cursor_pos == row_end && !more_rows))) {
+                /* On a space hanging off the row end it shows in the last column */
+                g_wrap_cursor_row = screen_row;
+                g_wrap_cursor_col = (int)(ed->cursor_col - row_col);
+                if (g_wrap_cursor_col >= ed->edit_width) g_wrap_cursor_col = ed->edit_width - 1;
+            }
+        }
 
-        /* Pre-compute syntax highlighting for this line */
-        size_t line_start = pos;
-        size_t line_end = buffer_line_end(ed->buffer, pos);
-        size_t line_char_idx = 0;
+        /* Look up syntax highlighting for this line */
+        size_t line_char_idx = pos - line_start;
+        int sel_idx = selection_view_seek(&sel, pos);
+        last_line = line_num;
+
+        /* Current token run: colour and attribute are looked up once per run.
+         * Runs are fetched at the first visible byte so that long lines only
+         * get highlighted around what is on screen. */
+        size_t run_idx = 0;
+        size_t run_end = 0;
+        int run_color = COLOR_EDITOR;
+        int run_attr = A_NORMAL;
+        bool runs_fetched = !use_syntax;
+
+        line_runs = NULL;
+        if (use_syntax && (wrap_row == 0 || screen_row == 0)) {
+            line_length = column_line_end(ed->col_index, line_start, pos) - line_start;
+        }
 
-        if (use_syntax) {
-            memset(line_tokens, TOKEN_NORMAL, sizeof(line_tokens));
-            syntax_highlight_line(ed->buffer, line_start, line_end, ed->syntax_lang,
-                                  &hl_state, line_tokens, MAX_LINE_LENGTH);
+        /* Nothing left of the scroll column is drawn - jump straight to it */
+        if (ed->scroll_col > 0) {
+            pos = column_to_pos(ed->col_index, line_start, ed->scroll_col + 1, &visual_col);
+            line_char_idx = pos - line_start;
         }
 
-        while (pos < buf_len) {
+        while (pos < buf_len && (!more_rows || pos < row_end)) {
             char c = buffer_get_char(ed->buffer, pos);
 
             if (c == '\n') {
@@ -569,80 +824,146 @@ void display_draw_editor(Editor *ed) {
                 break;
             }
 
+            if (!runs_fetched && visual_col > first_col) {
+                size_t run_start = 0;
+                line_runs = highlight_line_runs(ed->hl_cache, line_num,
+                                                line_start, line_length, line_char_idx,
+                                                line_char_idx + (size_t)ed->edit_width * 4,
+                                                &run_start, &run_count);
+                run_end = run_start;
+                runs_fetched = true;
+            }
+
             /* Determine color and attribute for this character */
             int char_color = COLOR_EDITOR;
             int char_attr = A_NORMAL;
-            if (has_sel && pos_in_selection(ed, pos)) {
+            while (sel_idx < sel.count && sel.ranges[sel_idx].end <= pos) {
+                sel_idx++;
+            }
+            if (sel_idx < sel.count && sel.ranges[sel_idx].start <= pos) {
                 char_color = COLOR_HIGHLIGHT;
-            } else if (use_syntax && line_char_idx < MAX_LINE_LENGTH) {
-                char_color = syntax_token_to_color(line_tokens[line_char_idx]);
-                char_attr = syntax_token_to_attr(line_tokens[line_char_idx]);
+            } else if (line_runs) {
+                if (line_char_idx >= run_end && run_idx < run_count) {
+                    while (run_idx < run_count && line_char_idx >= run_end) {
+                        run_end += line_runs[run_idx++].length;
+                    }
+                    run_color = syntax_token_to_color(line_runs[run_idx - 1].token);
+                    run_attr = syntax_token_to_attr(line_runs[run_idx - 1].token);
+                }
+                if (run_idx > 0 && line_char_idx < run_end) {
+                    char_color = run_color;
+                    char_attr = run_attr;
+                }
             }
-            attrset(COLOR_PAIR(char_color) | char_attr);
 
-            /* Decode UTF-8 character */
-            wchar_t wc;
-            int char_bytes = utf8_decode(ed->buffer, pos, buf_len, &wc);
-            int char_width = (c == '\t') ? (int)(TAB_WIDTH - ((visual_col - 1) % TAB_WIDTH)) : wchar_width(wc);
+            /* Printable ASCII runs are copied straight into the row, up to the
+             * next selection or token boundary */
+            size_t ascii = 0;
+            const char *span = NULL;
+            int draw_col = (int)(visual_col - first_col - 1);
+            if (c >= 0x20 && c < 0x7F && visual_col > first_col && draw_col < ed->edit_width) {
+                size_t want = (size_t)(ed->edit_width - draw_col);
+                if (want > MAX_ROW_CELLS) want = MAX_ROW_CELLS;
+                if (want > row_end - pos) want = row_end - pos;
+                if (sel_idx < sel.count) {
+                    const SelectionRange *range = &sel.ranges[sel_idx];
+                    size_t boundary = range->start <= pos ? range->end : range->start;
+                    if (boundary - pos < want) want = boundary - pos;
+                }
+                if (line_runs && run_idx > 0 && line_char_idx < run_end &&
+                    run_end - line_char_idx < want) {
+                    want = run_end - line_char_idx;
+                }
+                if (want > 1) {
+                    span = buffer_get_span(ed->buffer, pos, pos + want, g_span_scratch);
+                    ascii = span ? unicode_ascii_run(span, want) : 0;
+                }
+            }
+
+            if (ascii > 1) {
+                row_move(row, ed->gutter_width + draw_col);
+                row_set_attr(row, char_color, char_attr);
+                row_put_ascii(row, span, (int)ascii);
+                last_cell = draw_col + (int)ascii - 1;
 
-            /* Handle horizontal scroll */
-            if (visual_col > ed->scroll_col) {
-                int draw_col = visual_col - ed->scroll_col - 1;
+                visual_col += ascii;
+                pos += ascii;
+                line_char_idx += ascii;
+            } else {
+                /* Decode UTF-8 character */
+                wchar_t wc;
+                int char_bytes = unicode_decode(ed->buffer, pos, buf_len, &wc);
+                int char_width = (c == '\t') ? (int)(TAB_WIDTH - ((visual_col - 1) % TAB_WIDTH)) : unicode_width(wc);
+
+                if (char_width == 0 && unicode_is_mark(wc)) {
+                    /* Combining marks share the cell of the character before them */
+                    if (last_cell >= 0) {
+                        row_add_mark(row, ed->gutter_width + last_cell, wc);
+                    }
+                } else if (visual_col > first_col && draw_col < ed->edit_width) {
+                    /* Handle horizontal scroll */
+                    last_cell = draw_col;
+                    row_move(row, ed->gutter_width + draw_col);
+                    row_set_attr(row, char_color, char_attr);
 
-                if (draw_col < ed->edit_width) {
                     if (c == '\t') {
-                        for (int t = 0; t < char_width && draw_col + t < ed->edit_width; t++) {
-                            mvaddch(ed->edit_top + screen_row, ed->edit_left + draw_col + t, ' ');
-                        }
+                        row_fill(row, L' ', char_width);
                     } else if (wc >= 32 && wc < 127) {
-                        /* Plain ASCII - use simple addch */
-                        mvaddch(ed->edit_top + screen_row, ed->edit_left + draw_col, (char)wc);
+                        /* Plain ASCII */
+                        row_put(row, wc, 1);
                     } else if (wc >= 127 && iswprint(wc)) {
-                        /* Printable Unicode character - use wide char function */
-                        draw_wchar(ed->edit_top + screen_row, ed->edit_left + draw_col, wc);
-                    } else if (wc < 32) {
-                        /* Control character - show as ^X notation or ? */
-                        mvaddch(ed->edit_top + screen_row, ed->edit_left + draw_col, '?');
+                        /* Printable Unicode character */
+                        row_put(row, wc, char_width);
                     } else {
-                        /* Non-printable character */
-                        mvaddch(ed->edit_top + screen_row, ed->edit_left + draw_col, '?');
+                        /* Control or non-printable character */
+                        row_put(row, L'?', 1);
                     }
                 }
+
+                visual_col += char_width;
+                pos += char_bytes;
+                line_char_idx += char_bytes;
             }
 
-            visual_col += char_width;
-            pos += char_bytes;
-            line_char_idx += char_bytes;
+            screen_col = visual_col - first_col - 1;
+            if (screen_col >= ed->edit_width && !ed->soft_wrap) {
+                /* Marks on the last visible character are still drawn */
+                wchar_t next;
+                if (unicode_decode(ed->buffer, pos, buf_len, &next) > 0 && unicode_is_mark(next)) {
+                    continue;
+                }
 
-            screen_col = visual_col - ed->scroll_col - 1;
-            if (screen_col >= ed->edit_width) {
                 /* Skip rest of line (horizontal scroll) */
-                while (pos < buf_len && buffer_get_char(ed->buffer, pos) != '\n') {
-                    pos++;
-                }
+                pos = column_line_end(ed->col_index, line_start, pos);
                 if (pos < buf_len) pos++;  /* Skip newline */
                 break;
             }
         }
 
-        attron(COLOR_PAIR(COLOR_EDITOR));
-    }
-
-    /* Reset all attributes to prevent bleeding into other UI elements */
-    attrset(A_NORMAL);
-    attroff(COLOR_PAIR(COLOR_EDITOR));
+        row_emit(row, ed->edit_top + screen_row, row_x);
 
-    /* Position cursor */
-    int cursor_screen_row = ed->cursor_row - ed->scroll_row - 1;
-    int cursor_screen_col = ed->cursor_col - ed->scroll_col - 1;
+        if (more_rows) {
+            wrap_row++;
+        } else {
+            wrap_row = 0;
+            line_num++;
+            line_start = pos;
+        }
+    }
 
-    if (cursor_screen_row >= 0 && cursor_screen_row < ed->edit_height &&
-        cursor_screen_col >= 0 && cursor_screen_col < ed->edit_width) {
-        move(ed->edit_top + cursor_screen_row, ed->edit_left + cursor_screen_col);
-        curs_set(1);
-    } else {
-        curs_set(0);
+    /* Queue highlighting for anything drawn plain or stale; pos is now past the last line */
+    if (use_syntax) {
+        if (draw_from >= draw_to || draw_to < ed->edit_height) {
+            /* The rows below were kept - the view still ends at the bottom */
+            last_line = ed->scroll_row + (size_t)ed->edit_height;
+            pos = highlight_line_offset(ed->hl_cache, ed->syntax_lang, last_line + 1);
+        }
+        if (last_line > total_lines) last_line = total_lines;
+        highlight_request(ed->hl_cache, ed->syntax_lang, ed->scroll_row + 1, last_line, pos);
     }
+
+    /* The cursor is placed by display_refresh once everything is drawn;
+     * switching its visibility here as well cost escape sequences every frame */
 }
 
 /* Draw file panel on left side */
@@ -654,22 +975,6 @@ static void display_draw_panel(Editor *ed) {
     int bottom_border_y = ed->show_status_bar ? ed->screen_rows - 2 : ed->screen_rows - 1;
     int panel_height = bottom_border_y - panel_top;  /* Extend to bottom border */
 
-    /* Fill panel background */
-    attron(COLOR_PAIR(COLOR_DIALOG));
-    for (int row = 0; row < panel_height; row++) {
-        move(panel_top + row, 1);
-        for (int col = 0; col < PANEL_WIDTH; col++) {
-            addch(' ');
-        }
-    }
-
-    /* Draw vertical separator between panel and editor */
-    attron(COLOR_PAIR(COLOR_BORDER));
-    for (int row = 0; row < panel_height; row++) {
-        draw_box_char(panel_top + row, PANEL_WIDTH + 1, ACS_VLINE, BOX_VERT);
-    }
-    attroff(COLOR_PAIR(COLOR_BORDER));
-
     /* Calculate content area */
     int content_top = panel_top;
     int content_height = panel_height;  /* Use full height */
@@ -683,87 +988,96 @@ static void display_draw_panel(Editor *ed) {
         state->scroll_offset = state->selected_index - content_height + 1;
     }
 
-    /* Draw entries */
-    for (int i = 0; i < content_height && (state->scroll_offset + i) < state->entry_count; i++) {
+    /* Each row spans the panel background and the separator next to the editor */
+    RowBuilder *row = &g_row;
+
+    for (int i = 0; i < content_height; i++) {
         int entry_idx = state->scroll_offset + i;
-        ExplorerEntry *entry = &state->entries[entry_idx];
         int y = content_top + i;
 
-        /* Check if entry is in selection range */
-        bool is_selected;
-        if (state->selection_anchor >= 0) {
-            int sel_start = state->selection_anchor < state->selected_index ?
-                            state->selection_anchor : state->selected_index;
-            int sel_end = state->selection_anchor > state->selected_index ?
-                          state->selection_anchor : state->selected_index;
-            is_selected = (entry_idx >= sel_start && entry_idx <= sel_end);
-        } else {
-            is_selected = (entry_idx == state->selected_index);
-        }
-        bool is_cursor = (entry_idx == state->selected_index);
-
-        /* Use highlight for selection and cursor */
-        if (is_cursor && ed->panel_focused) {
-            attron(COLOR_PAIR(COLOR_MENUSEL));
-        } else if (is_selected && ed->panel_focused) {
-            attron(COLOR_PAIR(COLOR_HIGHLIGHT));
-        } else if (is_cursor || is_selected) {
-            attron(COLOR_PAIR(COLOR_HIGHLIGHT) | A_DIM);
-        } else {
-            attron(COLOR_PAIR(COLOR_DIALOG));
-        }
+        row_begin(row, PANEL_WIDTH + 1, COLOR_DIALOG);
 
-        /* Clear line */
-        move(y, 2);
-        for (int j = 0; j < content_width; j++) {
-            addch(' ');
-        }
+        if (entry_idx < state->entry_count) {
+            ExplorerEntry *entry = &state->entries[entry_idx];
 
-        /* Draw entry - truncate if needed */
-        char display_name[32];
-        if (entry->is_directory) {
-            int max_name = content_width - 7;  /* "[DIR] " + name */
-            if (max_name < 3) max_name = 3;
-            if ((int)strlen(entry->name) > max_name) {
-                snprintf(display_name, sizeof(display_name), "[DIR] %.*s..", max_name - 2, entry->name);
+            /* Check if entry is in selection range */
+            bool is_selected;
+            if (state->selection_anchor >= 0) {
+                int sel_start = state->selection_anchor < state->selected_index ?
+                                state->selection_anchor : state->selected_index;
+                int sel_end = state->selection_anchor > state->selected_index ?
+                              state->selection_anchor : state->selected_index;
+                is_selected = (entry_idx >= sel_start && entry_idx <= sel_end);
             } else {
-                snprintf(display_name, sizeof(display_name), "[DIR] %s", entry->name);
+                is_selected = (entry_idx == state->selected_index);
             }
-        } else {
-            int max_name = content_width;
-            if ((int)strlen(entry->name) > max_name) {
-                snprintf(display_name, sizeof(display_name), "%.*s..", max_name - 2, entry->name);
+            bool is_cursor = (entry_idx == state->selected_index);
+
+            /* Use highlight for selection and cursor */
+            if (is_cursor && ed->panel_focused) {
+                row_set_attr(row, COLOR_MENUSEL, A_NORMAL);
+            } else if (is_selected && ed->panel_focused) {
+                row_set_attr(row, COLOR_HIGHLIGHT, A_NORMAL);
+            } else if (is_cursor || is_selected) {
+                row_set_attr(row, COLOR_HIGHLIGHT, A_DIM);
+            }
+
+            /* Draw entry - truncate if needed */
+            char display_name[32];
+            if (entry->is_directory) {
+                int max_name = content_width - 7;  /* "[DIR] " + name */
+                if (max_name < 3) max_name = 3;
+                if ((int)strlen(entry->name) > max_name) {
+                    snprintf(display_name, sizeof(display_name), "[DIR] %.*s..", max_name - 2, entry->name);
+                } else {
+                    snprintf(display_name, sizeof(display_name), "[DIR] %s", entry->name);
+                }
             } else {
-                snprintf(display_name, sizeof(display_name), "%s", entry->name);
+                int max_name = content_width;
+                if ((int)strlen(entry->name) > max_name) {
+                    snprintf(display_name, sizeof(display_name), "%.*s..", max_name - 2, entry->name);
+                } else {
+                    snprintf(display_name, sizeof(display_name), "%s", entry->name);
+                }
             }
+
+            /* Highlight covers the whole line */
+            row_move(row, 1);
+            row_put_str(row, display_name, content_width);
+            row_fill(row, L' ', 1 + content_width - row->col);
         }
-        mvprintw(y, 2, "%s", display_name);
 
-        /* Turn off all attributes used */
-        attroff(COLOR_PAIR(COLOR_MENUSEL));
-        attroff(COLOR_PAIR(COLOR_HIGHLIGHT));
-        attroff(COLOR_PAIR(COLOR_DIALOG));
-        attroff(A_DIM);
-    }
+        /* Draw vertical separator between panel and editor */
+        row_set_attr(row, COLOR_BORDER, A_NORMAL);
+        row_move(row, PANEL_WIDTH);
+        row_put_box(row, ACS_VLINE, BOX_VERT);
 
-    attroff(COLOR_PAIR(COLOR_DIALOG));
+        row_emit(row, y, 1);
+    }
 }
 
 void display_refresh(Editor *ed) {
     if (!ed) return;
 
-    erase();
+    bool keep = edit_view_scroll(ed);
+    if (!keep) {
+        erase();
+    }
 
-    /* Fill entire screen with blue background */
-    attron(COLOR_PAIR(COLOR_EDITOR));
+    /* Fill entire screen with blue background, around the edit area if it was kept */
+    row_begin(&g_row, ed->screen_cols, COLOR_EDITOR);
+    int edit_x = ed->edit_left - ed->gutter_width;
+    int edit_end = ed->edit_left + ed->edit_width;
     for (int y = 0; y < ed->screen_rows; y++) {
-        move(y, 0);
-        for (int x = 0; x < ed->screen_cols; x++) {
-            addch(' ');
+        if (keep && y >= ed->edit_top && y < ed->edit_top + ed->edit_height) {
+            if (edit_x > 0) mvadd_wchnstr(y, 0, g_row.cells, edit_x);
+            if (edit_end < g_row.max_width) {
+                mvadd_wchnstr(y, edit_end, g_row.cells, g_row.max_width - edit_end);
+            }
+        } else {
+            mvadd_wchnstr(y, 0, g_row.cells, g_row.max_width);
         }
     }
-    attrset(A_NORMAL);
-    attroff(COLOR_PAIR(COLOR_EDITOR));
 
     display_draw_menubar(ed);
     display_draw_border(ed);
@@ -774,6 +1088,10 @@ void display_refresh(Editor *ed) {
     /* Position cursor after all drawing is complete */
     int cursor_screen_row = ed->cursor_row - ed->scroll_row - 1;
     int cursor_screen_col = ed->cursor_col - ed->scroll_col - 1;
+    if (ed->soft_wrap && !ed->hex_mode) {
+        cursor_screen_row = g_wrap_cursor_row;
+        cursor_screen_col = g_wrap_cursor_col;
+    }
 
     if (cursor_screen_row >= 0 && cursor_screen_row < ed->edit_height &&
         cursor_screen_col >= 0 && cursor_screen_col < ed->edit_width) {
@@ -22,6 +22,10 @@ void display_draw_box(int y, int x, int height, int width, bool double_line);
 void display_draw_hline(int y, int x, int width, bool double_line);
 void display_draw_vline(int y, int x, int height, bool double_line);
 
+/* Anything drawn over the screen outside display_refresh (menus, dialogs)
+ * must call this so the next frame repaints the edit area in full */
+void display_invalidate(void);
+
 /* ACS mode - use terminal-native box drawing instead of Unicode */
 void display_set_acs_mode(bool use_acs);
 bool display_get_acs_mode(void);
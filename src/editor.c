@@ -11,94 +11,6 @@
 #include <unistd.h>
 #endif
 
-/* UTF-8 helper functions for cursor positioning */
-
-/* Get the number of bytes in a UTF-8 character based on the first byte */
-static int utf8_char_len(unsigned char c) {
-    if ((c & 0x80) == 0) return 1;        /* 0xxxxxxx - ASCII */
-    if ((c & 0xE0) == 0xC0) return 2;     /* 110xxxxx */
-    if ((c & 0xF0) == 0xE0) return 3;     /* 1110xxxx */
-    if ((c & 0xF8) == 0xF0) return 4;     /* 11110xxx */
-    return 1; /* Invalid, treat as single byte */
-}
-
-/* Check if byte is a UTF-8 continuation byte */
-static bool is_utf8_cont(unsigned char c) {
-    return (c & 0xC0) == 0x80;  /* 10xxxxxx */
-}
-
-/* Decode a UTF-8 sequence from buffer to a wide character. Returns bytes consumed */
-static int utf8_decode_at(Buffer *buf, size_t pos, size_t buf_len, wchar_t *wc) {
-    if (pos >= buf_len) return 0;
-
-    unsigned char c = (unsigned char)buffer_get_char(buf, pos);
-    int len = utf8_char_len(c);
-
-    /* Check if we have enough bytes */
-    if (pos + len > buf_len) {
-        *wc = L'?';
-        return 1;
-    }
-
-    /* Validate continuation bytes and decode */
-    wchar_t result = 0;
-    if (len == 1) {
-        result = c;
-    } else if (len == 2) {
-        unsigned char c1 = (unsigned char)buffer_get_char(buf, pos + 1);
-        if (!is_utf8_cont(c1)) {
-            *wc = L'?';
-            return 1;
-        }
-        result = ((c & 0x1F) << 6) | (c1 & 0x3F);
-    } else if (len == 3) {
-        unsigned char c1 = (unsigned char)buffer_get_char(buf, pos + 1);
-        unsigned char c2 = (unsigned char)buffer_get_char(buf, pos + 2);
-        if (!is_utf8_cont(c1) || !is_utf8_cont(c2)) {
-            *wc = L'?';
-            return 1;
-        }
-        result = ((c & 0x0F) << 12) | ((c1 & 0x3F) << 6) | (c2 & 0x3F);
-    } else if (len == 4) {
-        unsigned char c1 = (unsigned char)buffer_get_char(buf, pos + 1);
-        unsigned char c2 = (unsigned char)buffer_get_char(buf, pos + 2);
-        unsigned char c3 = (unsigned char)buffer_get_char(buf, pos + 3);
-        if (!is_utf8_cont(c1) || !is_utf8_cont(c2) || !is_utf8_cont(c3)) {
-            *wc = L'?';
-            return 1;
-        }
-        result = ((c & 0x07) << 18) | ((c1 & 0x3F) << 12) | ((c2 & 0x3F) << 6) | (c3 & 0x3F);
-    }
-
-    *wc = result;
-    return len;
-}
-
-/* Get the display width of a wide character (1 or 2 columns) */
-static int wchar_display_width(wchar_t wc) {
-    if (wc == L'\0') return 0;
-    if (wc < 32) return 0;  /* Control characters */
-
-    /* Use wcwidth if available (POSIX only, not on Windows) */
-#if defined(_XOPEN_SOURCE) && !defined(PDCURSES) && !defined(_WIN32)
-    int w = wcwidth(wc);
-    if (w >= 0) return w;
-#endif
-
-    /* Fallback: Common wide character ranges */
-    if (wc >= 0x1100 && wc <= 0x115F) return 2;  /* Hangul Jamo */
-    if (wc >= 0x2E80 && wc <= 0x9FFF) return 2;  /* CJK */
-    if (wc >= 0xAC00 && wc <= 0xD7AF) return 2;  /* Hangul Syllables */
-    if (wc >= 0xF900 && wc <= 0xFAFF) return 2;  /* CJK Compatibility */
-    if (wc >= 0xFE10 && wc <= 0xFE1F) return 2;  /* Vertical Forms */
-    if (wc >= 0xFE30 && wc <= 0xFE6F) return 2;  /* CJK Compatibility Forms */
-    if (wc >= 0xFF00 && wc <= 0xFF60) return 2;  /* Fullwidth Forms */
-    if (wc >= 0xFFE0 && wc <= 0xFFE6) return 2;  /* Fullwidth Signs */
-    if (wc >= 0x20000 && wc <= 0x2FFFF) return 2; /* CJK Extension B+ */
-
-    return 1;
-}
-
 Editor *editor_create(void) {
     Editor *ed = malloc(sizeof(Editor));
     if (!ed) return NULL;
@@ -107,7 +19,12 @@ Editor *editor_create(void) {
     ed->undo = undo_create();
     ed->clipboard = clipboard_create();
 
-    if (!ed->buffer || !ed->undo || !ed->clipboard) {
+    ed->hl_cache = ed->buffer ? highlight_cache_create(ed->buffer) : NULL;
+    ed->col_index = ed->buffer ? column_index_create(ed->buffer) : NULL;
+    ed->wrap_layout = ed->buffer ? wrap_layout_create(ed->buffer) : NULL;
+
+    if (!ed->buffer || !ed->undo || !ed->clipboard || !ed->hl_cache || !ed->col_index ||
+        !ed->wrap_layout) {
         editor_destroy(ed);
         return NULL;
     }
@@ -117,6 +34,7 @@ Editor *editor_create(void) {
     ed->cursor_col = 1;
     ed->scroll_row = 0;
     ed->scroll_col = 0;
+    ed->scroll_subrow = 0;
 
     ed->screen_rows = 0;
     ed->screen_cols = 0;
@@ -124,6 +42,7 @@ Editor *editor_create(void) {
     ed->edit_height = 0;
     ed->edit_left = 1;
     ed->edit_width = 0;
+    ed->gutter_width = 0;
 
     ed->selection.active = false;
     ed->selection.start = 0;
@@ -133,10 +52,13 @@ Editor *editor_create(void) {
     ed->filename[0] = '\0';
     ed->modified = false;
     ed->readonly = false;
+    ed->loading = NULL;
+    ed->searching = NULL;
 
     ed->show_line_numbers = false;
     ed->show_status_bar = true;
     ed->use_acs_chars = false;  /* Default to Unicode box-drawing */
+    ed->soft_wrap = false;
 
     ed->mode = MODE_NORMAL;
     ed->running = true;
@@ -151,11 +73,18 @@ Editor *editor_create(void) {
     ed->syntax_lang = LANG_NONE;
     ed->syntax_enabled = true;
 
+    ed->frame_interval_ms = DEFAULT_FRAME_INTERVAL_MS;
+    ed->keys_per_frame = 0;
+    ed->keys_per_frame_peak = 0;
+
     return ed;
 }
 
 void editor_destroy(Editor *ed) {
     if (ed) {
+        highlight_cache_destroy(ed->hl_cache);
+        column_index_destroy(ed->col_index);
+        wrap_layout_destroy(ed->wrap_layout);
         buffer_destroy(ed->buffer);
         undo_destroy(ed->undo);
         clipboard_destroy(ed->clipboard);
@@ -176,6 +105,10 @@ void editor_init_screen(Editor *ed) {
     noecho();
     keypad(stdscr, TRUE);
 
+    /* Let curses scroll the terminal (scroll regions, insert/delete line)
+     * when a frame is the last one shifted, instead of repainting every row */
+    idlok(stdscr, TRUE);
+
     /* Disable Ctrl+Z (SIGTSTP) so it can be used for undo */
 #ifndef _WIN32
     signal(SIGTSTP, SIG_IGN);
@@ -239,10 +172,9 @@ void editor_update_dimensions(Editor *ed) {
         ed->edit_height = ed->screen_rows - 3;  /* Minus menu, top border, bottom border */
     }
 
-    if (ed->show_line_numbers) {
-        ed->edit_left += 6;  /* Line number width + space */
-        ed->edit_width -= 6;
-    }
+    ed->gutter_width = editor_gutter_width(ed);
+    ed->edit_left += ed->gutter_width;
+    ed->edit_width -= ed->gutter_width;
 
     /* Adjust for file panel */
     if (ed->panel_visible) {
@@ -250,32 +182,46 @@ void editor_update_dimensions(Editor *ed) {
         ed->edit_width -= PANEL_WIDTH + 1;
     }
 
+    /* Wrapped rows depend on the width; the top row is found again from the cursor */
+    if (ed->wrap_layout && ed->wrap_layout->width != ed->edit_width) {
+        wrap_layout_set_width(ed->wrap_layout, ed->edit_width);
+        ed->scroll_subrow = 0;
+    }
+
     /* Ensure cursor is visible after resize */
     editor_scroll_to_cursor(ed);
 }
 
-void editor_update_cursor_position(Editor *ed) {
-    if (!ed || !ed->buffer) return;
+/* Width of the line number gutter: enough digits for the last line plus a space */
+int editor_gutter_width(Editor *ed) {
+    if (!ed || !ed->show_line_numbers) return 0;
 
-    ed->cursor_row = buffer_get_line_number(ed->buffer, ed->cursor_pos);
+    size_t total_lines = buffer_count_lines(ed->buffer);
+    int digits = 1;
+    while (total_lines >= 10) {
+        total_lines /= 10;
+        digits++;
+    }
+    if (digits < MIN_GUTTER_DIGITS) digits = MIN_GUTTER_DIGITS;
 
-    size_t line_start = buffer_line_start(ed->buffer, ed->cursor_pos);
-    size_t buf_len = buffer_get_length(ed->buffer);
-    ed->cursor_col = 1;
+    return digits + 1;
+}
 
-    size_t i = line_start;
-    while (i < ed->cursor_pos && i < buf_len) {
-        char c = buffer_get_char(ed->buffer, i);
-        if (c == '\t') {
-            ed->cursor_col += TAB_WIDTH - ((ed->cursor_col - 1) % TAB_WIDTH);
-            i++;
-        } else {
-            wchar_t wc;
-            int char_bytes = utf8_decode_at(ed->buffer, i, buf_len, &wc);
-            ed->cursor_col += wchar_display_width(wc);
-            i += char_bytes;
+void editor_update_cursor_position(Editor *ed) {
+    if (!ed || !ed->buffer) return;
+
+    /* A large file still being indexed can only place the cursor as far as
+     * its line lookups reach */
+    if (ed->buffer->paged) {
+        size_t reach = paged_lookup_clamp(ed->buffer->paged, ed->cursor_pos);
+        if (reach != ed->cursor_pos) {
+            ed->cursor_pos = buffer_line_start(ed->buffer, reach);
+            editor_set_status_message(ed, "Still indexing lines - can't go further yet");
         }
     }
+
+    ed->cursor_row = buffer_get_line_number(ed->buffer, ed->cursor_pos);
+    ed->cursor_col = column_from_pos(ed->col_index, ed->cursor_pos);
 }
 
 size_t editor_pos_to_row(Editor *ed, size_t pos) {
@@ -285,50 +231,96 @@ size_t editor_pos_to_row(Editor *ed, size_t pos) {
 
 size_t editor_pos_to_col(Editor *ed, size_t pos) {
     if (!ed || !ed->buffer) return 1;
+    return column_from_pos(ed->col_index, pos);
+}
 
-    size_t line_start = buffer_line_start(ed->buffer, pos);
-    size_t buf_len = buffer_get_length(ed->buffer);
-    size_t col = 1;
-
-    size_t i = line_start;
-    while (i < pos && i < buf_len) {
-        char c = buffer_get_char(ed->buffer, i);
-        if (c == '\t') {
-            col += TAB_WIDTH - ((col - 1) % TAB_WIDTH);
-            i++;
-        } else {
-            wchar_t wc;
-            int char_bytes = utf8_decode_at(ed->buffer, i, buf_len, &wc);
-            col += wchar_display_width(wc);
-            i += char_bytes;
-        }
+size_t editor_row_col_to_pos(Editor *ed, size_t row, size_t col) {
+    if (!ed || !ed->buffer) return 0;
+    return column_to_pos(ed->col_index, buffer_get_line_start(ed->buffer, row), col, NULL);
+}
+
+/* A wrapped row: the line (0-based) and its start offset, and the row within it */
+typedef struct VisualRow {
+    size_t line;
+    size_t line_start;
+    size_t row;
+} VisualRow;
+
+static bool editor_visual_row_up(Editor *ed, VisualRow *v) {
+    if (v->row > 0) {
+        v->row--;
+        return true;
     }
+    if (v->line_start == 0) return false;
 
-    return col;
+    v->line_start = buffer_line_start(ed->buffer, v->line_start - 1);
+    v->line--;
+    v->row = wrap_row_count(ed->wrap_layout, v->line_start) - 1;
+    return true;
 }
 
-size_t editor_row_col_to_pos(Editor *ed, size_t row, size_t col) {
-    if (!ed || !ed->buffer) return 0;
+static bool editor_visual_row_down(Editor *ed, VisualRow *v) {
+    if (wrap_row_span(ed->wrap_layout, v->line_start, v->row + 1, NULL, NULL, NULL)) {
+        v->row++;
+        return true;
+    }
 
-    size_t pos = buffer_get_line_start(ed->buffer, row);
-    size_t line_end = buffer_line_end(ed->buffer, pos);
-    size_t buf_len = buffer_get_length(ed->buffer);
-    size_t current_col = 1;
+    size_t line_end;
+    if (!wrap_row_span(ed->wrap_layout, v->line_start, v->row, NULL, &line_end, NULL) ||
+        line_end >= buffer_get_length(ed->buffer)) {
+        return false;
+    }
+    v->line_start = line_end + 1;
+    v->line++;
+    v->row = 0;
+    return true;
+}
 
-    while (pos < line_end && current_col < col) {
-        char c = buffer_get_char(ed->buffer, pos);
-        if (c == '\t') {
-            current_col += TAB_WIDTH - ((current_col - 1) % TAB_WIDTH);
-            pos++;
-        } else {
-            wchar_t wc;
-            int char_bytes = utf8_decode_at(ed->buffer, pos, buf_len, &wc);
-            current_col += wchar_display_width(wc);
-            pos += char_bytes;
-        }
+/* Soft wrap: keep the cursor's row within the view, counting wrapped rows */
+static void editor_wrap_scroll_to_cursor(Editor *ed) {
+    VisualRow v;
+    v.line = ed->cursor_row - 1;
+    v.line_start = buffer_line_start(ed->buffer, ed->cursor_pos);
+    v.row = wrap_row_of(ed->wrap_layout, v.line_start, ed->cursor_pos);
+
+    ed->scroll_col = 0;
+
+    if (v.line < ed->scroll_row || (v.line == ed->scroll_row && v.row < ed->scroll_subrow)) {
+        ed->scroll_row = v.line;
+        ed->scroll_subrow = v.row;
+        return;
     }
 
-    return pos;
+    /* Walk up at most a screenful; if the top row isn't met the cursor is below the view */
+    for (int n = 1; n < ed->edit_height; n++) {
+        if (v.line == ed->scroll_row && v.row == ed->scroll_subrow) return;
+        if (!editor_visual_row_up(ed, &v)) break;
+    }
+    ed->scroll_row = v.line;
+    ed->scroll_subrow = v.row;
+}
+
+/* Soft wrap: move to the same column of the wrapped row above or below */
+static void editor_wrap_move_vertical(Editor *ed, bool down) {
+    VisualRow v;
+    size_t row_col;
+    v.line = 0;
+    v.line_start = buffer_line_start(ed->buffer, ed->cursor_pos);
+    v.row = wrap_row_of(ed->wrap_layout, v.line_start, ed->cursor_pos);
+    if (!wrap_row_span(ed->wrap_layout, v.line_start, v.row, NULL, NULL, &row_col)) return;
+
+    size_t x = ed->cursor_col - row_col;
+    if (!(down ? editor_visual_row_down(ed, &v) : editor_visual_row_up(ed, &v))) return;
+
+    size_t row_end;
+    wrap_row_span(ed->wrap_layout, v.line_start, v.row, NULL, &row_end, &row_col);
+    ed->cursor_pos = column_to_pos(ed->col_index, v.line_start, row_col + x, NULL);
+
+    /* Stay on the row: its end is where the next row starts */
+    if (ed->cursor_pos >= row_end &&
+        wrap_row_span(ed->wrap_layout, v.line_start, v.row + 1, NULL, NULL, NULL)) {
+        ed->cursor_pos = unicode_prev_cluster(ed->buffer, row_end);
+    }
 }
 
 void editor_scroll_to_cursor(Editor *ed) {
@@ -336,6 +328,11 @@ void editor_scroll_to_cursor(Editor *ed) {
 
     editor_update_cursor_position(ed);
 
+    if (ed->soft_wrap) {
+        editor_wrap_scroll_to_cursor(ed);
+        return;
+    }
+
     /* Vertical scrolling */
     if (ed->cursor_row <= ed->scroll_row) {
         ed->scroll_row = ed->cursor_row - 1;
@@ -355,6 +352,7 @@ void editor_scroll_to_cursor(Editor *ed) {
 
 void editor_scroll_up(Editor *ed, int lines) {
     if (!ed) return;
+    ed->scroll_subrow = 0;
     if (ed->scroll_row >= (size_t)lines) {
         ed->scroll_row -= lines;
     } else {
@@ -365,6 +363,7 @@ void editor_scroll_up(Editor *ed, int lines) {
 void editor_scroll_down(Editor *ed, int lines) {
     if (!ed || !ed->buffer) return;
     size_t total_lines = buffer_count_lines(ed->buffer);
+    ed->scroll_subrow = 0;
     ed->scroll_row += lines;
     if (ed->scroll_row + (size_t)ed->edit_height > total_lines) {
         if (total_lines > (size_t)ed->edit_height) {
@@ -379,12 +378,8 @@ void editor_scroll_down(Editor *ed, int lines) {
 void editor_move_left(Editor *ed) {
     if (!ed || !ed->buffer || ed->cursor_pos == 0) return;
 
-    /* Move back to the start of the previous UTF-8 character */
-    ed->cursor_pos--;
-    /* Skip continuation bytes (10xxxxxx) */
-    while (ed->cursor_pos > 0 && is_utf8_cont((unsigned char)buffer_get_char(ed->buffer, ed->cursor_pos))) {
-        ed->cursor_pos--;
-    }
+    /* Move back to the start of the previous character and its marks */
+    ed->cursor_pos = unicode_prev_cluster(ed->buffer, ed->cursor_pos);
 
     if (ed->selection.active) {
         editor_update_selection(ed);
@@ -396,13 +391,8 @@ void editor_move_right(Editor *ed) {
     if (!ed || !ed->buffer) return;
     size_t buf_len = buffer_get_length(ed->buffer);
     if (ed->cursor_pos < buf_len) {
-        /* Get the length of the current UTF-8 character and skip it */
-        unsigned char c = (unsigned char)buffer_get_char(ed->buffer, ed->cursor_pos);
-        int char_bytes = utf8_char_len(c);
-        ed->cursor_pos += char_bytes;
-        if (ed->cursor_pos > buf_len) {
-            ed->cursor_pos = buf_len;
-        }
+        /* Skip the current character and any marks on it */
+        ed->cursor_pos = unicode_next_cluster(ed->buffer, ed->cursor_pos);
         if (ed->selection.active) {
             editor_update_selection(ed);
         }
@@ -413,17 +403,21 @@ void editor_move_right(Editor *ed) {
 void editor_move_up(Editor *ed) {
     if (!ed || !ed->buffer) return;
 
-    size_t target_col = ed->cursor_col;
-    size_t current_row = buffer_get_line_number(ed->buffer, ed->cursor_pos);
+    if (ed->soft_wrap) {
+        editor_wrap_move_vertical(ed, false);
+    } else {
+        size_t target_col = ed->cursor_col;
+        size_t current_row = buffer_get_line_number(ed->buffer, ed->cursor_pos);
 
-    if (current_row > 1) {
-        size_t prev_line_start = buffer_prev_line(ed->buffer, ed->cursor_pos);
-        ed->cursor_pos = editor_row_col_to_pos(ed, current_row - 1, target_col);
+        if (current_row > 1) {
+            size_t prev_line_start = buffer_prev_line(ed->buffer, ed->cursor_pos);
+            ed->cursor_pos = editor_row_col_to_pos(ed, current_row - 1, target_col);
 
-        /* Don't go past end of line */
-        size_t line_end = buffer_line_end(ed->buffer, prev_line_start);
-        if (ed->cursor_pos > line_end) {
-            ed->cursor_pos = line_end;
+            /* Don't go past end of line */
+            size_t line_end = buffer_line_end(ed->buffer, prev_line_start);
+            if (ed->cursor_pos > line_end) {
+                ed->cursor_pos = line_end;
+            }
         }
     }
 
@@ -436,18 +430,22 @@ void editor_move_up(Editor *ed) {
 void editor_move_down(Editor *ed) {
     if (!ed || !ed->buffer) return;
 
-    size_t target_col = ed->cursor_col;
-    size_t current_row = buffer_get_line_number(ed->buffer, ed->cursor_pos);
-    size_t total_lines = buffer_count_lines(ed->buffer);
-
-    if (current_row < total_lines) {
-        size_t next_line_start = buffer_next_line(ed->buffer, ed->cursor_pos);
-        ed->cursor_pos = editor_row_col_to_pos(ed, current_row + 1, target_col);
-
-        /* Don't go past end of line */
-        size_t line_end = buffer_line_end(ed->buffer, next_line_start);
-        if (ed->cursor_pos > line_end) {
-            ed->cursor_pos = line_end;
+    if (ed->soft_wrap) {
+        editor_wrap_move_vertical(ed, true);
+    } else {
+        size_t target_col = ed->cursor_col;
+        size_t current_row = buffer_get_line_number(ed->buffer, ed->cursor_pos);
+        size_t total_lines = buffer_count_lines(ed->buffer);
+
+        if (current_row < total_lines) {
+            size_t next_line_start = buffer_next_line(ed->buffer, ed->cursor_pos);
+            ed->cursor_pos = editor_row_col_to_pos(ed, current_row + 1, target_col);
+
+            /* Don't go past end of line */
+            size_t line_end = buffer_line_end(ed->buffer, next_line_start);
+            if (ed->cursor_pos > line_end) {
+                ed->cursor_pos = line_end;
+            }
         }
     }
 
@@ -591,49 +589,178 @@ void editor_goto_line(Editor *ed, size_t line) {
 
     size_t total_lines = buffer_count_lines(ed->buffer);
     if (line < 1) line = 1;
-    if (line > total_lines) line = total_lines;
+    if (line > total_lines) {
+        line = total_lines;
+
+        /* A large file's line count grows while its index is built */
+        if (ed->buffer->paged && !paged_index_complete(ed->buffer->paged)) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "Only %zu lines indexed so far", total_lines);
+            editor_set_status_message(ed, msg);
+        }
+    }
 
     ed->cursor_pos = buffer_get_line_start(ed->buffer, line);
     editor_scroll_to_cursor(ed);
 }
 
+/* Multi-selection bookkeeping.
+ * ed->selection.ranges is kept sorted by start, with start <= end and no
+ * overlaps, so the renderer can binary search it and edits can walk it
+ * from the end without re-sorting. */
+
+static int selection_compare(const void *a, const void *b) {
+    const SelectionRange *ra = (const SelectionRange *)a;
+    const SelectionRange *rb = (const SelectionRange *)b;
+    if (ra->start != rb->start) return ra->start < rb->start ? -1 : 1;
+    if (ra->end != rb->end) return ra->end < rb->end ? -1 : 1;
+    return 0;
+}
+
+void editor_normalize_selection(Editor *ed) {
+    if (!ed || ed->selection.count == 0) return;
+
+    SelectionRange *ranges = ed->selection.ranges;
+    int count = ed->selection.count;
+    bool sorted = true;
+
+    for (int i = 0; i < count; i++) {
+        if (ranges[i].start > ranges[i].end) {
+            size_t tmp = ranges[i].start;
+            ranges[i].start = ranges[i].end;
+            ranges[i].end = tmp;
+        }
+        if (i > 0 && selection_compare(&ranges[i - 1], &ranges[i]) > 0) {
+            sorted = false;
+        }
+    }
+
+    if (!sorted) {
+        qsort(ranges, count, sizeof(SelectionRange), selection_compare);
+    }
+
+    /* Merge overlapping ranges and duplicate cursors */
+    int out = 0;
+    for (int i = 1; i < count; i++) {
+        SelectionRange *last = &ranges[out];
+        bool overlaps = ranges[i].start < last->end;
+        bool duplicate = ranges[i].start == last->start && ranges[i].end == last->end;
+        if (overlaps || duplicate) {
+            if (ranges[i].end > last->end) {
+                last->end = ranges[i].end;
+            }
+            last->cursor = last->end;
+        } else {
+            ranges[++out] = ranges[i];
+        }
+    }
+    ed->selection.count = out + 1;
+}
+
+int editor_selection_index_after(Editor *ed, size_t pos) {
+    if (!ed) return 0;
+
+    int lo = 0, hi = ed->selection.count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ed->selection.ranges[mid].end <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Record the edit made at one range: removed bytes at pos, cursor lands at new_pos.
+ * Positions are still relative to the text before lower ranges were edited. */
+static void selection_record_edit(SelectionRange *range, size_t pos, size_t removed, size_t new_pos) {
+    range->start = pos;
+    range->end = pos + removed;
+    range->cursor = new_pos;
+}
+
+/* After editing every range from the end, apply the net shift of all lower
+ * edits to each range in one ascending pass and collapse them to cursors */
+static void selection_settle_edits(Editor *ed, size_t inserted) {
+    long shift = 0;
+
+    for (int i = 0; i < ed->selection.count; i++) {
+        SelectionRange *range = &ed->selection.ranges[i];
+        size_t pos = (size_t)((long)range->cursor + shift);
+        shift += (long)inserted - (long)(range->end - range->start);
+        range->start = pos;
+        range->end = pos;
+        range->cursor = pos;
+    }
+
+    editor_normalize_selection(ed);
+
+    ed->cursor_pos = ed->selection.ranges[0].cursor;
+    ed->selection.active = true;
+}
+
 /* Text operations */
+bool editor_check_writable(Editor *ed) {
+    if (ed && ed->searching) {
+        editor_set_status_message(ed, "Search running (Esc stops)");
+        return false;
+    }
+    if (!ed || !ed->readonly) return ed != NULL;
+    editor_set_status_message(ed, ed->buffer->paged ? "Large file is read-only (Edit > Allow Editing)"
+                                                    : "Buffer is read-only");
+    return false;
+}
+
+/* Edits to a large file are kept in memory over the mapped file, which needs
+ * every line indexed first */
+void editor_allow_editing(Editor *ed) {
+    if (!ed) return;
+
+    PagedFile *pf = ed->buffer->paged;
+    if (ed->searching) {
+        editor_set_status_message(ed, "Search running (Esc stops)");
+    } else if (!ed->readonly) {
+        editor_set_status_message(ed, "Buffer is already editable");
+    } else if (!pf) {
+        editor_set_status_message(ed, "Buffer is read-only");
+    } else if (paged_index_percent(pf) < 0 && !paged_index_complete(pf)) {
+        editor_set_status_message(ed, "Line index failed; file stays read-only");
+    } else if (!paged_index_complete(pf)) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Still indexing lines (%d%%)", paged_index_percent(pf));
+        editor_set_status_message(ed, msg);
+    } else if (!paged_allow_editing(pf)) {
+        editor_set_status_message(ed, "Out of memory");
+    } else {
+        ed->readonly = false;
+        editor_set_status_message(ed, "Editing enabled; changes stay in memory until saved");
+    }
+}
+
 void editor_insert_char(Editor *ed, char c) {
-    if (!ed || !ed->buffer) return;
+    editor_insert_text(ed, &c, 1);
+}
+
+/* Insert text at the cursor (or every multi-select cursor) as one undo step */
+void editor_insert_text(Editor *ed, const char *text, size_t len) {
+    if (!ed || !ed->buffer || !text || len == 0) return;
+    if (!editor_check_writable(ed)) return;
 
     /* Handle multi-select */
     if (ed->selection.count > 0) {
-        debug_log("\n########## INSERT_CHAR '%c' (0x%02x) ##########\n", c, (unsigned char)c);
+        debug_log("\n########## INSERT_TEXT len=%zu first=0x%02x ##########\n", len, (unsigned char)text[0]);
         debug_log_state(ed, "ENTRY");
 
-        /* Sort selections by position (descending) to process from end first */
-        for (int i = 0; i < ed->selection.count - 1; i++) {
-            for (int j = i + 1; j < ed->selection.count; j++) {
-                if (ed->selection.ranges[i].start < ed->selection.ranges[j].start) {
-                    SelectionRange tmp = ed->selection.ranges[i];
-                    ed->selection.ranges[i] = ed->selection.ranges[j];
-                    ed->selection.ranges[j] = tmp;
-                }
-            }
-        }
-        debug_log_state(ed, "AFTER SORT");
-
         undo_begin_group(ed->undo);
 
-        /* Process from end to start - higher positions first so lower ones stay valid */
-        char str[2] = {c, '\0'};
-        int valid_count = ed->selection.count;
-
-        for (int i = 0; i < ed->selection.count; i++) {
+        /* Ranges are sorted ascending - process from the end so lower positions stay valid */
+        for (int i = ed->selection.count - 1; i >= 0; i--) {
             debug_log("--- LOOP ITERATION i=%d ---\n", i);
 
-            size_t start = ed->selection.ranges[i].start;
-            size_t end = ed->selection.ranges[i].end;
-            if (start > end) {
-                size_t tmp = start;
-                start = end;
-                end = tmp;
-            }
+            SelectionRange *range = &ed->selection.ranges[i];
+            size_t start = range->start;
+            size_t end = range->end;
 
             /* Bounds check */
             size_t buf_len = buffer_get_length(ed->buffer);
@@ -651,40 +778,17 @@ void editor_insert_char(Editor *ed, char c) {
                 buffer_delete_range(ed->buffer, start, end);
             }
 
-            /* Calculate how much this operation shifts higher positions */
-            size_t orig_end = ed->selection.ranges[i].end;
-            size_t orig_start = ed->selection.ranges[i].start;
-            if (orig_start > orig_end) { size_t t = orig_start; orig_start = orig_end; orig_end = t; }
-            int shift = 1 - (int)(orig_end - orig_start);
-
-            /* Insert the character and record undo */
-            debug_log("  INSERTING '%c' at %zu\n", c, start);
-            undo_record_insert(ed->undo, start, str, 1, start);
-            buffer_insert_char(ed->buffer, start, c);
-
-            /* Update THIS range to cursor after insert */
-            ed->selection.ranges[i].start = start + 1;
-            ed->selection.ranges[i].end = start + 1;
-            ed->selection.ranges[i].cursor = start + 1;
-
-            /* Shift all HIGHER positions (earlier in array) by net change */
-            for (int k = 0; k < i; k++) {
-                ed->selection.ranges[k].start += shift;
-                ed->selection.ranges[k].end += shift;
-                ed->selection.ranges[k].cursor += shift;
-            }
+            /* Insert the text and record undo */
+            debug_log("  INSERTING %zu bytes at %zu\n", len, start);
+            undo_record_insert(ed->undo, start, text, len, start);
+            buffer_insert_string(ed->buffer, start, text, len);
 
-            debug_log_state(ed, "LOOP END");
+            selection_record_edit(range, start, end - start, start + len);
         }
 
         undo_end_group(ed->undo);
 
-        if (valid_count > 0) {
-            ed->cursor_pos = ed->selection.ranges[valid_count - 1].start;
-            ed->selection.active = true;
-        } else {
-            ed->selection.active = false;
-        }
+        selection_settle_edits(ed, len);
         ed->modified = true;
 
         debug_log_state(ed, "COMPLETE");
@@ -696,11 +800,10 @@ void editor_insert_char(Editor *ed, char c) {
         editor_delete_selection(ed);
     }
 
-    char str[2] = {c, '\0'};
-    undo_record_insert(ed->undo, ed->cursor_pos, str, 1, ed->cursor_pos);
+    undo_record_insert(ed->undo, ed->cursor_pos, text, len, ed->cursor_pos);
 
-    buffer_insert_char(ed->buffer, ed->cursor_pos, c);
-    ed->cursor_pos++;
+    buffer_insert_string(ed->buffer, ed->cursor_pos, text, len);
+    ed->cursor_pos += len;
     ed->modified = true;
     editor_scroll_to_cursor(ed);
 }
@@ -721,42 +824,25 @@ void editor_insert_tab(Editor *ed) {
 
 void editor_delete_char(Editor *ed) {
     if (!ed || !ed->buffer) return;
+    if (!editor_check_writable(ed)) return;
 
     /* Handle multi-select */
     if (ed->selection.count > 0) {
-        /* Sort selections by position (descending) */
-        for (int i = 0; i < ed->selection.count - 1; i++) {
-            for (int j = i + 1; j < ed->selection.count; j++) {
-                if (ed->selection.ranges[i].start < ed->selection.ranges[j].start) {
-                    SelectionRange tmp = ed->selection.ranges[i];
-                    ed->selection.ranges[i] = ed->selection.ranges[j];
-                    ed->selection.ranges[j] = tmp;
-                }
-            }
-        }
-
         /* Begin undo group so all deletes can be undone together */
         undo_begin_group(ed->undo);
 
-        /* Delete selections from end to start */
-        size_t new_positions[MAX_SELECTIONS];
-        int valid_count = 0;
-
-        for (int i = 0; i < ed->selection.count; i++) {
-            size_t start = ed->selection.ranges[i].start;
-            size_t end = ed->selection.ranges[i].end;
-            if (start > end) {
-                size_t tmp = start;
-                start = end;
-                end = tmp;
-            }
+        /* Delete from the highest range down so lower positions stay valid */
+        for (int i = ed->selection.count - 1; i >= 0; i--) {
+            SelectionRange *range = &ed->selection.ranges[i];
+            size_t start = range->start;
+            size_t end = range->end;
 
             /* Bounds check */
             size_t buf_len = buffer_get_length(ed->buffer);
             if (start > buf_len) start = buf_len;
             if (end > buf_len) end = buf_len;
 
-            int deleted_len = 0;
+            size_t deleted_len = 0;
             if (end > start) {
                 /* Delete selection content */
                 char *deleted = buffer_get_range(ed->buffer, start, end);
@@ -765,7 +851,7 @@ void editor_delete_char(Editor *ed) {
                     free(deleted);
                 }
                 buffer_delete_range(ed->buffer, start, end);
-                deleted_len = (int)(end - start);
+                deleted_len = end - start;
             } else if (start < buf_len) {
                 /* Zero-width cursor: delete char forward */
                 char c = buffer_get_char(ed->buffer, start);
@@ -775,31 +861,13 @@ void editor_delete_char(Editor *ed) {
                 deleted_len = 1;
             }
 
-            new_positions[valid_count++] = start;
-
-            /* Shift all previously-processed (higher) positions down */
-            for (int k = 0; k < valid_count - 1; k++) {
-                new_positions[k] -= deleted_len;
-            }
+            selection_record_edit(range, start, deleted_len, start);
         }
 
         /* End undo group */
         undo_end_group(ed->undo);
 
-        /* Update ranges */
-        ed->selection.count = valid_count;
-        for (int i = 0; i < valid_count; i++) {
-            ed->selection.ranges[i].start = new_positions[i];
-            ed->selection.ranges[i].end = new_positions[i];
-            ed->selection.ranges[i].cursor = new_positions[i];
-        }
-
-        if (valid_count > 0) {
-            ed->cursor_pos = new_positions[valid_count - 1];
-            ed->selection.active = true;
-        } else {
-            ed->selection.active = false;
-        }
+        selection_settle_edits(ed, 0);
         ed->modified = true;
         editor_scroll_to_cursor(ed);
         return;
@@ -812,13 +880,8 @@ void editor_delete_char(Editor *ed) {
 
     size_t buf_len = buffer_get_length(ed->buffer);
     if (ed->cursor_pos < buf_len) {
-        /* Get the length of the current UTF-8 character */
-        unsigned char c = (unsigned char)buffer_get_char(ed->buffer, ed->cursor_pos);
-        int char_bytes = utf8_char_len(c);
-        size_t end_pos = ed->cursor_pos + char_bytes;
-        if (end_pos > buf_len) {
-            end_pos = buf_len;
-        }
+        /* Delete the current character together with its marks */
+        size_t end_pos = unicode_next_cluster(ed->buffer, ed->cursor_pos);
 
         char *deleted = buffer_get_range(ed->buffer, ed->cursor_pos, end_pos);
         if (deleted) {
@@ -833,42 +896,24 @@ void editor_delete_char(Editor *ed) {
 
 void editor_backspace(Editor *ed) {
     if (!ed || !ed->buffer) return;
+    if (!editor_check_writable(ed)) return;
 
     /* Handle multi-select */
     if (ed->selection.count > 0) {
-        /* Sort selections by position (descending) */
-        for (int i = 0; i < ed->selection.count - 1; i++) {
-            for (int j = i + 1; j < ed->selection.count; j++) {
-                if (ed->selection.ranges[i].start < ed->selection.ranges[j].start) {
-                    SelectionRange tmp = ed->selection.ranges[i];
-                    ed->selection.ranges[i] = ed->selection.ranges[j];
-                    ed->selection.ranges[j] = tmp;
-                }
-            }
-        }
-
         /* Begin undo group so all deletes can be undone together */
         undo_begin_group(ed->undo);
 
-        /* Delete selections from end to start */
-        size_t new_positions[MAX_SELECTIONS];
-        int valid_count = 0;
-
-        for (int i = 0; i < ed->selection.count; i++) {
-            size_t start = ed->selection.ranges[i].start;
-            size_t end = ed->selection.ranges[i].end;
-            if (start > end) {
-                size_t tmp = start;
-                start = end;
-                end = tmp;
-            }
+        /* Delete from the highest range down so lower positions stay valid */
+        for (int i = ed->selection.count - 1; i >= 0; i--) {
+            SelectionRange *range = &ed->selection.ranges[i];
+            size_t start = range->start;
+            size_t end = range->end;
 
             /* Bounds check */
             size_t buf_len = buffer_get_length(ed->buffer);
             if (start > buf_len) start = buf_len;
             if (end > buf_len) end = buf_len;
 
-            int deleted_len = 0;
             if (end > start) {
                 /* Delete selection content */
                 char *deleted = buffer_get_range(ed->buffer, start, end);
@@ -877,8 +922,7 @@ void editor_backspace(Editor *ed) {
                     free(deleted);
                 }
                 buffer_delete_range(ed->buffer, start, end);
-                deleted_len = (int)(end - start);
-                new_positions[valid_count++] = start;
+                selection_record_edit(range, start, end - start, start);
             } else if (start > 0) {
                 /* Zero-width cursor: delete char backward */
                 start--;
@@ -886,33 +930,16 @@ void editor_backspace(Editor *ed) {
                 char str[2] = {c, '\0'};
                 undo_record_delete(ed->undo, start, str, 1, start + 1);
                 buffer_delete_char(ed->buffer, start);
-                deleted_len = 1;
-                new_positions[valid_count++] = start;
-            }
-
-            /* Shift all previously-processed (higher) positions down */
-            for (int k = 0; k < valid_count - 1; k++) {
-                new_positions[k] -= deleted_len;
+                selection_record_edit(range, start, 1, start);
+            } else {
+                selection_record_edit(range, start, 0, start);
             }
         }
 
         /* End undo group */
         undo_end_group(ed->undo);
 
-        /* Update ranges */
-        ed->selection.count = valid_count;
-        for (int i = 0; i < valid_count; i++) {
-            ed->selection.ranges[i].start = new_positions[i];
-            ed->selection.ranges[i].end = new_positions[i];
-            ed->selection.ranges[i].cursor = new_positions[i];
-        }
-
-        if (valid_count > 0) {
-            ed->cursor_pos = new_positions[valid_count - 1];
-            ed->selection.active = true;
-        } else {
-            ed->selection.active = false;
-        }
+        selection_settle_edits(ed, 0);
         ed->modified = true;
         editor_scroll_to_cursor(ed);
         return;
@@ -927,7 +954,7 @@ void editor_backspace(Editor *ed) {
         /* Find the start of the previous UTF-8 character */
         size_t orig_pos = ed->cursor_pos;
         ed->cursor_pos--;
-        while (ed->cursor_pos > 0 && is_utf8_cont((unsigned char)buffer_get_char(ed->buffer, ed->cursor_pos))) {
+        while (ed->cursor_pos > 0 && unicode_is_continuation((unsigned char)buffer_get_char(ed->buffer, ed->cursor_pos))) {
             ed->cursor_pos--;
         }
 
@@ -947,6 +974,7 @@ void editor_backspace(Editor *ed) {
 
 void editor_delete_line(Editor *ed) {
     if (!ed || !ed->buffer) return;
+    if (!editor_check_writable(ed)) return;
 
     size_t line_start = buffer_line_start(ed->buffer, ed->cursor_pos);
     size_t line_end = buffer_line_end(ed->buffer, ed->cursor_pos);
@@ -1020,6 +1048,7 @@ char *editor_get_selection(Editor *ed) {
 
 void editor_delete_selection(Editor *ed) {
     if (!ed || !ed->buffer || !editor_has_selection(ed)) return;
+    if (!editor_check_writable(ed)) return;
 
     size_t start = ed->selection.start;
     size_t end = ed->selection.end;
@@ -1099,9 +1128,8 @@ bool editor_add_next_occurrence(Editor *ed) {
         size_t end = first->start < first->end ? first->end : first->start;
         search_text = buffer_get_range(ed->buffer, start, end);
         search_len = end - start;
-        /* Search from after the last selection */
-        SelectionRange *last = &ed->selection.ranges[ed->selection.count - 1];
-        search_from = last->end;
+        /* Search from after the most recently added selection (the cursor) */
+        search_from = ed->cursor_pos;
     } else if (editor_has_selection(ed)) {
         /* First Ctrl+D with a selection - convert to multi-select */
         size_t start = ed->selection.start < ed->selection.end ? ed->selection.start : ed->selection.end;
@@ -1153,13 +1181,9 @@ bool editor_add_next_occurrence(Editor *ed) {
         }
         if (match) {
             /* Check if this position is already selected */
-            bool already_selected = false;
-            for (int k = 0; k < ed->selection.count; k++) {
-                if (ed->selection.ranges[k].start == i) {
-                    already_selected = true;
-                    break;
-                }
-            }
+            int k = editor_selection_index_after(ed, i);
+            bool already_selected = k < ed->selection.count &&
+                                    ed->selection.ranges[k].start <= i;
             if (!already_selected) {
                 found = true;
                 found_pos = i;
@@ -1178,13 +1202,9 @@ bool editor_add_next_occurrence(Editor *ed) {
                 }
             }
             if (match) {
-                bool already_selected = false;
-                for (int k = 0; k < ed->selection.count; k++) {
-                    if (ed->selection.ranges[k].start == i) {
-                        already_selected = true;
-                        break;
-                    }
-                }
+                int k = editor_selection_index_after(ed, i);
+                bool already_selected = k < ed->selection.count &&
+                                        ed->selection.ranges[k].start <= i;
                 if (!already_selected) {
                     found = true;
                     found_pos = i;
@@ -1203,6 +1223,7 @@ bool editor_add_next_occurrence(Editor *ed) {
         ed->selection.ranges[idx].end = found_pos + search_len;
         ed->selection.ranges[idx].cursor = found_pos + search_len;
         ed->selection.count++;
+        editor_normalize_selection(ed);
 
         /* Move cursor to the new selection */
         ed->cursor_pos = found_pos + search_len;
@@ -1221,6 +1242,7 @@ bool editor_add_next_occurrence(Editor *ed) {
 /* Clipboard operations */
 void editor_cut(Editor *ed) {
     if (!ed || !ed->buffer) return;
+    if (!editor_check_writable(ed)) return;
 
     if (editor_has_selection(ed)) {
         /* Cut selection */
@@ -1289,25 +1311,16 @@ void editor_copy(Editor *ed) {
 void editor_paste(Editor *ed) {
     if (!ed || !ed->buffer || clipboard_empty(ed->clipboard)) return;
 
-    if (editor_has_selection(ed)) {
-        editor_delete_selection(ed);
-    }
-
     char *text = clipboard_get(ed->clipboard);
     size_t len = clipboard_length(ed->clipboard);
 
-    if (text && len > 0) {
-        undo_record_insert(ed->undo, ed->cursor_pos, text, len, ed->cursor_pos);
-        buffer_insert_string(ed->buffer, ed->cursor_pos, text, len);
-        ed->cursor_pos += len;
-        ed->modified = true;
-        editor_scroll_to_cursor(ed);
-    }
+    editor_insert_text(ed, text, len);
 }
 
 /* Undo/Redo */
 void editor_undo(Editor *ed) {
     if (!ed || !undo_can_undo(ed->undo)) return;
+    if (!editor_check_writable(ed)) return;
 
     int group_id = undo_peek_group(ed->undo);
     debug_log("\n=== UNDO group_id=%d ===\n", group_id);
@@ -1399,6 +1412,7 @@ void editor_undo(Editor *ed) {
 
 void editor_redo(Editor *ed) {
     if (!ed || !undo_can_redo(ed->undo)) return;
+    if (!editor_check_writable(ed)) return;
 
     int group_id = redo_peek_group(ed->undo);
 
@@ -1479,9 +1493,13 @@ void editor_set_status_message(Editor *ed, const char *msg) {
         strncpy(ed->status_message, msg, sizeof(ed->status_message) - 1);
         ed->status_message[sizeof(ed->status_message) - 1] = '\0';
         ed->status_message_time = time(NULL);
+        /* Wake the main loop to clear it; time() has whole-second
+         * granularity so this is never early */
+        event_schedule(EVENT_TIMER_STATUS, STATUS_MESSAGE_SECONDS * 1000L);
     } else {
         ed->status_message[0] = '\0';
         ed->status_message_time = 0;
+        event_cancel(EVENT_TIMER_STATUS);
     }
 }
 
@@ -1513,6 +1531,7 @@ void editor_hex_update_scroll(Editor *ed) {
 
 void editor_hex_set_byte(Editor *ed, unsigned char value) {
     if (!ed || !ed->buffer) return;
+    if (!editor_check_writable(ed)) return;
 
     size_t buf_len = buffer_get_length(ed->buffer);
     if (ed->cursor_pos >= buf_len) return;
@@ -10,6 +10,11 @@ typedef struct Buffer Buffer;
 typedef struct UndoStack UndoStack;
 typedef struct Clipboard Clipboard;
 typedef struct ExplorerState ExplorerState;
+typedef struct HighlightCache HighlightCache;
+typedef struct ColumnIndex ColumnIndex;
+typedef struct WrapLayout WrapLayout;
+typedef struct FileLoad FileLoad;
+typedef struct SearchJob SearchJob;
 
 /* Editor mode */
 typedef enum {
@@ -53,6 +58,7 @@ typedef struct Editor {
     /* Scroll position */
     size_t scroll_row;      /* First visible row (0-based) */
     size_t scroll_col;      /* First visible column (0-based) */
+    size_t scroll_subrow;   /* First visible wrapped row of that line */
 
     /* Screen dimensions */
     int screen_rows;
@@ -61,6 +67,7 @@ typedef struct Editor {
     int edit_height;        /* Height of edit area */
     int edit_left;          /* Left column of edit area */
     int edit_width;         /* Width of edit area */
+    int gutter_width;       /* Line number gutter width (0 when hidden) */
 
     /* Selection */
     Selection selection;
@@ -69,11 +76,14 @@ typedef struct Editor {
     char filename[MAX_FILENAME];
     bool modified;
     bool readonly;
+    FileLoad *loading;      /* Background load still reading the file, or NULL */
+    SearchJob *searching;   /* Background search of a large file, or NULL */
 
     /* View options */
     bool show_line_numbers;
     bool show_status_bar;
     bool use_acs_chars;         /* Use ACS instead of Unicode box-drawing */
+    bool soft_wrap;             /* Wrap long lines at the edit width */
 
     /* Editor state */
     EditorMode mode;
@@ -91,6 +101,18 @@ typedef struct Editor {
     /* Syntax highlighting */
     LanguageType syntax_lang;
     bool syntax_enabled;
+    HighlightCache *hl_cache;   /* Highlight state checkpoints */
+
+    /* Column checkpoints for long lines */
+    ColumnIndex *col_index;
+
+    /* Wrapped rows of the lines around the view (soft wrap) */
+    WrapLayout *wrap_layout;
+
+    /* Frame pacing */
+    int frame_interval_ms;      /* Minimum time between redraws while input keeps arriving */
+    int keys_per_frame;         /* Keys handled before the last redraw */
+    int keys_per_frame_peak;    /* Largest batch seen */
 
     /* Hex editing mode */
     bool hex_mode;              /* Hex view enabled */
@@ -116,6 +138,7 @@ Editor *editor_create(void);
 void editor_destroy(Editor *ed);
 void editor_init_screen(Editor *ed);
 void editor_update_dimensions(Editor *ed);
+int editor_gutter_width(Editor *ed);
 
 /* Cursor movement */
 void editor_move_left(Editor *ed);
@@ -133,7 +156,10 @@ void editor_move_word_right(Editor *ed);
 void editor_goto_line(Editor *ed, size_t line);
 
 /* Text operations */
+bool editor_check_writable(Editor *ed);     /* False, with a message, when read-only */
+void editor_allow_editing(Editor *ed);      /* Make a large file viewed in place editable */
 void editor_insert_char(Editor *ed, char c);
+void editor_insert_text(Editor *ed, const char *text, size_t len);
 void editor_insert_newline(Editor *ed);
 void editor_insert_tab(Editor *ed);
 void editor_delete_char(Editor *ed);
@@ -154,6 +180,8 @@ void editor_delete_selection(Editor *ed);
 bool editor_add_next_occurrence(Editor *ed);
 bool editor_has_multi_selection(Editor *ed);
 void editor_clear_multi_selection(Editor *ed);
+void editor_normalize_selection(Editor *ed);
+int editor_selection_index_after(Editor *ed, size_t pos);
 
 /* Clipboard operations */
 void editor_cut(Editor *ed);
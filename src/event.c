@@ -0,0 +1,245 @@
+#include "smashedit.h"
+#include <signal.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#ifdef _WIN32
+#include <stdatomic.h>
+#else
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Timer deadlines in event_now_ms() time, -1 when not scheduled.
+ * Timers belong to the main thread; only event_wake is thread-safe. */
+static long g_deadlines[EVENT_TIMER_COUNT];
+
+long event_now_ms(void) {
+#ifdef _WIN32
+    return (long)(clock() * 1000 / CLOCKS_PER_SEC);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+void event_schedule(EventTimer timer, long delay_ms) {
+    if (timer < 0 || timer >= EVENT_TIMER_COUNT) return;
+    if (delay_ms < 0) delay_ms = 0;
+    g_deadlines[timer] = event_now_ms() + delay_ms;
+}
+
+void event_cancel(EventTimer timer) {
+    if (timer < 0 || timer >= EVENT_TIMER_COUNT) return;
+    g_deadlines[timer] = -1;
+}
+
+/* Clear expired timers, returns EVENT_TIMER if any fired */
+static int event_expire_timers(void) {
+    long now = event_now_ms();
+    int flags = 0;
+    for (int i = 0; i < EVENT_TIMER_COUNT; i++) {
+        if (g_deadlines[i] >= 0 && g_deadlines[i] <= now) {
+            g_deadlines[i] = -1;
+            flags |= EVENT_TIMER;
+        }
+    }
+    return flags;
+}
+
+/* Milliseconds until the next timer, or -1 to wait forever */
+static int event_next_timeout(void) {
+    long now = event_now_ms();
+    long wait = -1;
+    for (int i = 0; i < EVENT_TIMER_COUNT; i++) {
+        if (g_deadlines[i] < 0) continue;
+        long remaining = g_deadlines[i] > now ? g_deadlines[i] - now : 0;
+        if (wait < 0 || remaining < wait) wait = remaining;
+    }
+    return wait > INT_MAX ? INT_MAX : (int)wait;
+}
+
+#ifndef _WIN32
+
+/* Self-pipe: signal handlers write the signal number, event_wake writes 0 */
+static int g_pipe[2] = {-1, -1};
+
+static void event_signal_handler(int sig) {
+    int saved_errno = errno;
+    unsigned char byte = (unsigned char)sig;
+    ssize_t written = write(g_pipe[1], &byte, 1);
+    (void)written;  /* A full pipe already has a wake-up pending */
+    errno = saved_errno;
+}
+
+static bool event_set_flags(int fd) {
+    int fl = fcntl(fd, F_GETFL);
+    int fd_fl = fcntl(fd, F_GETFD);
+    return fl >= 0 && fd_fl >= 0 &&
+           fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0 &&
+           fcntl(fd, F_SETFD, fd_fl | FD_CLOEXEC) == 0;
+}
+
+bool event_init(void) {
+    for (int i = 0; i < EVENT_TIMER_COUNT; i++) {
+        g_deadlines[i] = -1;
+    }
+
+    if (pipe(g_pipe) != 0) return false;
+    if (!event_set_flags(g_pipe[0]) || !event_set_flags(g_pipe[1])) {
+        event_shutdown();
+        return false;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = event_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;  /* Keep blocking getch in dialogs from failing */
+
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+#ifdef SIGWINCH
+    sigaction(SIGWINCH, &sa, NULL);
+#endif
+
+    return true;
+}
+
+void event_shutdown(void) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+#ifdef SIGWINCH
+    signal(SIGWINCH, SIG_DFL);
+#endif
+
+    for (int i = 0; i < 2; i++) {
+        if (g_pipe[i] >= 0) {
+            close(g_pipe[i]);
+            g_pipe[i] = -1;
+        }
+    }
+}
+
+void event_wake(void) {
+    if (g_pipe[1] < 0) return;
+    unsigned char byte = 0;
+    ssize_t written = write(g_pipe[1], &byte, 1);
+    (void)written;
+}
+
+/* Read everything queued on the self-pipe */
+static int event_drain_pipe(void) {
+    int flags = 0;
+    unsigned char bytes[64];
+    ssize_t n;
+
+    while ((n = read(g_pipe[0], bytes, sizeof(bytes))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            switch (bytes[i]) {
+                case 0:
+                    flags |= EVENT_WAKE;
+                    break;
+#ifdef SIGWINCH
+                case SIGWINCH:
+                    flags |= EVENT_RESIZE;
+                    break;
+#endif
+                default:
+                    flags |= EVENT_TERMINATE;
+                    break;
+            }
+        }
+    }
+    return flags;
+}
+
+int event_wait(void) {
+    for (;;) {
+        int flags = event_expire_timers();
+        if (flags) return flags;
+
+        struct pollfd fds[2] = {
+            {STDIN_FILENO, POLLIN, 0},
+            {g_pipe[0], POLLIN, 0}
+        };
+        int nfds = g_pipe[0] >= 0 ? 2 : 1;
+
+        int ready = poll(fds, nfds, event_next_timeout());
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return EVENT_INPUT;  /* Fall back to a blocking read */
+        }
+
+        if (nfds > 1 && (fds[1].revents & POLLIN)) {
+            flags |= event_drain_pipe();
+        }
+        if (fds[0].revents & POLLIN) {
+            flags |= EVENT_INPUT;
+        } else if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            flags |= EVENT_TERMINATE;  /* Terminal closed */
+        }
+        flags |= event_expire_timers();
+
+        if (flags) return flags;
+    }
+}
+
+#else /* _WIN32 */
+
+/* No poll() on console handles - wait in getch with a short timeout instead */
+#define EVENT_POLL_MS 50
+
+static volatile sig_atomic_t g_terminate = 0;
+static atomic_int g_wake = 0;
+
+static void event_signal_handler(int sig) {
+    (void)sig;
+    g_terminate = 1;
+}
+
+bool event_init(void) {
+    for (int i = 0; i < EVENT_TIMER_COUNT; i++) {
+        g_deadlines[i] = -1;
+    }
+    signal(SIGINT, event_signal_handler);
+    signal(SIGTERM, event_signal_handler);
+    return true;
+}
+
+void event_shutdown(void) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+}
+
+void event_wake(void) {
+    atomic_store(&g_wake, 1);
+}
+
+int event_wait(void) {
+    for (;;) {
+        int flags = event_expire_timers();
+
+        if (g_terminate) flags |= EVENT_TERMINATE;
+        if (atomic_exchange(&g_wake, 0)) flags |= EVENT_WAKE;
+        if (flags) return flags;
+
+        int wait = event_next_timeout();
+        if (wait < 0 || wait > EVENT_POLL_MS) wait = EVENT_POLL_MS;
+
+        timeout(wait);
+        int key = getch();
+        timeout(-1);
+
+        if (key != ERR) {
+            ungetch(key);
+            return EVENT_INPUT;
+        }
+    }
+}
+
+#endif /* _WIN32 */
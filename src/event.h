@@ -0,0 +1,39 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdbool.h>
+
+/* What woke the main loop - event_wait returns a mask of these */
+typedef enum {
+    EVENT_INPUT     = 1 << 0,   /* Terminal input is ready */
+    EVENT_RESIZE    = 1 << 1,   /* SIGWINCH arrived */
+    EVENT_TERMINATE = 1 << 2,   /* SIGTERM/SIGINT/SIGHUP or the terminal went away */
+    EVENT_TIMER     = 1 << 3,   /* A scheduled timer expired */
+    EVENT_WAKE      = 1 << 4    /* event_wake() was called, e.g. by a worker thread */
+} EventFlags;
+
+/* One-shot timers, each slot holds at most one deadline */
+typedef enum {
+    EVENT_TIMER_STATUS,         /* Status bar message expiry */
+    EVENT_TIMER_FRAME,          /* Next redraw allowed by the frame interval */
+    EVENT_TIMER_COUNT
+} EventTimer;
+
+/* Lifecycle - installs the signal handlers */
+bool event_init(void);
+void event_shutdown(void);
+
+/* Block until input, a signal, a timer or a wake-up; returns EventFlags */
+int event_wait(void);
+
+/* Timers */
+void event_schedule(EventTimer timer, long delay_ms);
+void event_cancel(EventTimer timer);
+
+/* Wake event_wait from any thread */
+void event_wake(void);
+
+/* Monotonic clock in milliseconds */
+long event_now_ms(void);
+
+#endif /* EVENT_H */
@@ -308,6 +308,8 @@ static void explorer_filter_and_select(ExplorerState *state) {
 }
 
 static void explorer_draw(ExplorerState *state, int rows, int cols) {
+    display_invalidate();
+
     /* Use full screen */
     int box_y = 0;
     int box_x = 0;
@@ -517,7 +519,7 @@ bool explorer_open(Editor *ed) {
 
         /* Use halfdelay for timeout-based input */
         halfdelay(5);  /* 0.5 second timeout */
-        int key = getch();
+        int key = input_get_key();
         cbreak();  /* Return to normal mode */
 
         if (key == ERR) {
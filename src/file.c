@@ -1,12 +1,255 @@
+#define _DEFAULT_SOURCE  /* MAP_POPULATE and madvise alongside _XOPEN_SOURCE */
 #include "smashedit.h"
 #include <stdio.h>
 #include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+/* Copy len bytes to dst without CR characters (Windows line endings) and
+ * return the bytes kept. dst may be src. Runs between CRs are found and
+ * moved with memchr and memmove, which the C library vectorises. */
+static size_t file_strip_cr(char *dst, const char *src, size_t len) {
+    char *out = dst;
+    const char *end = src + len;
+
+    while (src < end) {
+        const char *cr = memchr(src, '\r', end - src);
+        size_t run = (cr ? cr : end) - src;
+        memmove(out, src, run);
+        out += run;
+        if (!cr) break;
+        src = cr + 1;
+    }
+    return out - dst;
+}
+
+/* Length of a UTF-8 byte order mark at the start of data, if any */
+static size_t file_bom_length(const char *data, size_t len) {
+    if (len >= 3 &&
+        (unsigned char)data[0] == 0xEF &&
+        (unsigned char)data[1] == 0xBB &&
+        (unsigned char)data[2] == 0xBF) {
+        return 3;
+    }
+    return 0;
+}
+
+/* Map a regular file and normalise it straight into the (empty) buffer */
+static bool file_load_mapped(Buffer *buf, int fd, size_t size) {
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;  /* Fault the pages in up front; they're all read once */
+#endif
+    char *map = mmap(NULL, size, PROT_READ, flags, fd, 0);
+    if (map == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+    madvise(map, size, MADV_SEQUENTIAL);
+#endif
+
+    size_t bom = file_bom_length(map, size);
+    char *dst = buffer_reserve(buf, 0, size - bom);
+    if (dst) {
+        buffer_commit(buf, file_strip_cr(dst, map + bom, size - bom));
+    }
+
+    munmap(map, size);
+    return dst != NULL;
+}
+
+/* Read a file that can't be mapped (pipes, /proc) a chunk at a time */
+static bool file_load_stream(Buffer *buf, int fd) {
+    bool first_chunk = true;
+
+    for (;;) {
+        char *dst = buffer_reserve(buf, buffer_get_length(buf), FILE_READ_CHUNK);
+        if (!dst) return false;
+
+        ssize_t n = read(fd, dst, FILE_READ_CHUNK);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return n == 0;
+
+        size_t bom = first_chunk ? file_bom_length(dst, (size_t)n) : 0;
+        first_chunk = false;
+        buffer_commit(buf, file_strip_cr(dst, dst + bom, (size_t)n - bom));
+    }
+}
+
+/* A large file being read into the buffer a chunk at a time by a worker.
+ * Exactly one chunk job is queued while it runs; its completion appends the
+ * chunk and queues the next one, and frees the load once detached. */
+struct FileLoad {
+    Editor *ed;             /* NULL once the editor has let go of the load */
+    JobToken *token;
+    int fd;
+    size_t size;            /* File size when opened, for progress */
+    size_t offset;          /* File bytes read so far (worker) */
+    size_t progress;        /* File bytes appended so far (main thread) */
+    char *chunk;            /* Text read by the last job, CRs removed */
+    size_t chunk_len;
+    bool at_end;            /* End of file reached or a read failed */
+    int error;              /* errno of a failed read */
+};
+
+static void file_load_free(FileLoad *load) {
+    close(load->fd);
+    free(load->chunk);
+    job_token_release(load->token);
+    free(load);
+}
+
+/* Stop a background load; what it read so far stays in the buffer */
+static void file_load_detach(Editor *ed) {
+    if (!ed->loading) return;
+
+    job_token_cancel(ed->loading->token);
+    ed->loading->ed = NULL;     /* The queued job's completion frees it */
+    ed->loading = NULL;
+}
+
+/* Worker: read and normalise the next chunk */
+static void file_load_chunk_run(void *arg, const JobToken *token) {
+    FileLoad *load = arg;
+    size_t got = 0;
+
+    while (got < FILE_LOAD_CHUNK && !job_token_cancelled(token)) {
+        ssize_t n = pread(load->fd, load->chunk + got, FILE_LOAD_CHUNK - got,
+                          (off_t)(load->offset + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n < 0) load->error = errno;
+            load->at_end = true;
+            break;
+        }
+        got += (size_t)n;
+    }
+
+    size_t bom = load->offset == 0 ? file_bom_length(load->chunk, got) : 0;
+    load->offset += got;
+    load->chunk_len = file_strip_cr(load->chunk, load->chunk + bom, got - bom);
+}
+
+/* Main thread: append the chunk, then read on or finish. The next read is
+ * only queued once this chunk is in, which leaves the main loop time for
+ * input and a redraw between chunks. */
+static void file_load_chunk_done(void *arg, bool cancelled) {
+    FileLoad *load = arg;
+    Editor *ed = load->ed;
+    if (cancelled || !ed) {
+        file_load_free(load);
+        return;
+    }
+
+    bool first = load->progress == 0;
+    buffer_insert_string(ed->buffer, buffer_get_length(ed->buffer), load->chunk, load->chunk_len);
+    load->progress = load->offset;
+
+    /* The first lines are in, so a shebang can name the language */
+    if (first && ed->syntax_lang == LANG_NONE) {
+        ed->syntax_lang = syntax_detect_from_shebang(ed->buffer);
+    }
+
+    if (!load->at_end) {
+        if (jobs_submit(file_load_chunk_run, file_load_chunk_done, load, load->token)) return;
+        load->error = ENOMEM;
+    }
+
+    ed->loading = NULL;
+    if (load->error) {
+        /* Keep what was read, but never let it be saved over the file */
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Read failed: %s (read-only)", strerror(load->error));
+        editor_set_status_message(ed, msg);
+    } else {
+        ed->readonly = false;
+        if (ed->syntax_lang != LANG_NONE) {
+            highlight_scan(ed->hl_cache, ed->syntax_lang);
+        }
+    }
+    file_load_free(load);
+}
+
+/* Start reading a large regular file in the background. The buffer is
+ * read-only until the whole file is in. Takes over fd on success. */
+static bool file_load_async(Editor *ed, int fd, size_t size) {
+    FileLoad *load = calloc(1, sizeof(FileLoad));
+    if (!load) return false;
+
+    load->ed = ed;
+    load->fd = fd;
+    load->size = size;
+    load->token = job_token_create();
+    load->chunk = malloc(FILE_LOAD_CHUNK);
+
+    /* Room for the whole file up front, so appends never move the text */
+    if (!load->token || !load->chunk || !buffer_reserve(ed->buffer, 0, size) ||
+        !jobs_submit(file_load_chunk_run, file_load_chunk_done, load, load->token)) {
+        if (load->token) job_token_release(load->token);
+        free(load->chunk);
+        free(load);
+        return false;
+    }
+
+    ed->loading = load;
+    ed->readonly = true;
+    return true;
+}
+
+void file_cancel_load(Editor *ed) {
+    if (!ed || !ed->loading) return;
+
+    file_load_detach(ed);
+    editor_set_status_message(ed, "Loading stopped (read-only)");
+}
+
+int file_load_percent(Editor *ed) {
+    if (!ed || !ed->loading) return -1;
+
+    FileLoad *load = ed->loading;
+    if (load->size == 0) return 0;
+    size_t percent = (size_t)((double)load->progress * 100.0 / (double)load->size);
+    return percent > 99 ? 99 : (int)percent;
+}
+
+/* View a file too large to read into memory in place. It stays read-only
+ * until editing is allowed from the Edit menu. Takes over fd on success. */
+static bool file_load_paged(Editor *ed, int fd, size_t size) {
+    PagedFile *pf = paged_open(fd, size);
+    if (!pf) return false;
+
+    buffer_attach_paged(ed->buffer, pf);
+    ed->readonly = true;
+    return true;
+}
+
+/* Open a file to load and stat it; -1 with errno set on failure */
+static int file_open_read(const char *filename, struct stat *st) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+
+    int err = 0;
+    if (fstat(fd, st) != 0) {
+        err = errno;
+    } else if (S_ISDIR(st->st_mode)) {
+        err = EISDIR;
+    }
+    if (err) {
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
 
 bool file_load(Editor *ed, const char *filename) {
     if (!ed || !filename || !filename[0]) return false;
 
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
+    struct stat st;
+    int fd = file_open_read(filename, &st);
+    if (fd < 0) {
         char msg[128];
         snprintf(msg, sizeof(msg), "Cannot open: %s", strerror(errno));
         editor_set_status_message(ed, msg);
@@ -14,46 +257,42 @@ bool file_load(Editor *ed, const char *filename) {
     }
 
     /* Clear buffer */
+    file_load_detach(ed);
+    search_cancel(ed);
+    ed->readonly = false;
     buffer_clear(ed->buffer);
     undo_clear(ed->undo);
 
-    /* Read file content */
-    char buf[4096];
-    size_t n;
-    size_t pos = 0;
-    bool first_chunk = true;
-
-    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
-        char *data = buf;
-        size_t len = n;
-
-        /* Skip UTF-8 BOM if present at start of file */
-        if (first_chunk && len >= 3) {
-            if ((unsigned char)buf[0] == 0xEF &&
-                (unsigned char)buf[1] == 0xBB &&
-                (unsigned char)buf[2] == 0xBF) {
-                data += 3;
-                len -= 3;
-            }
-        }
-        first_chunk = false;
-
-        /* Strip Windows line endings (CR characters) */
-        size_t write_idx = 0;
-        for (size_t i = 0; i < len; i++) {
-            if (data[i] != '\r') {
-                data[write_idx++] = data[i];
-            }
-        }
-        len = write_idx;
-
-        if (len > 0) {
-            buffer_insert_string(ed->buffer, pos, data, len);
-            pos += len;
-        }
+    /* Huge files are viewed in place through mapped windows. Large files
+     * are read in the background and shown as they arrive. Other regular
+     * files are mapped and copied in one pass into a buffer sized from the
+     * file; empty-looking or unmappable ones are read. */
+    bool loaded;
+    bool regular = S_ISREG(st.st_mode) && st.st_size > 0 && (uintmax_t)st.st_size <= SIZE_MAX;
+    if (regular && (size_t)st.st_size >= PAGED_MIN_SIZE &&
+        file_load_paged(ed, fd, (size_t)st.st_size)) {
+        loaded = true;
+        fd = -1;
+    } else if (regular && (size_t)st.st_size >= FILE_ASYNC_MIN &&
+        file_load_async(ed, fd, (size_t)st.st_size)) {
+        loaded = true;
+        fd = -1;
+    } else if (regular && file_load_mapped(ed->buffer, fd, (size_t)st.st_size)) {
+        loaded = true;
+    } else {
+        loaded = file_load_stream(ed->buffer, fd);
     }
+    int load_errno = errno;
+    if (fd >= 0) close(fd);
 
-    fclose(fp);
+    /* Never leave part of a file behind under its name */
+    if (!loaded) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Cannot read: %s", strerror(load_errno));
+        editor_set_status_message(ed, msg);
+        buffer_clear(ed->buffer);
+        filename = "";
+    }
 
     /* Update editor state */
     strncpy(ed->filename, filename, MAX_FILENAME - 1);
@@ -62,6 +301,7 @@ bool file_load(Editor *ed, const char *filename) {
     ed->cursor_pos = 0;
     ed->scroll_row = 0;
     ed->scroll_col = 0;
+    ed->scroll_subrow = 0;
     editor_clear_selection(ed);
     editor_update_cursor_position(ed);
 
@@ -73,28 +313,183 @@ bool file_load(Editor *ed, const char *filename) {
         ed->syntax_lang = syntax_detect_from_shebang(ed->buffer);
     }
 
+    /* Highlighting works from copies of the text, which a huge file can't afford */
+    if (ed->buffer->paged) {
+        ed->syntax_lang = LANG_NONE;
+        editor_set_status_message(ed, "Large file: read-only (Edit > Allow Editing)");
+    }
+
+    /* Build highlight checkpoints for the whole file in the background
+     * (a background load does this once the file is in) */
+    if (ed->syntax_lang != LANG_NONE && !ed->loading) {
+        highlight_scan(ed->hl_cache, ed->syntax_lang);
+    }
+
+    return loaded;
+}
+
+/* Write the whole buffer to fd, both sides of the gap per system call */
+static bool file_write_buffer(Buffer *buf, int fd) {
+    if (buf->paged) return paged_write(buf->paged, fd);
+
+    const char *first, *second;
+    size_t first_len, second_len;
+    buffer_get_segments(buf, &first, &first_len, &second, &second_len);
+
+    struct iovec iov[2] = {{(void *)first, first_len}, {(void *)second, second_len}};
+    struct iovec *v = iov;
+    int count = 2;
+
+    while (count > 0) {
+        if (v->iov_len == 0) {
+            v++;
+            count--;
+            continue;
+        }
+
+        ssize_t n = writev(fd, v, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        /* Short write: resume where it stopped */
+        while (count > 0 && (size_t)n >= v->iov_len) {
+            n -= v->iov_len;
+            v++;
+            count--;
+        }
+        if (count > 0) {
+            v->iov_base = (char *)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
     return true;
 }
 
+/* Create a temporary file next to filename to write the new contents to */
+static int file_create_temp(const char *filename, char *temp, size_t temp_size) {
+    const char *slash = strrchr(filename, '/');
+    int dir_len = slash ? (int)(slash - filename + 1) : 0;
+    const char *base = slash ? slash + 1 : filename;
+
+    if ((size_t)snprintf(temp, temp_size, "%.*s.%s.XXXXXX", dir_len, filename, base) >= temp_size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return mkstemp(temp);
+}
+
+/* Make a rename into the directory holding filename durable */
+static void file_sync_directory(const char *filename) {
+    char dir[MAX_FILENAME];
+    const char *slash = strrchr(filename, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else {
+        size_t len = slash > filename ? (size_t)(slash - filename) : 1;
+        if (len >= sizeof(dir)) return;
+        memcpy(dir, filename, len);
+        dir[len] = '\0';
+    }
+
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
 bool file_save_to(Editor *ed, const char *filename) {
     if (!ed || !ed->buffer || !filename || !filename[0]) return false;
 
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
+    /* A partly loaded file must not replace the whole one */
+    if (!editor_check_writable(ed)) return false;
+
+    /* Save through a symlink to the file it points at */
+    struct stat st;
+    bool exists = stat(filename, &st) == 0;
+    char *resolved = NULL;
+    struct stat link_st;
+    if (exists && lstat(filename, &link_st) == 0 && S_ISLNK(link_st.st_mode)) {
+        resolved = realpath(filename, NULL);
+    }
+    const char *target = resolved ? resolved : filename;
+
+    /* Write a temporary file and rename it over the original, so a crash
+     * leaves either the old or the new contents. Files with other hard
+     * links, files we couldn't hand back to their owner and files in
+     * directories we can't create files in are rewritten in place instead. */
+    char temp[MAX_FILENAME];
+    int fd = -1;
+    if (!exists || st.st_nlink == 1) {
+        fd = file_create_temp(target, temp, sizeof(temp));
+    }
+    if (fd >= 0 && exists && fchown(fd, st.st_uid, st.st_gid) != 0) {
+        /* Replacing it would take the file away from its owner */
+        close(fd);
+        unlink(temp);
+        fd = -1;
+    }
+    bool replace = fd >= 0;
+    if (!replace && ed->buffer->paged) {
+        /* Truncating the file would pull it out from under the view */
+        editor_set_status_message(ed, "Cannot save a large file in place");
+        free(resolved);
+        return false;
+    }
+    if (!replace) {
+        fd = open(target, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    }
+    if (fd < 0) {
         char msg[128];
         snprintf(msg, sizeof(msg), "Cannot save: %s", strerror(errno));
         editor_set_status_message(ed, msg);
+        free(resolved);
         return false;
     }
 
-    /* Write buffer content */
-    size_t len = buffer_get_length(ed->buffer);
-    for (size_t i = 0; i < len; i++) {
-        char c = buffer_get_char(ed->buffer, i);
-        fputc(c, fp);
+    /* The temporary file takes the original's mode, or the mode a newly
+     * created file would get */
+    if (replace) {
+        mode_t mode;
+        if (exists) {
+            mode = st.st_mode & 07777;
+        } else {
+            mode_t mask = umask(0);
+            umask(mask);
+            mode = 0666 & ~mask;
+        }
+        fchmod(fd, mode);
+    }
+
+    bool saved = file_write_buffer(ed->buffer, fd);
+    if (saved && SAVE_FSYNC) saved = fsync(fd) == 0;
+    int save_errno = errno;
+    if (close(fd) != 0 && saved) {
+        saved = false;
+        save_errno = errno;
+    }
+
+    if (replace) {
+        if (saved && rename(temp, target) != 0) {
+            saved = false;
+            save_errno = errno;
+        }
+        if (!saved) {
+            unlink(temp);
+        } else if (SAVE_FSYNC) {
+            file_sync_directory(target);
+        }
     }
+    free(resolved);
 
-    fclose(fp);
+    if (!saved) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Cannot save: %s", strerror(save_errno));
+        editor_set_status_message(ed, msg);
+        return false;
+    }
 
     /* Update editor state */
     strncpy(ed->filename, filename, MAX_FILENAME - 1);
@@ -133,6 +528,9 @@ void file_new(Editor *ed) {
         }
     }
 
+    file_load_detach(ed);
+    search_cancel(ed);
+    ed->readonly = false;
     buffer_clear(ed->buffer);
     undo_clear(ed->undo);
     ed->filename[0] = '\0';
@@ -140,6 +538,7 @@ void file_new(Editor *ed) {
     ed->cursor_pos = 0;
     ed->scroll_row = 0;
     ed->scroll_col = 0;
+    ed->scroll_subrow = 0;
     editor_clear_selection(ed);
     editor_update_cursor_position(ed);
 }
@@ -174,7 +573,7 @@ bool file_save_as(Editor *ed) {
     if (dialog_save_file(ed, filename, sizeof(filename)) == DIALOG_OK) {
         if (filename[0]) {
             bool result = file_save_to(ed, filename);
-            if (result) {
+            if (result && !ed->buffer->paged) {
                 /* Update syntax highlighting for new filename */
                 ed->syntax_lang = syntax_detect_language(filename);
             }
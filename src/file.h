@@ -16,6 +16,10 @@ void file_new(struct Editor *ed);
 void file_open_dialog(struct Editor *ed);
 bool file_save_as(struct Editor *ed);
 
+/* Background loading of large files */
+void file_cancel_load(struct Editor *ed);
+int file_load_percent(struct Editor *ed);     /* -1 when not loading */
+
 /* Check if file needs saving */
 bool file_check_modified(struct Editor *ed);
 
@@ -0,0 +1,1326 @@
+#include "smashedit.h"
+#include <pthread.h>
+#include <stdint.h>
+
+/* Background highlighting of a range of lines from a buffer snapshot */
+struct HighlightJob {
+    HighlightCache *cache;      /* Main thread only; NULL once the cache is gone */
+    JobToken *token;
+    Buffer *snapshot;           /* Text from start_line through last_line */
+    LanguageType lang;
+    unsigned long version;      /* Buffer version the snapshot was taken at */
+    size_t base;                /* Buffer offset of snapshot byte 0 */
+    size_t start_line;
+    HighlightState start_state;
+    size_t store_first;         /* Lines before this only contribute state */
+    size_t last_line;
+    bool prefetch;              /* Below the viewport rather than in it */
+
+    /* Results, filled in on the worker */
+    HighlightLine *lines;
+    size_t line_count;
+    HighlightCheckpoint *checkpoints;
+    size_t checkpoint_count;
+    size_t checkpoint_capacity;
+};
+
+/* One chunk of a whole-file scan; starts at a line start */
+typedef struct ScanChunk {
+    HighlightScan *scan;
+    size_t start;               /* Snapshot offsets */
+    size_t end;
+    size_t lines;               /* Newlines inside the chunk */
+    HighlightState entry;       /* State the chunk was highlighted from */
+    HighlightState exit;        /* State leaving the chunk */
+    HighlightCheckpoint *checkpoints;   /* Lines relative to the chunk start */
+    size_t count;
+    size_t capacity;
+    bool failed;                /* Set by the worker, read once the chunk is done */
+} ScanChunk;
+
+struct HighlightScan {
+    HighlightCache *cache;      /* Main thread only; NULL once the cache is gone */
+    JobToken *token;
+    Buffer *snapshot;           /* The whole file */
+    LanguageType lang;
+    unsigned long version;
+    ScanChunk *chunks;
+    size_t chunk_count;
+    size_t chunks_done;         /* Speculative passes completed (main thread) */
+    size_t chunks_fixed;        /* Chunks the fix-up pass re-ran */
+    bool failed;                /* Main thread, then the fix-up worker */
+    long start_ms;
+};
+
+static HighlightScanStats g_scan_stats[LANG_MAX];
+
+/* A highlighted line remembered by its text, entry state and language */
+typedef struct LineCacheEntry {
+    uint64_t hash;
+    LanguageType lang;
+    HighlightState state;               /* Entering the line */
+    HighlightState end_state;
+    size_t length;
+    TokenRun *runs;                     /* One block: the runs, then the text */
+    size_t run_count;
+    const char *text;
+    struct LineCacheEntry *chain;       /* Next in the hash bucket */
+    struct LineCacheEntry *newer;       /* LRU order */
+    struct LineCacheEntry *older;
+} LineCacheEntry;
+
+/* Shared by all buffers and worker threads, guarded by g_line_lock */
+static pthread_mutex_t g_line_lock = PTHREAD_MUTEX_INITIALIZER;
+static LineCacheEntry g_line_entries[HL_LINE_CACHE_SIZE];
+static LineCacheEntry *g_line_buckets[HL_LINE_CACHE_SIZE * 2];
+static LineCacheEntry *g_line_newest = NULL;
+static LineCacheEntry *g_line_oldest = NULL;
+static HighlightLineCacheStats g_line_stats;
+
+/* Find the first checkpoint whose offset is after pos (never index 0) */
+static size_t checkpoint_first_after(HighlightCache *cache, size_t pos) {
+    size_t lo = 1, hi = cache->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cache->checkpoints[mid].offset <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Find the last checkpoint at or before a line */
+static size_t checkpoint_at_line(HighlightCache *cache, size_t line) {
+    size_t lo = 0, hi = cache->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cache->checkpoints[mid].line <= line) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool checkpoint_insert(HighlightCache *cache, size_t idx, size_t line,
+                              size_t offset, HighlightState state) {
+    if (cache->count >= cache->capacity) {
+        size_t new_capacity = cache->capacity * 2;
+        HighlightCheckpoint *grown = realloc(cache->checkpoints,
+                                             new_capacity * sizeof(HighlightCheckpoint));
+        if (!grown) return false;
+        cache->checkpoints = grown;
+        cache->capacity = new_capacity;
+    }
+
+    memmove(&cache->checkpoints[idx + 1], &cache->checkpoints[idx],
+            (cache->count - idx) * sizeof(HighlightCheckpoint));
+    cache->count++;
+
+    HighlightCheckpoint *cp = &cache->checkpoints[idx];
+    cp->line = line;
+    cp->offset = offset;
+    cp->state = state;
+    cp->dirty = false;
+    cp->edited_before = false;
+    return true;
+}
+
+/* Store a freshly computed state at a checkpoint */
+static void checkpoint_validate(HighlightCache *cache, size_t idx, HighlightState state) {
+    HighlightCheckpoint *cp = &cache->checkpoints[idx];
+
+    if (cp->dirty) {
+        if (cp->state == state) {
+            /* Converged: checkpoints up to the next edited region are valid again */
+            for (size_t k = idx + 1; k < cache->count; k++) {
+                HighlightCheckpoint *later = &cache->checkpoints[k];
+                if (!later->dirty || later->edited_before) break;
+                later->dirty = false;
+            }
+        } else {
+            cp->state = state;
+            if (idx + 1 < cache->count) {
+                cache->checkpoints[idx + 1].edited_before = true;
+            }
+        }
+        cp->dirty = false;
+        cp->edited_before = false;
+    } else {
+        cp->state = state;
+    }
+}
+
+/* Token results */
+
+/* Find the first stored line at or after a line number */
+static size_t line_lower_bound(HighlightCache *cache, size_t line) {
+    size_t lo = 0, hi = cache->line_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cache->lines[mid].line < line) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void line_free(HighlightLine *hl) {
+    free(hl->runs);
+    free(hl->resumes);
+}
+
+static void lines_clear(HighlightCache *cache) {
+    for (size_t i = 0; i < cache->line_count; i++) {
+        line_free(&cache->lines[i]);
+    }
+    cache->line_count = 0;
+}
+
+/* True when every line in [first, last] has an up to date result */
+static bool lines_fresh(HighlightCache *cache, size_t first, size_t last) {
+    size_t idx = line_lower_bound(cache, first);
+    for (size_t line = first; line <= last; line++, idx++) {
+        if (idx >= cache->line_count || cache->lines[idx].line != line ||
+            cache->lines[idx].stale) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Right-sized copy of a run list for storing in a HighlightLine */
+static TokenRun *runs_copy(const TokenRuns *runs) {
+    TokenRun *copy = malloc((runs->count ? runs->count : 1) * sizeof(TokenRun));
+    if (copy && runs->count) {
+        memcpy(copy, runs->runs, runs->count * sizeof(TokenRun));
+    }
+    return copy;
+}
+
+/* Append the bytes [from, to) of a run list */
+static void runs_append_range(TokenRuns *dst, const TokenRun *runs, size_t count,
+                              size_t from, size_t to) {
+    size_t at = 0;
+    for (size_t i = 0; i < count && at < to; i++) {
+        size_t run_end = at + runs[i].length;
+        size_t lo = at > from ? at : from;
+        size_t hi = run_end < to ? run_end : to;
+        if (lo < hi) token_runs_add(dst, hi - lo, runs[i].token);
+        at = run_end;
+    }
+}
+
+/* Long lines keep the resume points before the edit (the one at the line
+ * start never changes) and drop a window the edit touched; the renderer
+ * highlights it again from the live text */
+static void line_patch_long(HighlightLine *hl, const BufferChange *change) {
+    size_t rel = change->pos - hl->offset;
+
+    size_t kept = 0;
+    while (kept < hl->resume_count &&
+           (hl->resumes[kept].offset < rel || hl->resumes[kept].offset == 0)) {
+        kept++;
+    }
+    hl->resume_count = kept;
+
+    if (hl->runs && rel <= hl->run_end) {
+        free(hl->runs);
+        hl->runs = NULL;
+        hl->run_count = 0;
+        hl->run_start = hl->run_end = 0;
+    }
+    hl->length = hl->length - change->removed + change->inserted;
+}
+
+/* Splice an edit inside a single line into its runs, so the line keeps its
+ * colours until the recomputed result arrives */
+static bool line_patch(HighlightLine *hl, const BufferChange *change) {
+    if (hl->resumes) {
+        line_patch_long(hl, change);
+        return true;
+    }
+
+    size_t rel = change->pos - hl->offset;
+    TokenRuns patched;
+    token_runs_init(&patched);
+
+    runs_append_range(&patched, hl->runs, hl->run_count, 0, rel);
+
+    /* Inserted text takes the token of the character before it */
+    TokenType fill = patched.count ? patched.runs[patched.count - 1].token : TOKEN_NORMAL;
+    token_runs_add(&patched, change->inserted, fill);
+
+    runs_append_range(&patched, hl->runs, hl->run_count, rel + change->removed, hl->length);
+
+    TokenRun *runs = patched.failed ? NULL : runs_copy(&patched);
+    size_t run_count = patched.count;
+    token_runs_free(&patched);
+    if (!runs) return false;
+
+    free(hl->runs);
+    hl->runs = runs;
+    hl->run_count = run_count;
+    hl->length = hl->length - change->removed + change->inserted;
+    hl->run_end = hl->length;
+    return true;
+}
+
+/* Keep results before the edit, patch the edited line, shift the rest;
+ * everything from the edit on is stale until highlighted again */
+static void lines_on_change(HighlightCache *cache, const BufferChange *change) {
+    size_t edit_end = change->pos + change->removed;
+    bool single_line = change->lines_removed == 0 && change->lines_inserted == 0;
+    size_t kept = 0;
+
+    for (size_t i = 0; i < cache->line_count; i++) {
+        HighlightLine *hl = &cache->lines[i];
+        size_t hl_end = hl->offset + hl->length;
+
+        if (hl_end < change->pos) {
+            /* Entirely before the edit */
+        } else if (hl->offset > edit_end) {
+            hl->offset = hl->offset - change->removed + change->inserted;
+            hl->line = hl->line - change->lines_removed + change->lines_inserted;
+            hl->stale = true;
+        } else if (single_line && hl->offset <= change->pos && edit_end <= hl_end &&
+                   line_patch(hl, change)) {
+            hl->stale = true;
+        } else {
+            line_free(hl);
+            continue;
+        }
+        cache->lines[kept++] = *hl;
+    }
+    cache->line_count = kept;
+    cache->generation++;
+}
+
+/* Buffer change listener: drop checkpoints inside the edit, shift and dirty the rest */
+static void highlight_on_change(void *ctx, const BufferChange *change) {
+    HighlightCache *cache = ctx;
+    size_t edit_end = change->pos + change->removed;
+
+    size_t first = checkpoint_first_after(cache, change->pos);
+    size_t keep = first;
+    while (keep < cache->count && cache->checkpoints[keep].offset <= edit_end) {
+        keep++;
+    }
+
+    if (keep > first) {
+        memmove(&cache->checkpoints[first], &cache->checkpoints[keep],
+                (cache->count - keep) * sizeof(HighlightCheckpoint));
+        cache->count -= keep - first;
+    }
+
+    for (size_t i = first; i < cache->count; i++) {
+        HighlightCheckpoint *cp = &cache->checkpoints[i];
+        cp->offset = cp->offset - change->removed + change->inserted;
+        cp->line = cp->line - change->lines_removed + change->lines_inserted;
+        cp->dirty = true;
+    }
+
+    if (first < cache->count) {
+        cache->checkpoints[first].edited_before = true;
+    }
+
+    lines_on_change(cache, change);
+
+    /* Running jobs are highlighting text that no longer exists */
+    if (cache->pending) {
+        job_token_cancel(cache->pending->token);
+    }
+    if (cache->scan) {
+        job_token_cancel(cache->scan->token);
+    }
+}
+
+/* Long lines */
+
+static bool line_is_long(LanguageType lang, size_t length) {
+    return length > HL_LONG_LINE && syntax_resumable(lang);
+}
+
+/* Highlight a long line a resume interval at a time, so the scratch runs
+ * never hold more than one interval, optionally keeping the resume points */
+static bool long_line_walk(Buffer *buf, size_t pos, size_t end, LanguageType lang,
+                           HighlightState *state, TokenRuns *scratch, HighlightResume **resumes,
+                           size_t *resume_count, const JobToken *token) {
+    size_t length = end - pos;
+    size_t capacity = length / HL_RESUME_INTERVAL + 2;
+    size_t from = 0;
+
+    if (resumes) {
+        *resume_count = 0;
+        *resumes = malloc(capacity * sizeof(HighlightResume));
+        if (!*resumes) return false;
+    }
+
+    while (from < length) {
+        if (job_token_cancelled(token)) return false;
+        if (resumes && *resume_count < capacity) {
+            (*resumes)[*resume_count].offset = from;
+            (*resumes)[*resume_count].state = *state;
+            (*resume_count)++;
+        }
+
+        size_t stop;
+        if (!syntax_highlight_span(buf, pos, end, from, from + HL_RESUME_INTERVAL, lang,
+                                   state, scratch, &stop)) {
+            return false;
+        }
+        from = stop;
+    }
+    return true;
+}
+
+/* Advance state over a line whose tokens are not needed */
+static bool line_walk(Buffer *buf, size_t pos, size_t end, LanguageType lang,
+                      HighlightState *state, TokenRuns *scratch, const JobToken *token) {
+    if (line_is_long(lang, end - pos)) {
+        return long_line_walk(buf, pos, end, lang, state, scratch, NULL, NULL, token);
+    }
+    return syntax_highlight_line(buf, pos, end, lang, state, scratch);
+}
+
+/* Highlight the part of a long line around [from, to) on the main thread,
+ * starting from the closest resume point before it. When that point is far
+ * back (the line was edited since the job ran) new ones are added a budget's
+ * worth at a time, finishing on later frames. */
+static void line_window(HighlightCache *cache, HighlightLine *hl, size_t from, size_t to) {
+    size_t start = from > HL_WINDOW_MARGIN ? from - HL_WINDOW_MARGIN : 0;
+    size_t stop_at = to + HL_WINDOW_MARGIN < hl->length ? to + HL_WINDOW_MARGIN : hl->length;
+    size_t line_end = hl->offset + hl->length;
+
+    if (hl->resume_count == 0) return;
+
+    size_t lo = 1, hi = hl->resume_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (hl->resumes[mid].offset <= start) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t idx = lo - 1;
+
+    /* Fill in resume points up to the window */
+    while (idx + 1 == hl->resume_count && start - hl->resumes[idx].offset > HL_RESUME_INTERVAL) {
+        if (cache->window_budget < HL_RESUME_INTERVAL) {
+            cache->window_deferred = true;
+            cache->generation++;
+            return;
+        }
+        HighlightResume next = hl->resumes[idx];
+        if (!syntax_highlight_span(cache->buffer, hl->offset, line_end, next.offset,
+                                   next.offset + HL_RESUME_INTERVAL, cache->lang,
+                                   &next.state, &cache->scratch, &next.offset)) {
+            return;
+        }
+        size_t walked = next.offset - hl->resumes[idx].offset;
+        cache->window_budget -= walked < cache->window_budget ? walked : cache->window_budget;
+
+        HighlightResume *grown = realloc(hl->resumes,
+                                         (hl->resume_count + 1) * sizeof(HighlightResume));
+        if (!grown) return;
+        hl->resumes = grown;
+        hl->resumes[hl->resume_count++] = next;
+        if (next.offset > start) break;
+        idx++;
+    }
+
+    HighlightResume *resume = &hl->resumes[idx];
+    size_t cost = stop_at - resume->offset;
+    if (cost > cache->window_budget) {
+        cache->window_deferred = true;
+        cache->generation++;
+        return;
+    }
+    cache->window_budget -= cost;
+
+    HighlightState state = resume->state;
+    size_t stop;
+    if (!syntax_highlight_span(cache->buffer, hl->offset, line_end, resume->offset, stop_at,
+                               cache->lang, &state, &cache->scratch, &stop)) {
+        return;
+    }
+    TokenRun *runs = runs_copy(&cache->scratch);
+    if (!runs) return;
+
+    free(hl->runs);
+    hl->runs = runs;
+    hl->run_count = cache->scratch.count;
+    hl->run_start = resume->offset;
+    hl->run_end = stop;
+    cache->generation++;
+}
+
+HighlightCache *highlight_cache_create(Buffer *buf) {
+    HighlightCache *cache = malloc(sizeof(HighlightCache));
+    if (!cache) return NULL;
+
+    cache->buffer = buf;
+    cache->lines = NULL;
+    cache->line_count = 0;
+    cache->line_capacity = 0;
+    cache->view_first = 1;
+    cache->view_last = 1;
+    cache->pending = NULL;
+    cache->scan = NULL;
+    cache->capacity = 64;
+    cache->checkpoints = malloc(cache->capacity * sizeof(HighlightCheckpoint));
+    token_runs_init(&cache->scratch);
+    cache->window_budget = HL_WINDOW_BUDGET;
+    cache->window_deferred = false;
+    cache->generation = 0;
+
+    if (!cache->checkpoints) {
+        free(cache);
+        return NULL;
+    }
+
+    highlight_cache_reset(cache, LANG_NONE);
+    buffer_add_listener(buf, highlight_on_change, cache);
+
+    return cache;
+}
+
+void highlight_cache_destroy(HighlightCache *cache) {
+    if (cache) {
+        buffer_remove_listener(cache->buffer, highlight_on_change, cache);
+        if (cache->pending) {
+            /* Its completion still runs later, but must not touch the cache */
+            job_token_cancel(cache->pending->token);
+            cache->pending->cache = NULL;
+        }
+        if (cache->scan) {
+            job_token_cancel(cache->scan->token);
+            cache->scan->cache = NULL;
+        }
+        lines_clear(cache);
+        free(cache->lines);
+        free(cache->checkpoints);
+        token_runs_free(&cache->scratch);
+        free(cache);
+    }
+}
+
+void highlight_cache_reset(HighlightCache *cache, LanguageType lang) {
+    if (!cache) return;
+
+    cache->lang = lang;
+    cache->count = 1;
+    cache->checkpoints[0].line = 1;
+    cache->checkpoints[0].offset = 0;
+    cache->checkpoints[0].state = HL_STATE_NORMAL;
+    cache->checkpoints[0].dirty = false;
+    cache->checkpoints[0].edited_before = false;
+
+    lines_clear(cache);
+    cache->generation++;
+    if (cache->pending) {
+        job_token_cancel(cache->pending->token);
+    }
+    if (cache->scan) {
+        job_token_cancel(cache->scan->token);
+    }
+}
+
+HighlightState highlight_state_at_line(HighlightCache *cache, LanguageType lang,
+                                       size_t line, size_t *line_start) {
+    if (!cache) {
+        if (line_start) *line_start = 0;
+        return HL_STATE_NORMAL;
+    }
+
+    if (lang != cache->lang) {
+        highlight_cache_reset(cache, lang);
+    }
+
+    Buffer *buf = cache->buffer;
+    size_t buf_len = buffer_get_length(buf);
+    if (line < 1) line = 1;
+
+    /* Start from the last trusted checkpoint at or before the target */
+    size_t idx = checkpoint_at_line(cache, line);
+    while (idx > 0 && cache->checkpoints[idx].dirty) {
+        idx--;
+    }
+
+    size_t cur_line = cache->checkpoints[idx].line;
+    size_t pos = cache->checkpoints[idx].offset;
+    HighlightState state = cache->checkpoints[idx].state;
+    size_t last_cp_line = cur_line;
+    size_t next = idx + 1;
+
+    while (cur_line < line) {
+        size_t end = buffer_line_end(buf, pos);
+        line_walk(buf, pos, end, lang, &state, &cache->scratch, NULL);
+        if (end >= buf_len) {
+            pos = buf_len;  /* Target is past the last line */
+            break;
+        }
+
+        pos = end + 1;
+        cur_line++;
+
+        if (next < cache->count && cache->checkpoints[next].line == cur_line) {
+            checkpoint_validate(cache, next, state);
+            last_cp_line = cur_line;
+            next++;
+
+            /* Jump over trusted checkpoints that are still before the target */
+            while (next < cache->count && !cache->checkpoints[next].dirty &&
+                   cache->checkpoints[next].line <= line) {
+                cur_line = cache->checkpoints[next].line;
+                pos = cache->checkpoints[next].offset;
+                state = cache->checkpoints[next].state;
+                last_cp_line = cur_line;
+                next++;
+            }
+        } else if (cur_line - last_cp_line >= HL_CHECKPOINT_INTERVAL) {
+            if (checkpoint_insert(cache, next, cur_line, pos, state)) {
+                next++;
+            }
+            last_cp_line = cur_line;
+        }
+    }
+
+    if (line_start) *line_start = pos;
+    return state;
+}
+
+/* Line cache */
+
+static uint64_t line_cache_hash(const char *text, size_t length, LanguageType lang,
+                                HighlightState state) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 1099511628211ULL;
+    }
+    hash = (hash ^ (uint64_t)lang) * 1099511628211ULL;
+    return (hash ^ (uint64_t)state) * 1099511628211ULL;
+}
+
+static LineCacheEntry **line_cache_bucket(uint64_t hash) {
+    return &g_line_buckets[hash & (HL_LINE_CACHE_SIZE * 2 - 1)];
+}
+
+static void line_cache_unlink(LineCacheEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else g_line_newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else g_line_oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+static void line_cache_push(LineCacheEntry *entry) {
+    entry->older = g_line_newest;
+    entry->newer = NULL;
+    if (g_line_newest) g_line_newest->newer = entry;
+    g_line_newest = entry;
+    if (!g_line_oldest) g_line_oldest = entry;
+}
+
+static LineCacheEntry *line_cache_find(uint64_t hash, LanguageType lang, HighlightState state,
+                                       const char *text, size_t length) {
+    for (LineCacheEntry *e = *line_cache_bucket(hash); e; e = e->chain) {
+        if (e->hash == hash && e->lang == lang && e->state == state &&
+            e->length == length && memcmp(e->text, text, length) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* Take the least recently used slot, or a never used one */
+static LineCacheEntry *line_cache_reclaim(void) {
+    if (g_line_stats.entries < HL_LINE_CACHE_SIZE) {
+        return &g_line_entries[g_line_stats.entries++];
+    }
+
+    LineCacheEntry *entry = g_line_oldest;
+    LineCacheEntry **link = line_cache_bucket(entry->hash);
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+    line_cache_unlink(entry);
+    free(entry->runs);
+    entry->runs = NULL;
+    return entry;
+}
+
+static void line_cache_store(uint64_t hash, LanguageType lang, HighlightState state,
+                             const char *text, size_t length, const TokenRuns *runs,
+                             HighlightState end_state) {
+    size_t runs_size = runs->count * sizeof(TokenRun);
+    TokenRun *block = malloc(runs_size + length);
+    if (!block) return;
+    memcpy(block, runs->runs, runs_size);
+    memcpy((char *)block + runs_size, text, length);
+
+    pthread_mutex_lock(&g_line_lock);
+    if (line_cache_find(hash, lang, state, text, length)) {
+        /* Another worker got there first */
+        pthread_mutex_unlock(&g_line_lock);
+        free(block);
+        return;
+    }
+
+    LineCacheEntry *entry = line_cache_reclaim();
+    entry->hash = hash;
+    entry->lang = lang;
+    entry->state = state;
+    entry->end_state = end_state;
+    entry->length = length;
+    entry->runs = block;
+    entry->run_count = runs->count;
+    entry->text = (const char *)block + runs_size;
+
+    LineCacheEntry **bucket = line_cache_bucket(hash);
+    entry->chain = *bucket;
+    *bucket = entry;
+    line_cache_push(entry);
+    pthread_mutex_unlock(&g_line_lock);
+}
+
+/* syntax_highlight_line through the line cache. Lines are matched on their
+ * full text, so edits can never leave a wrong entry behind; lines past
+ * HL_LINE_CACHE_MAX_LENGTH are always highlighted directly. */
+static bool highlight_line_cached(Buffer *buf, size_t pos, size_t end, LanguageType lang,
+                                  HighlightState *state, TokenRuns *out) {
+    size_t length = end - pos;
+    if (length == 0 || length > HL_LINE_CACHE_MAX_LENGTH) {
+        return syntax_highlight_line(buf, pos, end, lang, state, out);
+    }
+
+    char scratch[HL_LINE_CACHE_MAX_LENGTH];
+    const char *text = buffer_get_span(buf, pos, end, scratch);
+    if (!text) return syntax_highlight_line(buf, pos, end, lang, state, out);
+
+    HighlightState entry_state = *state;
+    uint64_t hash = line_cache_hash(text, length, lang, entry_state);
+
+    pthread_mutex_lock(&g_line_lock);
+    LineCacheEntry *entry = line_cache_find(hash, lang, entry_state, text, length);
+    if (entry) {
+        line_cache_unlink(entry);
+        line_cache_push(entry);
+        g_line_stats.hits++;
+
+        out->count = 0;
+        out->length = 0;
+        out->failed = false;
+        for (size_t i = 0; i < entry->run_count; i++) {
+            token_runs_add(out, entry->runs[i].length, entry->runs[i].token);
+        }
+        *state = entry->end_state;
+        pthread_mutex_unlock(&g_line_lock);
+        return !out->failed;
+    }
+    g_line_stats.misses++;
+    pthread_mutex_unlock(&g_line_lock);
+
+    if (!syntax_highlight_line(buf, pos, end, lang, state, out)) return false;
+    line_cache_store(hash, lang, entry_state, text, length, out, *state);
+    return true;
+}
+
+HighlightLineCacheStats highlight_line_cache_stats(void) {
+    pthread_mutex_lock(&g_line_lock);
+    HighlightLineCacheStats stats = g_line_stats;
+    pthread_mutex_unlock(&g_line_lock);
+    return stats;
+}
+
+/* Background jobs */
+
+static void highlight_job_free(HighlightJob *job) {
+    for (size_t i = 0; i < job->line_count; i++) {
+        line_free(&job->lines[i]);
+    }
+    free(job->lines);
+    free(job->checkpoints);
+    buffer_destroy(job->snapshot);
+    job_token_release(job->token);
+    free(job);
+}
+
+static void highlight_job_add_checkpoint(HighlightJob *job, size_t line, size_t offset,
+                                         HighlightState state) {
+    if (job->checkpoint_count >= job->checkpoint_capacity) {
+        size_t new_capacity = job->checkpoint_capacity ? job->checkpoint_capacity * 2 : 16;
+        HighlightCheckpoint *grown = realloc(job->checkpoints,
+                                             new_capacity * sizeof(HighlightCheckpoint));
+        if (!grown) return;
+        job->checkpoints = grown;
+        job->checkpoint_capacity = new_capacity;
+    }
+
+    HighlightCheckpoint *cp = &job->checkpoints[job->checkpoint_count++];
+    cp->line = line;
+    cp->offset = offset;
+    cp->state = state;
+    cp->dirty = false;
+    cp->edited_before = false;
+}
+
+/* Worker thread: highlight the snapshot line by line */
+static void highlight_job_run(void *arg, const JobToken *token) {
+    HighlightJob *job = arg;
+    Buffer *snap = job->snapshot;
+    size_t len = buffer_get_length(snap);
+    size_t pos = 0;
+    size_t line = job->start_line;
+    HighlightState state = job->start_state;
+
+    TokenRuns scratch;
+    token_runs_init(&scratch);
+    job->lines = malloc((job->last_line - job->store_first + 1) * sizeof(HighlightLine));
+    if (!job->lines) return;
+
+    while (line <= job->last_line && !job_token_cancelled(token)) {
+        size_t end = buffer_line_end(snap, pos);
+
+        if (line > job->start_line && (line - job->start_line) % HL_CHECKPOINT_INTERVAL == 0) {
+            highlight_job_add_checkpoint(job, line, job->base + pos, state);
+        }
+
+        if (line < job->store_first) {
+            if (!line_walk(snap, pos, end, job->lang, &state, &scratch, token)) break;
+        } else {
+            HighlightLine *hl = &job->lines[job->line_count];
+            hl->line = line;
+            hl->offset = job->base + pos;
+            hl->length = end - pos;
+            hl->runs = NULL;
+            hl->run_count = 0;
+            hl->run_start = 0;
+            hl->run_end = 0;
+            hl->resumes = NULL;
+            hl->resume_count = 0;
+            hl->stale = false;
+
+            /* Long lines only get resume points; the renderer highlights
+             * the visible window */
+            if (line_is_long(job->lang, end - pos)) {
+                if (!long_line_walk(snap, pos, end, job->lang, &state, &scratch,
+                                    &hl->resumes, &hl->resume_count, token)) {
+                    free(hl->resumes);
+                    break;
+                }
+            } else {
+                if (!highlight_line_cached(snap, pos, end, job->lang, &state, &scratch)) break;
+                hl->runs = runs_copy(&scratch);
+                if (!hl->runs) break;
+                hl->run_count = scratch.count;
+                hl->run_end = end - pos;
+            }
+            hl->end_state = state;
+            job->line_count++;
+        }
+
+        if (end >= len) break;
+        pos = end + 1;
+        line++;
+    }
+
+    token_runs_free(&scratch);
+}
+
+/* Fold states the job passed through into the checkpoint list */
+static void highlight_merge_checkpoints(HighlightCache *cache, HighlightJob *job) {
+    for (size_t i = 0; i < job->checkpoint_count; i++) {
+        HighlightCheckpoint *found = &job->checkpoints[i];
+        size_t idx = checkpoint_at_line(cache, found->line);
+
+        if (cache->checkpoints[idx].line == found->line) {
+            checkpoint_validate(cache, idx, found->state);
+        } else if (found->line - cache->checkpoints[idx].line >= HL_CHECKPOINT_INTERVAL) {
+            checkpoint_insert(cache, idx + 1, found->line, found->offset, found->state);
+        }
+    }
+}
+
+/* Move a job's lines into the cache, replacing older results for the same
+ * lines and dropping anything that has scrolled well out of view */
+static void highlight_store_lines(HighlightCache *cache, HighlightJob *job) {
+    if (job->line_count == 0) return;
+
+    size_t span = cache->view_last - cache->view_first + 1;
+    size_t keep_first = cache->view_first > span ? cache->view_first - span : 1;
+    size_t keep_last = cache->view_last + span;
+    size_t first = job->lines[0].line;
+    size_t last = job->lines[job->line_count - 1].line;
+
+    size_t needed = cache->line_count + job->line_count;
+    HighlightLine *merged = malloc(needed * sizeof(HighlightLine));
+    if (!merged) return;
+
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i < cache->line_count && cache->lines[i].line < first; i++) {
+        if (cache->lines[i].line >= keep_first) {
+            merged[count++] = cache->lines[i];
+        } else {
+            line_free(&cache->lines[i]);
+        }
+    }
+    for (size_t k = 0; k < job->line_count; k++) {
+        size_t line = job->lines[k].line;
+        if (line >= keep_first && line <= keep_last) {
+            merged[count++] = job->lines[k];
+        } else {
+            line_free(&job->lines[k]);
+        }
+    }
+    job->line_count = 0;
+    for (; i < cache->line_count; i++) {
+        if (cache->lines[i].line > last && cache->lines[i].line <= keep_last) {
+            merged[count++] = cache->lines[i];
+        } else {
+            line_free(&cache->lines[i]);
+        }
+    }
+
+    free(cache->lines);
+    cache->lines = merged;
+    cache->line_count = count;
+    cache->line_capacity = needed;
+
+    /* Results below the view (prefetched) change nothing drawn yet */
+    if (first <= cache->view_last && last >= cache->view_first) {
+        cache->generation++;
+    }
+}
+
+static void highlight_prefetch(HighlightCache *cache);
+
+/* Main thread: take the results if the buffer hasn't changed meanwhile */
+static void highlight_job_done(void *arg, bool cancelled) {
+    HighlightJob *job = arg;
+    HighlightCache *cache = job->cache;
+
+    if (cache && cache->pending == job) {
+        cache->pending = NULL;
+    }
+    if (cache && !cancelled && job->lang == cache->lang &&
+        job->version == cache->buffer->version) {
+        highlight_merge_checkpoints(cache, job);
+        highlight_store_lines(cache, job);
+
+        /* Viewport done - carry on below it */
+        highlight_prefetch(cache);
+    }
+
+    highlight_job_free(job);
+}
+
+static bool highlight_submit(HighlightCache *cache, size_t start_line, size_t start_offset,
+                             HighlightState start_state, size_t store_first,
+                             size_t last_line, size_t end_offset, bool prefetch) {
+    HighlightJob *job = calloc(1, sizeof(HighlightJob));
+    if (!job) return false;
+
+    job->token = job_token_create();
+    job->snapshot = buffer_snapshot(cache->buffer, start_offset, end_offset);
+    if (!job->token || !job->snapshot) {
+        highlight_job_free(job);
+        return false;
+    }
+
+    job->cache = cache;
+    job->lang = cache->lang;
+    job->version = cache->buffer->version;
+    job->base = start_offset;
+    job->start_line = start_line;
+    job->start_state = start_state;
+    job->store_first = store_first;
+    job->last_line = last_line;
+    job->prefetch = prefetch;
+
+    if (cache->pending) {
+        job_token_cancel(cache->pending->token);
+    }
+    cache->pending = job;
+
+    if (!jobs_submit(highlight_job_run, highlight_job_done, job, job->token)) {
+        cache->pending = NULL;
+        highlight_job_free(job);
+        return false;
+    }
+    return true;
+}
+
+/* Highlight one screenful below the viewport, continuing from its last line */
+static void highlight_prefetch(HighlightCache *cache) {
+    if (cache->pending) return;
+
+    Buffer *buf = cache->buffer;
+    size_t span = cache->view_last - cache->view_first + 1;
+    size_t last = cache->view_last + span;
+    size_t total = buffer_count_lines(buf);
+    if (last > total) last = total;
+    if (last <= cache->view_last || lines_fresh(cache, cache->view_last + 1, last)) return;
+
+    size_t idx = line_lower_bound(cache, cache->view_last);
+    if (idx >= cache->line_count || cache->lines[idx].line != cache->view_last ||
+        cache->lines[idx].stale) {
+        return;
+    }
+
+    HighlightLine *from = &cache->lines[idx];
+    size_t start = from->offset + from->length + 1;
+    size_t end = start;
+    for (size_t line = cache->view_last + 1; line <= last; line++) {
+        end = buffer_next_line(buf, end);
+    }
+
+    highlight_submit(cache, cache->view_last + 1, start, from->end_state,
+                     cache->view_last + 1, last, end, true);
+}
+
+size_t highlight_line_offset(HighlightCache *cache, LanguageType lang, size_t line) {
+    if (!cache) return 0;
+
+    if (lang != cache->lang) {
+        highlight_cache_reset(cache, lang);
+    }
+
+    Buffer *buf = cache->buffer;
+    size_t buf_len = buffer_get_length(buf);
+    if (line < 1) line = 1;
+
+    /* Checkpoint offsets stay exact across edits, dirty or not */
+    size_t idx = checkpoint_at_line(cache, line);
+    size_t cur_line = cache->checkpoints[idx].line;
+    size_t pos = cache->checkpoints[idx].offset;
+
+    /* A stored result may be closer */
+    size_t near = line_lower_bound(cache, line);
+    if (near < cache->line_count && cache->lines[near].line == line) {
+        return cache->lines[near].offset;
+    }
+    if (near > 0 && cache->lines[near - 1].line > cur_line) {
+        cur_line = cache->lines[near - 1].line;
+        pos = cache->lines[near - 1].offset;
+    }
+
+    while (cur_line < line) {
+        size_t end = buffer_line_end(buf, pos);
+        if (end >= buf_len) return buf_len;
+        pos = end + 1;
+        cur_line++;
+    }
+    return pos;
+}
+
+const TokenRun *highlight_line_runs(HighlightCache *cache, size_t line, size_t offset,
+                                    size_t length, size_t from, size_t to,
+                                    size_t *run_start, size_t *count) {
+    if (!cache) return NULL;
+
+    size_t idx = line_lower_bound(cache, line);
+    if (idx >= cache->line_count) return NULL;
+
+    HighlightLine *hl = &cache->lines[idx];
+    if (hl->line != line || hl->offset != offset || hl->length != length) return NULL;
+
+    if (to > length) to = length;
+    if (hl->resumes && from < to &&
+        (!hl->runs || from < hl->run_start || to > hl->run_end)) {
+        line_window(cache, hl, from, to);
+    }
+
+    *run_start = hl->run_start;
+    *count = hl->run_count;
+    return hl->runs;
+}
+
+void highlight_request(HighlightCache *cache, LanguageType lang,
+                       size_t first_line, size_t last_line, size_t view_end) {
+    if (!cache) return;
+
+    /* Called once per frame: a long line window that did not fit gets the next one */
+    cache->window_budget = HL_WINDOW_BUDGET;
+    if (cache->window_deferred) {
+        cache->window_deferred = false;
+        event_wake();
+    }
+
+    if (lang != cache->lang) {
+        highlight_cache_reset(cache, lang);
+    }
+    size_t total = buffer_count_lines(cache->buffer);
+    if (first_line < 1) first_line = 1;
+    if (last_line > total) last_line = total;
+    if (first_line > last_line) return;
+    cache->view_first = first_line;
+    cache->view_last = last_line;
+
+    if (lines_fresh(cache, first_line, last_line)) {
+        highlight_prefetch(cache);
+        return;
+    }
+
+    /* Already on its way */
+    HighlightJob *pending = cache->pending;
+    if (pending && !pending->prefetch && pending->version == cache->buffer->version &&
+        pending->store_first <= first_line && last_line <= pending->last_line) {
+        return;
+    }
+
+    /* Start from the last trusted checkpoint, keeping up to a screenful above the view */
+    size_t idx = checkpoint_at_line(cache, first_line);
+    while (idx > 0 && cache->checkpoints[idx].dirty) {
+        idx--;
+    }
+    HighlightCheckpoint *cp = &cache->checkpoints[idx];
+
+    size_t span = last_line - first_line + 1;
+    size_t store_first = first_line > span ? first_line - span : 1;
+    if (store_first < cp->line) store_first = cp->line;
+    if (view_end < cp->offset) view_end = cp->offset;
+
+    highlight_submit(cache, cp->line, cp->offset, cp->state, store_first,
+                     last_line, view_end, false);
+}
+
+/* Whole-file scan */
+
+static void scan_free(HighlightScan *scan) {
+    for (size_t i = 0; i < scan->chunk_count; i++) {
+        free(scan->chunks[i].checkpoints);
+    }
+    free(scan->chunks);
+    buffer_destroy(scan->snapshot);
+    job_token_release(scan->token);
+    free(scan);
+}
+
+static bool chunk_add_checkpoint(ScanChunk *chunk, size_t line, size_t offset,
+                                 HighlightState state) {
+    if (chunk->count >= chunk->capacity) {
+        size_t new_capacity = chunk->capacity ? chunk->capacity * 2 : 16;
+        HighlightCheckpoint *grown = realloc(chunk->checkpoints,
+                                             new_capacity * sizeof(HighlightCheckpoint));
+        if (!grown) return false;
+        chunk->checkpoints = grown;
+        chunk->capacity = new_capacity;
+    }
+
+    HighlightCheckpoint *cp = &chunk->checkpoints[chunk->count++];
+    cp->line = line;
+    cp->offset = offset;
+    cp->state = state;
+    cp->dirty = false;
+    cp->edited_before = false;
+    return true;
+}
+
+/* Highlight a chunk from its entry state, recording a checkpoint every
+ * interval. A re-run compares against the states recorded by the first run
+ * and stops as soon as one matches: everything after it is already right. */
+static bool chunk_highlight(ScanChunk *chunk, TokenRuns *scratch, const JobToken *token,
+                            bool rerun) {
+    HighlightScan *scan = chunk->scan;
+    Buffer *snap = scan->snapshot;
+    size_t len = buffer_get_length(snap);
+    size_t pos = chunk->start;
+    size_t line = 0;
+    size_t next_cp = 0;
+    HighlightState state = chunk->entry;
+
+    while (pos < chunk->end) {
+        if ((line & 255) == 0 && job_token_cancelled(token)) return false;
+
+        size_t end = buffer_line_end(snap, pos);
+        if (!line_walk(snap, pos, end, scan->lang, &state, scratch, token)) return false;
+        if (end >= len) break;
+
+        pos = end + 1;
+        line++;
+
+        if (line % HL_CHECKPOINT_INTERVAL != 0 || pos >= chunk->end) continue;
+
+        if (!rerun) {
+            if (!chunk_add_checkpoint(chunk, line, pos, state)) return false;
+        } else if (next_cp < chunk->count) {
+            HighlightCheckpoint *cp = &chunk->checkpoints[next_cp++];
+            if (cp->state == state) return true;  /* Converged */
+            cp->state = state;
+        }
+    }
+
+    if (!rerun) chunk->lines = line;
+    chunk->exit = state;
+    return true;
+}
+
+/* Worker: speculative pass over one chunk from HL_STATE_NORMAL */
+static void scan_chunk_run(void *arg, const JobToken *token) {
+    ScanChunk *chunk = arg;
+    TokenRuns scratch;
+    token_runs_init(&scratch);
+
+    if (!chunk_highlight(chunk, &scratch, token, false)) {
+        chunk->failed = true;
+    }
+    token_runs_free(&scratch);
+}
+
+/* Worker: walk the chunks in order and re-run those whose real entry state
+ * differs from the guess */
+static void scan_fixup_run(void *arg, const JobToken *token) {
+    HighlightScan *scan = arg;
+    TokenRuns scratch;
+    token_runs_init(&scratch);
+
+    for (size_t i = 1; i < scan->chunk_count; i++) {
+        ScanChunk *chunk = &scan->chunks[i];
+        HighlightState real = scan->chunks[i - 1].exit;
+        if (chunk->entry == real) continue;
+
+        chunk->entry = real;
+        scan->chunks_fixed++;
+        if (!chunk_highlight(chunk, &scratch, token, true)) {
+            scan->failed = true;
+            break;
+        }
+    }
+    token_runs_free(&scratch);
+}
+
+/* Main thread: replace the checkpoint list with the scan's */
+static void scan_fixup_done(void *arg, bool cancelled) {
+    HighlightScan *scan = arg;
+    HighlightCache *cache = scan->cache;
+
+    if (cache && cache->scan == scan) {
+        cache->scan = NULL;
+    }
+    if (cache && !cancelled && !scan->failed && scan->lang == cache->lang &&
+        scan->version == cache->buffer->version) {
+        cache->count = 1;
+        size_t line = 1;
+
+        for (size_t i = 0; i < scan->chunk_count; i++) {
+            ScanChunk *chunk = &scan->chunks[i];
+            if (i > 0 &&
+                !checkpoint_insert(cache, cache->count, line, chunk->start, chunk->entry)) {
+                break;
+            }
+            for (size_t k = 0; k < chunk->count; k++) {
+                HighlightCheckpoint *cp = &chunk->checkpoints[k];
+                checkpoint_insert(cache, cache->count, line + cp->line, cp->offset, cp->state);
+            }
+            line += chunk->lines;
+        }
+
+        HighlightScanStats *stats = &g_scan_stats[scan->lang];
+        stats->scans++;
+        stats->bytes += buffer_get_length(scan->snapshot);
+        stats->ms += event_now_ms() - scan->start_ms;
+        stats->chunks += scan->chunk_count;
+        stats->chunks_fixed += scan->chunks_fixed;
+    }
+
+    scan_free(scan);
+}
+
+/* Main thread: once every chunk is in, hand the fix-up to a worker */
+static void scan_chunk_done(void *arg, bool cancelled) {
+    ScanChunk *chunk = arg;
+    HighlightScan *scan = chunk->scan;
+
+    if (cancelled || chunk->failed) scan->failed = true;
+    if (++scan->chunks_done < scan->chunk_count) return;
+
+    if (scan->failed || !scan->cache ||
+        !jobs_submit(scan_fixup_run, scan_fixup_done, scan, scan->token)) {
+        if (scan->cache && scan->cache->scan == scan) {
+            scan->cache->scan = NULL;
+        }
+        scan_free(scan);
+    }
+}
+
+bool highlight_scan(HighlightCache *cache, LanguageType lang) {
+    if (!cache || lang == LANG_NONE) return false;
+
+    if (lang != cache->lang) {
+        highlight_cache_reset(cache, lang);
+    }
+    if (cache->scan) {
+        job_token_cancel(cache->scan->token);
+        cache->scan = NULL;
+    }
+
+    Buffer *buf = cache->buffer;
+    size_t len = buffer_get_length(buf);
+
+    HighlightScan *scan = calloc(1, sizeof(HighlightScan));
+    if (!scan) return false;
+
+    scan->start_ms = event_now_ms();
+    scan->token = job_token_create();
+    scan->snapshot = buffer_snapshot(buf, 0, len);
+    scan->chunk_count = len / HL_SCAN_CHUNK_SIZE + 1;
+    scan->chunks = calloc(scan->chunk_count, sizeof(ScanChunk));
+    if (!scan->token || !scan->snapshot || !scan->chunks) {
+        scan_free(scan);
+        return false;
+    }
+
+    scan->cache = cache;
+    scan->lang = lang;
+    scan->version = buf->version;
+
+    /* Split at line starts near every HL_SCAN_CHUNK_SIZE bytes */
+    const char *text = scan->snapshot->data;
+    size_t start = 0;
+    size_t count = 0;
+    while (count < scan->chunk_count) {
+        size_t end = len;
+        if (start + HL_SCAN_CHUNK_SIZE < len) {
+            const char *nl = memchr(text + start + HL_SCAN_CHUNK_SIZE, '\n',
+                                    len - start - HL_SCAN_CHUNK_SIZE);
+            if (nl) end = (size_t)(nl - text) + 1;
+        }
+
+        ScanChunk *chunk = &scan->chunks[count++];
+        chunk->scan = scan;
+        chunk->start = start;
+        chunk->end = end;
+        chunk->entry = HL_STATE_NORMAL;
+
+        if (end >= len) break;
+        start = end;
+    }
+    scan->chunk_count = count;
+    cache->scan = scan;
+
+    /* Each completion holds the scan until the last one hands it on */
+    for (size_t i = 0; i < count; i++) {
+        if (!jobs_submit(scan_chunk_run, scan_chunk_done, &scan->chunks[i], scan->token)) {
+            scan->failed = true;
+            scan->chunks_done += count - i - 1;
+            scan_chunk_done(&scan->chunks[i], true);
+            return false;
+        }
+    }
+    return true;
+}
+
+const HighlightScanStats *highlight_scan_stats(LanguageType lang) {
+    if ((int)lang < 0 || lang >= LANG_MAX) return NULL;
+    return &g_scan_stats[lang];
+}
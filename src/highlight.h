@@ -0,0 +1,144 @@
+#ifndef HIGHLIGHT_H
+#define HIGHLIGHT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Forward declarations */
+typedef struct Buffer Buffer;
+
+/* Lines between highlight state checkpoints */
+#define HL_CHECKPOINT_INTERVAL 256
+
+/* Bytes per chunk of a whole-file scan */
+#define HL_SCAN_CHUNK_SIZE (1024 * 1024)
+
+/* Lines longer than this are highlighted a window at a time, restarting
+ * from resume points kept every HL_RESUME_INTERVAL bytes */
+#define HL_LONG_LINE (256 * 1024)
+#define HL_RESUME_INTERVAL (64 * 1024)
+
+/* Bytes highlighted either side of the visible part of a long line, and the
+ * window highlighting the renderer may do per frame */
+#define HL_WINDOW_MARGIN 4096
+#define HL_WINDOW_BUDGET (1024 * 1024)
+
+/* Highlighted lines remembered across jobs, and the longest line kept */
+#define HL_LINE_CACHE_SIZE 1024
+#define HL_LINE_CACHE_MAX_LENGTH 1024
+
+/* Saved highlight state at the start of a line */
+typedef struct HighlightCheckpoint {
+    size_t line;            /* Line number (1-based) */
+    size_t offset;          /* Byte offset of the line start */
+    HighlightState state;   /* Highlight state entering the line */
+    bool dirty;             /* Text before this point changed - state unverified */
+    bool edited_before;     /* An edit landed between the previous checkpoint and this one */
+} HighlightCheckpoint;
+
+/* Where highlighting can restart inside a long line */
+typedef struct HighlightResume {
+    size_t offset;              /* Bytes from the line start */
+    HighlightState state;
+} HighlightResume;
+
+/* Tokens for one line, produced by a background job */
+typedef struct HighlightLine {
+    size_t line;                /* Line number (1-based) */
+    size_t offset;              /* Byte offset of the line start */
+    size_t length;              /* Line length in bytes, without the newline */
+    TokenRun *runs;
+    size_t run_count;
+    size_t run_start;           /* Bytes the runs cover: the whole line, or the */
+    size_t run_end;             /* window last drawn of a long line */
+    HighlightResume *resumes;   /* Long lines only, NULL otherwise */
+    size_t resume_count;
+    HighlightState end_state;   /* Highlight state leaving the line */
+    bool stale;                 /* Edited since - still drawn until the next result */
+} HighlightLine;
+
+typedef struct HighlightJob HighlightJob;
+typedef struct HighlightScan HighlightScan;
+
+/* Whole-file scan throughput, kept per language for key debug mode */
+typedef struct HighlightScanStats {
+    unsigned long scans;        /* Completed scans */
+    size_t bytes;               /* Bytes scanned in total */
+    long ms;                    /* Time from start to finished fix-up, in total */
+    size_t chunks;              /* Chunks highlighted speculatively */
+    size_t chunks_fixed;        /* Chunks re-run because their entry state was wrong */
+} HighlightScanStats;
+
+/* Line cache counters for key debug mode */
+typedef struct HighlightLineCacheStats {
+    unsigned long hits;         /* Lines whose runs were reused */
+    unsigned long misses;       /* Lines that had to be highlighted */
+    size_t entries;             /* Lines currently cached */
+} HighlightLineCacheStats;
+
+/* Per-buffer highlight state cache.
+ * Checkpoints are kept every HL_CHECKPOINT_INTERVAL lines so the state for
+ * any line can be recovered by highlighting at most one interval of text.
+ * Edits only dirty checkpoints after the edit point; those are revalidated
+ * lazily and become trusted again as soon as the state converges.
+ * Token runs for the lines around the viewport are computed on a worker
+ * thread from a snapshot of the buffer; until they arrive the renderer
+ * draws those lines as plain text. */
+typedef struct HighlightCache {
+    Buffer *buffer;
+    LanguageType lang;
+    HighlightCheckpoint *checkpoints;   /* Sorted by line, [0] is always line 1 */
+    size_t count;
+    size_t capacity;
+    TokenRuns scratch;                  /* Token output for lines we only need state from */
+    size_t window_budget;               /* Long line bytes the renderer may still highlight this frame */
+    bool window_deferred;               /* A window waited for the next frame */
+    unsigned long generation;           /* Bumped whenever drawn results may change */
+
+    /* Background highlighting */
+    HighlightLine *lines;               /* Results around the viewport, sorted by line */
+    size_t line_count;
+    size_t line_capacity;
+    size_t view_first;                  /* Viewport of the last request */
+    size_t view_last;
+    HighlightJob *pending;              /* In-flight job, NULL when idle */
+    HighlightScan *scan;                /* Whole-file scan in progress, NULL when idle */
+} HighlightCache;
+
+/* Lifecycle */
+HighlightCache *highlight_cache_create(Buffer *buf);
+void highlight_cache_destroy(HighlightCache *cache);
+void highlight_cache_reset(HighlightCache *cache, LanguageType lang);
+
+/* Highlight state entering a line (1-based), optionally returning the line's start offset */
+HighlightState highlight_state_at_line(HighlightCache *cache, LanguageType lang,
+                                       size_t line, size_t *line_start);
+
+/* Start offset of a line (1-based), found from the nearest checkpoint or result */
+size_t highlight_line_offset(HighlightCache *cache, LanguageType lang, size_t line);
+
+/* Token runs for a line if a job has produced them, NULL to draw it plain.
+ * The runs start *run_start bytes into the line: long lines only get the
+ * visible bytes [from, to) highlighted, on demand and within the frame's
+ * HL_WINDOW_BUDGET. */
+const TokenRun *highlight_line_runs(HighlightCache *cache, size_t line, size_t offset,
+                                    size_t length, size_t from, size_t to,
+                                    size_t *run_start, size_t *count);
+
+/* Make sure the viewport gets highlighted: starts a background job when its
+ * lines are missing or stale. view_end is the offset just past the last line. */
+void highlight_request(HighlightCache *cache, LanguageType lang,
+                       size_t first_line, size_t last_line, size_t view_end);
+
+/* Rebuild every checkpoint in the background: the file is split into chunks
+ * highlighted in parallel from HL_STATE_NORMAL, then chunks that guessed
+ * their entry state wrong are re-run until the states converge */
+bool highlight_scan(HighlightCache *cache, LanguageType lang);
+const HighlightScanStats *highlight_scan_stats(LanguageType lang);
+
+/* Viewport jobs look lines up by text, entry state and language before
+ * highlighting them, so re-highlighting after an edit only lexes the lines
+ * that changed */
+HighlightLineCacheStats highlight_line_cache_stats(void);
+
+#endif /* HIGHLIGHT_H */
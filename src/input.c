@@ -5,6 +5,9 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <errno.h>
+#ifndef PDCURSES
+#include <poll.h>
+#endif
 
 /* PDCurses extended key codes for Windows - from curses.h */
 #ifdef PDCURSES
@@ -81,8 +84,71 @@
 static int debug_key_mode = 0;
 static int last_key_code = 0;
 
+/* Bytes that arrived after a paste end marker, in the same read as the paste.
+ * They are handed out as keys before anything new is taken from curses. */
+#define PENDING_SEQ_MAX 32
+static char *g_pending = NULL;
+static size_t g_pending_len = 0;
+static size_t g_pending_pos = 0;
+
+/* A key put back after being read, returned before the pending bytes */
+static int g_unget_key = ERR;
+
+#ifndef PDCURSES
+/* Read more bytes onto the pending ones, waiting as long as curses would
+ * for the rest of an escape sequence */
+static bool input_pending_fill(void) {
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&pfd, 1, ESCDELAY) <= 0) return false;
+
+    char *grown = realloc(g_pending, g_pending_len + PENDING_SEQ_MAX);
+    if (!grown) return false;
+    g_pending = grown;
+
+    ssize_t n = read(STDIN_FILENO, g_pending + g_pending_len, PENDING_SEQ_MAX);
+    if (n <= 0) return false;
+    g_pending_len += (size_t)n;
+    return true;
+}
+
+/* Decode the next key from the pending bytes the way curses would, taking the
+ * longest escape sequence it knows */
+static int input_pending_key(void) {
+    if (g_pending[g_pending_pos] == 27) {
+        char seq[PENDING_SEQ_MAX + 1];
+        for (size_t len = 2; len <= PENDING_SEQ_MAX; len++) {
+            if (g_pending_pos + len > g_pending_len && !input_pending_fill()) break;
+
+            memcpy(seq, g_pending + g_pending_pos, len);
+            seq[len] = '\0';
+            int code = key_defined(seq);
+            if (code > 0) {
+                g_pending_pos += len;
+                return code;
+            }
+            if (code == 0) break;  /* Not the start of any key */
+        }
+    }
+
+    return (unsigned char)g_pending[g_pending_pos++];
+}
+#endif
+
+/* Next key from the put-back slot, the pending bytes, then curses */
+static int input_next_key(void) {
+    if (g_unget_key != ERR) {
+        int key = g_unget_key;
+        g_unget_key = ERR;
+        return key;
+    }
+#ifndef PDCURSES
+    if (g_pending_pos < g_pending_len) return input_pending_key();
+#endif
+    return getch();
+}
+
 int input_get_key(void) {
-    int key = getch();
+    int key = input_next_key();
     last_key_code = key;
     return key;
 }
@@ -137,7 +203,7 @@ void debug_log_state(Editor *ed, const char *label) {
 bool input_is_alt_key(int *key) {
     if (*key == 27) {  /* Escape */
         nodelay(stdscr, TRUE);
-        int next = getch();
+        int next = input_next_key();
         nodelay(stdscr, FALSE);
 
         if (next != ERR) {
@@ -148,6 +214,185 @@ bool input_is_alt_key(int *key) {
     return false;
 }
 
+/* Max wait for the rest of a UTF-8 character */
+#define UTF8_CONT_TIMEOUT_MS 50
+
+/* Bracketed paste - the terminal wraps pasted text in ESC[200~ ... ESC[201~ */
+#define PASTE_START_SEQ "\033[200~"
+#define PASTE_END_SEQ "\033[201~"
+#define PASTE_READ_CHUNK 65536
+#define PASTE_TIMEOUT_MS 1000
+
+void input_init(void) {
+#ifndef PDCURSES
+    define_key(PASTE_START_SEQ, KEY_PASTE_BEGIN);
+    define_key(PASTE_END_SEQ, KEY_PASTE_END);
+    printf("\033[?2004h");
+    fflush(stdout);
+#endif
+}
+
+void input_shutdown(void) {
+    free(g_pending);
+    g_pending = NULL;
+    g_pending_len = g_pending_pos = 0;
+#ifndef PDCURSES
+    printf("\033[?2004l");
+    fflush(stdout);
+#endif
+}
+
+#ifndef PDCURSES
+/* Find the paste end marker in data, returns its offset or len if absent */
+static size_t paste_find_end(const char *data, size_t from, size_t len) {
+    size_t marker_len = sizeof(PASTE_END_SEQ) - 1;
+    while (from + marker_len <= len) {
+        const char *esc = memchr(data + from, '\033', len - from);
+        if (!esc) break;
+        size_t at = esc - data;
+        if (at + marker_len <= len && memcmp(esc, PASTE_END_SEQ, marker_len) == 0) {
+            return at;
+        }
+        from = at + 1;
+    }
+    return len;
+}
+
+/* Read a bracketed paste body straight from the terminal after KEY_PASTE_BEGIN.
+ * ncurses reads escape sequences a byte at a time, so nothing past the start
+ * marker has been consumed yet. Returns a malloc'd buffer or NULL. */
+static char *input_read_paste(size_t *out_len) {
+    /* A paste sent right behind another starts in the bytes left from it */
+    size_t carried = g_pending_len - g_pending_pos;
+    size_t capacity = carried + PASTE_READ_CHUNK;
+    size_t len = 0;
+    char *data = malloc(capacity + 1);
+    if (!data) return NULL;
+
+    if (carried > 0) {
+        memcpy(data, g_pending + g_pending_pos, carried);
+        len = carried;
+    }
+    free(g_pending);
+    g_pending = NULL;
+    g_pending_len = g_pending_pos = 0;
+
+    size_t end = paste_find_end(data, 0, len);
+    bool found = end < len;
+
+    while (!found) {
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        int ready = poll(&pfd, 1, PASTE_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) break;  /* Terminal never sent the end marker */
+
+        if (capacity - len < PASTE_READ_CHUNK) {
+            char *grown = realloc(data, capacity * 2 + 1);
+            if (!grown) break;
+            data = grown;
+            capacity *= 2;
+        }
+
+        ssize_t n = read(STDIN_FILENO, data + len, PASTE_READ_CHUNK);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        /* The marker may straddle two reads */
+        size_t marker_len = sizeof(PASTE_END_SEQ) - 1;
+        size_t from = len >= marker_len ? len - marker_len + 1 : 0;
+        len += (size_t)n;
+
+        end = paste_find_end(data, from, len);
+        found = end < len;
+    }
+
+    if (!found) end = len;
+
+    /* Anything typed after the paste is kept for input_next_key */
+    size_t rest = found ? end + sizeof(PASTE_END_SEQ) - 1 : len;
+    if (rest < len) {
+        g_pending = malloc(len - rest);
+        if (g_pending) {
+            memcpy(g_pending, data + rest, len - rest);
+            g_pending_len = len - rest;
+        }
+    }
+
+    /* Terminals send CR for line breaks - normalize CR and CRLF to LF */
+    size_t out = 0;
+    for (size_t i = 0; i < end; i++) {
+        if (data[i] == '\r') {
+            data[out++] = '\n';
+            if (i + 1 < end && data[i + 1] == '\n') i++;
+        } else {
+            data[out++] = data[i];
+        }
+    }
+    data[out] = '\0';
+
+    *out_len = out;
+    return data;
+}
+#endif
+
+/* Paste from the terminal as a single insert and undo step */
+static void input_handle_paste(Editor *ed) {
+#ifndef PDCURSES
+    size_t len = 0;
+    char *text = input_read_paste(&len);
+    if (!text) return;
+
+    if (ed->selection.active && !editor_has_selection(ed)) {
+        editor_clear_selection(ed);
+    }
+    editor_insert_text(ed, text, len);
+    free(text);
+#else
+    (void)ed;
+#endif
+}
+
+/* Complete a UTF-8 sequence whose lead byte getch already returned.
+ * Writes up to 4 bytes to out and returns the length, or 0 if the sequence is invalid. */
+int input_read_utf8(int lead, char *out) {
+    int len;
+    if (lead >= 0xC2 && lead <= 0xDF) len = 2;
+    else if (lead >= 0xE0 && lead <= 0xEF) len = 3;
+    else if (lead >= 0xF0 && lead <= 0xF4) len = 4;
+    else return 0;
+
+    out[0] = (char)lead;
+
+    /* Continuation bytes arrive with the lead byte - don't wait long for them */
+    timeout(UTF8_CONT_TIMEOUT_MS);
+    int i;
+    for (i = 1; i < len; i++) {
+        int c = input_next_key();
+        if (c == ERR) break;
+        if (c > 0xFF || (c & 0xC0) != 0x80) {
+            g_unget_key = c;
+            break;
+        }
+        out[i] = (char)c;
+    }
+    timeout(-1);
+
+    return i == len ? len : 0;
+}
+
+/* Check whether another key has already been typed, without waiting or consuming it */
+bool input_has_pending(void) {
+    if (g_unget_key != ERR || g_pending_pos < g_pending_len) return true;
+
+    timeout(0);
+    int next = getch();
+    timeout(-1);
+
+    if (next == ERR) return false;
+    ungetch(next);
+    return true;
+}
+
 /* Get basename from path */
 static const char *get_basename(const char *path) {
     const char *base = strrchr(path, '/');
@@ -1112,6 +1357,9 @@ void input_handle(Editor *ed, MenuState *menu) {
                 case ACTION_SELECT_ALL:
                     editor_select_all(ed);
                     break;
+                case ACTION_ALLOW_EDITING:
+                    editor_allow_editing(ed);
+                    break;
                 case ACTION_FIND:
                     search_find_dialog(ed);
                     break;
@@ -1132,6 +1380,11 @@ void input_handle(Editor *ed, MenuState *menu) {
                     ed->show_status_bar = !ed->show_status_bar;
                     editor_update_dimensions(ed);
                     break;
+                case ACTION_TOGGLE_WORD_WRAP:
+                    ed->soft_wrap = !ed->soft_wrap;
+                    ed->scroll_subrow = 0;
+                    editor_scroll_to_cursor(ed);
+                    break;
                 case ACTION_TOGGLE_ACS_CHARS:
                     ed->use_acs_chars = !ed->use_acs_chars;
                     display_set_acs_mode(ed->use_acs_chars);
@@ -1340,6 +1593,13 @@ void input_handle(Editor *ed, MenuState *menu) {
             editor_insert_tab(ed);
             break;
 
+        /* Bracketed paste from the terminal */
+        case KEY_PASTE_BEGIN:
+            input_handle_paste(ed);
+            break;
+        case KEY_PASTE_END:
+            break;
+
         /* Ctrl+Tab to switch focus to panel */
         case KEY_BTAB:  /* Shift+Tab - use as fallback for Ctrl+Tab */
             if (ed->panel_visible) {
@@ -1505,10 +1765,14 @@ void input_handle(Editor *ed, MenuState *menu) {
             ed->mode = MODE_MENU;
             break;
 
-        /* Escape - clear selection or open menu */
+        /* Escape - clear selection, stop a background load or search, or open menu */
         case 27:
             if (ed->selection.active || editor_has_multi_selection(ed)) {
                 editor_clear_selection(ed);
+            } else if (ed->loading) {
+                file_cancel_load(ed);
+            } else if (ed->searching) {
+                search_cancel(ed);
             } else {
                 /* Escape alone (not Alt+key) could open menu */
                 menu_open(menu, 0);
@@ -1524,6 +1788,16 @@ void input_handle(Editor *ed, MenuState *menu) {
                     editor_clear_selection(ed);
                 }
                 editor_insert_char(ed, (char)key);
+            } else if (key >= 0x80 && key <= 0xFF) {
+                /* UTF-8 lead byte - insert the whole character as one edit */
+                char utf8[4];
+                int len = input_read_utf8(key, utf8);
+                if (len > 0) {
+                    if (ed->selection.active && !editor_has_selection(ed)) {
+                        editor_clear_selection(ed);
+                    }
+                    editor_insert_text(ed, utf8, len);
+                }
             }
             break;
     }
@@ -5,10 +5,20 @@
 struct Editor;
 struct MenuState;
 
+/* Bracketed paste markers, mapped with define_key (ncurses only) */
+#define KEY_PASTE_BEGIN (KEY_MAX + 1)
+#define KEY_PASTE_END   (KEY_MAX + 2)
+
+/* Terminal input modes */
+void input_init(void);
+void input_shutdown(void);
+
 /* Input handling */
 void input_handle(struct Editor *ed, struct MenuState *menu);
 int input_get_key(void);
 bool input_is_alt_key(int *key);
+bool input_has_pending(void);
+int input_read_utf8(int lead, char *out);
 
 /* Debug mode for key code detection */
 int input_get_last_key_code(void);
@@ -0,0 +1,385 @@
+#include "smashedit.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+/* A queued unit of work; also the node of the completion queue */
+typedef struct Job {
+    JobFn run;
+    JobDoneFn done;
+    void *arg;
+    JobToken *token;
+    long submit_ms;
+    bool cancelled;
+    _Atomic(struct Job *) next;
+} Job;
+
+struct JobToken {
+    atomic_bool cancelled;
+    atomic_int refs;
+};
+
+/* Per-worker deque: the owner pushes and pops at the bottom (LIFO, cache
+ * warm), idle workers steal from the top (FIFO, oldest work first) */
+typedef struct WorkerQueue {
+    pthread_mutex_t lock;
+    Job **items;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} WorkerQueue;
+
+typedef struct Worker {
+    pthread_t thread;
+    bool running;
+    WorkerQueue queue;
+    int index;
+} Worker;
+
+/* Vyukov intrusive MPSC queue: workers push, the main thread pops */
+typedef struct CompletionQueue {
+    _Atomic(Job *) head;
+    Job *tail;
+    Job stub;
+} CompletionQueue;
+
+static Worker g_workers[JOBS_MAX_WORKERS];
+static int g_worker_count = 0;   /* Deques jobs are spread over, 0 = run inline */
+static int g_queue_count = 0;    /* Initialized deques */
+static atomic_uint g_next_worker = 0;
+
+/* Sleeping workers wait here until g_queued becomes non-zero */
+static pthread_mutex_t g_idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_idle_cond = PTHREAD_COND_INITIALIZER;
+static atomic_int g_queued = 0;
+static atomic_bool g_stop = false;
+
+static CompletionQueue g_done;
+static JobStats g_stats;
+static bool g_initialized = false;
+
+/* Worker index of the current thread, -1 on the main thread */
+static _Thread_local int t_worker = -1;
+
+/* Cancellation tokens */
+
+JobToken *job_token_create(void) {
+    JobToken *token = malloc(sizeof(JobToken));
+    if (!token) return NULL;
+    atomic_init(&token->cancelled, false);
+    atomic_init(&token->refs, 1);
+    return token;
+}
+
+void job_token_retain(JobToken *token) {
+    if (token) atomic_fetch_add(&token->refs, 1);
+}
+
+void job_token_release(JobToken *token) {
+    if (token && atomic_fetch_sub(&token->refs, 1) == 1) {
+        free(token);
+    }
+}
+
+void job_token_cancel(JobToken *token) {
+    if (token) atomic_store(&token->cancelled, true);
+}
+
+bool job_token_cancelled(const JobToken *token) {
+    return token && atomic_load(&((JobToken *)token)->cancelled);
+}
+
+/* Completion queue */
+
+static void completion_init(CompletionQueue *q) {
+    atomic_init(&q->stub.next, NULL);
+    atomic_init(&q->head, &q->stub);
+    q->tail = &q->stub;
+}
+
+static void completion_push(CompletionQueue *q, Job *job) {
+    atomic_store(&job->next, NULL);
+    Job *prev = atomic_exchange(&q->head, job);
+    atomic_store(&prev->next, job);
+}
+
+/* Returns NULL when empty or when a push is half finished (retried on the next drain) */
+static Job *completion_pop(CompletionQueue *q) {
+    Job *tail = q->tail;
+    Job *next = atomic_load(&tail->next);
+
+    if (tail == &q->stub) {
+        if (!next) return NULL;
+        q->tail = next;
+        tail = next;
+        next = atomic_load(&next->next);
+    }
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load(&q->head)) return NULL;
+
+    completion_push(q, &q->stub);
+    next = atomic_load(&tail->next);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/* Worker deques */
+
+static bool queue_init(WorkerQueue *q) {
+    q->capacity = 64;
+    q->head = 0;
+    q->count = 0;
+    q->items = malloc(q->capacity * sizeof(Job *));
+    if (!q->items) return false;
+    pthread_mutex_init(&q->lock, NULL);
+    return true;
+}
+
+static void queue_destroy(WorkerQueue *q) {
+    pthread_mutex_destroy(&q->lock);
+    free(q->items);
+    q->items = NULL;
+}
+
+static bool queue_push_bottom(WorkerQueue *q, Job *job) {
+    pthread_mutex_lock(&q->lock);
+
+    if (q->count == q->capacity) {
+        size_t new_capacity = q->capacity * 2;
+        Job **grown = malloc(new_capacity * sizeof(Job *));
+        if (!grown) {
+            pthread_mutex_unlock(&q->lock);
+            return false;
+        }
+        for (size_t i = 0; i < q->count; i++) {
+            grown[i] = q->items[(q->head + i) % q->capacity];
+        }
+        free(q->items);
+        q->items = grown;
+        q->head = 0;
+        q->capacity = new_capacity;
+    }
+
+    q->items[(q->head + q->count) % q->capacity] = job;
+    q->count++;
+
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+static Job *queue_pop_bottom(WorkerQueue *q) {
+    Job *job = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->count > 0) {
+        q->count--;
+        job = q->items[(q->head + q->count) % q->capacity];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+static Job *queue_steal_top(WorkerQueue *q) {
+    Job *job = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->count > 0) {
+        job = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+/* Execution */
+
+static void job_finish(Job *job) {
+    completion_push(&g_done, job);
+    event_wake();
+}
+
+static void job_execute(Job *job) {
+    job->cancelled = job_token_cancelled(job->token);
+    if (!job->cancelled && job->run) {
+        job->run(job->arg, job->token);
+        job->cancelled = job_token_cancelled(job->token);
+    }
+    job_finish(job);
+}
+
+static Job *worker_find_job(Worker *self) {
+    Job *job = queue_pop_bottom(&self->queue);
+
+    for (int i = 1; !job && i < g_worker_count; i++) {
+        job = queue_steal_top(&g_workers[(self->index + i) % g_worker_count].queue);
+    }
+    return job;
+}
+
+static void *worker_main(void *data) {
+    Worker *self = data;
+    t_worker = self->index;
+
+    while (!atomic_load(&g_stop)) {
+        Job *job = worker_find_job(self);
+        if (job) {
+            atomic_fetch_sub(&g_queued, 1);
+            job_execute(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&g_idle_lock);
+        while (!atomic_load(&g_stop) && atomic_load(&g_queued) == 0) {
+            pthread_cond_wait(&g_idle_cond, &g_idle_lock);
+        }
+        pthread_mutex_unlock(&g_idle_lock);
+    }
+
+    return NULL;
+}
+
+/* Pool lifecycle */
+
+bool jobs_init(int threads) {
+    completion_init(&g_done);
+    g_initialized = true;
+    memset(&g_stats, 0, sizeof(g_stats));
+    atomic_store(&g_stop, false);
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > JOBS_MAX_WORKERS) threads = JOBS_MAX_WORKERS;
+
+    g_queue_count = 0;
+    for (int i = 0; i < threads; i++) {
+        Worker *w = &g_workers[i];
+        w->index = i;
+        if (!queue_init(&w->queue)) break;
+        g_queue_count++;
+    }
+
+    /* Fixed before any thread starts; a deque whose thread failed to start
+     * is still emptied by the others stealing from it */
+    g_worker_count = g_queue_count;
+    int started = 0;
+    for (int i = 0; i < g_queue_count; i++) {
+        g_workers[i].running = pthread_create(&g_workers[i].thread, NULL,
+                                              worker_main, &g_workers[i]) == 0;
+        if (g_workers[i].running) started++;
+    }
+    if (started == 0) {
+        g_worker_count = 0;  /* Jobs run inline */
+    }
+
+    return g_worker_count > 0;
+}
+
+void jobs_shutdown(void) {
+    if (!g_initialized) return;
+
+    pthread_mutex_lock(&g_idle_lock);
+    atomic_store(&g_stop, true);
+    pthread_cond_broadcast(&g_idle_cond);
+    pthread_mutex_unlock(&g_idle_lock);
+
+    for (int i = 0; i < g_queue_count; i++) {
+        if (g_workers[i].running) {
+            pthread_join(g_workers[i].thread, NULL);
+            g_workers[i].running = false;
+        }
+    }
+
+    /* Jobs that never ran complete as cancelled so their callbacks can clean up */
+    for (int i = 0; i < g_queue_count; i++) {
+        Job *job;
+        while ((job = queue_pop_bottom(&g_workers[i].queue)) != NULL) {
+            job->cancelled = true;
+            completion_push(&g_done, job);
+        }
+        queue_destroy(&g_workers[i].queue);
+    }
+    g_worker_count = 0;
+    g_queue_count = 0;
+    atomic_store(&g_queued, 0);
+
+    jobs_drain();
+}
+
+int jobs_worker_count(void) {
+    return g_worker_count;
+}
+
+bool jobs_submit(JobFn run, JobDoneFn done, void *arg, JobToken *token) {
+    if (!g_initialized) return false;
+
+    Job *job = malloc(sizeof(Job));
+    if (!job) return false;
+
+    job->run = run;
+    job->done = done;
+    job->arg = arg;
+    job->token = token;
+    job->submit_ms = event_now_ms();
+    job->cancelled = false;
+    atomic_init(&job->next, NULL);
+    job_token_retain(token);
+
+    /* No worker threads - run inline, completion still goes through the queue */
+    if (g_worker_count == 0) {
+        job_execute(job);
+        return true;
+    }
+
+    /* Workers keep their own sub-jobs; the main thread spreads jobs round-robin */
+    int target = t_worker >= 0 ? t_worker
+                               : (int)(atomic_fetch_add(&g_next_worker, 1) % (unsigned)g_worker_count);
+
+    atomic_fetch_add(&g_queued, 1);
+    if (!queue_push_bottom(&g_workers[target].queue, job)) {
+        atomic_fetch_sub(&g_queued, 1);
+        job_token_release(token);
+        free(job);
+        return false;
+    }
+
+    pthread_mutex_lock(&g_idle_lock);
+    pthread_cond_signal(&g_idle_cond);
+    pthread_mutex_unlock(&g_idle_lock);
+
+    return true;
+}
+
+int jobs_drain(void) {
+    if (!g_initialized) return 0;
+
+    int count = 0;
+    Job *job;
+
+    while ((job = completion_pop(&g_done)) != NULL) {
+        long latency = event_now_ms() - job->submit_ms;
+        g_stats.completed++;
+        g_stats.last_ms = latency;
+        g_stats.total_ms += latency;
+        if (latency > g_stats.max_ms) g_stats.max_ms = latency;
+
+        if (job->done) {
+            job->done(job->arg, job->cancelled);
+        }
+        job_token_release(job->token);
+        free(job);
+        count++;
+    }
+
+    return count;
+}
+
+const JobStats *jobs_get_stats(void) {
+    return &g_stats;
+}
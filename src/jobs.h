@@ -0,0 +1,44 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Shared cancellation flag - one token can cover a whole batch of jobs */
+typedef struct JobToken JobToken;
+
+/* Runs on a worker thread - must not touch curses or editor state */
+typedef void (*JobFn)(void *arg, const JobToken *token);
+
+/* Runs on the main thread from jobs_drain - always called, so it can free arg */
+typedef void (*JobDoneFn)(void *arg, bool cancelled);
+
+/* Round-trip statistics, shown in key debug mode */
+typedef struct JobStats {
+    unsigned long completed;    /* Jobs drained on the main thread */
+    long last_ms;               /* Submit to completion-drained latency */
+    long max_ms;
+    long total_ms;
+} JobStats;
+
+/* Pool lifecycle - threads = 0 picks one per CPU (up to JOBS_MAX_WORKERS) */
+bool jobs_init(int threads);
+void jobs_shutdown(void);
+int jobs_worker_count(void);
+
+/* Queue a job. Callable from the main thread or from inside a job. */
+bool jobs_submit(JobFn run, JobDoneFn done, void *arg, JobToken *token);
+
+/* Run completion callbacks for finished jobs (main thread only); returns how many ran */
+int jobs_drain(void);
+
+const JobStats *jobs_get_stats(void);
+
+/* Cancellation tokens are reference counted; each queued job holds a reference */
+JobToken *job_token_create(void);
+void job_token_retain(JobToken *token);
+void job_token_release(JobToken *token);
+void job_token_cancel(JobToken *token);
+bool job_token_cancelled(const JobToken *token);
+
+#endif /* JOBS_H */
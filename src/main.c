@@ -1,10 +1,16 @@
 #include "smashedit.h"
-#include <signal.h>
 
 static Editor *g_editor = NULL;
 static MenuState *g_menu = NULL;
 
 static void cleanup(void) {
+    /* Finish background work before the state it points at goes away */
+    if (g_editor) {
+        file_cancel_load(g_editor);
+        search_cancel(g_editor);
+    }
+    jobs_shutdown();
+
     if (g_menu) {
         menu_destroy(g_menu);
         g_menu = NULL;
@@ -13,31 +19,65 @@ static void cleanup(void) {
         editor_destroy(g_editor);
         g_editor = NULL;
     }
+    input_shutdown();
     display_shutdown();
+    event_shutdown();
 }
 
-static void handle_signal(int sig) {
-    (void)sig;
-    cleanup();
-    exit(0);
+/* Re-read the terminal size after SIGWINCH (runs in the main loop, not the handler) */
+static void handle_resize(void) {
+    endwin();
+    refresh();
+    display_invalidate();
+    editor_update_dimensions(g_editor);
 }
 
-static void handle_resize(int sig) {
-    (void)sig;
-    if (g_editor) {
-        endwin();
-        refresh();
+/* Keys handled since the last redraw */
+static int g_frame_keys = 0;
+
+/* Handle everything already typed, without waiting for more */
+static void handle_input(void) {
+    do {
+        input_handle(g_editor, g_menu);
+        g_frame_keys++;
+    } while (g_editor->running && input_has_pending());
+}
+
+/* Draw the screen and menu and record the batch of keys it shows */
+static void redraw(void) {
+    /* Update dimensions on terminal resize or when the gutter needs another digit */
+    int rows, cols;
+    getmaxyx(stdscr, rows, cols);
+    if (rows != g_editor->screen_rows || cols != g_editor->screen_cols ||
+        editor_gutter_width(g_editor) != g_editor->gutter_width) {
         editor_update_dimensions(g_editor);
     }
+
+    g_editor->keys_per_frame = g_frame_keys;
+    if (g_frame_keys > g_editor->keys_per_frame_peak) {
+        g_editor->keys_per_frame_peak = g_frame_keys;
+    }
+    g_frame_keys = 0;
+
+    /* Render */
+    display_refresh(g_editor);
+
+    /* Draw menu if active */
+    if (g_menu->active) {
+        menu_draw(g_menu, g_editor);
+        refresh();
+    }
 }
 
 int main(int argc, char *argv[]) {
-    /* Set up signal handlers */
-    signal(SIGINT, handle_signal);
-    signal(SIGTERM, handle_signal);
-#ifdef SIGWINCH
-    signal(SIGWINCH, handle_resize);
-#endif
+    /* Set up signal handling before curses so it doesn't install its own */
+    if (!event_init()) {
+        fprintf(stderr, "Failed to set up event loop\n");
+        return 1;
+    }
+
+    /* Worker threads - without them jobs simply run inline */
+    jobs_init(0);
 
     /* Create editor */
     g_editor = editor_create();
@@ -56,34 +96,56 @@ int main(int argc, char *argv[]) {
 
     /* Initialize screen */
     editor_init_screen(g_editor);
+    input_init();
+
+    /* Frame interval override, e.g. SMASHEDIT_FRAME_MS=0 to redraw after every batch */
+    const char *frame_ms = getenv("SMASHEDIT_FRAME_MS");
+    if (frame_ms && *frame_ms) {
+        g_editor->frame_interval_ms = atoi(frame_ms);
+    }
 
     /* Load file if specified */
     if (argc > 1) {
         file_load(g_editor, argv[1]);
     }
 
-    /* Main loop */
+    /* Main loop. A redraw happens as soon as the events before it are
+     * handled, unless the last one was less than a frame interval ago; then
+     * it waits for the frame timer while input keeps being handled. */
+    bool dirty = true;
+    long last_redraw = event_now_ms() - g_editor->frame_interval_ms;
     while (g_editor->running) {
         debug_log("[MAIN] loop start, sel.count=%d\n", g_editor->selection.count);
 
-        /* Update dimensions on terminal resize */
-        int rows, cols;
-        getmaxyx(stdscr, rows, cols);
-        if (rows != g_editor->screen_rows || cols != g_editor->screen_cols) {
-            editor_update_dimensions(g_editor);
+        if (dirty) {
+            long wait = g_editor->frame_interval_ms - (event_now_ms() - last_redraw);
+            if (wait <= 0) {
+                redraw();
+                last_redraw = event_now_ms();
+                dirty = false;
+                event_cancel(EVENT_TIMER_FRAME);
+            } else {
+                event_schedule(EVENT_TIMER_FRAME, wait);
+            }
         }
 
-        /* Render */
-        display_refresh(g_editor);
+        /* Sleep until input, a signal, a timer or background work needs us.
+         * Keys curses has already buffered never show up on stdin. */
+        int events = input_has_pending() ? EVENT_INPUT : event_wait();
 
-        /* Draw menu if active */
-        if (g_menu->active) {
-            menu_draw(g_menu, g_editor);
-            refresh();
+        if (events & EVENT_TERMINATE) {
+            break;
+        }
+        dirty = true;
+        if (events & EVENT_RESIZE) {
+            handle_resize();
+        }
+        if (events & EVENT_WAKE) {
+            jobs_drain();
+        }
+        if (events & EVENT_INPUT) {
+            handle_input();
         }
-
-        /* Handle input */
-        input_handle(g_editor, g_menu);
     }
 
     /* Cleanup */
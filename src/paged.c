@@ -0,0 +1,787 @@
+#include "smashedit.h"
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* One mapped stretch of the file */
+typedef struct PagedWindow {
+    char *map;              /* NULL when unused */
+    size_t offset;          /* File offset, a multiple of PAGED_WINDOW_SIZE */
+    size_t length;
+    unsigned long used;     /* Last access, for replacement */
+} PagedWindow;
+
+/* A run of text taken from the file or from the add buffer */
+typedef struct PagedPiece {
+    bool added;
+    size_t offset;          /* Start in the file or in the add buffer */
+    size_t length;
+    size_t newlines;
+    size_t file_newlines;   /* Newlines in the file before offset (file pieces) */
+} PagedPiece;
+
+/* A file offset and the number of newlines before it */
+typedef struct PagedPoint {
+    size_t offset;
+    size_t newlines;
+} PagedPoint;
+
+struct PagedFile {
+    int fd;
+    size_t size;
+
+    /* Sparse line index: checkpoint i sits at min(i * PAGED_INDEX_INTERVAL, size)
+     * and counts[i] is the newlines before it. The main thread reads
+     * [0, ready); the queued index job fills [ready, indexed) and its
+     * completion publishes them. */
+    size_t *counts;
+    size_t checkpoints;     /* Checkpoints in the complete index */
+    size_t ready;
+    size_t indexed;
+    char *scan;             /* Read buffer of the index job */
+    int error;              /* errno of a failed index read */
+    JobToken *token;
+    bool indexing;          /* An index job is queued */
+    int holds;              /* Other jobs reading through paged_read */
+    bool closed;            /* Closed while jobs were out; the last one frees it */
+
+    PagedWindow windows[PAGED_WINDOWS];
+    int last_window;
+    unsigned long clock;
+
+    PagedPoint anchors[PAGED_ANCHORS];
+    int anchor_count;
+    int anchor_next;
+
+    /* Piece table, once editing is allowed */
+    bool editable;
+    PagedPiece *pieces;
+    size_t piece_count;
+    size_t piece_capacity;
+    size_t piece_hint;      /* Piece found by the last lookup, and its start */
+    size_t piece_hint_start;
+    char *added;            /* Inserted text, only ever appended to */
+    size_t added_length;
+    size_t added_capacity;
+    size_t length;
+    size_t newlines;
+};
+
+static size_t paged_count_raw(const char *p, size_t len) {
+    size_t count = 0;
+    const char *end = p + len;
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        count++;
+        p++;
+    }
+    return count;
+}
+
+/* Read exactly len bytes at offset; 0 or an errno */
+static int paged_pread(int fd, char *dst, size_t len, size_t offset) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = pread(fd, dst + got, len - got, (off_t)(offset + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return n < 0 ? errno : EIO;    /* EOF early: the file shrank */
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static size_t paged_checkpoint(const PagedFile *pf, size_t i) {
+    size_t offset = i * PAGED_INDEX_INTERVAL;
+    return offset < pf->size ? offset : pf->size;
+}
+
+/* Windows */
+
+/* Window holding a file offset, mapping it over the least recently used one
+ * if needed */
+static PagedWindow *paged_window(PagedFile *pf, size_t offset) {
+    size_t start = offset - offset % PAGED_WINDOW_SIZE;
+    PagedWindow *w = &pf->windows[pf->last_window];
+
+    if (!w->map || w->offset != start) {
+        int victim = 0;
+        int found = -1;
+        for (int i = 0; i < PAGED_WINDOWS; i++) {
+            PagedWindow *c = &pf->windows[i];
+            if (c->map && c->offset == start) {
+                found = i;
+                break;
+            }
+            if (!c->map || (pf->windows[victim].map && c->used < pf->windows[victim].used)) {
+                victim = i;
+            }
+        }
+
+        if (found < 0) {
+            found = victim;
+            w = &pf->windows[victim];
+            if (w->map) munmap(w->map, w->length);
+
+            size_t length = pf->size - start < PAGED_WINDOW_SIZE ? pf->size - start : PAGED_WINDOW_SIZE;
+            void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, pf->fd, (off_t)start);
+            if (map == MAP_FAILED) {
+                w->map = NULL;
+                return NULL;
+            }
+            w->map = map;
+            w->offset = start;
+            w->length = length;
+        }
+        pf->last_window = found;
+        w = &pf->windows[found];
+    }
+
+    w->used = ++pf->clock;
+    return w;
+}
+
+/* File bytes from offset to the end of its window */
+static const char *paged_file_span(PagedFile *pf, size_t offset, size_t *len) {
+    PagedWindow *w = offset < pf->size ? paged_window(pf, offset) : NULL;
+    if (!w) {
+        *len = 0;
+        return NULL;
+    }
+    *len = w->length - (offset - w->offset);
+    return w->map + (offset - w->offset);
+}
+
+/* Newlines in the file between start and end */
+static size_t paged_file_count(PagedFile *pf, size_t start, size_t end) {
+    size_t count = 0;
+    while (start < end) {
+        size_t len;
+        const char *p = paged_file_span(pf, start, &len);
+        if (!p) break;
+        if (len > end - start) len = end - start;
+        count += paged_count_raw(p, len);
+        start += len;
+    }
+    return count;
+}
+
+/* File lines */
+
+static void paged_remember(PagedFile *pf, size_t offset, size_t newlines) {
+    for (int i = 0; i < pf->anchor_count; i++) {
+        if (pf->anchors[i].offset == offset) return;
+    }
+    pf->anchors[pf->anchor_next].offset = offset;
+    pf->anchors[pf->anchor_next].newlines = newlines;
+    pf->anchor_next = (pf->anchor_next + 1) % PAGED_ANCHORS;
+    if (pf->anchor_count < PAGED_ANCHORS) pf->anchor_count++;
+}
+
+/* Nearest checkpoint or recent lookup at or before offset, and after it
+ * (offset SIZE_MAX when nothing past it is known) */
+static void paged_known_around(const PagedFile *pf, size_t offset, PagedPoint *from, PagedPoint *to) {
+    size_t c = offset / PAGED_INDEX_INTERVAL;
+    if (c >= pf->ready) c = pf->ready - 1;
+
+    from->offset = paged_checkpoint(pf, c);
+    from->newlines = pf->counts[c];
+    to->offset = SIZE_MAX;
+    to->newlines = 0;
+    if (c + 1 < pf->ready) {
+        to->offset = paged_checkpoint(pf, c + 1);
+        to->newlines = pf->counts[c + 1];
+    }
+    for (int i = 0; i < pf->anchor_count; i++) {
+        const PagedPoint *a = &pf->anchors[i];
+        if (a->offset <= offset && a->offset > from->offset) *from = *a;
+        if (a->offset >= offset && a->offset < to->offset) *to = *a;
+    }
+}
+
+/* Whether offset is close enough to a known point to be counted from it */
+static bool paged_reaches(size_t offset, const PagedPoint *from, const PagedPoint *to) {
+    return offset - from->offset <= PAGED_INDEX_INTERVAL || to->offset - offset <= PAGED_INDEX_INTERVAL;
+}
+
+/* Newlines in the file before offset, counted from the nearest checkpoint
+ * or recent lookup on either side. Past what the index reaches, the answer
+ * is for the farthest point a short scan gets to rather than reading the
+ * rest of the file here. */
+static size_t paged_file_newlines(PagedFile *pf, size_t offset) {
+    PagedPoint from, to;
+    paged_known_around(pf, offset, &from, &to);
+    if (!paged_reaches(offset, &from, &to)) {
+        offset = from.offset + PAGED_INDEX_INTERVAL;
+        to.offset = SIZE_MAX;
+    }
+
+    size_t newlines;
+    if (to.offset - offset < offset - from.offset) {
+        newlines = to.newlines - paged_file_count(pf, offset, to.offset);
+    } else {
+        newlines = from.newlines + paged_file_count(pf, from.offset, offset);
+    }
+    if (offset != from.offset && offset != to.offset) {
+        paged_remember(pf, offset, newlines);
+    }
+    return newlines;
+}
+
+/* Offset of the given newline (1-based), looking back at most an interval
+ * from a known point after it; SIZE_MAX if it is further back */
+static size_t paged_newline_back(PagedFile *pf, const PagedPoint *to, size_t newline) {
+    size_t want = to->newlines - newline + 1;
+    size_t stop = to->offset > PAGED_INDEX_INTERVAL ? to->offset - PAGED_INDEX_INTERVAL : 0;
+    size_t pos = to->offset;
+
+    while (pos > stop) {
+        size_t start = (pos - 1) - (pos - 1) % PAGED_WINDOW_SIZE;
+        if (start < stop) start = stop;
+        size_t len;
+        const char *p = paged_file_span(pf, start, &len);
+        if (!p) break;
+
+        for (size_t i = pos - start; i > 0; i--) {
+            if (p[i - 1] == '\n' && --want == 0) {
+                size_t at = start + i - 1;
+                paged_remember(pf, at, newline - 1);
+                return at;
+            }
+        }
+        pos = start;
+    }
+    return SIZE_MAX;
+}
+
+/* File offset just after the given newline (1-based), or the file size.
+ * Scans go at most an interval from a known point, which only cuts them
+ * short past what the index reaches; the answer is then the start of the
+ * last line seen. */
+static size_t paged_file_newline_end(PagedFile *pf, size_t newline) {
+    if (newline == 0) return 0;
+
+    /* Last checkpoint with fewer newlines before it, and the next one */
+    size_t lo = 0, hi = pf->ready;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pf->counts[mid] < newline) lo = mid;
+        else hi = mid;
+    }
+    PagedPoint from = {paged_checkpoint(pf, lo), pf->counts[lo]};
+    PagedPoint to = {SIZE_MAX, 0};
+    if (hi < pf->ready && pf->counts[hi] >= newline) {
+        to.offset = paged_checkpoint(pf, hi);
+        to.newlines = pf->counts[hi];
+    }
+    for (int i = 0; i < pf->anchor_count; i++) {
+        const PagedPoint *a = &pf->anchors[i];
+        if (a->newlines < newline && a->offset > from.offset) from = *a;
+        if (a->newlines >= newline && a->offset < to.offset) to = *a;
+    }
+
+    /* Across a gap in what is known, try back from its far side first */
+    if (to.offset != SIZE_MAX && to.offset - from.offset > PAGED_INDEX_INTERVAL) {
+        size_t at = paged_newline_back(pf, &to, newline);
+        if (at != SIZE_MAX) return at + 1;
+    }
+
+    size_t want = newline - from.newlines;
+    size_t pos = from.offset;
+    size_t stop = pf->size - from.offset > PAGED_INDEX_INTERVAL ? from.offset + PAGED_INDEX_INTERVAL : pf->size;
+    size_t last = SIZE_MAX;     /* Last newline seen */
+    while (pos < stop) {
+        size_t len;
+        const char *p = paged_file_span(pf, pos, &len);
+        if (!p) break;
+        if (len > stop - pos) len = stop - pos;
+
+        const char *end = p + len;
+        for (const char *q = p; (q = memchr(q, '\n', end - q)) != NULL; q++) {
+            last = pos + (size_t)(q - p);
+            if (--want == 0) {
+                paged_remember(pf, last, newline - 1);
+                return last + 1;
+            }
+        }
+        pos += len;
+    }
+    if (stop == pf->size) return pf->size;
+
+    if (last == SIZE_MAX) return from.offset;
+    paged_remember(pf, last, newline - want - 1);
+    return last + 1;
+}
+
+/* Background line index */
+
+static void paged_free(PagedFile *pf) {
+    close(pf->fd);
+    free(pf->pieces);
+    free(pf->added);
+    free(pf->counts);
+    free(pf->scan);
+    job_token_release(pf->token);
+    free(pf);
+}
+
+/* Worker: count the newlines of the next few intervals */
+static void paged_index_run(void *arg, const JobToken *token) {
+    PagedFile *pf = arg;
+    size_t i = pf->ready;
+    size_t stop = i + PAGED_INDEX_STEP;
+    if (stop > pf->checkpoints) stop = pf->checkpoints;
+
+    for (; i < stop && !job_token_cancelled(token); i++) {
+        size_t start = paged_checkpoint(pf, i - 1);
+        size_t len = paged_checkpoint(pf, i) - start;
+
+        pf->error = paged_pread(pf->fd, pf->scan, len, start);
+        if (pf->error) break;
+
+        pf->counts[i] = pf->counts[i - 1] + paged_count_raw(pf->scan, len);
+    }
+    pf->indexed = i;
+}
+
+static void paged_index_next(PagedFile *pf);
+
+/* Main thread: publish the new checkpoints and queue the next step */
+static void paged_index_done(void *arg, bool cancelled) {
+    PagedFile *pf = arg;
+    pf->indexing = false;
+    if (pf->closed) {
+        if (pf->holds == 0) paged_free(pf);
+        return;
+    }
+    if (cancelled) return;
+
+    pf->ready = pf->indexed;
+    if (pf->ready < pf->checkpoints && !pf->error) {
+        paged_index_next(pf);
+    }
+    if (!pf->indexing) {
+        free(pf->scan);
+        pf->scan = NULL;
+    }
+}
+
+static void paged_index_next(PagedFile *pf) {
+    pf->indexing = jobs_submit(paged_index_run, paged_index_done, pf, pf->token);
+}
+
+/* Lifecycle */
+
+PagedFile *paged_open(int fd, size_t size) {
+    PagedFile *pf = calloc(1, sizeof(PagedFile));
+    if (!pf) return NULL;
+
+    pf->fd = fd;
+    pf->size = size;
+    pf->length = size;
+    pf->checkpoints = (size + PAGED_INDEX_INTERVAL - 1) / PAGED_INDEX_INTERVAL + 1;
+    pf->counts = malloc(pf->checkpoints * sizeof(size_t));
+    pf->scan = malloc(PAGED_INDEX_INTERVAL);
+    pf->token = job_token_create();
+    if (!pf->counts || !pf->scan || !pf->token) {
+        if (pf->token) job_token_release(pf->token);
+        free(pf->counts);
+        free(pf->scan);
+        free(pf);
+        return NULL;
+    }
+
+    pf->counts[0] = 0;
+    pf->ready = 1;
+    pf->indexed = 1;
+    paged_index_next(pf);
+
+    return pf;
+}
+
+void paged_close(PagedFile *pf) {
+    if (!pf) return;
+
+    for (int i = 0; i < PAGED_WINDOWS; i++) {
+        if (pf->windows[i].map) munmap(pf->windows[i].map, pf->windows[i].length);
+    }
+
+    if (pf->indexing || pf->holds > 0) {
+        job_token_cancel(pf->token);
+        pf->closed = true;
+        return;
+    }
+    paged_free(pf);
+}
+
+void paged_hold(PagedFile *pf) {
+    if (pf) pf->holds++;
+}
+
+void paged_release(PagedFile *pf) {
+    if (!pf) return;
+    pf->holds--;
+    if (pf->closed && pf->holds == 0 && !pf->indexing) paged_free(pf);
+}
+
+/* Pieces */
+
+/* Piece holding pos (piece_count at the end) and where it starts */
+static size_t paged_piece_at(PagedFile *pf, size_t pos, size_t *start) {
+    size_t i = 0, at = 0;
+    if (pf->piece_hint_start <= pos) {
+        i = pf->piece_hint;
+        at = pf->piece_hint_start;
+    }
+    while (i < pf->piece_count && at + pf->pieces[i].length <= pos) {
+        at += pf->pieces[i].length;
+        i++;
+    }
+    if (i < pf->piece_count) {
+        pf->piece_hint = i;
+        pf->piece_hint_start = at;
+    }
+    *start = at;
+    return i;
+}
+
+static bool paged_grow_pieces(PagedFile *pf, size_t extra) {
+    if (pf->piece_count + extra <= pf->piece_capacity) return true;
+
+    size_t new_capacity = pf->piece_capacity * 2;
+    PagedPiece *grown = realloc(pf->pieces, new_capacity * sizeof(PagedPiece));
+    if (!grown) return false;
+    pf->pieces = grown;
+    pf->piece_capacity = new_capacity;
+    return true;
+}
+
+/* Index of the piece starting at pos, splitting the one around it first;
+ * piece_count at the end, SIZE_MAX when out of memory */
+static size_t paged_split(PagedFile *pf, size_t pos) {
+    size_t start;
+    size_t i = paged_piece_at(pf, pos, &start);
+    if (i == pf->piece_count || start == pos) return i;
+    if (!paged_grow_pieces(pf, 1)) return SIZE_MAX;
+
+    PagedPiece *piece = &pf->pieces[i];
+    size_t rel = pos - start;
+    PagedPiece right = *piece;
+    right.offset += rel;
+    right.length -= rel;
+
+    size_t left_newlines;
+    if (piece->added) {
+        left_newlines = paged_count_raw(pf->added + piece->offset, rel);
+    } else {
+        right.file_newlines = paged_file_newlines(pf, right.offset);
+        left_newlines = right.file_newlines - piece->file_newlines;
+    }
+    right.newlines = piece->newlines - left_newlines;
+    piece->newlines = left_newlines;
+    piece->length = rel;
+
+    memmove(&pf->pieces[i + 2], &pf->pieces[i + 1], (pf->piece_count - i - 1) * sizeof(PagedPiece));
+    pf->pieces[i + 1] = right;
+    pf->piece_count++;
+    pf->piece_hint = 0;
+    pf->piece_hint_start = 0;
+    return i + 1;
+}
+
+/* Access */
+
+size_t paged_length(PagedFile *pf) {
+    return pf ? pf->length : 0;
+}
+
+const char *paged_span(PagedFile *pf, size_t pos, size_t *len) {
+    *len = 0;
+    if (!pf || pos >= pf->length) return NULL;
+    if (!pf->editable) return paged_file_span(pf, pos, len);
+
+    size_t start;
+    const PagedPiece *piece = &pf->pieces[paged_piece_at(pf, pos, &start)];
+    size_t rel = pos - start;
+    size_t avail = piece->length - rel;
+
+    if (piece->added) {
+        *len = avail;
+        return pf->added + piece->offset + rel;
+    }
+    const char *p = paged_file_span(pf, piece->offset + rel, len);
+    if (*len > avail) *len = avail;
+    return p;
+}
+
+char paged_get_char(PagedFile *pf, size_t pos) {
+    size_t len;
+    const char *p = paged_span(pf, pos, &len);
+    return p ? *p : '\0';
+}
+
+size_t paged_read(PagedFile *pf, size_t pos, char *dst, size_t len) {
+    if (!pf || pos >= pf->length) return 0;
+    if (len > pf->length - pos) len = pf->length - pos;
+    if (!pf->editable) return paged_pread(pf->fd, dst, len, pos) == 0 ? len : 0;
+
+    /* Walk the pieces without the lookup hint, which the main thread owns */
+    size_t copied = 0, at = 0;
+    for (size_t i = 0; i < pf->piece_count && copied < len; i++) {
+        const PagedPiece *piece = &pf->pieces[i];
+        if (pos + copied >= at + piece->length) {
+            at += piece->length;
+            continue;
+        }
+
+        size_t rel = pos + copied - at;
+        size_t n = piece->length - rel;
+        if (n > len - copied) n = len - copied;
+        if (piece->added) {
+            memcpy(dst + copied, pf->added + piece->offset + rel, n);
+        } else if (paged_pread(pf->fd, dst + copied, n, piece->offset + rel) != 0) {
+            break;
+        }
+        copied += n;
+        at += piece->length;
+    }
+    return copied;
+}
+
+/* Lines */
+
+size_t paged_line_count(PagedFile *pf) {
+    if (!pf) return 1;
+    if (pf->editable) return pf->newlines + 1;
+
+    /* Lookups past the indexed part have seen lines it hasn't yet */
+    size_t newlines = pf->counts[pf->ready - 1];
+    if (!paged_index_complete(pf)) {
+        for (int i = 0; i < pf->anchor_count; i++) {
+            if (pf->anchors[i].newlines > newlines) newlines = pf->anchors[i].newlines;
+        }
+    }
+    return newlines + 1;
+}
+
+size_t paged_newlines_before(PagedFile *pf, size_t pos) {
+    if (!pf) return 0;
+    if (pos > pf->length) pos = pf->length;
+    if (!pf->editable) return paged_file_newlines(pf, pos);
+
+    size_t count = 0, at = 0;
+    for (size_t i = 0; i < pf->piece_count; i++) {
+        const PagedPiece *piece = &pf->pieces[i];
+        if (pos < at + piece->length) {
+            size_t rel = pos - at;
+            if (rel == 0) break;
+            if (piece->added) {
+                count += paged_count_raw(pf->added + piece->offset, rel);
+            } else {
+                count += paged_file_newlines(pf, piece->offset + rel) - piece->file_newlines;
+            }
+            break;
+        }
+        count += piece->newlines;
+        at += piece->length;
+    }
+    return count;
+}
+
+void paged_note_line(PagedFile *pf, size_t pos, size_t newlines) {
+    if (!pf || pf->editable || pos > pf->size || paged_index_complete(pf)) return;
+    paged_remember(pf, pos, newlines);
+}
+
+size_t paged_lookup_clamp(PagedFile *pf, size_t pos) {
+    if (!pf || pf->editable || paged_index_complete(pf) || pos > pf->size) return pos;
+
+    PagedPoint from, to;
+    paged_known_around(pf, pos, &from, &to);
+    return paged_reaches(pos, &from, &to) ? pos : from.offset + PAGED_INDEX_INTERVAL;
+}
+
+size_t paged_newline_end(PagedFile *pf, size_t newline) {
+    if (!pf || newline == 0) return 0;
+    if (!pf->editable) return paged_file_newline_end(pf, newline);
+
+    size_t count = 0, at = 0;
+    for (size_t i = 0; i < pf->piece_count; i++) {
+        const PagedPiece *piece = &pf->pieces[i];
+        if (count + piece->newlines >= newline) {
+            size_t want = newline - count;
+            if (!piece->added) {
+                return at + paged_file_newline_end(pf, piece->file_newlines + want) - piece->offset;
+            }
+            const char *p = pf->added + piece->offset;
+            for (size_t k = 0; k < piece->length; k++) {
+                if (p[k] == '\n' && --want == 0) return at + k + 1;
+            }
+        }
+        count += piece->newlines;
+        at += piece->length;
+    }
+    return pf->length;
+}
+
+/* Index progress */
+
+bool paged_index_complete(PagedFile *pf) {
+    return pf && pf->ready == pf->checkpoints;
+}
+
+int paged_index_percent(PagedFile *pf) {
+    if (!pf || !pf->indexing) return -1;
+
+    size_t percent = pf->ready * 100 / pf->checkpoints;
+    return percent > 99 ? 99 : (int)percent;
+}
+
+/* Editing */
+
+bool paged_allow_editing(PagedFile *pf) {
+    if (!pf) return false;
+    if (pf->editable) return true;
+    if (!paged_index_complete(pf)) return false;
+
+    pf->pieces = malloc(16 * sizeof(PagedPiece));
+    if (!pf->pieces) return false;
+    pf->piece_capacity = 16;
+    pf->piece_count = 1;
+    pf->pieces[0].added = false;
+    pf->pieces[0].offset = 0;
+    pf->pieces[0].length = pf->size;
+    pf->pieces[0].newlines = pf->counts[pf->checkpoints - 1];
+    pf->pieces[0].file_newlines = 0;
+    pf->newlines = pf->pieces[0].newlines;
+    pf->piece_hint = 0;
+    pf->piece_hint_start = 0;
+    pf->editable = true;
+    return true;
+}
+
+bool paged_editable(PagedFile *pf) {
+    return pf && pf->editable;
+}
+
+bool paged_insert(PagedFile *pf, size_t pos, const char *text, size_t len) {
+    if (!pf || !pf->editable || pos > pf->length) return false;
+    if (len == 0) return true;
+
+    if (pf->added_length + len > pf->added_capacity) {
+        size_t new_capacity = pf->added_capacity ? pf->added_capacity * 2 : 4096;
+        while (new_capacity < pf->added_length + len) new_capacity *= 2;
+        char *grown = realloc(pf->added, new_capacity);
+        if (!grown) return false;
+        pf->added = grown;
+        pf->added_capacity = new_capacity;
+    }
+    size_t newlines = paged_count_raw(text, len);
+
+    /* Typing extends the piece it just added instead of making a new one */
+    size_t start = 0;
+    size_t prev = pos > 0 ? paged_piece_at(pf, pos - 1, &start) : pf->piece_count;
+    if (prev < pf->piece_count && pf->pieces[prev].added &&
+        start + pf->pieces[prev].length == pos &&
+        pf->pieces[prev].offset + pf->pieces[prev].length == pf->added_length) {
+        pf->pieces[prev].length += len;
+        pf->pieces[prev].newlines += newlines;
+    } else {
+        size_t at = paged_split(pf, pos);
+        if (at == SIZE_MAX || !paged_grow_pieces(pf, 1)) return false;
+
+        memmove(&pf->pieces[at + 1], &pf->pieces[at], (pf->piece_count - at) * sizeof(PagedPiece));
+        pf->pieces[at].added = true;
+        pf->pieces[at].offset = pf->added_length;
+        pf->pieces[at].length = len;
+        pf->pieces[at].newlines = newlines;
+        pf->pieces[at].file_newlines = 0;
+        pf->piece_count++;
+        pf->piece_hint = 0;
+        pf->piece_hint_start = 0;
+    }
+
+    memcpy(pf->added + pf->added_length, text, len);
+    pf->added_length += len;
+    pf->length += len;
+    pf->newlines += newlines;
+    return true;
+}
+
+bool paged_delete(PagedFile *pf, size_t start, size_t end, size_t *newlines) {
+    if (!pf || !pf->editable || start >= end || end > pf->length) return false;
+
+    size_t first = paged_split(pf, start);
+    size_t last = first == SIZE_MAX ? SIZE_MAX : paged_split(pf, end);
+    if (last == SIZE_MAX) return false;
+
+    size_t removed = 0;
+    for (size_t i = first; i < last; i++) {
+        removed += pf->pieces[i].newlines;
+    }
+    memmove(&pf->pieces[first], &pf->pieces[last], (pf->piece_count - last) * sizeof(PagedPiece));
+    pf->piece_count -= last - first;
+    pf->piece_hint = 0;
+    pf->piece_hint_start = 0;
+    pf->length -= end - start;
+    pf->newlines -= removed;
+
+    if (newlines) *newlines = removed;
+    return true;
+}
+
+/* Saving */
+
+static bool paged_write_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* Copy file bytes through a read buffer, leaving the view's windows alone */
+static bool paged_write_file(PagedFile *pf, int fd, size_t offset, size_t len, char *bounce) {
+    while (len > 0) {
+        size_t want = len < PAGED_WINDOW_SIZE ? len : PAGED_WINDOW_SIZE;
+        ssize_t n = pread(pf->fd, bounce, want, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            return false;
+        }
+        if (!paged_write_all(fd, bounce, (size_t)n)) return false;
+        offset += (size_t)n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool paged_write(PagedFile *pf, int fd) {
+    if (!pf) return false;
+
+    char *bounce = malloc(PAGED_WINDOW_SIZE);
+    if (!bounce) return false;
+
+    bool ok = true;
+    if (!pf->editable) {
+        ok = paged_write_file(pf, fd, 0, pf->size, bounce);
+    }
+    for (size_t i = 0; ok && i < pf->piece_count; i++) {
+        const PagedPiece *piece = &pf->pieces[i];
+        if (piece->added) {
+            ok = paged_write_all(fd, pf->added + piece->offset, piece->length);
+        } else {
+            ok = paged_write_file(pf, fd, piece->offset, piece->length, bounce);
+        }
+    }
+
+    int err = errno;
+    free(bounce);
+    errno = err;
+    return ok;
+}
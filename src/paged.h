@@ -0,0 +1,75 @@
+#ifndef PAGED_H
+#define PAGED_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Files this large are viewed in place instead of being read into memory */
+#define PAGED_MIN_SIZE ((size_t)1024 * 1024 * 1024)
+
+/* Bytes mapped per window; a multiple of any page size */
+#define PAGED_WINDOW_SIZE (8 * 1024 * 1024)
+
+/* Windows kept mapped at once, bounding what the view keeps resident */
+#define PAGED_WINDOWS 8
+
+/* Bytes between line index checkpoints */
+#define PAGED_INDEX_INTERVAL (2 * 1024 * 1024)
+
+/* Checkpoints counted per background index job */
+#define PAGED_INDEX_STEP 8
+
+/* Recent line lookups remembered to start the next one from */
+#define PAGED_ANCHORS 8
+
+/* A file shown through a few mmap'd windows, with a sparse line index built
+ * in the background. Read-only until editing is allowed, after which edits
+ * go into a piece table over the file and an in-memory add buffer; the file
+ * itself is never written through the mapping.
+ * The file must not be truncated by someone else while it is open. */
+typedef struct PagedFile PagedFile;
+
+/* Lifecycle - takes over fd */
+PagedFile *paged_open(int fd, size_t size);
+void paged_close(PagedFile *pf);
+
+/* Access */
+size_t paged_length(PagedFile *pf);
+char paged_get_char(PagedFile *pf, size_t pos);
+/* Contiguous bytes starting at pos; *len gets how many (0 on failure) */
+const char *paged_span(PagedFile *pf, size_t pos, size_t *len);
+/* Copy up to len bytes at pos into dst, returning how many. Safe on a worker
+ * thread while the main thread leaves the text unchanged; hold the file
+ * for as long as such a job is out. */
+size_t paged_read(PagedFile *pf, size_t pos, char *dst, size_t len);
+void paged_hold(PagedFile *pf);
+void paged_release(PagedFile *pf);
+
+/* Lines. While the index is being built the line count is a lower bound,
+ * and lookups scan at most PAGED_INDEX_INTERVAL past the indexed part or a
+ * recent lookup; ones further out answer for the farthest point reached. */
+size_t paged_line_count(PagedFile *pf);
+size_t paged_newlines_before(PagedFile *pf, size_t pos);
+/* Offset just after the given newline (1-based), or the length if there is none */
+size_t paged_newline_end(PagedFile *pf, size_t newline);
+/* pos, or the furthest position before it that line lookups reach without
+ * a long scan */
+size_t paged_lookup_clamp(PagedFile *pf, size_t pos);
+/* Record newlines before pos counted by the caller, so lookups reach there */
+void paged_note_line(PagedFile *pf, size_t pos, size_t newlines);
+
+/* Index progress: -1 once complete (or stopped by a read error) */
+int paged_index_percent(PagedFile *pf);
+bool paged_index_complete(PagedFile *pf);
+
+/* Editing, possible once the index is complete */
+bool paged_allow_editing(PagedFile *pf);
+bool paged_editable(PagedFile *pf);
+bool paged_insert(PagedFile *pf, size_t pos, const char *text, size_t len);
+/* Removes [start, end); *newlines gets how many newlines went with it */
+bool paged_delete(PagedFile *pf, size_t start, size_t end, size_t *newlines);
+
+/* Write the current text to fd */
+bool paged_write(PagedFile *pf, int fd);
+
+#endif /* PAGED_H */
@@ -1,68 +1,322 @@
 #include "smashedit.h"
+#include <stdint.h>
 
-bool search_find(Editor *ed, const char *term, size_t start_pos) {
-    if (!ed || !ed->buffer || !term || !term[0]) return false;
+/* Whether len bytes at text match term, ignoring case */
+static bool search_equal_fold(const char *text, const char *term, size_t len) {
+    for (size_t j = 0; j < len; j++) {
+        if (tolower((unsigned char)text[j]) != tolower((unsigned char)term[j])) return false;
+    }
+    return true;
+}
 
-    size_t term_len = strlen(term);
-    size_t buf_len = buffer_get_length(ed->buffer);
+/* Offset of the first match starting in span[0, starts), or SIZE_MAX. The
+ * span holds term_len - 1 bytes more so a match at the last start is whole. */
+static size_t search_span(const char *span, size_t starts, const char *term, size_t term_len, bool fold) {
+    int first = tolower((unsigned char)term[0]);
+
+    for (size_t i = 0; i < starts; i++) {
+        if (!fold) {
+            const char *p = memchr(span + i, term[0], starts - i);
+            if (!p) break;
+            i = (size_t)(p - span);
+            if (memcmp(p, term, term_len) == 0) return i;
+        } else if (tolower((unsigned char)span[i]) == first &&
+                   search_equal_fold(span + i, term, term_len)) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
 
-    if (term_len > buf_len) return false;
+/* First match of term starting in [from, to), or SIZE_MAX. The text is taken
+ * a chunk at a time as contiguous spans rather than a byte at a time. */
+static size_t search_range(Editor *ed, const char *term, size_t term_len, size_t from, size_t to) {
+    if (from >= to) return SIZE_MAX;
 
-    /* Search from start_pos to end */
-    for (size_t i = start_pos; i <= buf_len - term_len; i++) {
-        bool match = true;
-        for (size_t j = 0; j < term_len && match; j++) {
-            char buf_char = buffer_get_char(ed->buffer, i + j);
-            char term_char = term[j];
-
-            if (!ed->search_case_sensitive) {
-                buf_char = tolower(buf_char);
-                term_char = tolower(term_char);
-            }
-
-            if (buf_char != term_char) {
-                match = false;
-            }
-        }
+    char *scratch = malloc(SEARCH_CHUNK + term_len);
+    if (!scratch) return SIZE_MAX;
 
-        if (match) {
-            ed->cursor_pos = i;
-            ed->selection.active = true;
-            ed->selection.start = i;
-            ed->selection.end = i + term_len;
-            editor_scroll_to_cursor(ed);
-            return true;
-        }
+    bool fold = !ed->search_case_sensitive;
+    size_t found = SIZE_MAX;
+
+    while (from < to && found == SIZE_MAX) {
+        /* Chunks overlap by the term length so matches across them are seen */
+        size_t starts = to - from < SEARCH_CHUNK ? to - from : SEARCH_CHUNK;
+        const char *span = buffer_get_span(ed->buffer, from, from + starts + term_len - 1, scratch);
+        if (!span) break;
+
+        size_t at = search_span(span, starts, term, term_len, fold);
+        if (at != SIZE_MAX) found = from + at;
+        from += starts;
     }
 
-    /* Wrap around to beginning */
-    for (size_t i = 0; i < start_pos && i <= buf_len - term_len; i++) {
-        bool match = true;
-        for (size_t j = 0; j < term_len && match; j++) {
-            char buf_char = buffer_get_char(ed->buffer, i + j);
-            char term_char = term[j];
+    free(scratch);
+    return found;
+}
+
+/* Select the match at pos and bring it into view */
+static void search_select(Editor *ed, size_t pos, size_t term_len) {
+    ed->cursor_pos = pos;
+    ed->selection.active = true;
+    ed->selection.start = pos;
+    ed->selection.end = pos + term_len;
+    editor_scroll_to_cursor(ed);
+}
 
-            if (!ed->search_case_sensitive) {
-                buf_char = tolower(buf_char);
-                term_char = tolower(term_char);
-            }
+/* Replace the match at pos, recording both halves for undo */
+static void search_replace_at(Editor *ed, size_t pos, size_t search_len,
+                              const char *replace, size_t replace_len) {
+    char *old_text = buffer_get_range(ed->buffer, pos, pos + search_len);
+    if (old_text) {
+        undo_record_delete(ed->undo, pos, old_text, search_len, ed->cursor_pos);
+        free(old_text);
+    }
 
-            if (buf_char != term_char) {
-                match = false;
-            }
-        }
+    buffer_delete_range(ed->buffer, pos, pos + search_len);
+
+    if (replace_len > 0) {
+        buffer_insert_string(ed->buffer, pos, replace, replace_len);
+        undo_record_insert(ed->undo, pos, replace, replace_len, ed->cursor_pos);
+    }
+    ed->modified = true;
+}
+
+static void search_report_replaced(Editor *ed, int count) {
+    if (count > 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Replaced %d occurrence%s", count, count == 1 ? "" : "s");
+        editor_set_status_message(ed, msg);
+    } else {
+        editor_set_status_message(ed, "Not found");
+    }
+}
+
+/* A search through a large file viewed in place. One job at a time reads the
+ * next chunk on a worker and looks for the term in it; its completion queues
+ * the next one, so the main loop keeps drawing and taking keys in between.
+ * Editing waits until it finishes. Replace all makes each replacement from
+ * the completion that found the match, while no job is reading. */
+struct SearchJob {
+    Editor *ed;             /* NULL once the editor has let go of the search */
+    PagedFile *pf;          /* Held while the search is out */
+    JobToken *token;
+    char *term;
+    size_t term_len;
+    bool fold;
+    char *replace;          /* NULL for a find */
+    size_t replace_len;
+    int replaced;
+
+    size_t from;            /* Next start to try (worker) */
+    size_t to;              /* End of the starts in this pass */
+    size_t wrap_to;         /* A find goes on with [0, wrap_to) after the end */
+    bool wrapped;
+    bool count_lines;       /* Count newlines so the match's line can be looked up */
+    size_t newlines;        /* Newlines before from */
+    size_t found;           /* Match found by the last job, or SIZE_MAX */
+    bool failed;            /* A read came back short */
+
+    size_t step_from;       /* from when the last job was queued */
+    size_t progress;        /* Bytes searched (main thread) */
+    size_t total;
+    char *chunk;
+};
+
+static void search_job_free(SearchJob *job) {
+    paged_release(job->pf);
+    job_token_release(job->token);
+    free(job->term);
+    free(job->replace);
+    free(job->chunk);
+    free(job);
+}
+
+/* Stop a background search where it is */
+static void search_job_detach(Editor *ed) {
+    if (!ed->searching) return;
+
+    job_token_cancel(ed->searching->token);
+    ed->searching->ed = NULL;   /* The queued job's completion frees it */
+    ed->searching = NULL;
+}
 
-        if (match) {
-            ed->cursor_pos = i;
-            ed->selection.active = true;
-            ed->selection.start = i;
-            ed->selection.end = i + term_len;
-            editor_scroll_to_cursor(ed);
-            return true;
+/* Worker: look for the term in the next chunk */
+static void search_job_run(void *arg, const JobToken *token) {
+    SearchJob *job = arg;
+    (void)token;
+
+    size_t starts = job->to - job->from < SEARCH_JOB_CHUNK ? job->to - job->from : SEARCH_JOB_CHUNK;
+    size_t want = starts + job->term_len - 1;
+    size_t got = paged_read(job->pf, job->from, job->chunk, want);
+    if (got < want) {
+        job->failed = true;
+        starts = got >= job->term_len ? got - job->term_len + 1 : 0;
+    }
+
+    size_t at = search_span(job->chunk, starts, job->term, job->term_len, job->fold);
+    size_t scanned = at != SIZE_MAX ? at : starts;
+    if (job->count_lines) {
+        for (const char *p = job->chunk, *end = job->chunk + scanned;
+             (p = memchr(p, '\n', end - p)) != NULL; p++) {
+            job->newlines++;
         }
     }
+    if (at != SIZE_MAX) job->found = job->from + at;
+    job->from += scanned;
+}
+
+static void search_job_done(void *arg, bool cancelled);
+
+static bool search_job_next(SearchJob *job) {
+    job->step_from = job->from;
+    return jobs_submit(search_job_run, search_job_done, job, job->token);
+}
+
+/* Main thread: act on what the last chunk turned up and queue the next one */
+static void search_job_done(void *arg, bool cancelled) {
+    SearchJob *job = arg;
+    Editor *ed = job->ed;
+    if (cancelled || !ed) {
+        search_job_free(job);
+        return;
+    }
+
+    size_t found = job->found;
+    job->found = SIZE_MAX;
+    job->progress = job->replace ? job->from : job->progress + (job->from - job->step_from);
+
+    if (found != SIZE_MAX && !job->replace) {
+        ed->searching = NULL;
+        if (job->count_lines) paged_note_line(job->pf, found, job->newlines);
+        search_select(ed, found, job->term_len);
+        search_job_free(job);
+        return;
+    }
+
+    if (found != SIZE_MAX) {
+        search_replace_at(ed, found, job->term_len, job->replace, job->replace_len);
+        job->replaced++;
+        size_t length = buffer_get_length(ed->buffer);
+        job->from = found + job->replace_len;
+        job->to = length >= job->term_len ? length - job->term_len + 1 : 0;
+        job->total = length;
+    } else if (job->from >= job->to && !job->replace && !job->wrapped && job->wrap_to > 0) {
+        job->wrapped = true;
+        job->from = 0;
+        job->to = job->wrap_to;
+        job->newlines = 0;
+    }
+
+    if (job->from < job->to && !job->failed && search_job_next(job)) return;
+
+    ed->searching = NULL;
+    if (job->replace) {
+        search_report_replaced(ed, job->replaced);
+    } else {
+        editor_set_status_message(ed, job->failed ? "Search stopped: read failed" : "Not found");
+    }
+    search_job_free(job);
+}
+
+/* Search a large file viewed in place in the background, from start_pos
+ * (wrapping around) for a find, or through the whole text replacing every
+ * match when replace is given. False if it couldn't be started. */
+static bool search_job_start(Editor *ed, const char *term, size_t start_pos, const char *replace) {
+    search_job_detach(ed);
+
+    PagedFile *pf = ed->buffer->paged;
+    size_t term_len = strlen(term);
+    size_t length = buffer_get_length(ed->buffer);
+    size_t last = length - term_len + 1;
+
+    SearchJob *job = calloc(1, sizeof(SearchJob));
+    if (!job) return false;
+
+    job->ed = ed;
+    job->pf = pf;
+    job->term = strdup(term);
+    job->term_len = term_len;
+    job->fold = !ed->search_case_sensitive;
+    job->replace = replace ? strdup(replace) : NULL;
+    job->replace_len = replace ? strlen(replace) : 0;
+    job->found = SIZE_MAX;
+    job->token = job_token_create();
+    job->chunk = malloc(SEARCH_JOB_CHUNK + term_len);
+
+    if (replace) {
+        job->from = 0;
+        job->to = last;
+        job->total = length;
+    } else {
+        if (start_pos > last) start_pos = last;
+        job->from = start_pos;
+        job->to = last;
+        job->wrap_to = start_pos;
+        job->total = last;
+
+        /* While lines are being indexed, a match far out can only be shown
+         * if the search counts the lines on the way */
+        job->count_lines = !paged_index_complete(pf) &&
+                           paged_lookup_clamp(pf, start_pos) == start_pos;
+        if (job->count_lines) job->newlines = paged_newlines_before(pf, start_pos);
+    }
+
+    paged_hold(pf);
+    if (!job->term || (replace && !job->replace) || !job->token || !job->chunk ||
+        !search_job_next(job)) {
+        search_job_free(job);
+        return false;
+    }
+
+    ed->searching = job;
+    return true;
+}
+
+void search_cancel(Editor *ed) {
+    if (!ed || !ed->searching) return;
+
+    int replaced = ed->searching->replace ? ed->searching->replaced : -1;
+    search_job_detach(ed);
+
+    if (replaced >= 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Replace stopped after %d occurrence%s", replaced, replaced == 1 ? "" : "s");
+        editor_set_status_message(ed, msg);
+    } else {
+        editor_set_status_message(ed, "Search stopped");
+    }
+}
+
+int search_percent(Editor *ed) {
+    if (!ed || !ed->searching) return -1;
 
-    return false;
+    SearchJob *job = ed->searching;
+    if (job->total == 0) return 0;
+    size_t percent = (size_t)((double)job->progress * 100.0 / (double)job->total);
+    return percent > 99 ? 99 : (int)percent;
+}
+
+bool search_find(Editor *ed, const char *term, size_t start_pos) {
+    if (!ed || !ed->buffer || !term || !term[0]) return false;
+
+    size_t term_len = strlen(term);
+    size_t buf_len = buffer_get_length(ed->buffer);
+
+    if (term_len > buf_len) return false;
+
+    /* A large file viewed in place is searched in the background */
+    if (ed->buffer->paged && search_job_start(ed, term, start_pos, NULL)) return true;
+
+    /* Search from start_pos to end, then wrap around to the beginning */
+    size_t last = buf_len - term_len + 1;
+    size_t found = search_range(ed, term, term_len, start_pos, last);
+    if (found == SIZE_MAX) {
+        found = search_range(ed, term, term_len, 0, start_pos < last ? start_pos : last);
+    }
+    if (found == SIZE_MAX) return false;
+
+    search_select(ed, found, term_len);
+    return true;
 }
 
 bool search_find_next(Editor *ed) {
@@ -86,51 +340,20 @@ bool search_find_next(Editor *ed) {
 
 int search_replace_all(Editor *ed, const char *search, const char *replace) {
     if (!ed || !ed->buffer || !search || !search[0]) return 0;
+    if (!editor_check_writable(ed)) return 0;
 
     int count = 0;
     size_t search_len = strlen(search);
     size_t replace_len = replace ? strlen(replace) : 0;
     size_t pos = 0;
 
-    while (pos <= buffer_get_length(ed->buffer) - search_len) {
-        bool match = true;
-        for (size_t j = 0; j < search_len && match; j++) {
-            char buf_char = buffer_get_char(ed->buffer, pos + j);
-            char term_char = search[j];
+    while (buffer_get_length(ed->buffer) >= search_len) {
+        pos = search_range(ed, search, search_len, pos, buffer_get_length(ed->buffer) - search_len + 1);
+        if (pos == SIZE_MAX) break;
 
-            if (!ed->search_case_sensitive) {
-                buf_char = tolower(buf_char);
-                term_char = tolower(term_char);
-            }
-
-            if (buf_char != term_char) {
-                match = false;
-            }
-        }
-
-        if (match) {
-            /* Record for undo */
-            char *old_text = buffer_get_range(ed->buffer, pos, pos + search_len);
-            if (old_text) {
-                undo_record_delete(ed->undo, pos, old_text, search_len, ed->cursor_pos);
-                free(old_text);
-            }
-
-            /* Delete old text */
-            buffer_delete_range(ed->buffer, pos, pos + search_len);
-
-            /* Insert new text */
-            if (replace && replace_len > 0) {
-                buffer_insert_string(ed->buffer, pos, replace, replace_len);
-                undo_record_insert(ed->undo, pos, replace, replace_len, ed->cursor_pos);
-            }
-
-            pos += replace_len;
-            count++;
-            ed->modified = true;
-        } else {
-            pos++;
-        }
+        search_replace_at(ed, pos, search_len, replace, replace_len);
+        pos += replace_len;
+        count++;
     }
 
     return count;
@@ -154,17 +377,16 @@ void search_find_dialog(Editor *ed) {
 
 void search_replace_dialog(Editor *ed) {
     if (!ed) return;
+    if (!editor_check_writable(ed)) return;
 
     if (dialog_replace(ed, ed->search_term, sizeof(ed->search_term),
                        ed->replace_term, sizeof(ed->replace_term)) == DIALOG_OK) {
-        int count = search_replace_all(ed, ed->search_term, ed->replace_term);
-        if (count > 0) {
-            char msg[64];
-            snprintf(msg, sizeof(msg), "Replaced %d occurrence%s", count, count == 1 ? "" : "s");
-            editor_set_status_message(ed, msg);
-        } else {
-            editor_set_status_message(ed, "Not found");
+        /* A large file viewed in place reports when the background pass ends */
+        if (ed->buffer->paged && buffer_get_length(ed->buffer) >= strlen(ed->search_term) &&
+            search_job_start(ed, ed->search_term, 0, ed->replace_term)) {
+            return;
         }
+        search_report_replaced(ed, search_replace_all(ed, ed->search_term, ed->replace_term));
     }
 }
 
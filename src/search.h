@@ -12,6 +12,10 @@ bool search_find(struct Editor *ed, const char *term, size_t start_pos);
 bool search_find_next(struct Editor *ed);
 int search_replace_all(struct Editor *ed, const char *search, const char *replace);
 
+/* Background search of a large file viewed in place */
+void search_cancel(struct Editor *ed);
+int search_percent(struct Editor *ed);       /* -1 when not searching */
+
 /* Dialog wrappers */
 void search_find_dialog(struct Editor *ed);
 void search_replace_dialog(struct Editor *ed);
@@ -22,7 +22,8 @@ static MenuItem edit_items[] = {
     {"Copy",       "Ctrl+C", ACTION_COPY, false, 0},       /* C */
     {"Paste",      "Ctrl+V", ACTION_PASTE, false, 0},      /* P */
     {"",           "",       0, true, -1},                 /* Separator */
-    {"Select All", "Ctrl+A", ACTION_SELECT_ALL, false, 7}  /* A */
+    {"Select All", "Ctrl+A", ACTION_SELECT_ALL, false, 7}, /* A */
+    {"Allow Editing", "",    ACTION_ALLOW_EDITING, false, 6}  /* E */
 };
 
 static MenuItem search_items[] = {
@@ -36,6 +37,7 @@ static MenuItem search_items[] = {
 static MenuItem view_items[] = {
     {"Line Numbers", "", ACTION_TOGGLE_LINE_NUMBERS, false, 0},  /* L */
     {"Status Bar",   "", ACTION_TOGGLE_STATUS_BAR, false, 0},    /* S */
+    {"Word Wrap",    "", ACTION_TOGGLE_WORD_WRAP, false, 0},     /* W */
     {"ASCII Borders", "", ACTION_TOGGLE_ACS_CHARS, false, 0},    /* A */
     {"",             "", 0, true, -1},                           /* Separator */
     {"File Panel",   "Ctrl+Alt+E", ACTION_TOGGLE_PANEL, false, 0},  /* F */
@@ -222,6 +224,7 @@ void menu_draw(MenuState *state, Editor *ed) {
     if (!state || !state->active || state->current_menu < 0 || !ed) return;
 
     Menu *menu = &state->menus[state->current_menu];
+    display_invalidate();
 
     /* Calculate dropdown dimensions */
     int max_label = 0;
@@ -50,6 +50,7 @@ typedef enum {
     ACTION_COPY,
     ACTION_PASTE,
     ACTION_SELECT_ALL,
+    ACTION_ALLOW_EDITING,
     /* Search menu */
     ACTION_FIND,
     ACTION_FIND_NEXT,
@@ -58,6 +59,7 @@ typedef enum {
     /* View menu */
     ACTION_TOGGLE_LINE_NUMBERS,
     ACTION_TOGGLE_STATUS_BAR,
+    ACTION_TOGGLE_WORD_WRAP,
     ACTION_TOGGLE_PANEL,
     ACTION_TOGGLE_ACS_CHARS,
     ACTION_HEX_MODE,
@@ -3,6 +3,9 @@
 #include "smashedit.h"
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
 
 /* Extension mappings */
 static const char *c_extensions[] = {".c", ".h", ".cpp", ".hpp", ".cc", ".cxx", ".C", ".H", NULL};
@@ -376,6 +379,12 @@ static const Keyword makefile_keywords[] = {
     {NULL, TOKEN_NORMAL}
 };
 
+/* JSON - just the literals */
+static const Keyword json_keywords[] = {
+    {"true", TOKEN_TYPE}, {"false", TOKEN_TYPE}, {"null", TOKEN_TYPE},
+    {NULL, TOKEN_NORMAL}
+};
+
 /* YAML - minimal, mostly structural */
 static const Keyword yaml_keywords[] = {
     {"true", TOKEN_TYPE}, {"false", TOKEN_TYPE}, {"null", TOKEN_TYPE},
@@ -1855,82 +1864,170 @@ int syntax_token_to_attr(TokenType token) {
     }
 }
 
+/* Open-addressed keyword index, built the first time a language is highlighted */
+typedef struct KeywordSlot {
+    const char *word;           /* NULL for an empty slot */
+    size_t len;
+    TokenType type;
+} KeywordSlot;
+
+typedef struct KeywordIndex {
+    KeywordSlot *slots;
+    size_t mask;                /* Slot count - 1, a power of two */
+    size_t min_len;             /* Words outside this range can't match */
+    size_t max_len;
+} KeywordIndex;
+
+/* A language's keyword table and its index */
+typedef struct KeywordSet {
+    const Keyword *words;
+    _Atomic(KeywordIndex *) index;
+} KeywordSet;
+
+/* Keywords for each language */
+static KeywordSet keyword_sets[LANG_MAX] = {
+    [LANG_C]          = {c_keywords, NULL},
+    [LANG_SHELL]      = {shell_keywords, NULL},
+    [LANG_PYTHON]     = {python_keywords, NULL},
+    [LANG_JAVASCRIPT] = {js_keywords, NULL},
+    [LANG_GO]         = {go_keywords, NULL},
+    [LANG_RUST]       = {rust_keywords, NULL},
+    [LANG_JAVA]       = {java_keywords, NULL},
+    [LANG_RUBY]       = {ruby_keywords, NULL},
+    [LANG_LUA]        = {lua_keywords, NULL},
+    [LANG_SQL]        = {sql_keywords, NULL},
+    [LANG_CSS]        = {css_keywords, NULL},
+    [LANG_MAKEFILE]   = {makefile_keywords, NULL},
+    [LANG_YAML]       = {yaml_keywords, NULL},
+    [LANG_JSON]       = {json_keywords, NULL},
+    [LANG_TOML]       = {toml_keywords, NULL},
+    [LANG_PERL]       = {perl_keywords, NULL},
+    [LANG_HASKELL]    = {haskell_keywords, NULL},
+    [LANG_LISP]       = {lisp_keywords, NULL},
+    [LANG_CSHARP]     = {csharp_keywords, NULL},
+    [LANG_FORTRAN]    = {fortran_keywords, NULL},
+    [LANG_PASCAL]     = {pascal_keywords, NULL},
+    [LANG_ADA]        = {ada_keywords, NULL},
+    [LANG_POWERSHELL] = {powershell_keywords, NULL},
+    [LANG_DOCKER]     = {docker_keywords, NULL},
+    [LANG_GITCONFIG]  = {gitconfig_keywords, NULL},
+    [LANG_HTML]       = {html_keywords, NULL},
+    [LANG_TYPESCRIPT] = {typescript_keywords, NULL},
+    [LANG_TERRAFORM]  = {terraform_keywords, NULL},
+    [LANG_PHP]        = {php_keywords, NULL},
+    [LANG_KOTLIN]     = {kotlin_keywords, NULL},
+    [LANG_SWIFT]      = {swift_keywords, NULL},
+    [LANG_SCALA]      = {scala_keywords, NULL},
+    [LANG_ELIXIR]     = {elixir_keywords, NULL},
+    [LANG_ERLANG]     = {erlang_keywords, NULL},
+    [LANG_R]          = {r_keywords, NULL},
+    [LANG_JULIA]      = {julia_keywords, NULL},
+    [LANG_ZIG]        = {zig_keywords, NULL},
+    [LANG_NIM]        = {nim_keywords, NULL},
+    [LANG_DART]       = {dart_keywords, NULL},
+    [LANG_OCAML]      = {ocaml_keywords, NULL},
+    [LANG_FSHARP]     = {fsharp_keywords, NULL},
+    [LANG_GROOVY]     = {groovy_keywords, NULL},
+    [LANG_PROLOG]     = {prolog_keywords, NULL},
+    [LANG_VERILOG]    = {verilog_keywords, NULL},
+    [LANG_VHDL]       = {vhdl_keywords, NULL},
+    [LANG_LATEX]      = {latex_keywords, NULL},
+    [LANG_NGINX]      = {nginx_keywords, NULL},
+    [LANG_APACHE]     = {apache_keywords, NULL},
+    [LANG_INI]        = {ini_keywords, NULL},
+};
+
 /* Get keywords for a language */
-static const Keyword *get_keywords(LanguageType lang) {
-    switch (lang) {
-        case LANG_C:          return c_keywords;
-        case LANG_SHELL:      return shell_keywords;
-        case LANG_PYTHON:     return python_keywords;
-        case LANG_JAVASCRIPT: return js_keywords;
-        case LANG_GO:         return go_keywords;
-        case LANG_RUST:       return rust_keywords;
-        case LANG_JAVA:       return java_keywords;
-        case LANG_RUBY:       return ruby_keywords;
-        case LANG_LUA:        return lua_keywords;
-        case LANG_SQL:        return sql_keywords;
-        case LANG_CSS:        return css_keywords;
-        case LANG_MAKEFILE:   return makefile_keywords;
-        case LANG_YAML:       return yaml_keywords;
-        case LANG_TOML:       return toml_keywords;
-        case LANG_PERL:       return perl_keywords;
-        case LANG_HASKELL:    return haskell_keywords;
-        case LANG_LISP:       return lisp_keywords;
-        case LANG_CSHARP:     return csharp_keywords;
-        case LANG_FORTRAN:    return fortran_keywords;
-        case LANG_PASCAL:     return pascal_keywords;
-        case LANG_ADA:        return ada_keywords;
-        case LANG_POWERSHELL: return powershell_keywords;
-        case LANG_DOCKER:     return docker_keywords;
-        case LANG_GITCONFIG:  return gitconfig_keywords;
-        case LANG_JSON:       return NULL; /* JSON has no keywords, just structure */
-        case LANG_HTML:       return html_keywords;
-        case LANG_TYPESCRIPT: return typescript_keywords;
-        case LANG_TERRAFORM:  return terraform_keywords;
-        case LANG_PHP:        return php_keywords;
-        case LANG_KOTLIN:     return kotlin_keywords;
-        case LANG_SWIFT:      return swift_keywords;
-        case LANG_SCALA:      return scala_keywords;
-        case LANG_ELIXIR:     return elixir_keywords;
-        case LANG_ERLANG:     return erlang_keywords;
-        case LANG_R:          return r_keywords;
-        case LANG_JULIA:      return julia_keywords;
-        case LANG_ZIG:        return zig_keywords;
-        case LANG_NIM:        return nim_keywords;
-        case LANG_DART:       return dart_keywords;
-        case LANG_OCAML:      return ocaml_keywords;
-        case LANG_FSHARP:     return fsharp_keywords;
-        case LANG_GROOVY:     return groovy_keywords;
-        case LANG_PROLOG:     return prolog_keywords;
-        case LANG_VERILOG:    return verilog_keywords;
-        case LANG_VHDL:       return vhdl_keywords;
-        case LANG_LATEX:      return latex_keywords;
-        case LANG_NGINX:      return nginx_keywords;
-        case LANG_APACHE:     return apache_keywords;
-        case LANG_INI:        return ini_keywords;
-        default:              return NULL;
+static KeywordSet *get_keywords(LanguageType lang) {
+    if ((int)lang < 0 || lang >= LANG_MAX || !keyword_sets[lang].words) return NULL;
+    return &keyword_sets[lang];
+}
+
+/* FNV-1a */
+static size_t keyword_hash(const char *word, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)word[i];
+        h *= 16777619u;
     }
+    return h;
 }
 
-/* Look up a word in keyword table */
-static TokenType lookup_keyword(const Keyword *keywords, const char *word, size_t len) {
-    if (!keywords) return TOKEN_NORMAL;
+static KeywordIndex *keyword_index_build(const Keyword *words) {
+    size_t count = 0;
+    while (words[count].word) count++;
+
+    size_t capacity = 16;
+    while (capacity < count * 2) capacity *= 2;
+
+    KeywordIndex *index = malloc(sizeof(KeywordIndex));
+    KeywordSlot *slots = calloc(capacity, sizeof(KeywordSlot));
+    if (!index || !slots) {
+        free(index);
+        free(slots);
+        return NULL;
+    }
 
-    for (int i = 0; keywords[i].word; i++) {
-        if (strlen(keywords[i].word) == len &&
-            strncmp(keywords[i].word, word, len) == 0) {
-            return keywords[i].type;
+    index->slots = slots;
+    index->mask = capacity - 1;
+    index->min_len = (size_t)-1;
+    index->max_len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(words[i].word);
+        size_t slot = keyword_hash(words[i].word, len) & index->mask;
+
+        /* Earlier entries win, as they did with the linear scan */
+        while (slots[slot].word &&
+               !(slots[slot].len == len && memcmp(slots[slot].word, words[i].word, len) == 0)) {
+            slot = (slot + 1) & index->mask;
         }
+        if (slots[slot].word) continue;
+
+        slots[slot].word = words[i].word;
+        slots[slot].len = len;
+        slots[slot].type = words[i].type;
+        if (len < index->min_len) index->min_len = len;
+        if (len > index->max_len) index->max_len = len;
     }
-    return TOKEN_NORMAL;
+
+    return index;
 }
 
-/* Check if position is start of line (ignoring whitespace) */
-static bool is_line_start_nonws(Buffer *buf, size_t pos, size_t line_start) {
-    for (size_t i = line_start; i < pos; i++) {
-        char c = buffer_get_char(buf, i);
-        if (c != ' ' && c != '\t') return false;
+/* Index for a set; highlighting runs on worker threads, so the first
+ * thread to publish wins and any other copy is thrown away */
+static KeywordIndex *keyword_index(KeywordSet *set) {
+    KeywordIndex *index = atomic_load_explicit(&set->index, memory_order_acquire);
+    if (index) return index;
+
+    KeywordIndex *built = keyword_index_build(set->words);
+    if (!built) return NULL;
+
+    if (atomic_compare_exchange_strong_explicit(&set->index, &index, built,
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        return built;
     }
-    return true;
+    free(built->slots);
+    free(built);
+    return index;
+}
+
+/* Look up a word in keyword table */
+static TokenType lookup_keyword(KeywordSet *keywords, const char *word, size_t len) {
+    if (!keywords) return TOKEN_NORMAL;
+
+    KeywordIndex *index = keyword_index(keywords);
+    if (!index || len < index->min_len || len > index->max_len) return TOKEN_NORMAL;
+
+    size_t slot = keyword_hash(word, len) & index->mask;
+    while (index->slots[slot].word) {
+        const KeywordSlot *entry = &index->slots[slot];
+        if (entry->len == len && memcmp(entry->word, word, len) == 0) {
+            return entry->type;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+    return TOKEN_NORMAL;
 }
 
 /* Check if string matches at position in buffer */
@@ -1944,363 +2041,706 @@ static bool match_string(Buffer *buf, size_t pos, size_t line_end, const char *s
     return true;
 }
 
-/* Highlight a line for C-like languages (C, C++, JavaScript) */
-static void highlight_c_like(Buffer *buf, size_t line_start, size_t line_end,
-                             LanguageType lang, HighlightState *state,
-                             TokenType *out, size_t out_size) {
-    const Keyword *keywords = get_keywords(lang);
-    size_t pos = line_start;
-    size_t idx = 0;
+/* Table-driven lexer
+ *
+ * Most languages are described by an ordered list of rules instead of a
+ * hand-written highlighter. Each description is compiled once into a
+ * byte-class table plus a first-byte dispatch list, and the engine runs it
+ * over the raw bytes of a line; bytes no rule can start on are skipped
+ * without any work since the output is already TOKEN_NORMAL. */
+
+#define LEX_MAX_RULES      15   /* Two class bits per rule, plus the close bit */
+#define LEX_MAX_CANDIDATES 4    /* Rules sharing one first byte */
+#define LEX_WORD_CHUNK     63   /* Chunked words are looked up this many bytes at a time */
+#define LEX_WORD_MAX       64   /* Whole words this long are never keywords */
+#define LEX_SPAN_SLACK     65536 /* Bytes a window reads past its end */
+
+typedef enum {
+    LEX_LINE,       /* Opener to end of line */
+    LEX_BLOCK,      /* Opener to close, may span lines through state */
+    LEX_STRING,     /* Opener to close or end of line, with optional escapes */
+    LEX_CHAR,       /* Opener, one (possibly escaped) byte, optional closing quote */
+    LEX_SIGIL,      /* Opener and a run of body bytes ($var, @attr, :sym) */
+    LEX_PLAIN,      /* Opener that is plain text, hiding a shorter rule */
+    LEX_WORD,       /* Identifier, looked up in the keyword set */
+    LEX_NUMBER      /* Start byte and a run of body bytes */
+} LexKind;
+
+/* Rule flags */
+#define LEX_AT_INDENT   0x01    /* Only as the first non-blank of the line */
+#define LEX_AT_COLUMN0  0x02    /* Only in the first column */
+#define LEX_BRACED      0x04    /* Sigil followed by {...} takes the braces instead */
+#define LEX_DOUBLED     0x08    /* A doubled close quote is an escaped quote */
+#define LEX_WHOLE       0x10    /* Look words up whole instead of in chunks */
+#define LEX_FOLD        0x20    /* Keywords are matched case-insensitively */
+#define LEX_FIXED       0x40    /* Words always get the rule's token */
+#define LEX_KEYED       0x80    /* A string followed by ':' is a key (TOKEN_KEYWORD) */
+
+typedef struct LexRule {
+    LexKind kind;
+    const char *open;       /* Literal opener; NULL for words/numbers, which use start */
+    TokenType token;
+    const char *close;      /* Block and string terminator */
+    char escape;            /* Escape byte inside strings and chars, 0 for none */
+    HighlightState state;   /* Carried over by unterminated blocks */
+    const char *start;      /* First-byte set for words and numbers */
+    const char *next;       /* Set the byte after the opener must belong to */
+    const char *body;       /* Continuation set */
+    unsigned flags;
+} LexRule;
+
+/* Compiled form: class bits per byte and the rules each byte can start */
+typedef struct LexTable {
+    uint32_t classes[256];
+    uint8_t candidates[256][LEX_MAX_CANDIDATES];    /* Rule index + 1, 0 ends the list */
+} LexTable;
+
+typedef struct LexerDef {
+    const LexRule *rules;
+    size_t rule_count;
+    _Atomic(LexTable *) table;
+} LexerDef;
+
+#define LEX_BODY_BIT(i) (1u << (2 * (i)))
+#define LEX_NEXT_BIT(i) (1u << (2 * (i) + 1))
+#define LEX_CLOSE_BIT   (1u << 31)
+
+#define LEXER(rules) {rules, sizeof(rules) / sizeof(rules[0]), NULL}
+
+/* Byte sets */
+#define LEX_LOWER   "abcdefghijklmnopqrstuvwxyz"
+#define LEX_UPPER   "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define LEX_DIGIT   "0123456789"
+#define LEX_ALPHA   LEX_LOWER LEX_UPPER
+#define LEX_ALNUM   LEX_ALPHA LEX_DIGIT
+#define LEX_XDIGIT  LEX_DIGIT "abcdefABCDEF"
+#define LEX_IDENT   LEX_ALPHA "_"
+#define LEX_IDENT_BODY LEX_ALNUM "_"
+
+/* Rule constructors, one per kind */
+#define LEX_RULE_LINE(o, tok, fl) \
+    {.kind = LEX_LINE, .open = o, .token = tok, .flags = fl}
+#define LEX_RULE_BLOCK(o, c, tok, st) \
+    {.kind = LEX_BLOCK, .open = o, .close = c, .token = tok, .state = st}
+#define LEX_RULE_STRING(o, c, tok, esc, fl) \
+    {.kind = LEX_STRING, .open = o, .close = c, .token = tok, .escape = esc, .flags = fl}
+#define LEX_RULE_CHAR(o, tok, esc) \
+    {.kind = LEX_CHAR, .open = o, .token = tok, .escape = esc}
+#define LEX_RULE_SIGIL(o, tok, nx, bd, fl) \
+    {.kind = LEX_SIGIL, .open = o, .token = tok, .next = nx, .body = bd, .flags = fl}
+#define LEX_RULE_PLAIN(o) \
+    {.kind = LEX_PLAIN, .open = o, .token = TOKEN_NORMAL}
+#define LEX_RULE_WORD(st, bd, tok, fl) \
+    {.kind = LEX_WORD, .start = st, .body = bd, .token = tok, .flags = fl}
+#define LEX_RULE_NUMBER(o, st, nx, bd) \
+    {.kind = LEX_NUMBER, .open = o, .start = st, .next = nx, .body = bd, .token = TOKEN_NUMBER}
+
+static const LexRule c_rules[] = {
+    LEX_RULE_LINE("//", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_LINE("#", TOKEN_PREPROCESSOR, LEX_AT_INDENT),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xXeE+-uUlLfF"),
+    LEX_RULE_NUMBER(".", NULL, LEX_DIGIT, LEX_XDIGIT ".xXeE+-uUlLfF"),
+};
 
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
+/* C without the preprocessor: Go, Rust, Java, Kotlin, Swift, ... */
+static const LexRule c_family_rules[] = {
+    LEX_RULE_LINE("//", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xXeE+-uUlLfF"),
+    LEX_RULE_NUMBER(".", NULL, LEX_DIGIT, LEX_XDIGIT ".xXeE+-uUlLfF"),
+};
 
-        /* Handle continuing block comment */
-        if (*state == HL_STATE_BLOCK_COMMENT) {
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-            }
-            pos++;
-            continue;
+static const LexRule js_rules[] = {
+    LEX_RULE_LINE("//", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("`", "`", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xXeE+-uUlLfF"),
+    LEX_RULE_NUMBER(".", NULL, LEX_DIGIT, LEX_XDIGIT ".xXeE+-uUlLfF"),
+};
+
+static const LexRule shell_rules[] = {
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_SIGIL("$", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY "?@*#", LEX_BRACED),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, 0, 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT),
+};
+
+static const LexRule python_rules[] = {
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_SIGIL("@", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY "@.", LEX_AT_INDENT),
+    LEX_RULE_STRING("\"\"\"", "\"\"\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'''", "'''", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xXeE+-oObB_"),
+};
+
+static const LexRule ruby_rules[] = {
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_SIGIL("@", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_SIGIL(":", TOKEN_TYPE, LEX_ALPHA, LEX_IDENT_BODY, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY "?", TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT "._"),
+};
+
+static const LexRule lua_rules[] = {
+    LEX_RULE_BLOCK("--[[", "]]", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_LINE("--", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xX"),
+};
+
+static const LexRule sql_rules[] = {
+    LEX_RULE_LINE("--", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, 0, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, 0, 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT "."),
+};
+
+static const LexRule css_rules[] = {
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_SIGIL("@", TOKEN_PREPROCESSOR, NULL, LEX_ALNUM "-", 0),
+    LEX_RULE_SIGIL(".", TOKEN_TYPE, NULL, LEX_ALNUM "-_", 0),
+    LEX_RULE_SIGIL("#", TOKEN_TYPE, NULL, LEX_ALNUM "-_", 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_ALPHA "-", LEX_ALNUM "-", TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".%"),
+};
+
+static const LexRule json_rules[] = {
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', LEX_KEYED),
+    LEX_RULE_WORD(LEX_ALPHA, LEX_ALPHA, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT ".-+eE"),
+    LEX_RULE_NUMBER("-", NULL, LEX_DIGIT, LEX_DIGIT ".-+eE"),
+};
+
+static const LexRule perl_rules[] = {
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_SIGIL("$", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_SIGIL("@", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_SIGIL("%", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT "._x"),
+};
+
+static const LexRule haskell_rules[] = {
+    LEX_RULE_LINE("--", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("{-", "-}", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_CHAR("'", TOKEN_STRING, '\\'),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY "'", TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xo"),
+};
+
+static const LexRule lisp_rules[] = {
+    LEX_RULE_LINE(";", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_WORD(LEX_ALPHA "-_+*/<>=!?", LEX_ALNUM "-_+*/<>=!?:", TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT "."),
+    LEX_RULE_SIGIL("(", TOKEN_KEYWORD, NULL, NULL, 0),
+    LEX_RULE_SIGIL(")", TOKEN_KEYWORD, NULL, NULL, 0),
+};
+
+/* Fixed-form comments take the whole line when they start in column one */
+static const LexRule fortran_rules[] = {
+    LEX_RULE_LINE("C", TOKEN_COMMENT, LEX_AT_COLUMN0),
+    LEX_RULE_LINE("c", TOKEN_COMMENT, LEX_AT_COLUMN0),
+    LEX_RULE_LINE("*", TOKEN_COMMENT, LEX_AT_COLUMN0),
+    LEX_RULE_LINE("!", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, 0, 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, 0, 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT ".dDeE"),
+};
+
+/* Both comment forms share a state, so either close ends either one */
+static const LexRule pascal_rules[] = {
+    LEX_RULE_LINE("//", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("{", "}", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_BLOCK("(*", "*)", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, 0, LEX_DOUBLED),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT "$", NULL, LEX_XDIGIT ".$"),
+};
+
+static const LexRule ada_rules[] = {
+    LEX_RULE_LINE("--", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, 0, LEX_DOUBLED),
+    LEX_RULE_CHAR("'", TOKEN_STRING, 0),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT "._#Ee"),
+};
+
+static const LexRule powershell_rules[] = {
+    LEX_RULE_BLOCK("<#", "#>", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_SIGIL("$", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '`', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '`', 0),
+    LEX_RULE_WORD(LEX_IDENT "-", LEX_IDENT_BODY "-", TOKEN_NORMAL, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT "."),
+};
+
+static const LexRule php_rules[] = {
+    LEX_RULE_LINE("//", TOKEN_COMMENT, 0),
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_SIGIL("$", TOKEN_VARIABLE, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT ".xX"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, LEX_WHOLE),
+};
+
+static const LexRule elixir_rules[] = {
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_SIGIL(":", TOKEN_TYPE, LEX_IDENT, LEX_IDENT_BODY "?!", 0),
+    LEX_RULE_SIGIL("@", TOKEN_PREPROCESSOR, NULL, LEX_IDENT_BODY, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT "._eExXbBoO"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY "?!", TOKEN_NORMAL, LEX_WHOLE),
+};
+
+static const LexRule erlang_rules[] = {
+    LEX_RULE_LINE("%", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_TYPE, '\\', 0),
+    LEX_RULE_SIGIL("-", TOKEN_PREPROCESSOR, NULL, LEX_IDENT, LEX_AT_COLUMN0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_ALNUM ".#"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY "@", TOKEN_NORMAL, LEX_WHOLE),
+};
+
+static const LexRule r_rules[] = {
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT ".eELi"),
+    LEX_RULE_NUMBER(".", NULL, LEX_DIGIT, LEX_DIGIT ".eELi"),
+    LEX_RULE_WORD(LEX_IDENT ".", LEX_IDENT_BODY ".", TOKEN_NORMAL, LEX_WHOLE),
+};
+
+static const LexRule julia_rules[] = {
+    LEX_RULE_BLOCK("#=", "=#", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"\"\"", "\"\"\"", TOKEN_STRING, 0, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_SIGIL(":", TOKEN_TYPE, LEX_ALPHA, LEX_IDENT_BODY "!", 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT "._xXoO"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY "!", TOKEN_NORMAL, LEX_WHOLE),
+};
+
+/* "#[" is not a line comment */
+static const LexRule nim_rules[] = {
+    LEX_RULE_PLAIN("#["),
+    LEX_RULE_LINE("#", TOKEN_COMMENT, 0),
+    LEX_RULE_BLOCK("\"\"\"", "\"\"\"", TOKEN_STRING, HL_STATE_STRING),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_CHAR, '\\', 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT "._'xXoO"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, LEX_WHOLE),
+};
+
+static const LexRule ocaml_rules[] = {
+    LEX_RULE_BLOCK("(*", "*)", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_CHAR, '\\', 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT "._xXoO"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY "'", TOKEN_NORMAL, LEX_WHOLE),
+};
+
+/* Capitalized words are variables, lowercase ones atoms */
+static const LexRule prolog_rules[] = {
+    LEX_RULE_BLOCK("/*", "*/", TOKEN_COMMENT, HL_STATE_BLOCK_COMMENT),
+    LEX_RULE_LINE("%", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, '\\', 0),
+    LEX_RULE_STRING("'", "'", TOKEN_STRING, '\\', 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_DIGIT ".eE'"),
+    LEX_RULE_WORD(LEX_UPPER "_", LEX_IDENT_BODY, TOKEN_VARIABLE, LEX_FIXED),
+    LEX_RULE_WORD(LEX_LOWER, LEX_IDENT_BODY, TOKEN_NORMAL, LEX_WHOLE),
+};
+
+static const LexRule vhdl_rules[] = {
+    LEX_RULE_LINE("--", TOKEN_COMMENT, 0),
+    LEX_RULE_STRING("\"", "\"", TOKEN_STRING, 0, LEX_DOUBLED),
+    LEX_RULE_CHAR("'", TOKEN_CHAR, 0),
+    LEX_RULE_NUMBER(NULL, LEX_DIGIT, NULL, LEX_XDIGIT "._#"),
+    LEX_RULE_WORD(LEX_IDENT, LEX_IDENT_BODY, TOKEN_NORMAL, LEX_WHOLE | LEX_FOLD),
+};
+
+static LexerDef c_lexer = LEXER(c_rules);
+static LexerDef c_family_lexer = LEXER(c_family_rules);
+static LexerDef js_lexer = LEXER(js_rules);
+static LexerDef shell_lexer = LEXER(shell_rules);
+static LexerDef python_lexer = LEXER(python_rules);
+static LexerDef ruby_lexer = LEXER(ruby_rules);
+static LexerDef lua_lexer = LEXER(lua_rules);
+static LexerDef sql_lexer = LEXER(sql_rules);
+static LexerDef css_lexer = LEXER(css_rules);
+static LexerDef json_lexer = LEXER(json_rules);
+static LexerDef perl_lexer = LEXER(perl_rules);
+static LexerDef haskell_lexer = LEXER(haskell_rules);
+static LexerDef lisp_lexer = LEXER(lisp_rules);
+static LexerDef fortran_lexer = LEXER(fortran_rules);
+static LexerDef pascal_lexer = LEXER(pascal_rules);
+static LexerDef ada_lexer = LEXER(ada_rules);
+static LexerDef powershell_lexer = LEXER(powershell_rules);
+static LexerDef php_lexer = LEXER(php_rules);
+static LexerDef elixir_lexer = LEXER(elixir_rules);
+static LexerDef erlang_lexer = LEXER(erlang_rules);
+static LexerDef r_lexer = LEXER(r_rules);
+static LexerDef julia_lexer = LEXER(julia_rules);
+static LexerDef nim_lexer = LEXER(nim_rules);
+static LexerDef ocaml_lexer = LEXER(ocaml_rules);
+static LexerDef prolog_lexer = LEXER(prolog_rules);
+static LexerDef vhdl_lexer = LEXER(vhdl_rules);
+
+static void lexer_add_class(LexTable *table, const char *set, uint32_t bit) {
+    for (; *set; set++) {
+        table->classes[(unsigned char)*set] |= bit;
+    }
+}
+
+static void lexer_add_candidate(LexTable *table, unsigned char byte, size_t rule) {
+    for (int i = 0; i < LEX_MAX_CANDIDATES; i++) {
+        if (table->candidates[byte][i] == 0) {
+            table->candidates[byte][i] = (uint8_t)(rule + 1);
+            return;
         }
+    }
+}
 
-        /* Check for line comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
+static LexTable *lexer_build(const LexerDef *def) {
+    LexTable *table = calloc(1, sizeof(LexTable));
+    if (!table) return NULL;
+
+    for (size_t i = 0; i < def->rule_count && i < LEX_MAX_RULES; i++) {
+        const LexRule *rule = &def->rules[i];
+
+        if (rule->body) lexer_add_class(table, rule->body, LEX_BODY_BIT(i));
+        if (rule->next) lexer_add_class(table, rule->next, LEX_NEXT_BIT(i));
+        if (rule->kind == LEX_BLOCK) {
+            table->classes[(unsigned char)rule->close[0]] |= LEX_CLOSE_BIT;
         }
 
-        /* Check for block comment start */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size && pos < line_end) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
+        if (rule->open) {
+            lexer_add_candidate(table, (unsigned char)rule->open[0], i);
+        } else {
+            for (const char *s = rule->start; *s; s++) {
+                lexer_add_candidate(table, (unsigned char)*s, i);
             }
-            continue;
         }
+    }
 
-        /* Check for preprocessor (C only, must be at line start) */
-        if (lang == LANG_C && c == '#' && is_line_start_nonws(buf, pos, line_start)) {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_PREPROCESSOR;
-                pos++;
-            }
-            break;
+    return table;
+}
+
+/* Same lazy publish as keyword_index */
+static LexTable *lexer_table(LexerDef *def) {
+    LexTable *table = atomic_load_explicit(&def->table, memory_order_acquire);
+    if (table) return table;
+
+    LexTable *built = lexer_build(def);
+    if (!built) return NULL;
+
+    if (atomic_compare_exchange_strong_explicit(&def->table, &table, built,
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        return built;
+    }
+    free(built);
+    return table;
+}
+
+static bool lexer_match(const char *s, size_t pos, size_t end, const char *str) {
+    for (; *str; str++, pos++) {
+        if (pos >= end || s[pos] != *str) return false;
+    }
+    return true;
+}
+
+/* Cover [from, to) with token; the gap since the last run is normal text */
+static void lexer_emit(TokenRuns *out, size_t from, size_t to, TokenType token) {
+    if (from > out->length) token_runs_add(out, from - out->length, TOKEN_NORMAL);
+    if (to > from) token_runs_add(out, to - from, token);
+}
+
+/* One pass of the engine over a contiguous piece of a line. Positions are
+ * relative to s, which starts base bytes into the line. */
+typedef struct LexScan {
+    const LexerDef *def;
+    const LexTable *table;
+    KeywordSet *keywords;
+    const char *s;
+    size_t end;                 /* Bytes available in s */
+    size_t base;
+    size_t indent;              /* First non-blank, SIZE_MAX when base > 0 */
+    size_t limit;               /* Stop at the first resumable point at or after this */
+    HighlightState *state;
+    TokenRuns *out;
+} LexScan;
+
+/* Scan for the close of the block *state names; every block rule with
+ * that state can end it. Every byte inside a block is a resume point. */
+static size_t lexer_block_tail(LexScan *scan, size_t pos) {
+    const LexerDef *def = scan->def;
+    const char *s = scan->s;
+    const LexRule *block = NULL;
+    for (size_t i = 0; i < def->rule_count && !block; i++) {
+        if (def->rules[i].kind == LEX_BLOCK && def->rules[i].state == *scan->state) {
+            block = &def->rules[i];
         }
+    }
+    if (!block) return pos;
 
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
+    size_t stop = scan->limit < scan->end ? scan->limit : scan->end;
+    if (stop < pos) stop = pos;
+    for (size_t p = pos; p < stop; p++) {
+        if (!(scan->table->classes[(unsigned char)s[p]] & LEX_CLOSE_BIT)) continue;
+
+        for (size_t i = 0; i < def->rule_count; i++) {
+            const LexRule *rule = &def->rules[i];
+            if (rule->kind != LEX_BLOCK || rule->state != *scan->state) continue;
+            if (lexer_match(s, p, scan->end, rule->close)) {
+                size_t close_end = p + strlen(rule->close);
+                lexer_emit(scan->out, pos, close_end, block->token);
+                *scan->state = HL_STATE_NORMAL;
+                return close_end;
             }
-            continue;
         }
+    }
+    lexer_emit(scan->out, pos, stop, block->token);
+    return stop;
+}
 
-        /* Check for template strings (JavaScript) */
-        if (lang == LANG_JAVASCRIPT && c == '`') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '`') {
-                    pos++;
+/* Try rule i at pos; returns the end of what it consumed, or pos if it
+ * does not apply */
+static size_t lexer_apply(LexScan *scan, size_t i, size_t pos) {
+    const LexRule *rule = &scan->def->rules[i];
+    const uint32_t *classes = scan->table->classes;
+    const char *s = scan->s;
+    size_t end = scan->end;
+    size_t p = pos;
+
+    if ((rule->flags & LEX_AT_INDENT) && pos != scan->indent) return pos;
+    if ((rule->flags & LEX_AT_COLUMN0) && scan->base + pos != 0) return pos;
+
+    if (rule->open) {
+        if (!lexer_match(s, pos, end, rule->open)) return pos;
+        p += strlen(rule->open);
+        if (rule->next && (p >= end || !(classes[(unsigned char)s[p]] & LEX_NEXT_BIT(i)))) {
+            return pos;
+        }
+    } else {
+        p++;
+    }
+
+    switch (rule->kind) {
+        case LEX_LINE:
+            p = end;
+            break;
+
+        case LEX_BLOCK:
+            lexer_emit(scan->out, pos, p, rule->token);
+            *scan->state = rule->state;
+            return lexer_block_tail(scan, p);
+
+        case LEX_STRING: {
+            size_t close_len = strlen(rule->close);
+            while (p < end) {
+                if (rule->escape && s[p] == rule->escape && p + 1 < end) {
+                    p += 2;
+                } else if (lexer_match(s, p, end, rule->close)) {
+                    if ((rule->flags & LEX_DOUBLED) && p + 1 < end && s[p + 1] == rule->close[0]) {
+                        p += 2;
+                        continue;
+                    }
+                    p += close_len;
                     break;
+                } else {
+                    p++;
                 }
-                pos++;
             }
-            continue;
+            if (rule->flags & LEX_KEYED) {
+                size_t q = p;
+                while (q < end && (s[q] == ' ' || s[q] == '\t')) q++;
+                if (q < end && s[q] == ':') {
+                    lexer_emit(scan->out, pos, p, TOKEN_KEYWORD);
+                    return p;
+                }
+            }
+            break;
         }
 
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
+        case LEX_CHAR:
+            if (p < end) {
+                if (rule->escape && s[p] == rule->escape) {
+                    p++;
+                    if (p < end) p++;
+                } else {
+                    p++;
+                }
             }
-            word[word_len] = '\0';
+            if (p < end && s[p] == rule->open[0]) p++;
+            break;
 
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
+        case LEX_SIGIL:
+            if ((rule->flags & LEX_BRACED) && p < end && s[p] == '{') {
+                while (p < end && s[p++] != '}') {}
+                break;
             }
-            continue;
-        }
+            /* fall through */
+        case LEX_NUMBER:
+            while (p < end && (classes[(unsigned char)s[p]] & LEX_BODY_BIT(i))) p++;
+            break;
 
-        /* Check for numbers */
-        if (isdigit(c) || (c == '.' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isxdigit(c) || c == '.' || c == 'x' || c == 'X' ||
-                    c == 'e' || c == 'E' || c == '+' || c == '-' ||
-                    c == 'u' || c == 'U' || c == 'l' || c == 'L' || c == 'f' || c == 'F') {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
+        case LEX_PLAIN:
+            return p;
+
+        case LEX_WORD: {
+            size_t limit = end;
+            if (!(rule->flags & (LEX_WHOLE | LEX_FIXED)) && pos + LEX_WORD_CHUNK < end) {
+                limit = pos + LEX_WORD_CHUNK;
+            }
+            while (p < limit && (classes[(unsigned char)s[p]] & LEX_BODY_BIT(i))) p++;
+
+            size_t len = p - pos;
+            TokenType token = rule->token;
+            if (!(rule->flags & LEX_FIXED)) {
+                if ((rule->flags & LEX_WHOLE) && len >= LEX_WORD_MAX) {
+                    token = TOKEN_NORMAL;
+                } else if (rule->flags & LEX_FOLD) {
+                    char word[LEX_WORD_MAX];
+                    for (size_t k = 0; k < len; k++) {
+                        word[k] = (char)tolower((unsigned char)s[pos + k]);
+                    }
+                    token = lookup_keyword(scan->keywords, word, len);
                 } else {
-                    break;
+                    token = lookup_keyword(scan->keywords, s + pos, len);
                 }
             }
+            if (token != TOKEN_NORMAL) lexer_emit(scan->out, pos, p, token);
+            return p;
+        }
+    }
+
+    lexer_emit(scan->out, pos, p, rule->token);
+    return p;
+}
+
+/* The main loop is memoryless apart from pos and *state, so the start of
+ * every iteration is a point the scan can be resumed from */
+static size_t lexer_run(LexScan *scan) {
+    const LexTable *table = scan->table;
+    const char *s = scan->s;
+    size_t pos = 0;
+
+    /* Resume points inside the indent would lose track of it */
+    if (scan->base == 0 && scan->limit <= scan->indent) scan->limit = scan->indent + 1;
+
+    if (*scan->state != HL_STATE_NORMAL) {
+        pos = lexer_block_tail(scan, pos);
+    }
+
+    while (pos < scan->end && pos < scan->limit) {
+        const uint8_t *candidates = table->candidates[(unsigned char)s[pos]];
+        if (!candidates[0]) {
+            pos++;
             continue;
         }
 
-        /* Default: normal */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
+        size_t next = pos;
+        for (int k = 0; k < LEX_MAX_CANDIDATES && candidates[k] && next == pos; k++) {
+            next = lexer_apply(scan, candidates[k] - 1, pos);
+        }
+        pos = next > pos ? next : pos + 1;
     }
+    return pos < scan->end ? pos : scan->end;
 }
 
-/* Highlight a line for shell scripts */
-static void highlight_shell(Buffer *buf, size_t line_start, size_t line_end,
-                            HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = shell_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state; /* Shell doesn't have multi-line constructs we handle */
+/* Run a language description over bytes [from, ...) of a line, stopping at
+ * the first resumable point at or after to (offsets within the line). Emits
+ * runs from from up to the last token and returns the stop point. */
+static size_t lexer_highlight(LexerDef *def, LanguageType keyword_lang,
+                              Buffer *buf, size_t line_start, size_t line_end,
+                              size_t from, size_t to, HighlightState *state, TokenRuns *out) {
+    size_t length = line_end > line_start ? line_end - line_start : 0;
+    if (from >= length) return length;
+
+    LexTable *table = lexer_table(def);
+    if (!table) return length;
+
+    LexScan scan = {def, table, get_keywords(keyword_lang), NULL, length - from, from,
+                    SIZE_MAX, to > from ? to - from : 0, state, out};
+
+    /* A window only reads a little past its end; a token running beyond
+     * that is redone below with the rest of the line */
+    if (to < length && length - to > LEX_SPAN_SLACK) {
+        scan.end = to - from + LEX_SPAN_SLACK;
+    }
 
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
+    HighlightState entry = *state;
+    char stack_scratch[MAX_LINE_LENGTH];
+    char *heap_scratch = NULL;
 
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
+    for (;;) {
+        /* Long spans get a heap copy, and only when they straddle the gap */
+        scan.s = buffer_get_span(buf, line_start + from, line_start + from + scan.end,
+                                 scan.end <= sizeof(stack_scratch) ? stack_scratch : NULL);
+        if (!scan.s) {
+            heap_scratch = malloc(scan.end);
+            if (!heap_scratch) {
+                out->failed = true;
+                return length;
             }
-            break;
+            scan.s = buffer_get_span(buf, line_start + from, line_start + from + scan.end,
+                                     heap_scratch);
         }
 
-        /* Check for variables */
-        if (c == '$') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
-            /* Handle ${...} */
-            if (pos < line_end && buffer_get_char(buf, pos) == '{') {
-                while (pos < line_end && idx < out_size) {
-                    out[idx++] = TOKEN_VARIABLE;
-                    if (buffer_get_char(buf, pos) == '}') {
-                        pos++;
-                        break;
-                    }
-                    pos++;
-                }
-            } else {
-                /* Handle $VAR or $1, $@, etc */
-                while (pos < line_end && idx < out_size) {
-                    c = buffer_get_char(buf, pos);
-                    if (isalnum(c) || c == '_' || c == '?' || c == '@' || c == '*' || c == '#') {
-                        out[idx++] = TOKEN_VARIABLE;
-                        pos++;
-                    } else {
-                        break;
-                    }
-                }
+        if (from == 0) {
+            scan.indent = 0;
+            while (scan.indent < scan.end &&
+                   (scan.s[scan.indent] == ' ' || scan.s[scan.indent] == '\t')) {
+                scan.indent++;
             }
-            continue;
         }
 
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && quote == '"' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size && isdigit(buffer_get_char(buf, pos))) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Python */
-static void highlight_python(Buffer *buf, size_t line_start, size_t line_end,
-                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = python_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state; /* TODO: handle multi-line strings */
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for decorator */
-        if (c == '@' && is_line_start_nonws(buf, pos, line_start)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '@' || c == '.') {
-                    out[idx++] = TOKEN_VARIABLE; /* Using variable color for decorators */
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
+        size_t stop = lexer_run(&scan);
+        free(heap_scratch);
+        heap_scratch = NULL;
 
-        /* Check for strings (single, double, triple) */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            bool triple = false;
-
-            /* Check for triple quotes */
-            if (pos + 2 < line_end &&
-                buffer_get_char(buf, pos + 1) == quote &&
-                buffer_get_char(buf, pos + 2) == quote) {
-                triple = true;
-                out[idx++] = TOKEN_STRING;
-                out[idx++] = TOKEN_STRING;
-                out[idx++] = TOKEN_STRING;
-                pos += 3;
-            } else {
-                out[idx++] = TOKEN_STRING;
-                pos++;
-            }
-
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                    pos++;
-                    continue;
-                }
-
-                if (triple) {
-                    if (c == quote && pos + 2 < line_end &&
-                        buffer_get_char(buf, pos + 1) == quote &&
-                        buffer_get_char(buf, pos + 2) == quote) {
-                        pos++;
-                        if (idx < out_size) out[idx++] = TOKEN_STRING;
-                        pos++;
-                        if (idx < out_size) out[idx++] = TOKEN_STRING;
-                        pos++;
-                        break;
-                    }
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isxdigit(c) || c == '.' || c == 'x' || c == 'X' ||
-                    c == 'e' || c == 'E' || c == '+' || c == '-' ||
-                    c == 'o' || c == 'O' || c == 'b' || c == 'B' || c == '_') {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
+        if (stop < scan.end || from + scan.end == length) {
+            return from + stop;
         }
 
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
+        /* Ran off the end of the window: start over with the whole rest */
+        scan.end = length - from;
+        scan.limit = to > from ? to - from : 0;
+        *state = entry;
+        out->count = 0;
+        out->length = 0;
     }
 }
 
@@ -2397,12 +2837,13 @@ static void highlight_markdown(Buffer *buf, size_t line_start, size_t line_end,
     }
 }
 
-/* Highlight a line for Ruby (# comments, similar to Python) */
-static void highlight_ruby(Buffer *buf, size_t line_start, size_t line_end,
+/* Highlight a line for YAML */
+static void highlight_yaml(Buffer *buf, size_t line_start, size_t line_end,
                            HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = ruby_keywords;
+    KeywordSet *keywords = get_keywords(LANG_YAML);
     size_t pos = line_start;
     size_t idx = 0;
+    bool at_key = true;
 
     (void)state;
 
@@ -2418,26 +2859,32 @@ static void highlight_ruby(Buffer *buf, size_t line_start, size_t line_end,
             break;
         }
 
-        /* Check for instance/class variables */
-        if (c == '@') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
+        /* Check for key: pattern */
+        if (at_key && (isalnum(c) || c == '_' || c == '-')) {
+            size_t key_start = idx;
             while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                out[idx++] = TOKEN_VARIABLE;
+                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
+                    buffer_get_char(buf, pos) == '-')) {
+                out[idx++] = TOKEN_KEYWORD;
                 pos++;
             }
-            continue;
-        }
-
-        /* Check for symbols */
-        if (c == ':' && pos + 1 < line_end && isalpha(buffer_get_char(buf, pos + 1))) {
-            out[idx++] = TOKEN_TYPE;
-            pos++;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                out[idx++] = TOKEN_TYPE;
-                pos++;
+            /* Check if followed by : */
+            if (pos < line_end && buffer_get_char(buf, pos) == ':') {
+                at_key = false;
+            } else {
+                /* Not a key, check if it's a keyword */
+                char word[64];
+                size_t word_len = idx - key_start;
+                if (word_len < 64) {
+                    for (size_t i = 0; i < word_len; i++) {
+                        word[i] = buffer_get_char(buf, line_start + key_start + i);
+                    }
+                    word[word_len] = '\0';
+                    TokenType token = lookup_keyword(keywords, word, word_len);
+                    for (size_t i = key_start; i < idx; i++) {
+                        out[i] = token;
+                    }
+                }
             }
             continue;
         }
@@ -2450,10 +2897,7 @@ static void highlight_ruby(Buffer *buf, size_t line_start, size_t line_end,
             while (pos < line_end && idx < out_size) {
                 c = buffer_get_char(buf, pos);
                 out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
+                if (c == quote) {
                     pos++;
                     break;
                 }
@@ -2462,30 +2906,12 @@ static void highlight_ruby(Buffer *buf, size_t line_start, size_t line_end,
             continue;
         }
 
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '?')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
         /* Check for numbers */
-        if (isdigit(c)) {
+        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
             while (pos < line_end && idx < out_size &&
                    (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '_')) {
+                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == 'e' ||
+                    buffer_get_char(buf, pos) == 'E')) {
                 out[idx++] = TOKEN_NUMBER;
                 pos++;
             }
@@ -2498,74 +2924,38 @@ static void highlight_ruby(Buffer *buf, size_t line_start, size_t line_end,
     }
 }
 
-/* Highlight a line for Lua (-- comments) */
-static void highlight_lua(Buffer *buf, size_t line_start, size_t line_end,
-                          HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = lua_keywords;
+/* Highlight a line for TOML */
+static void highlight_toml(Buffer *buf, size_t line_start, size_t line_end,
+                           HighlightState *state, TokenType *out, size_t out_size) {
+    KeywordSet *keywords = get_keywords(LANG_TOML);
     size_t pos = line_start;
     size_t idx = 0;
 
-    /* Handle block comment continuation */
-    if (*state == HL_STATE_BLOCK_COMMENT) {
-        while (pos < line_end && idx < out_size) {
-            out[idx++] = TOKEN_COMMENT;
-            if (buffer_get_char(buf, pos) == ']' && pos + 1 < line_end &&
-                buffer_get_char(buf, pos + 1) == ']') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-                pos++;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_BLOCK_COMMENT) return;
-    }
+    (void)state;
 
     while (pos < line_end && idx < out_size) {
         char c = buffer_get_char(buf, pos);
 
-        /* Check for comment (-- or --[[ for block) */
-        if (c == '-' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '-') {
-            /* Check for block comment --[[ */
-            if (pos + 3 < line_end && buffer_get_char(buf, pos + 2) == '[' &&
-                buffer_get_char(buf, pos + 3) == '[') {
-                *state = HL_STATE_BLOCK_COMMENT;
-                while (pos < line_end && idx < out_size) {
-                    out[idx++] = TOKEN_COMMENT;
-                    if (buffer_get_char(buf, pos) == ']' && pos + 1 < line_end &&
-                        buffer_get_char(buf, pos + 1) == ']') {
-                        pos++;
-                        if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                        *state = HL_STATE_NORMAL;
-                        pos++;
-                        break;
-                    }
-                    pos++;
-                }
-            } else {
-                /* Line comment */
-                while (pos < line_end && idx < out_size) {
-                    out[idx++] = TOKEN_COMMENT;
-                    pos++;
-                }
+        /* Check for comment */
+        if (c == '#') {
+            while (pos < line_end && idx < out_size) {
+                out[idx++] = TOKEN_COMMENT;
+                pos++;
             }
-            continue;
+            break;
         }
 
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
+        /* Check for section header [section] or [[array]] */
+        if (c == '[') {
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
+                out[idx++] = TOKEN_HEADING;
+                if (buffer_get_char(buf, pos) == ']') {
                     pos++;
+                    /* Check for ]] */
+                    if (pos < line_end && buffer_get_char(buf, pos) == ']') {
+                        if (idx < out_size) out[idx++] = TOKEN_HEADING;
+                        pos++;
+                    }
                     break;
                 }
                 pos++;
@@ -2573,29 +2963,67 @@ static void highlight_lua(Buffer *buf, size_t line_start, size_t line_end,
             continue;
         }
 
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
+        /* Check for key = pattern */
+        if (isalnum(c) || c == '_' || c == '-') {
+            size_t key_start = idx;
+            while (pos < line_end && idx < out_size &&
+                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
+                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '.')) {
+                out[idx++] = TOKEN_KEYWORD;
+                pos++;
             }
-            word[word_len] = '\0';
+            /* Skip whitespace and check for = */
+            size_t temp_pos = pos;
+            while (temp_pos < line_end && (buffer_get_char(buf, temp_pos) == ' ' ||
+                   buffer_get_char(buf, temp_pos) == '\t')) {
+                temp_pos++;
+            }
+            if (temp_pos >= line_end || buffer_get_char(buf, temp_pos) != '=') {
+                /* Not a key, might be a value */
+                char word[64];
+                size_t word_len = idx - key_start;
+                if (word_len < 64) {
+                    for (size_t i = 0; i < word_len; i++) {
+                        word[i] = buffer_get_char(buf, line_start + key_start + i);
+                    }
+                    word[word_len] = '\0';
+                    TokenType token = lookup_keyword(keywords, word, word_len);
+                    for (size_t i = key_start; i < idx; i++) {
+                        out[i] = token;
+                    }
+                }
+            }
+            continue;
+        }
 
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
+        /* Check for strings */
+        if (c == '"' || c == '\'') {
+            char quote = c;
+            out[idx++] = TOKEN_STRING;
+            pos++;
+            while (pos < line_end && idx < out_size) {
+                c = buffer_get_char(buf, pos);
+                out[idx++] = TOKEN_STRING;
+                if (c == '\\' && pos + 1 < line_end) {
+                    pos++;
+                    if (idx < out_size) out[idx++] = TOKEN_STRING;
+                } else if (c == quote) {
+                    pos++;
+                    break;
+                }
+                pos++;
             }
             continue;
         }
 
         /* Check for numbers */
-        if (isdigit(c)) {
+        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
             while (pos < line_end && idx < out_size &&
                    (isxdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == 'x' || buffer_get_char(buf, pos) == 'X')) {
+                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '_' ||
+                    buffer_get_char(buf, pos) == 'x' || buffer_get_char(buf, pos) == 'o' ||
+                    buffer_get_char(buf, pos) == 'b' || buffer_get_char(buf, pos) == 'e' ||
+                    buffer_get_char(buf, pos) == 'E' || buffer_get_char(buf, pos) == '+')) {
                 out[idx++] = TOKEN_NUMBER;
                 pos++;
             }
@@ -2608,30 +3036,57 @@ static void highlight_lua(Buffer *buf, size_t line_start, size_t line_end,
     }
 }
 
-/* Highlight a line for SQL (-- and block comments) */
-static void highlight_sql(Buffer *buf, size_t line_start, size_t line_end,
-                          HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = sql_keywords;
+/* Highlight a line for Makefile */
+static void highlight_makefile(Buffer *buf, size_t line_start, size_t line_end,
+                               HighlightState *state, TokenType *out, size_t out_size) {
+    KeywordSet *keywords = get_keywords(LANG_MAKEFILE);
     size_t pos = line_start;
     size_t idx = 0;
 
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
+    (void)state;
 
-        /* Handle block comment continuation */
-        if (*state == HL_STATE_BLOCK_COMMENT) {
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
+    /* Check if line starts with tab (recipe line) */
+    if (pos < line_end && buffer_get_char(buf, pos) == '\t') {
+        /* Recipe line - highlight as normal with variable expansion */
+        while (pos < line_end && idx < out_size) {
+            char c = buffer_get_char(buf, pos);
+
+            if (c == '$') {
+                out[idx++] = TOKEN_VARIABLE;
                 pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
+                if (pos < line_end) {
+                    c = buffer_get_char(buf, pos);
+                    if (c == '(' || c == '{') {
+                        char close = (c == '(') ? ')' : '}';
+                        out[idx++] = TOKEN_VARIABLE;
+                        pos++;
+                        while (pos < line_end && idx < out_size && buffer_get_char(buf, pos) != close) {
+                            out[idx++] = TOKEN_VARIABLE;
+                            pos++;
+                        }
+                        if (pos < line_end && idx < out_size) {
+                            out[idx++] = TOKEN_VARIABLE;
+                            pos++;
+                        }
+                    } else {
+                        out[idx++] = TOKEN_VARIABLE;
+                        pos++;
+                    }
+                }
+                continue;
             }
+
+            out[idx++] = TOKEN_NORMAL;
             pos++;
-            continue;
         }
+        return;
+    }
 
-        /* Check for line comment -- */
-        if (c == '-' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '-') {
+    while (pos < line_end && idx < out_size) {
+        char c = buffer_get_char(buf, pos);
+
+        /* Check for comment */
+        if (c == '#') {
             while (pos < line_end && idx < out_size) {
                 out[idx++] = TOKEN_COMMENT;
                 pos++;
@@ -2639,60 +3094,78 @@ static void highlight_sql(Buffer *buf, size_t line_start, size_t line_end,
             break;
         }
 
-        /* Check for block comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size && pos < line_end) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '\'' || c == '"') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
+        /* Check for variable expansion $(VAR) or ${VAR} */
+        if (c == '$') {
+            out[idx++] = TOKEN_VARIABLE;
             pos++;
-            while (pos < line_end && idx < out_size) {
+            if (pos < line_end) {
                 c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == quote) {
+                if (c == '(' || c == '{') {
+                    char close = (c == '(') ? ')' : '}';
+                    out[idx++] = TOKEN_VARIABLE;
+                    pos++;
+                    while (pos < line_end && idx < out_size && buffer_get_char(buf, pos) != close) {
+                        out[idx++] = TOKEN_VARIABLE;
+                        pos++;
+                    }
+                    if (pos < line_end && idx < out_size) {
+                        out[idx++] = TOKEN_VARIABLE;
+                        pos++;
+                    }
+                } else {
+                    /* Single char variable like $@ $< $^ */
+                    out[idx++] = TOKEN_VARIABLE;
                     pos++;
-                    break;
                 }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
             }
             continue;
         }
 
-        /* Check for numbers */
-        if (isdigit(c)) {
+        /* Check for target: or variable = */
+        if (isalpha(c) || c == '_' || c == '.') {
+            size_t word_start = pos;
+            size_t idx_start = idx;
             while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.')) {
-                out[idx++] = TOKEN_NUMBER;
+                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
+                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '.')) {
+                out[idx++] = TOKEN_NORMAL;
                 pos++;
             }
+            /* Check what follows */
+            size_t temp_pos = pos;
+            while (temp_pos < line_end && buffer_get_char(buf, temp_pos) == ' ') temp_pos++;
+            if (temp_pos < line_end) {
+                char next = buffer_get_char(buf, temp_pos);
+                if (next == ':' && (temp_pos + 1 >= line_end || buffer_get_char(buf, temp_pos + 1) != '=')) {
+                    /* It's a target */
+                    for (size_t i = idx_start; i < idx; i++) {
+                        out[i] = TOKEN_TYPE;
+                    }
+                } else if (next == '=' || (next == ':' && temp_pos + 1 < line_end && buffer_get_char(buf, temp_pos + 1) == '=') ||
+                           (next == '+' && temp_pos + 1 < line_end && buffer_get_char(buf, temp_pos + 1) == '=') ||
+                           (next == '?' && temp_pos + 1 < line_end && buffer_get_char(buf, temp_pos + 1) == '=')) {
+                    /* It's a variable assignment */
+                    for (size_t i = idx_start; i < idx; i++) {
+                        out[i] = TOKEN_KEYWORD;
+                    }
+                } else {
+                    /* Check if keyword */
+                    char word[64];
+                    size_t word_len = pos - word_start;
+                    if (word_len < 64) {
+                        for (size_t i = 0; i < word_len; i++) {
+                            word[i] = buffer_get_char(buf, word_start + i);
+                        }
+                        word[word_len] = '\0';
+                        TokenType token = lookup_keyword(keywords, word, word_len);
+                        if (token != TOKEN_NORMAL) {
+                            for (size_t i = idx_start; i < idx; i++) {
+                                out[i] = token;
+                            }
+                        }
+                    }
+                }
+            }
             continue;
         }
 
@@ -2702,397 +3175,62 @@ static void highlight_sql(Buffer *buf, size_t line_start, size_t line_end,
     }
 }
 
-/* Highlight a line for CSS */
-static void highlight_css(Buffer *buf, size_t line_start, size_t line_end,
-                          HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = css_keywords;
+/* Highlight a line for Dockerfile (# comments, instructions) */
+static void highlight_docker(Buffer *buf, size_t line_start, size_t line_end,
+                             HighlightState *state, TokenType *out, size_t out_size) {
+    KeywordSet *keywords = get_keywords(LANG_DOCKER);
     size_t pos = line_start;
     size_t idx = 0;
 
+    (void)state;
+
     while (pos < line_end && idx < out_size) {
         char c = buffer_get_char(buf, pos);
 
-        /* Handle block comment continuation */
-        if (*state == HL_STATE_BLOCK_COMMENT) {
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-            }
-            pos++;
-            continue;
-        }
-
-        /* Check for block comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size && pos < line_end) {
+        /* Check for comment */
+        if (c == '#') {
+            while (pos < line_end && idx < out_size) {
                 out[idx++] = TOKEN_COMMENT;
                 pos++;
             }
-            continue;
+            break;
         }
 
-        /* Check for @-rules */
-        if (c == '@') {
-            out[idx++] = TOKEN_PREPROCESSOR;
-            pos++;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '-')) {
-                out[idx++] = TOKEN_PREPROCESSOR;
+        /* Check for instruction at start of non-comment content */
+        if (idx == 0 && isupper(c)) {
+            char word[32];
+            size_t word_len = 0;
+            while (pos < line_end && word_len < 31 && isupper(buffer_get_char(buf, pos))) {
+                word[word_len++] = buffer_get_char(buf, pos);
                 pos++;
             }
-            continue;
-        }
+            word[word_len] = '\0';
 
-        /* Check for selectors (starting with . or #) */
-        if (c == '.' || c == '#') {
-            out[idx++] = TOKEN_TYPE;
-            pos++;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '-' ||
-                    buffer_get_char(buf, pos) == '_')) {
-                out[idx++] = TOKEN_TYPE;
-                pos++;
+            TokenType token = lookup_keyword(keywords, word, word_len);
+            for (size_t i = 0; i < word_len && idx < out_size; i++) {
+                out[idx++] = token;
             }
             continue;
         }
 
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
+        /* Check for variables $VAR or ${VAR} */
+        if (c == '$') {
+            out[idx++] = TOKEN_VARIABLE;
             pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '-') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '-')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers and colors */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isxdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '%')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for YAML */
-static void highlight_yaml(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = yaml_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-    bool at_key = true;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for key: pattern */
-        if (at_key && (isalnum(c) || c == '_' || c == '-')) {
-            size_t key_start = idx;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '-')) {
-                out[idx++] = TOKEN_KEYWORD;
-                pos++;
-            }
-            /* Check if followed by : */
-            if (pos < line_end && buffer_get_char(buf, pos) == ':') {
-                at_key = false;
-            } else {
-                /* Not a key, check if it's a keyword */
-                char word[64];
-                size_t word_len = idx - key_start;
-                if (word_len < 64) {
-                    for (size_t i = 0; i < word_len; i++) {
-                        word[i] = buffer_get_char(buf, line_start + key_start + i);
-                    }
-                    word[word_len] = '\0';
-                    TokenType token = lookup_keyword(keywords, word, word_len);
-                    for (size_t i = key_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == 'e' ||
-                    buffer_get_char(buf, pos) == 'E')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for TOML */
-static void highlight_toml(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = toml_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for section header [section] or [[array]] */
-        if (c == '[') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_HEADING;
-                if (buffer_get_char(buf, pos) == ']') {
-                    pos++;
-                    /* Check for ]] */
-                    if (pos < line_end && buffer_get_char(buf, pos) == ']') {
-                        if (idx < out_size) out[idx++] = TOKEN_HEADING;
-                        pos++;
-                    }
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for key = pattern */
-        if (isalnum(c) || c == '_' || c == '-') {
-            size_t key_start = idx;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '.')) {
-                out[idx++] = TOKEN_KEYWORD;
-                pos++;
-            }
-            /* Skip whitespace and check for = */
-            size_t temp_pos = pos;
-            while (temp_pos < line_end && (buffer_get_char(buf, temp_pos) == ' ' ||
-                   buffer_get_char(buf, temp_pos) == '\t')) {
-                temp_pos++;
-            }
-            if (temp_pos >= line_end || buffer_get_char(buf, temp_pos) != '=') {
-                /* Not a key, might be a value */
-                char word[64];
-                size_t word_len = idx - key_start;
-                if (word_len < 64) {
-                    for (size_t i = 0; i < word_len; i++) {
-                        word[i] = buffer_get_char(buf, line_start + key_start + i);
-                    }
-                    word[word_len] = '\0';
-                    TokenType token = lookup_keyword(keywords, word, word_len);
-                    for (size_t i = key_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
-            while (pos < line_end && idx < out_size &&
-                   (isxdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == 'x' || buffer_get_char(buf, pos) == 'o' ||
-                    buffer_get_char(buf, pos) == 'b' || buffer_get_char(buf, pos) == 'e' ||
-                    buffer_get_char(buf, pos) == 'E' || buffer_get_char(buf, pos) == '+')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Makefile */
-static void highlight_makefile(Buffer *buf, size_t line_start, size_t line_end,
-                               HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = makefile_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    /* Check if line starts with tab (recipe line) */
-    if (pos < line_end && buffer_get_char(buf, pos) == '\t') {
-        /* Recipe line - highlight as normal with variable expansion */
-        while (pos < line_end && idx < out_size) {
-            char c = buffer_get_char(buf, pos);
-
-            if (c == '$') {
+            if (pos < line_end && buffer_get_char(buf, pos) == '{') {
                 out[idx++] = TOKEN_VARIABLE;
                 pos++;
-                if (pos < line_end) {
-                    c = buffer_get_char(buf, pos);
-                    if (c == '(' || c == '{') {
-                        char close = (c == '(') ? ')' : '}';
-                        out[idx++] = TOKEN_VARIABLE;
-                        pos++;
-                        while (pos < line_end && idx < out_size && buffer_get_char(buf, pos) != close) {
-                            out[idx++] = TOKEN_VARIABLE;
-                            pos++;
-                        }
-                        if (pos < line_end && idx < out_size) {
-                            out[idx++] = TOKEN_VARIABLE;
-                            pos++;
-                        }
-                    } else {
-                        out[idx++] = TOKEN_VARIABLE;
-                        pos++;
-                    }
-                }
-                continue;
-            }
-
-            out[idx++] = TOKEN_NORMAL;
-            pos++;
-        }
-        return;
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for variable expansion $(VAR) or ${VAR} */
-        if (c == '$') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
-            if (pos < line_end) {
-                c = buffer_get_char(buf, pos);
-                if (c == '(' || c == '{') {
-                    char close = (c == '(') ? ')' : '}';
-                    out[idx++] = TOKEN_VARIABLE;
-                    pos++;
-                    while (pos < line_end && idx < out_size && buffer_get_char(buf, pos) != close) {
-                        out[idx++] = TOKEN_VARIABLE;
-                        pos++;
-                    }
-                    if (pos < line_end && idx < out_size) {
-                        out[idx++] = TOKEN_VARIABLE;
-                        pos++;
-                    }
-                } else {
-                    /* Single char variable like $@ $< $^ */
+                while (pos < line_end && idx < out_size && buffer_get_char(buf, pos) != '}') {
+                    out[idx++] = TOKEN_VARIABLE;
+                    pos++;
+                }
+                if (pos < line_end && idx < out_size) {
+                    out[idx++] = TOKEN_VARIABLE;
+                    pos++;
+                }
+            } else {
+                while (pos < line_end && idx < out_size &&
+                       (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
                     out[idx++] = TOKEN_VARIABLE;
                     pos++;
                 }
@@ -3100,2158 +3238,58 @@ static void highlight_makefile(Buffer *buf, size_t line_start, size_t line_end,
             continue;
         }
 
-        /* Check for target: or variable = */
-        if (isalpha(c) || c == '_' || c == '.') {
-            size_t word_start = pos;
-            size_t idx_start = idx;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '.')) {
-                out[idx++] = TOKEN_NORMAL;
-                pos++;
-            }
-            /* Check what follows */
-            size_t temp_pos = pos;
-            while (temp_pos < line_end && buffer_get_char(buf, temp_pos) == ' ') temp_pos++;
-            if (temp_pos < line_end) {
-                char next = buffer_get_char(buf, temp_pos);
-                if (next == ':' && (temp_pos + 1 >= line_end || buffer_get_char(buf, temp_pos + 1) != '=')) {
-                    /* It's a target */
-                    for (size_t i = idx_start; i < idx; i++) {
-                        out[i] = TOKEN_TYPE;
-                    }
-                } else if (next == '=' || (next == ':' && temp_pos + 1 < line_end && buffer_get_char(buf, temp_pos + 1) == '=') ||
-                           (next == '+' && temp_pos + 1 < line_end && buffer_get_char(buf, temp_pos + 1) == '=') ||
-                           (next == '?' && temp_pos + 1 < line_end && buffer_get_char(buf, temp_pos + 1) == '=')) {
-                    /* It's a variable assignment */
-                    for (size_t i = idx_start; i < idx; i++) {
-                        out[i] = TOKEN_KEYWORD;
-                    }
-                } else {
-                    /* Check if keyword */
-                    char word[64];
-                    size_t word_len = pos - word_start;
-                    if (word_len < 64) {
-                        for (size_t i = 0; i < word_len; i++) {
-                            word[i] = buffer_get_char(buf, word_start + i);
-                        }
-                        word[word_len] = '\0';
-                        TokenType token = lookup_keyword(keywords, word, word_len);
-                        if (token != TOKEN_NORMAL) {
-                            for (size_t i = idx_start; i < idx; i++) {
-                                out[i] = token;
-                            }
-                        }
-                    }
-                }
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Perl (# comments, $ variables) */
-static void highlight_perl(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = perl_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for variables $var, @array, %hash */
-        if (c == '$' || c == '@' || c == '%') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                out[idx++] = TOKEN_VARIABLE;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isxdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '_' || buffer_get_char(buf, pos) == 'x')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Haskell (-- line comments, {- -} block comments) */
-static void highlight_haskell(Buffer *buf, size_t line_start, size_t line_end,
-                              HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = haskell_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Handle block comment continuation */
-        if (*state == HL_STATE_BLOCK_COMMENT) {
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '-' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '}') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-            }
-            pos++;
-            continue;
-        }
-
-        /* Check for line comment -- */
-        if (c == '-' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '-') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for block comment {- */
-        if (c == '{' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '-') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size && pos < line_end) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for char literals */
-        if (c == '\'') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            if (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (c == '\\') {
-                    out[idx++] = TOKEN_STRING;
-                    pos++;
-                    if (pos < line_end && idx < out_size) {
-                        out[idx++] = TOKEN_STRING;
-                        pos++;
-                    }
-                } else {
-                    out[idx++] = TOKEN_STRING;
-                    pos++;
-                }
-                if (pos < line_end && idx < out_size && buffer_get_char(buf, pos) == '\'') {
-                    out[idx++] = TOKEN_STRING;
-                    pos++;
-                }
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '\'')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isxdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == 'x' || buffer_get_char(buf, pos) == 'o')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Lisp (; comments) */
-static void highlight_lisp(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = lisp_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == ';') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for keywords (after open paren) and symbols */
-        if (isalpha(c) || c == '-' || c == '_' || c == '+' || c == '*' || c == '/' ||
-            c == '<' || c == '>' || c == '=' || c == '!' || c == '?') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '-' || c == '_' || c == '+' || c == '*' ||
-                    c == '/' || c == '<' || c == '>' || c == '=' || c == '!' ||
-                    c == '?' || c == ':') {
-                    word[word_len++] = c;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Highlight parens */
-        if (c == '(' || c == ')') {
-            out[idx++] = TOKEN_KEYWORD;
-            pos++;
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Fortran (! comments) */
-static void highlight_fortran(Buffer *buf, size_t line_start, size_t line_end,
-                              HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = fortran_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    /* Check for comment (C in column 1 for fixed-form, or !) */
-    char first = buffer_get_char(buf, pos);
-    if (first == '!' || first == 'C' || first == 'c' || first == '*') {
-        if (first == '!' || pos == line_start) {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            return;
-        }
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for inline comment ! */
-        if (c == '!') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == 'd' || buffer_get_char(buf, pos) == 'D' ||
-                    buffer_get_char(buf, pos) == 'e' || buffer_get_char(buf, pos) == 'E')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Pascal ({ } comments, // line comments) */
-static void highlight_pascal(Buffer *buf, size_t line_start, size_t line_end,
-                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = pascal_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Handle block comment continuation */
-        if (*state == HL_STATE_BLOCK_COMMENT) {
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '}' || (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == ')')) {
-                if (c == '*') {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                }
-                *state = HL_STATE_NORMAL;
-            }
-            pos++;
-            continue;
-        }
-
-        /* Check for line comment // */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for block comment { or (* */
-        if (c == '{') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            continue;
-        }
-        if (c == '(' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size && pos < line_end) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '\'') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\'') {
-                    pos++;
-                    /* Check for escaped quote '' */
-                    if (pos < line_end && buffer_get_char(buf, pos) == '\'') {
-                        if (idx < out_size) out[idx++] = TOKEN_STRING;
-                        pos++;
-                    } else {
-                        break;
-                    }
-                } else {
-                    pos++;
-                }
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c) || c == '$') {
-            while (pos < line_end && idx < out_size &&
-                   (isxdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '$')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Ada (-- comments) */
-static void highlight_ada(Buffer *buf, size_t line_start, size_t line_end,
-                          HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = ada_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment -- */
-        if (c == '-' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '-') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '"') {
-                    pos++;
-                    /* Check for escaped quote "" */
-                    if (pos < line_end && buffer_get_char(buf, pos) == '"') {
-                        if (idx < out_size) out[idx++] = TOKEN_STRING;
-                        pos++;
-                    } else {
-                        break;
-                    }
-                } else {
-                    pos++;
-                }
-            }
-            continue;
-        }
-
-        /* Check for character literals */
-        if (c == '\'') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            if (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_STRING;
-                pos++;
-            }
-            if (pos < line_end && idx < out_size && buffer_get_char(buf, pos) == '\'') {
-                out[idx++] = TOKEN_STRING;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '_' || buffer_get_char(buf, pos) == '#' ||
-                    buffer_get_char(buf, pos) == 'E' || buffer_get_char(buf, pos) == 'e')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for PowerShell (# comments, $ variables) */
-static void highlight_powershell(Buffer *buf, size_t line_start, size_t line_end,
-                                 HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = powershell_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    /* Handle block comment continuation <# #> */
-    if (*state == HL_STATE_BLOCK_COMMENT) {
-        while (pos < line_end && idx < out_size) {
-            out[idx++] = TOKEN_COMMENT;
-            if (buffer_get_char(buf, pos) == '#' && pos + 1 < line_end &&
-                buffer_get_char(buf, pos + 1) == '>') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-                pos++;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_BLOCK_COMMENT) return;
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for block comment <# */
-        if (c == '<' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '#') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size && pos < line_end) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for line comment # */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for variables $var */
-        if (c == '$') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                out[idx++] = TOKEN_VARIABLE;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '`' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifiers/keywords */
-        if (isalpha(c) || c == '_' || c == '-') {
-            char word[64];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 63 &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '-')) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for JSON */
-static void highlight_json(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for strings (which are keys or values) */
-        if (c == '"') {
-            size_t string_start = idx;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            /* Check if this is a key (followed by :) */
-            size_t temp_pos = pos;
-            while (temp_pos < line_end && (buffer_get_char(buf, temp_pos) == ' ' ||
-                   buffer_get_char(buf, temp_pos) == '\t')) {
-                temp_pos++;
-            }
-            if (temp_pos < line_end && buffer_get_char(buf, temp_pos) == ':') {
-                /* It's a key - change to keyword color */
-                for (size_t i = string_start; i < idx; i++) {
-                    out[i] = TOKEN_KEYWORD;
-                }
-            }
-            continue;
-        }
-
-        /* Check for numbers */
-        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '+' ||
-                    buffer_get_char(buf, pos) == 'e' || buffer_get_char(buf, pos) == 'E')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for true/false/null */
-        if (isalpha(c)) {
-            char word[16];
-            size_t word_len = 0;
-            size_t word_start = idx;
-            while (pos < line_end && word_len < 15 && isalpha(buffer_get_char(buf, pos))) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_NORMAL;
-                pos++;
-            }
-            word[word_len] = '\0';
-            if (strcmp(word, "true") == 0 || strcmp(word, "false") == 0 || strcmp(word, "null") == 0) {
-                for (size_t i = word_start; i < idx; i++) {
-                    out[i] = TOKEN_TYPE;
-                }
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Dockerfile (# comments, instructions) */
-static void highlight_docker(Buffer *buf, size_t line_start, size_t line_end,
-                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = docker_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for instruction at start of non-comment content */
-        if (idx == 0 && isupper(c)) {
-            char word[32];
-            size_t word_len = 0;
-            while (pos < line_end && word_len < 31 && isupper(buffer_get_char(buf, pos))) {
-                word[word_len++] = buffer_get_char(buf, pos);
-                pos++;
-            }
-            word[word_len] = '\0';
-
-            TokenType token = lookup_keyword(keywords, word, word_len);
-            for (size_t i = 0; i < word_len && idx < out_size; i++) {
-                out[idx++] = token;
-            }
-            continue;
-        }
-
-        /* Check for variables $VAR or ${VAR} */
-        if (c == '$') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
-            if (pos < line_end && buffer_get_char(buf, pos) == '{') {
-                out[idx++] = TOKEN_VARIABLE;
-                pos++;
-                while (pos < line_end && idx < out_size && buffer_get_char(buf, pos) != '}') {
-                    out[idx++] = TOKEN_VARIABLE;
-                    pos++;
-                }
-                if (pos < line_end && idx < out_size) {
-                    out[idx++] = TOKEN_VARIABLE;
-                    pos++;
-                }
-            } else {
-                while (pos < line_end && idx < out_size &&
-                       (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                    out[idx++] = TOKEN_VARIABLE;
-                    pos++;
-                }
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Git config/ignore files (# comments, [sections]) */
-static void highlight_gitconfig(Buffer *buf, size_t line_start, size_t line_end,
-                                HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = gitconfig_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    (void)state;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment # or ; */
-        if (c == '#' || c == ';') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for section header [section] */
-        if (c == '[') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_HEADING;
-                if (buffer_get_char(buf, pos) == ']') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for key = value pattern (highlight key) */
-        if (isalpha(c) || c == '_') {
-            size_t key_start = idx;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '.')) {
-                out[idx++] = TOKEN_KEYWORD;
-                pos++;
-            }
-            /* Check what follows (whitespace then =) */
-            size_t temp_pos = pos;
-            while (temp_pos < line_end && (buffer_get_char(buf, temp_pos) == ' ' ||
-                   buffer_get_char(buf, temp_pos) == '\t')) {
-                temp_pos++;
-            }
-            if (temp_pos >= line_end || buffer_get_char(buf, temp_pos) != '=') {
-                /* Not a key, might be a value - check for true/false */
-                char word[64];
-                size_t word_len = idx - key_start;
-                if (word_len < 64) {
-                    for (size_t i = 0; i < word_len; i++) {
-                        word[i] = buffer_get_char(buf, line_start + key_start + i);
-                    }
-                    word[word_len] = '\0';
-                    TokenType token = lookup_keyword(keywords, word, word_len);
-                    if (token != TOKEN_NORMAL) {
-                        for (size_t i = key_start; i < idx; i++) {
-                            out[i] = token;
-                        }
-                    } else {
-                        for (size_t i = key_start; i < idx; i++) {
-                            out[i] = TOKEN_NORMAL;
-                        }
-                    }
-                }
-            }
-            continue;
-        }
-
-        /* Check for strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for HTML/XML */
-static void highlight_html(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    /* Handle continued block comment */
-    if (*state == HL_STATE_BLOCK_COMMENT) {
-        while (pos < line_end && idx < out_size) {
-            out[idx++] = TOKEN_COMMENT;
-            /* Check for --> */
-            if (pos + 2 < line_end &&
-                buffer_get_char(buf, pos) == '-' &&
-                buffer_get_char(buf, pos + 1) == '-' &&
-                buffer_get_char(buf, pos + 2) == '>') {
-                out[idx - 1] = TOKEN_COMMENT;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                pos += 3;
-                *state = HL_STATE_NORMAL;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_BLOCK_COMMENT) return;
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for comment <!-- */
-        if (c == '<' && pos + 3 < line_end &&
-            buffer_get_char(buf, pos + 1) == '!' &&
-            buffer_get_char(buf, pos + 2) == '-' &&
-            buffer_get_char(buf, pos + 3) == '-') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                /* Check for --> */
-                if (pos + 2 < line_end &&
-                    buffer_get_char(buf, pos) == '-' &&
-                    buffer_get_char(buf, pos + 1) == '-' &&
-                    buffer_get_char(buf, pos + 2) == '>') {
-                    out[idx - 1] = TOKEN_COMMENT;
-                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                    pos += 3;
-                    *state = HL_STATE_NORMAL;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for tag < ... > */
-        if (c == '<') {
-            out[idx++] = TOKEN_KEYWORD;
-            pos++;
-
-            /* Check for </ or <! or <? */
-            if (pos < line_end) {
-                char next = buffer_get_char(buf, pos);
-                if (next == '/' || next == '!' || next == '?') {
-                    if (idx < out_size) {
-                        out[idx++] = TOKEN_KEYWORD;
-                        pos++;
-                    }
-                }
-            }
-
-            /* Tag name */
-            while (pos < line_end && idx < out_size) {
-                char tc = buffer_get_char(buf, pos);
-                if (!isalnum(tc) && tc != '-' && tc != '_' && tc != ':') break;
-                out[idx++] = TOKEN_KEYWORD;
-                pos++;
-            }
-
-            /* Inside tag - attributes and values */
-            while (pos < line_end && idx < out_size) {
-                char tc = buffer_get_char(buf, pos);
-
-                if (tc == '>') {
-                    out[idx++] = TOKEN_KEYWORD;
-                    pos++;
-                    break;
-                }
-
-                /* Check for /> */
-                if (tc == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '>') {
-                    out[idx++] = TOKEN_KEYWORD;
-                    pos++;
-                    if (idx < out_size) {
-                        out[idx++] = TOKEN_KEYWORD;
-                        pos++;
-                    }
-                    break;
-                }
-
-                /* Attribute name */
-                if (isalpha(tc) || tc == '-' || tc == '_' || tc == ':') {
-                    while (pos < line_end && idx < out_size) {
-                        char ac = buffer_get_char(buf, pos);
-                        if (!isalnum(ac) && ac != '-' && ac != '_' && ac != ':') break;
-                        out[idx++] = TOKEN_TYPE;
-                        pos++;
-                    }
-                    continue;
-                }
-
-                /* String value */
-                if (tc == '"' || tc == '\'') {
-                    char quote = tc;
-                    out[idx++] = TOKEN_STRING;
-                    pos++;
-                    while (pos < line_end && idx < out_size) {
-                        char sc = buffer_get_char(buf, pos);
-                        out[idx++] = TOKEN_STRING;
-                        pos++;
-                        if (sc == quote) break;
-                    }
-                    continue;
-                }
-
-                /* Default for whitespace/= */
-                out[idx++] = TOKEN_NORMAL;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Default text outside tags */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Highlight a line for Terraform/HCL */
-static void highlight_terraform(Buffer *buf, size_t line_start, size_t line_end,
-                                HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = terraform_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    /* Handle continued block comment */
-    if (*state == HL_STATE_BLOCK_COMMENT) {
-        while (pos < line_end && idx < out_size) {
-            out[idx++] = TOKEN_COMMENT;
-            if (buffer_get_char(buf, pos) == '*' &&
-                pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                pos += 2;
-                *state = HL_STATE_NORMAL;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_BLOCK_COMMENT) return;
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Check for # comment */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for // comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Check for block comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            if (idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                if (buffer_get_char(buf, pos) == '*' &&
-                    pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                    pos += 2;
-                    *state = HL_STATE_NORMAL;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for string */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                char sc = buffer_get_char(buf, pos);
-                if (sc == '\\' && pos + 1 < line_end) {
-                    out[idx++] = TOKEN_STRING;
-                    pos++;
-                    if (idx < out_size) {
-                        out[idx++] = TOKEN_STRING;
-                        pos++;
-                    }
-                    continue;
-                }
-                /* Highlight ${...} interpolation */
-                if (sc == '$' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '{') {
-                    out[idx++] = TOKEN_VARIABLE;
-                    pos++;
-                    if (idx < out_size) {
-                        out[idx++] = TOKEN_VARIABLE;
-                        pos++;
-                    }
-                    int brace_depth = 1;
-                    while (pos < line_end && idx < out_size && brace_depth > 0) {
-                        char ic = buffer_get_char(buf, pos);
-                        out[idx++] = TOKEN_VARIABLE;
-                        if (ic == '{') brace_depth++;
-                        else if (ic == '}') brace_depth--;
-                        pos++;
-                    }
-                    continue;
-                }
-                out[idx++] = TOKEN_STRING;
-                pos++;
-                if (sc == '"') break;
-            }
-            continue;
-        }
-
-        /* Check for number */
-        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
-            while (pos < line_end && idx < out_size &&
-                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
-                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == 'e' ||
-                    buffer_get_char(buf, pos) == 'E')) {
-                out[idx++] = TOKEN_NUMBER;
-                pos++;
-            }
-            continue;
-        }
-
-        /* Check for identifier/keyword */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size &&
-                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
-                out[idx++] = TOKEN_NORMAL;
-                pos++;
-            }
-            /* Look up keyword */
-            size_t word_len = pos - word_pos;
-            char word[64];
-            if (word_len < 64) {
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        /* Default */
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* PHP highlighter */
-static void highlight_php(Buffer *buf, size_t line_start, size_t line_end,
-                          HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = php_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Continue multi-line comment */
-        if (*state == HL_STATE_BLOCK_COMMENT) {
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-            }
-            pos++;
-            continue;
-        }
-
-        /* Single-line comment with // or # */
-        if ((c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') ||
-            c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Multi-line comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            continue;
-        }
-
-        /* Strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Variables ($var) */
-        if (c == '$') {
-            out[idx++] = TOKEN_VARIABLE;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_VARIABLE;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == 'x' || c == 'X' ||
-                    (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Keywords and identifiers */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_NORMAL;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Elixir highlighter */
-static void highlight_elixir(Buffer *buf, size_t line_start, size_t line_end,
-                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = elixir_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Single-line comment with # */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Atoms (:atom) */
-        if (c == ':' && pos + 1 < line_end && (isalpha(buffer_get_char(buf, pos + 1)) ||
-            buffer_get_char(buf, pos + 1) == '_')) {
-            out[idx++] = TOKEN_TYPE;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '?' || c == '!') {
-                    out[idx++] = TOKEN_TYPE;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Module attributes (@attr) */
-        if (c == '@') {
-            out[idx++] = TOKEN_PREPROCESSOR;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_PREPROCESSOR;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == '_' || c == 'e' || c == 'E' ||
-                    c == 'x' || c == 'X' || c == 'b' || c == 'B' || c == 'o' || c == 'O') {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Keywords and identifiers */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '?' || c == '!') {
-                    out[idx++] = TOKEN_NORMAL;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-    (void)state;
-}
-
-/* Erlang highlighter */
-static void highlight_erlang(Buffer *buf, size_t line_start, size_t line_end,
-                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = erlang_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Single-line comment with % */
-        if (c == '%') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Atoms (single-quoted) */
-        if (c == '\'') {
-            out[idx++] = TOKEN_TYPE;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_TYPE;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_TYPE;
-                } else if (c == '\'') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Directives (-module, -export, etc.) */
-        if (c == '-' && idx == 0) {
-            out[idx++] = TOKEN_PREPROCESSOR;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalpha(c) || c == '_') {
-                    out[idx++] = TOKEN_PREPROCESSOR;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == '#' || c == 'e' || c == 'E' ||
-                    (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Keywords and atoms (lowercase start) */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '@') {
-                    out[idx++] = TOKEN_NORMAL;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-    (void)state;
-}
-
-/* R highlighter */
-static void highlight_r(Buffer *buf, size_t line_start, size_t line_end,
-                        HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = r_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Single-line comment with # */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Numbers */
-        if (isdigit(c) || (c == '.' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == 'L' || c == 'i') {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Keywords and identifiers */
-        if (isalpha(c) || c == '_' || c == '.') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '.') {
-                    out[idx++] = TOKEN_NORMAL;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-    (void)state;
-}
-
-/* Julia highlighter */
-static void highlight_julia(Buffer *buf, size_t line_start, size_t line_end,
-                            HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = julia_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    /* Continue multi-line comment */
-    if (*state == HL_STATE_BLOCK_COMMENT) {
-        while (pos < line_end && idx < out_size) {
-            char c = buffer_get_char(buf, pos);
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '=' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '#') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-                pos++;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_BLOCK_COMMENT) return;
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Multi-line comment #= =# */
-        if (c == '#' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '=') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            continue;
-        }
-
-        /* Single-line comment with # */
-        if (c == '#') {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Triple-quoted strings */
-        if (c == '"' && pos + 2 < line_end &&
-            buffer_get_char(buf, pos + 1) == '"' && buffer_get_char(buf, pos + 2) == '"') {
-            out[idx++] = TOKEN_STRING;
-            out[idx++] = TOKEN_STRING;
-            out[idx++] = TOKEN_STRING;
-            pos += 3;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '"' && pos + 2 < line_end &&
-                    buffer_get_char(buf, pos + 1) == '"' && buffer_get_char(buf, pos + 2) == '"') {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Symbols (:symbol) */
-        if (c == ':' && pos + 1 < line_end && isalpha(buffer_get_char(buf, pos + 1))) {
-            out[idx++] = TOKEN_TYPE;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '!') {
-                    out[idx++] = TOKEN_TYPE;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '_' ||
-                    c == 'x' || c == 'X' || c == 'b' || c == 'B' || c == 'o' || c == 'O' ||
-                    (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Keywords and identifiers */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '!') {
-                    out[idx++] = TOKEN_NORMAL;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
-            }
-            continue;
-        }
-
-        out[idx++] = TOKEN_NORMAL;
-        pos++;
-    }
-}
-
-/* Nim highlighter */
-static void highlight_nim(Buffer *buf, size_t line_start, size_t line_end,
-                          HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = nim_keywords;
-    size_t pos = line_start;
-    size_t idx = 0;
-
-    /* Continue multi-line string */
-    if (*state == HL_STATE_STRING) {
-        while (pos < line_end && idx < out_size) {
-            char c = buffer_get_char(buf, pos);
-            out[idx++] = TOKEN_STRING;
-            if (c == '"' && pos + 2 < line_end &&
-                buffer_get_char(buf, pos + 1) == '"' && buffer_get_char(buf, pos + 2) == '"') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_STRING;
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_STRING;
-                *state = HL_STATE_NORMAL;
-                pos++;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_STRING) return;
-    }
-
-    while (pos < line_end && idx < out_size) {
-        char c = buffer_get_char(buf, pos);
-
-        /* Single-line comment with # */
-        if (c == '#' && !(pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '[')) {
-            while (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_COMMENT;
-                pos++;
-            }
-            break;
-        }
-
-        /* Triple-quoted strings */
-        if (c == '"' && pos + 2 < line_end &&
-            buffer_get_char(buf, pos + 1) == '"' && buffer_get_char(buf, pos + 2) == '"') {
-            out[idx++] = TOKEN_STRING;
-            out[idx++] = TOKEN_STRING;
-            out[idx++] = TOKEN_STRING;
-            pos += 3;
-            *state = HL_STATE_STRING;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '"' && pos + 2 < line_end &&
-                    buffer_get_char(buf, pos + 1) == '"' && buffer_get_char(buf, pos + 2) == '"') {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                    pos++;
-                    *state = HL_STATE_NORMAL;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Character literals */
-        if (c == '\'') {
-            out[idx++] = TOKEN_CHAR;
-            pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_CHAR;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_CHAR;
-                } else if (c == '\'') {
-                    pos++;
-                    break;
-                }
-                pos++;
-            }
-            continue;
-        }
-
-        /* Numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == '_' || c == '\'' ||
-                    c == 'e' || c == 'E' || c == 'x' || c == 'X' ||
-                    c == 'b' || c == 'B' || c == 'o' || c == 'O' ||
-                    (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
-
-        /* Keywords and identifiers */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
+        /* Check for strings */
+        if (c == '"' || c == '\'') {
+            char quote = c;
+            out[idx++] = TOKEN_STRING;
+            pos++;
             while (pos < line_end && idx < out_size) {
                 c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_NORMAL;
+                out[idx++] = TOKEN_STRING;
+                if (c == '\\' && pos + 1 < line_end) {
+                    pos++;
+                    if (idx < out_size) out[idx++] = TOKEN_STRING;
+                } else if (c == quote) {
                     pos++;
-                } else {
                     break;
                 }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
+                pos++;
             }
             continue;
         }
 
+        /* Default */
         out[idx++] = TOKEN_NORMAL;
         pos++;
     }
 }
 
-/* OCaml highlighter (also used for F#) */
-static void highlight_ocaml(Buffer *buf, size_t line_start, size_t line_end,
-                            HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = ocaml_keywords;
+/* Highlight a line for Git config/ignore files (# comments, [sections]) */
+static void highlight_gitconfig(Buffer *buf, size_t line_start, size_t line_end,
+                                HighlightState *state, TokenType *out, size_t out_size) {
+    KeywordSet *keywords = get_keywords(LANG_GITCONFIG);
     size_t pos = line_start;
     size_t idx = 0;
 
-    /* Continue multi-line comment (* *) */
-    if (*state == HL_STATE_BLOCK_COMMENT) {
-        while (pos < line_end && idx < out_size) {
-            char c = buffer_get_char(buf, pos);
-            out[idx++] = TOKEN_COMMENT;
-            if (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == ')') {
-                pos++;
-                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
-                *state = HL_STATE_NORMAL;
-                pos++;
-                break;
-            }
-            pos++;
-        }
-        if (*state == HL_STATE_BLOCK_COMMENT) return;
-    }
+    (void)state;
 
     while (pos < line_end && idx < out_size) {
         char c = buffer_get_char(buf, pos);
 
-        /* Multi-line comment (* *) */
-        if (c == '(' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
-            *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            continue;
-        }
-
-        /* Strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
+        /* Check for comment # or ; */
+        if (c == '#' || c == ';') {
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == '"') {
-                    pos++;
-                    break;
-                }
+                out[idx++] = TOKEN_COMMENT;
                 pos++;
             }
-            continue;
+            break;
         }
 
-        /* Character literals */
-        if (c == '\'') {
-            out[idx++] = TOKEN_CHAR;
-            pos++;
+        /* Check for section header [section] */
+        if (c == '[') {
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_CHAR;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_CHAR;
-                } else if (c == '\'') {
+                out[idx++] = TOKEN_HEADING;
+                if (buffer_get_char(buf, pos) == ']') {
                     pos++;
                     break;
                 }
@@ -5260,75 +3298,90 @@ static void highlight_ocaml(Buffer *buf, size_t line_start, size_t line_end,
             continue;
         }
 
-        /* Numbers */
-        if (isdigit(c)) {
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == '_' ||
-                    c == 'e' || c == 'E' || c == 'x' || c == 'X' ||
-                    c == 'b' || c == 'B' || c == 'o' || c == 'O' ||
-                    (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
+        /* Check for key = value pattern (highlight key) */
+        if (isalpha(c) || c == '_') {
+            size_t key_start = idx;
+            while (pos < line_end && idx < out_size &&
+                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_' ||
+                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == '.')) {
+                out[idx++] = TOKEN_KEYWORD;
+                pos++;
+            }
+            /* Check what follows (whitespace then =) */
+            size_t temp_pos = pos;
+            while (temp_pos < line_end && (buffer_get_char(buf, temp_pos) == ' ' ||
+                   buffer_get_char(buf, temp_pos) == '\t')) {
+                temp_pos++;
+            }
+            if (temp_pos >= line_end || buffer_get_char(buf, temp_pos) != '=') {
+                /* Not a key, might be a value - check for true/false */
+                char word[64];
+                size_t word_len = idx - key_start;
+                if (word_len < 64) {
+                    for (size_t i = 0; i < word_len; i++) {
+                        word[i] = buffer_get_char(buf, line_start + key_start + i);
+                    }
+                    word[word_len] = '\0';
+                    TokenType token = lookup_keyword(keywords, word, word_len);
+                    if (token != TOKEN_NORMAL) {
+                        for (size_t i = key_start; i < idx; i++) {
+                            out[i] = token;
+                        }
+                    } else {
+                        for (size_t i = key_start; i < idx; i++) {
+                            out[i] = TOKEN_NORMAL;
+                        }
+                    }
                 }
             }
             continue;
         }
 
-        /* Keywords and identifiers */
-        if (isalpha(c) || c == '_') {
-            size_t word_start = idx;
-            size_t word_pos = pos;
+        /* Check for strings */
+        if (c == '"') {
+            out[idx++] = TOKEN_STRING;
+            pos++;
             while (pos < line_end && idx < out_size) {
                 c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_' || c == '\'') {
-                    out[idx++] = TOKEN_NORMAL;
+                out[idx++] = TOKEN_STRING;
+                if (c == '\\' && pos + 1 < line_end) {
+                    pos++;
+                    if (idx < out_size) out[idx++] = TOKEN_STRING;
+                } else if (c == '"') {
                     pos++;
-                } else {
                     break;
                 }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
-                }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
-                    }
-                }
+                pos++;
             }
             continue;
         }
 
+        /* Default */
         out[idx++] = TOKEN_NORMAL;
         pos++;
     }
 }
 
-/* Prolog highlighter */
-static void highlight_prolog(Buffer *buf, size_t line_start, size_t line_end,
-                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = prolog_keywords;
+/* Highlight a line for HTML/XML */
+static void highlight_html(Buffer *buf, size_t line_start, size_t line_end,
+                           HighlightState *state, TokenType *out, size_t out_size) {
     size_t pos = line_start;
     size_t idx = 0;
 
-    /* Continue multi-line comment */
+    /* Handle continued block comment */
     if (*state == HL_STATE_BLOCK_COMMENT) {
         while (pos < line_end && idx < out_size) {
-            char c = buffer_get_char(buf, pos);
             out[idx++] = TOKEN_COMMENT;
-            if (c == '*' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
-                pos++;
+            /* Check for --> */
+            if (pos + 2 < line_end &&
+                buffer_get_char(buf, pos) == '-' &&
+                buffer_get_char(buf, pos + 1) == '-' &&
+                buffer_get_char(buf, pos + 2) == '>') {
+                out[idx - 1] = TOKEN_COMMENT;
                 if (idx < out_size) out[idx++] = TOKEN_COMMENT;
+                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
+                pos += 3;
                 *state = HL_STATE_NORMAL;
-                pos++;
                 break;
             }
             pos++;
@@ -5339,118 +3392,142 @@ static void highlight_prolog(Buffer *buf, size_t line_start, size_t line_end,
     while (pos < line_end && idx < out_size) {
         char c = buffer_get_char(buf, pos);
 
-        /* Multi-line comment */
-        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
+        /* Check for comment <!-- */
+        if (c == '<' && pos + 3 < line_end &&
+            buffer_get_char(buf, pos + 1) == '!' &&
+            buffer_get_char(buf, pos + 2) == '-' &&
+            buffer_get_char(buf, pos + 3) == '-') {
             *state = HL_STATE_BLOCK_COMMENT;
-            out[idx++] = TOKEN_COMMENT;
-            pos++;
-            continue;
-        }
-
-        /* Single-line comment with % */
-        if (c == '%') {
             while (pos < line_end && idx < out_size) {
                 out[idx++] = TOKEN_COMMENT;
+                /* Check for --> */
+                if (pos + 2 < line_end &&
+                    buffer_get_char(buf, pos) == '-' &&
+                    buffer_get_char(buf, pos + 1) == '-' &&
+                    buffer_get_char(buf, pos + 2) == '>') {
+                    out[idx - 1] = TOKEN_COMMENT;
+                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
+                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
+                    pos += 3;
+                    *state = HL_STATE_NORMAL;
+                    break;
+                }
                 pos++;
             }
-            break;
+            continue;
         }
 
-        /* Strings */
-        if (c == '"' || c == '\'') {
-            char quote = c;
-            out[idx++] = TOKEN_STRING;
+        /* Check for tag < ... > */
+        if (c == '<') {
+            out[idx++] = TOKEN_KEYWORD;
             pos++;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '\\' && pos + 1 < line_end) {
-                    pos++;
-                    if (idx < out_size) out[idx++] = TOKEN_STRING;
-                } else if (c == quote) {
-                    pos++;
-                    break;
+
+            /* Check for </ or <! or <? */
+            if (pos < line_end) {
+                char next = buffer_get_char(buf, pos);
+                if (next == '/' || next == '!' || next == '?') {
+                    if (idx < out_size) {
+                        out[idx++] = TOKEN_KEYWORD;
+                        pos++;
+                    }
                 }
-                pos++;
             }
-            continue;
-        }
 
-        /* Numbers */
-        if (isdigit(c)) {
+            /* Tag name */
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '\'') {
-                    out[idx++] = TOKEN_NUMBER;
-                    pos++;
-                } else {
-                    break;
-                }
+                char tc = buffer_get_char(buf, pos);
+                if (!isalnum(tc) && tc != '-' && tc != '_' && tc != ':') break;
+                out[idx++] = TOKEN_KEYWORD;
+                pos++;
             }
-            continue;
-        }
 
-        /* Variables (start with uppercase or _) */
-        if (isupper(c) || c == '_') {
+            /* Inside tag - attributes and values */
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_VARIABLE;
+                char tc = buffer_get_char(buf, pos);
+
+                if (tc == '>') {
+                    out[idx++] = TOKEN_KEYWORD;
                     pos++;
-                } else {
                     break;
                 }
-            }
-            continue;
-        }
 
-        /* Keywords and atoms (lowercase start) */
-        if (islower(c)) {
-            size_t word_start = idx;
-            size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_NORMAL;
+                /* Check for /> */
+                if (tc == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '>') {
+                    out[idx++] = TOKEN_KEYWORD;
                     pos++;
-                } else {
+                    if (idx < out_size) {
+                        out[idx++] = TOKEN_KEYWORD;
+                        pos++;
+                    }
                     break;
                 }
-            }
-            size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
-                for (size_t i = 0; i < word_len; i++) {
-                    word[i] = buffer_get_char(buf, word_pos + i);
+
+                /* Attribute name */
+                if (isalpha(tc) || tc == '-' || tc == '_' || tc == ':') {
+                    while (pos < line_end && idx < out_size) {
+                        char ac = buffer_get_char(buf, pos);
+                        if (!isalnum(ac) && ac != '-' && ac != '_' && ac != ':') break;
+                        out[idx++] = TOKEN_TYPE;
+                        pos++;
+                    }
+                    continue;
                 }
-                word[word_len] = '\0';
-                TokenType token = lookup_keyword(keywords, word, word_len);
-                if (token != TOKEN_NORMAL) {
-                    for (size_t i = word_start; i < idx; i++) {
-                        out[i] = token;
+
+                /* String value */
+                if (tc == '"' || tc == '\'') {
+                    char quote = tc;
+                    out[idx++] = TOKEN_STRING;
+                    pos++;
+                    while (pos < line_end && idx < out_size) {
+                        char sc = buffer_get_char(buf, pos);
+                        out[idx++] = TOKEN_STRING;
+                        pos++;
+                        if (sc == quote) break;
                     }
+                    continue;
                 }
+
+                /* Default for whitespace/= */
+                out[idx++] = TOKEN_NORMAL;
+                pos++;
             }
             continue;
         }
 
+        /* Default text outside tags */
         out[idx++] = TOKEN_NORMAL;
         pos++;
     }
 }
 
-/* VHDL highlighter */
-static void highlight_vhdl(Buffer *buf, size_t line_start, size_t line_end,
-                           HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = vhdl_keywords;
+/* Highlight a line for Terraform/HCL */
+static void highlight_terraform(Buffer *buf, size_t line_start, size_t line_end,
+                                HighlightState *state, TokenType *out, size_t out_size) {
+    KeywordSet *keywords = get_keywords(LANG_TERRAFORM);
     size_t pos = line_start;
     size_t idx = 0;
 
+    /* Handle continued block comment */
+    if (*state == HL_STATE_BLOCK_COMMENT) {
+        while (pos < line_end && idx < out_size) {
+            out[idx++] = TOKEN_COMMENT;
+            if (buffer_get_char(buf, pos) == '*' &&
+                pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
+                if (idx < out_size) out[idx++] = TOKEN_COMMENT;
+                pos += 2;
+                *state = HL_STATE_NORMAL;
+                break;
+            }
+            pos++;
+        }
+        if (*state == HL_STATE_BLOCK_COMMENT) return;
+    }
+
     while (pos < line_end && idx < out_size) {
         char c = buffer_get_char(buf, pos);
 
-        /* Single-line comment with -- */
-        if (c == '-' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '-') {
+        /* Check for # comment */
+        if (c == '#') {
             while (pos < line_end && idx < out_size) {
                 out[idx++] = TOKEN_COMMENT;
                 pos++;
@@ -5458,78 +3535,105 @@ static void highlight_vhdl(Buffer *buf, size_t line_start, size_t line_end,
             break;
         }
 
-        /* Strings */
-        if (c == '"') {
-            out[idx++] = TOKEN_STRING;
-            pos++;
+        /* Check for // comment */
+        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                out[idx++] = TOKEN_STRING;
-                if (c == '"') {
-                    /* Check for escaped quote "" */
-                    if (pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '"') {
-                        pos++;
-                        if (idx < out_size) out[idx++] = TOKEN_STRING;
-                    } else {
-                        pos++;
-                        break;
-                    }
-                }
+                out[idx++] = TOKEN_COMMENT;
                 pos++;
             }
-            continue;
+            break;
         }
 
-        /* Character literals */
-        if (c == '\'') {
-            out[idx++] = TOKEN_CHAR;
+        /* Check for block comment */
+        if (c == '/' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '*') {
+            *state = HL_STATE_BLOCK_COMMENT;
+            out[idx++] = TOKEN_COMMENT;
             pos++;
-            if (pos < line_end && idx < out_size) {
-                out[idx++] = TOKEN_CHAR;
+            if (idx < out_size) {
+                out[idx++] = TOKEN_COMMENT;
                 pos++;
             }
-            if (pos < line_end && idx < out_size && buffer_get_char(buf, pos) == '\'') {
-                out[idx++] = TOKEN_CHAR;
+            while (pos < line_end && idx < out_size) {
+                out[idx++] = TOKEN_COMMENT;
+                if (buffer_get_char(buf, pos) == '*' &&
+                    pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '/') {
+                    if (idx < out_size) out[idx++] = TOKEN_COMMENT;
+                    pos += 2;
+                    *state = HL_STATE_NORMAL;
+                    break;
+                }
                 pos++;
             }
             continue;
         }
 
-        /* Numbers (including based literals) */
-        if (isdigit(c)) {
+        /* Check for string */
+        if (c == '"') {
+            out[idx++] = TOKEN_STRING;
+            pos++;
             while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isdigit(c) || c == '.' || c == '_' || c == '#' ||
-                    c == 'e' || c == 'E' ||
-                    (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
-                    out[idx++] = TOKEN_NUMBER;
+                char sc = buffer_get_char(buf, pos);
+                if (sc == '\\' && pos + 1 < line_end) {
+                    out[idx++] = TOKEN_STRING;
                     pos++;
-                } else {
-                    break;
+                    if (idx < out_size) {
+                        out[idx++] = TOKEN_STRING;
+                        pos++;
+                    }
+                    continue;
+                }
+                /* Highlight ${...} interpolation */
+                if (sc == '$' && pos + 1 < line_end && buffer_get_char(buf, pos + 1) == '{') {
+                    out[idx++] = TOKEN_VARIABLE;
+                    pos++;
+                    if (idx < out_size) {
+                        out[idx++] = TOKEN_VARIABLE;
+                        pos++;
+                    }
+                    int brace_depth = 1;
+                    while (pos < line_end && idx < out_size && brace_depth > 0) {
+                        char ic = buffer_get_char(buf, pos);
+                        out[idx++] = TOKEN_VARIABLE;
+                        if (ic == '{') brace_depth++;
+                        else if (ic == '}') brace_depth--;
+                        pos++;
+                    }
+                    continue;
                 }
+                out[idx++] = TOKEN_STRING;
+                pos++;
+                if (sc == '"') break;
+            }
+            continue;
+        }
+
+        /* Check for number */
+        if (isdigit(c) || (c == '-' && pos + 1 < line_end && isdigit(buffer_get_char(buf, pos + 1)))) {
+            while (pos < line_end && idx < out_size &&
+                   (isdigit(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '.' ||
+                    buffer_get_char(buf, pos) == '-' || buffer_get_char(buf, pos) == 'e' ||
+                    buffer_get_char(buf, pos) == 'E')) {
+                out[idx++] = TOKEN_NUMBER;
+                pos++;
             }
             continue;
         }
 
-        /* Keywords and identifiers (case-insensitive) */
+        /* Check for identifier/keyword */
         if (isalpha(c) || c == '_') {
             size_t word_start = idx;
             size_t word_pos = pos;
-            while (pos < line_end && idx < out_size) {
-                c = buffer_get_char(buf, pos);
-                if (isalnum(c) || c == '_') {
-                    out[idx++] = TOKEN_NORMAL;
-                    pos++;
-                } else {
-                    break;
-                }
+            while (pos < line_end && idx < out_size &&
+                   (isalnum(buffer_get_char(buf, pos)) || buffer_get_char(buf, pos) == '_')) {
+                out[idx++] = TOKEN_NORMAL;
+                pos++;
             }
+            /* Look up keyword */
             size_t word_len = pos - word_pos;
-            if (word_len > 0 && word_len < 64) {
-                char word[64];
+            char word[64];
+            if (word_len < 64) {
                 for (size_t i = 0; i < word_len; i++) {
-                    char ch = buffer_get_char(buf, word_pos + i);
-                    word[i] = tolower(ch);
+                    word[i] = buffer_get_char(buf, word_pos + i);
                 }
                 word[word_len] = '\0';
                 TokenType token = lookup_keyword(keywords, word, word_len);
@@ -5542,16 +3646,16 @@ static void highlight_vhdl(Buffer *buf, size_t line_start, size_t line_end,
             continue;
         }
 
+        /* Default */
         out[idx++] = TOKEN_NORMAL;
         pos++;
     }
-    (void)state;
 }
 
 /* LaTeX highlighter */
 static void highlight_latex(Buffer *buf, size_t line_start, size_t line_end,
                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = latex_keywords;
+    KeywordSet *keywords = get_keywords(LANG_LATEX);
     size_t pos = line_start;
     size_t idx = 0;
 
@@ -5662,7 +3766,7 @@ static void highlight_latex(Buffer *buf, size_t line_start, size_t line_end,
 /* Nginx/Apache config highlighter */
 static void highlight_nginx(Buffer *buf, size_t line_start, size_t line_end,
                             HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = nginx_keywords;
+    KeywordSet *keywords = get_keywords(LANG_NGINX);
     size_t pos = line_start;
     size_t idx = 0;
 
@@ -5769,7 +3873,7 @@ static void highlight_nginx(Buffer *buf, size_t line_start, size_t line_end,
 /* INI file highlighter */
 static void highlight_ini(Buffer *buf, size_t line_start, size_t line_end,
                           HighlightState *state, TokenType *out, size_t out_size) {
-    const Keyword *keywords = ini_keywords;
+    KeywordSet *keywords = get_keywords(LANG_INI);
     size_t pos = line_start;
     size_t idx = 0;
 
@@ -5925,143 +4029,280 @@ static void highlight_ini(Buffer *buf, size_t line_start, size_t line_end,
     (void)state;
 }
 
-/* Main highlighting function */
-void syntax_highlight_line(Buffer *buf, size_t line_start, size_t line_end,
-                           LanguageType lang, HighlightState *state,
-                           TokenType *out, size_t out_size) {
-    /* Initialize output to normal */
+/* Hand-written highlighters fill one token per byte */
+typedef void (*LineHighlighter)(Buffer *buf, size_t line_start, size_t line_end,
+                                HighlightState *state, TokenType *out, size_t out_size);
+
+void token_runs_init(TokenRuns *runs) {
+    memset(runs, 0, sizeof(*runs));
+}
+
+void token_runs_free(TokenRuns *runs) {
+    free(runs->runs);
+    free(runs->bytes);
+    token_runs_init(runs);
+}
+
+/* Append length bytes of token, extending the last run when it matches */
+bool token_runs_add(TokenRuns *runs, size_t length, TokenType token) {
+    while (length > 0) {
+        TokenRun *last = runs->count ? &runs->runs[runs->count - 1] : NULL;
+
+        if (last && last->token == token && last->length < UINT_MAX) {
+            size_t room = UINT_MAX - last->length;
+            size_t take = length < room ? length : room;
+            last->length += (unsigned int)take;
+            runs->length += take;
+            length -= take;
+            continue;
+        }
+
+        if (runs->count == runs->capacity) {
+            size_t new_capacity = runs->capacity ? runs->capacity * 2 : 16;
+            TokenRun *grown = realloc(runs->runs, new_capacity * sizeof(TokenRun));
+            if (!grown) {
+                runs->failed = true;
+                return false;
+            }
+            runs->runs = grown;
+            runs->capacity = new_capacity;
+        }
+        runs->runs[runs->count].length = 0;
+        runs->runs[runs->count].token = token;
+        runs->count++;
+    }
+    return true;
+}
+
+/* Run a hand-written highlighter into the byte buffer and fold it into runs */
+static void highlight_bytes(LineHighlighter highlighter, Buffer *buf, size_t line_start,
+                            size_t line_end, HighlightState *state, TokenRuns *out) {
     size_t len = line_end > line_start ? line_end - line_start : 0;
-    if (len > out_size) len = out_size;
+
+    if (len > out->bytes_capacity) {
+        TokenType *grown = realloc(out->bytes, len * sizeof(TokenType));
+        if (!grown) {
+            out->failed = true;
+            return;
+        }
+        out->bytes = grown;
+        out->bytes_capacity = len;
+    }
     for (size_t i = 0; i < len; i++) {
-        out[i] = TOKEN_NORMAL;
+        out->bytes[i] = TOKEN_NORMAL;
+    }
+
+    highlighter(buf, line_start, line_end, state, out->bytes, len);
+
+    size_t i = 0;
+    while (i < len) {
+        size_t j = i + 1;
+        while (j < len && out->bytes[j] == out->bytes[i]) j++;
+        if (!token_runs_add(out, j - i, out->bytes[i])) return;
+        i = j;
     }
+}
+
+/* Which highlighter handles a language: a lexer description (with the
+ * language whose keywords it uses) or a hand-written function */
+static void syntax_highlighter(LanguageType lang, LexerDef **lexer, LanguageType *keyword_lang,
+                               LineHighlighter *handwritten) {
+    *lexer = NULL;
+    *keyword_lang = lang;
+    *handwritten = NULL;
 
     switch (lang) {
         case LANG_C:
+            *lexer = &c_lexer;
+            break;
+        case LANG_CSHARP:
+            *lexer = &c_lexer;
+            *keyword_lang = LANG_C;
+            break;
         case LANG_JAVASCRIPT:
+            *lexer = &js_lexer;
+            break;
         case LANG_TYPESCRIPT:
         case LANG_GO:
         case LANG_RUST:
         case LANG_JAVA:
-            highlight_c_like(buf, line_start, line_end, lang, state, out, out_size);
+        case LANG_KOTLIN:
+        case LANG_SWIFT:
+        case LANG_SCALA:
+        case LANG_ZIG:
+        case LANG_DART:
+        case LANG_GROOVY:
+        case LANG_VERILOG:
+            *lexer = &c_family_lexer;
             break;
         case LANG_SHELL:
-            highlight_shell(buf, line_start, line_end, state, out, out_size);
+            *lexer = &shell_lexer;
             break;
         case LANG_PYTHON:
-            highlight_python(buf, line_start, line_end, state, out, out_size);
+            *lexer = &python_lexer;
             break;
         case LANG_MARKDOWN:
-            highlight_markdown(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_markdown;
             break;
         case LANG_RUBY:
-            highlight_ruby(buf, line_start, line_end, state, out, out_size);
+            *lexer = &ruby_lexer;
             break;
         case LANG_LUA:
-            highlight_lua(buf, line_start, line_end, state, out, out_size);
+            *lexer = &lua_lexer;
             break;
         case LANG_SQL:
-            highlight_sql(buf, line_start, line_end, state, out, out_size);
+            *lexer = &sql_lexer;
             break;
         case LANG_CSS:
-            highlight_css(buf, line_start, line_end, state, out, out_size);
+            *lexer = &css_lexer;
             break;
         case LANG_YAML:
-            highlight_yaml(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_yaml;
             break;
         case LANG_TOML:
-            highlight_toml(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_toml;
             break;
         case LANG_MAKEFILE:
-            highlight_makefile(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_makefile;
             break;
         case LANG_PERL:
-            highlight_perl(buf, line_start, line_end, state, out, out_size);
+            *lexer = &perl_lexer;
             break;
         case LANG_HASKELL:
-            highlight_haskell(buf, line_start, line_end, state, out, out_size);
+            *lexer = &haskell_lexer;
             break;
         case LANG_LISP:
-            highlight_lisp(buf, line_start, line_end, state, out, out_size);
-            break;
-        case LANG_CSHARP:
-            highlight_c_like(buf, line_start, line_end, LANG_C, state, out, out_size);
+            *lexer = &lisp_lexer;
             break;
         case LANG_FORTRAN:
-            highlight_fortran(buf, line_start, line_end, state, out, out_size);
+            *lexer = &fortran_lexer;
             break;
         case LANG_PASCAL:
-            highlight_pascal(buf, line_start, line_end, state, out, out_size);
+            *lexer = &pascal_lexer;
             break;
         case LANG_ADA:
-            highlight_ada(buf, line_start, line_end, state, out, out_size);
+            *lexer = &ada_lexer;
             break;
         case LANG_POWERSHELL:
-            highlight_powershell(buf, line_start, line_end, state, out, out_size);
+            *lexer = &powershell_lexer;
             break;
         case LANG_JSON:
-            highlight_json(buf, line_start, line_end, state, out, out_size);
+            *lexer = &json_lexer;
             break;
         case LANG_DOCKER:
-            highlight_docker(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_docker;
             break;
         case LANG_GITCONFIG:
-            highlight_gitconfig(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_gitconfig;
             break;
         case LANG_HTML:
-            highlight_html(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_html;
             break;
         case LANG_TERRAFORM:
-            highlight_terraform(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_terraform;
             break;
         case LANG_PHP:
-            highlight_php(buf, line_start, line_end, state, out, out_size);
-            break;
-        case LANG_KOTLIN:
-        case LANG_SWIFT:
-        case LANG_SCALA:
-        case LANG_ZIG:
-        case LANG_DART:
-        case LANG_GROOVY:
-        case LANG_VERILOG:
-            highlight_c_like(buf, line_start, line_end, lang, state, out, out_size);
+            *lexer = &php_lexer;
             break;
         case LANG_ELIXIR:
-            highlight_elixir(buf, line_start, line_end, state, out, out_size);
+            *lexer = &elixir_lexer;
             break;
         case LANG_ERLANG:
-            highlight_erlang(buf, line_start, line_end, state, out, out_size);
+            *lexer = &erlang_lexer;
             break;
         case LANG_R:
-            highlight_r(buf, line_start, line_end, state, out, out_size);
+            *lexer = &r_lexer;
             break;
         case LANG_JULIA:
-            highlight_julia(buf, line_start, line_end, state, out, out_size);
+            *lexer = &julia_lexer;
             break;
         case LANG_NIM:
-            highlight_nim(buf, line_start, line_end, state, out, out_size);
+            *lexer = &nim_lexer;
             break;
         case LANG_OCAML:
         case LANG_FSHARP:
-            highlight_ocaml(buf, line_start, line_end, state, out, out_size);
+            *lexer = &ocaml_lexer;
+            *keyword_lang = LANG_OCAML;
             break;
         case LANG_PROLOG:
-            highlight_prolog(buf, line_start, line_end, state, out, out_size);
+            *lexer = &prolog_lexer;
             break;
         case LANG_VHDL:
-            highlight_vhdl(buf, line_start, line_end, state, out, out_size);
+            *lexer = &vhdl_lexer;
             break;
         case LANG_LATEX:
-            highlight_latex(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_latex;
             break;
         case LANG_NGINX:
         case LANG_APACHE:
-            highlight_nginx(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_nginx;
             break;
         case LANG_INI:
-            highlight_ini(buf, line_start, line_end, state, out, out_size);
+            *handwritten = highlight_ini;
             break;
         default:
             break;
     }
 }
+
+static void token_runs_reset(TokenRuns *out) {
+    out->count = 0;
+    out->length = 0;
+    out->failed = false;
+}
+
+/* Main highlighting function */
+bool syntax_highlight_line(Buffer *buf, size_t line_start, size_t line_end,
+                           LanguageType lang, HighlightState *state, TokenRuns *out) {
+    size_t len = line_end > line_start ? line_end - line_start : 0;
+    LexerDef *lexer;
+    LanguageType keyword_lang;
+    LineHighlighter handwritten;
+
+    token_runs_reset(out);
+    syntax_highlighter(lang, &lexer, &keyword_lang, &handwritten);
+
+    if (lexer) {
+        lexer_highlight(lexer, keyword_lang, buf, line_start, line_end, 0, SIZE_MAX, state, out);
+    } else if (handwritten) {
+        highlight_bytes(handwritten, buf, line_start, line_end, state, out);
+    }
+
+    /* Whatever the highlighter left uncovered is normal text */
+    if (!out->failed && out->length < len) {
+        token_runs_add(out, len - out->length, TOKEN_NORMAL);
+    }
+    return !out->failed;
+}
+
+bool syntax_resumable(LanguageType lang) {
+    LexerDef *lexer;
+    LanguageType keyword_lang;
+    LineHighlighter handwritten;
+
+    syntax_highlighter(lang, &lexer, &keyword_lang, &handwritten);
+    return lexer != NULL;
+}
+
+bool syntax_highlight_span(Buffer *buf, size_t line_start, size_t line_end,
+                           size_t from, size_t to, LanguageType lang,
+                           HighlightState *state, TokenRuns *out, size_t *stop) {
+    size_t len = line_end > line_start ? line_end - line_start : 0;
+    LexerDef *lexer;
+    LanguageType keyword_lang;
+    LineHighlighter handwritten;
+
+    token_runs_reset(out);
+    syntax_highlighter(lang, &lexer, &keyword_lang, &handwritten);
+
+    *stop = len;
+    if (lexer) {
+        *stop = lexer_highlight(lexer, keyword_lang, buf, line_start, line_end,
+                                from, to, state, out);
+    }
+
+    if (!out->failed && from + out->length < *stop) {
+        token_runs_add(out, *stop - from - out->length, TOKEN_NORMAL);
+    }
+    return !out->failed;
+}
@@ -88,13 +88,46 @@ typedef enum {
     HL_STATE_CODE_BLOCK,        /* Markdown fenced code */
 } HighlightState;
 
+/* A stretch of bytes drawn with one token */
+typedef struct TokenRun {
+    unsigned int length;
+    TokenType token;
+} TokenRun;
+
+/* Highlighter output for one line - runs cover the whole line, adjacent
+ * runs never share a token. Reused from line to line. */
+typedef struct TokenRuns {
+    TokenRun *runs;
+    size_t count;
+    size_t capacity;
+    size_t length;              /* Bytes covered so far */
+    TokenType *bytes;           /* Per-byte output of the hand-written highlighters */
+    size_t bytes_capacity;
+    bool failed;                /* An allocation failed, the runs stop short */
+} TokenRuns;
+
 /* API functions */
 LanguageType syntax_detect_language(const char *filename);
 LanguageType syntax_detect_from_shebang(Buffer *buf);
 int syntax_token_to_color(TokenType token);
 int syntax_token_to_attr(TokenType token);
-void syntax_highlight_line(Buffer *buf, size_t line_start, size_t line_end,
-                           LanguageType lang, HighlightState *state,
-                           TokenType *out, size_t out_size);
+
+/* Highlight one line and advance *state; false if out ran out of memory */
+bool syntax_highlight_line(Buffer *buf, size_t line_start, size_t line_end,
+                           LanguageType lang, HighlightState *state, TokenRuns *out);
+
+/* Long lines in languages with a resumable highlighter can be done a piece
+ * at a time: start at byte from of the line (0, or a stop point of an
+ * earlier call, with the state it left) and stop at the first point at or
+ * after to where highlighting can resume. Runs in out start at from. */
+bool syntax_resumable(LanguageType lang);
+bool syntax_highlight_span(Buffer *buf, size_t line_start, size_t line_end,
+                           size_t from, size_t to, LanguageType lang,
+                           HighlightState *state, TokenRuns *out, size_t *stop);
+
+/* Run lists */
+void token_runs_init(TokenRuns *runs);
+void token_runs_free(TokenRuns *runs);
+bool token_runs_add(TokenRuns *runs, size_t length, TokenType token);
 
 #endif /* SYNTAX_H */
@@ -0,0 +1,248 @@
+#include "smashedit.h"
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/* Printable ASCII scanning */
+
+static bool is_printable_ascii(unsigned char c) {
+    return c >= 0x20 && c < 0x7F;
+}
+
+/* Eight bytes at a time: flags words holding a byte outside 0x20-0x7E */
+static bool word_printable(uint64_t w) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    uint64_t below_space = (w - ones * 0x20) & ~w;
+    uint64_t del = w ^ (ones * 0x7F);
+    del = (del - ones) & ~del;
+    return ((w | below_space | del) & highs) == 0;
+}
+
+size_t unicode_ascii_run(const char *s, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i high = _mm_set1_epi8(0x7F);
+    for (; i + 16 <= len; i += 16) {
+        /* Signed compares: bytes >= 0x80 are negative and fail the first test */
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, high));
+        int mask = _mm_movemask_epi8(ok);
+        if (mask != 0xFFFF) {
+            return i + (size_t)__builtin_ctz(~mask & 0xFFFF);
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    /* vminvq_u8 is AArch64 only; 32-bit ARM takes the word loop */
+    const uint8x16_t low = vdupq_n_u8(0x20);
+    const uint8x16_t high = vdupq_n_u8(0x7F);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(s + i));
+        uint8x16_t ok = vandq_u8(vcgeq_u8(v, low), vcltq_u8(v, high));
+        if (vminvq_u8(ok) == 0) break;  /* The byte loop below finds it */
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, s + i, sizeof(w));
+        if (!word_printable(w)) break;
+    }
+    while (i < len && is_printable_ascii((unsigned char)s[i])) {
+        i++;
+    }
+    return i;
+}
+
+/* UTF-8 decoding */
+
+/* Get the number of bytes in a UTF-8 character based on the first byte */
+int unicode_sequence_length(unsigned char c) {
+    if ((c & 0x80) == 0) return 1;        /* 0xxxxxxx - ASCII */
+    if ((c & 0xE0) == 0xC0) return 2;     /* 110xxxxx */
+    if ((c & 0xF0) == 0xE0) return 3;     /* 1110xxxx */
+    if ((c & 0xF8) == 0xF0) return 4;     /* 11110xxx */
+    return 1; /* Invalid, treat as single byte */
+}
+
+/* Check if byte is a UTF-8 continuation byte */
+bool unicode_is_continuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;  /* 10xxxxxx */
+}
+
+/* Decode a UTF-8 sequence to a wide character. Returns bytes consumed, 0 past the end */
+int unicode_decode(Buffer *buf, size_t pos, size_t buf_len, wchar_t *wc) {
+    if (pos >= buf_len) return 0;
+
+    unsigned char c = (unsigned char)buffer_get_char(buf, pos);
+    int len = unicode_sequence_length(c);
+
+    /* Check if we have enough bytes */
+    if (pos + len > buf_len) {
+        *wc = L'?';
+        return 1;
+    }
+
+    /* Validate continuation bytes and decode */
+    wchar_t result = c;
+    if (len > 1) {
+        result = c & (0x7F >> len);
+        for (int i = 1; i < len; i++) {
+            unsigned char cont = (unsigned char)buffer_get_char(buf, pos + i);
+            if (!unicode_is_continuation(cont)) {
+                *wc = L'?';
+                return 1;
+            }
+            result = (result << 6) | (cont & 0x3F);
+        }
+    }
+
+    *wc = result;
+    return len;
+}
+
+/* Display widths */
+
+/* Table entries: the width in the low bits plus a flag for marks */
+#define WIDTH_MASK 0x03
+#define WIDTH_MARK 0x04
+
+/* Two-level table: a block index per UNICODE_BLOCK_SIZE codepoints pointing
+ * at deduplicated blocks, so the many identical blocks (all width 1, all
+ * CJK) are stored once */
+static uint16_t g_width_index[UNICODE_TABLE_LIMIT / UNICODE_BLOCK_SIZE];
+static uint8_t *g_width_blocks = NULL;
+static pthread_once_t g_width_once = PTHREAD_ONCE_INIT;
+static atomic_bool g_width_ready = false;   /* Skips pthread_once once built */
+
+/* Width from libc, with the usual wide ranges as a fallback */
+static int width_compute(wchar_t wc) {
+    if (wc == L'\0') return 0;
+    if (wc < 32) return 0;  /* Control characters */
+
+    /* Use wcwidth if available (POSIX only, not on Windows) */
+#if defined(_XOPEN_SOURCE) && !defined(PDCURSES) && !defined(_WIN32)
+    int w = wcwidth(wc);
+    if (w >= 0) return w;
+#endif
+
+    /* Fallback: CJK and other wide characters are typically > U+1100 */
+    if (wc >= 0x1100 && wc <= 0x115F) return 2;  /* Hangul Jamo */
+    if (wc >= 0x2E80 && wc <= 0x9FFF) return 2;  /* CJK */
+    if (wc >= 0xAC00 && wc <= 0xD7AF) return 2;  /* Hangul Syllables */
+    if (wc >= 0xF900 && wc <= 0xFAFF) return 2;  /* CJK Compatibility */
+    if (wc >= 0xFE10 && wc <= 0xFE1F) return 2;  /* Vertical Forms */
+    if (wc >= 0xFE30 && wc <= 0xFE6F) return 2;  /* CJK Compatibility Forms */
+    if (wc >= 0xFF00 && wc <= 0xFF60) return 2;  /* Fullwidth Forms */
+    if (wc >= 0xFFE0 && wc <= 0xFFE6) return 2;  /* Fullwidth Signs */
+    if (wc >= 0x20000 && wc <= 0x2FFFF) return 2; /* CJK Extension B+ */
+
+    return 1;
+}
+
+/* Zero width outside the control ranges means the character draws on top of its base */
+static uint8_t width_entry(wchar_t wc) {
+    int width = width_compute(wc);
+    uint8_t entry = (uint8_t)width;
+    if (width == 0 && wc >= 0x300) entry |= WIDTH_MARK;
+    return entry;
+}
+
+/* Built on first use, after the locale is set */
+static void width_table_build(void) {
+    size_t block_total = UNICODE_TABLE_LIMIT / UNICODE_BLOCK_SIZE;
+    uint8_t *blocks = malloc(block_total * UNICODE_BLOCK_SIZE);
+    if (!blocks) return;
+
+    size_t count = 0;
+    uint8_t block[UNICODE_BLOCK_SIZE];
+    for (size_t b = 0; b < block_total; b++) {
+        for (size_t i = 0; i < UNICODE_BLOCK_SIZE; i++) {
+            block[i] = width_entry((wchar_t)(b * UNICODE_BLOCK_SIZE + i));
+        }
+
+        size_t found = 0;
+        while (found < count && memcmp(blocks + found * UNICODE_BLOCK_SIZE, block, UNICODE_BLOCK_SIZE) != 0) {
+            found++;
+        }
+        if (found == count) {
+            memcpy(blocks + count * UNICODE_BLOCK_SIZE, block, UNICODE_BLOCK_SIZE);
+            count++;
+        }
+        g_width_index[b] = (uint16_t)found;
+    }
+
+    uint8_t *shrunk = realloc(blocks, count * UNICODE_BLOCK_SIZE);
+    g_width_blocks = shrunk ? shrunk : blocks;
+    atomic_store_explicit(&g_width_ready, true, memory_order_release);
+}
+
+static uint8_t width_lookup(wchar_t wc) {
+    if (wc < 0) return 1;
+    if ((unsigned long)wc >= UNICODE_TABLE_LIMIT) return width_entry(wc);
+
+    if (!atomic_load_explicit(&g_width_ready, memory_order_acquire)) {
+        pthread_once(&g_width_once, width_table_build);
+        if (!g_width_blocks) return width_entry(wc);
+    }
+
+    size_t cp = (size_t)wc;
+    return g_width_blocks[(size_t)g_width_index[cp / UNICODE_BLOCK_SIZE] * UNICODE_BLOCK_SIZE +
+                          cp % UNICODE_BLOCK_SIZE];
+}
+
+int unicode_width(wchar_t wc) {
+    if (wc < 32) return 0;  /* Control characters */
+    if (wc < 0x7F) return 1;
+    return width_lookup(wc) & WIDTH_MASK;
+}
+
+bool unicode_is_mark(wchar_t wc) {
+    if (wc < 0x300) return false;
+    return (width_lookup(wc) & WIDTH_MARK) != 0;
+}
+
+/* Grapheme clusters */
+
+size_t unicode_next_cluster(Buffer *buf, size_t pos) {
+    size_t buf_len = buffer_get_length(buf);
+    if (pos >= buf_len) return buf_len;
+
+    wchar_t wc;
+    pos += unicode_decode(buf, pos, buf_len, &wc);
+
+    /* Marks never attach to a line break */
+    if (wc == L'\n') return pos;
+
+    while (pos < buf_len) {
+        int len = unicode_decode(buf, pos, buf_len, &wc);
+        if (!unicode_is_mark(wc)) break;
+        pos += len;
+    }
+    return pos;
+}
+
+size_t unicode_prev_cluster(Buffer *buf, size_t pos) {
+    size_t buf_len = buffer_get_length(buf);
+    if (pos > buf_len) pos = buf_len;
+
+    while (pos > 0) {
+        /* Back to the start of the previous character */
+        pos--;
+        while (pos > 0 && unicode_is_continuation((unsigned char)buffer_get_char(buf, pos))) {
+            pos--;
+        }
+
+        wchar_t wc;
+        unicode_decode(buf, pos, buf_len, &wc);
+        if (!unicode_is_mark(wc) || pos == 0 || buffer_get_char(buf, pos - 1) == '\n') break;
+    }
+    return pos;
+}
@@ -0,0 +1,38 @@
+#ifndef UNICODE_H
+#define UNICODE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <wchar.h>
+
+/* Forward declarations */
+typedef struct Buffer Buffer;
+
+/* Codepoints below this come from the width table, the rest are computed */
+#define UNICODE_TABLE_LIMIT 0x40000
+
+/* Codepoints per block of the width table */
+#define UNICODE_BLOCK_SIZE 256
+
+/* Length of the run of printable ASCII (0x20-0x7E) at the start of s.
+ * These bytes are one column each and need no decoding. */
+size_t unicode_ascii_run(const char *s, size_t len);
+
+/* UTF-8 decoding. Invalid or truncated sequences decode as one '?' byte. */
+int unicode_sequence_length(unsigned char c);
+bool unicode_is_continuation(unsigned char c);
+int unicode_decode(Buffer *buf, size_t pos, size_t buf_len, wchar_t *wc);
+
+/* Display columns of a character (0, 1 or 2); the same table serves the
+ * renderer and cursor math */
+int unicode_width(wchar_t wc);
+
+/* Zero-width characters that join the character before them (combining
+ * marks, variation selectors, joiners) */
+bool unicode_is_mark(wchar_t wc);
+
+/* Grapheme cluster boundaries: a character plus any marks after it */
+size_t unicode_next_cluster(Buffer *buf, size_t pos);
+size_t unicode_prev_cluster(Buffer *buf, size_t pos);
+
+#endif /* UNICODE_H */
@@ -0,0 +1,266 @@
+#include "smashedit.h"
+#include <stdint.h>
+
+/* Cached lines */
+
+static void wrap_line_drop(WrapLayout *layout, int i) {
+    free(layout->lines[i].rows);
+    layout->lines[i] = layout->lines[layout->count - 1];
+    layout->count--;
+}
+
+static void wrap_drop_all(WrapLayout *layout) {
+    for (int i = 0; i < layout->count; i++) {
+        free(layout->lines[i].rows);
+    }
+    layout->count = 0;
+}
+
+/* Cached line starting at line_start, added (replacing the least recently
+ * used one when full) if it isn't there yet */
+static WrapLine *wrap_line_get(WrapLayout *layout, size_t line_start) {
+    for (int i = 0; i < layout->count; i++) {
+        if (layout->lines[i].start == line_start) {
+            layout->lines[i].used = ++layout->clock;
+            return &layout->lines[i];
+        }
+    }
+
+    ColumnPoint *rows = malloc(4 * sizeof(ColumnPoint));
+    if (!rows) return NULL;
+
+    if (layout->count == WRAP_CACHE_LINES) {
+        int oldest = 0;
+        for (int i = 1; i < layout->count; i++) {
+            if (layout->lines[i].used < layout->lines[oldest].used) oldest = i;
+        }
+        wrap_line_drop(layout, oldest);
+    }
+
+    WrapLine *line = &layout->lines[layout->count++];
+    line->start = line_start;
+    line->end = buffer_line_end(layout->buffer, line_start);
+    line->rows = rows;
+    line->rows[0].offset = 0;
+    line->rows[0].col = 1;
+    line->count = 1;
+    line->capacity = 4;
+    line->complete = false;
+    line->used = ++layout->clock;
+    return line;
+}
+
+/* Lay out one row starting at from. Returns false when the line ends on this
+ * row, otherwise stores where the next row starts. */
+static bool wrap_walk_row(WrapLayout *layout, const WrapLine *line,
+                          const ColumnPoint *from, ColumnPoint *next) {
+    Buffer *buf = layout->buffer;
+    size_t buf_len = buffer_get_length(buf);
+    size_t width = (size_t)layout->width;
+    ColumnPoint at = *from;
+    ColumnPoint blank = *from;      /* Just past the last blank on the row */
+    size_t used = 0;
+
+    while (line->start + at.offset < line->end) {
+        size_t i = line->start + at.offset;
+        char c = buffer_get_char(buf, i);
+
+        /* Printable ASCII that still fits is taken in bulk */
+        if (c >= 0x20 && c < 0x7F && used < width) {
+            size_t want = width - used;
+            if (want > WRAP_ASCII_CHUNK) want = WRAP_ASCII_CHUNK;
+            if (want > line->end - i) want = line->end - i;
+
+            char scratch[WRAP_ASCII_CHUNK];
+            const char *span = want > 1 ? buffer_get_span(buf, i, i + want, scratch) : NULL;
+            size_t n = span ? unicode_ascii_run(span, want) : 1;
+
+            for (size_t k = n; k > 0; k--) {
+                if ((span ? span[k - 1] : c) == ' ') {
+                    blank.offset = at.offset + k;
+                    blank.col = at.col + k;
+                    break;
+                }
+            }
+            at.offset += n;
+            at.col += n;
+            used += n;
+            continue;
+        }
+
+        size_t w;
+        int len = 1;
+        if (c == '\t') {
+            w = TAB_WIDTH - ((at.col - 1) % TAB_WIDTH);
+        } else if (c >= 0x20 && c < 0x7F) {
+            w = 1;
+        } else {
+            wchar_t wc;
+            len = unicode_decode(buf, i, buf_len, &wc);
+            w = (size_t)unicode_width(wc);
+        }
+
+        /* Doesn't fit: break after the last blank, or here if there is none.
+         * A space that doesn't fit hangs off the end of the row instead. */
+        if (used > 0 && used + w > width) {
+            if (c == ' ') {
+                next->offset = at.offset + 1;
+                next->col = at.col + 1;
+            } else {
+                *next = blank.offset > from->offset ? blank : at;
+            }
+            return true;
+        }
+
+        at.offset += len;
+        at.col += w;
+        used += w;
+        if (c == '\t') blank = at;
+    }
+
+    /* A full last row leaves the cursor at the line end nowhere to go */
+    if (used >= width) {
+        *next = at;
+        return true;
+    }
+    return false;
+}
+
+/* Lay out rows until at least rows_wanted are known and the last one known
+ * starts after rel, or the line is complete */
+static void wrap_line_extend(WrapLayout *layout, WrapLine *line, size_t rows_wanted, size_t rel) {
+    while (!line->complete &&
+           (line->count < rows_wanted || line->rows[line->count - 1].offset <= rel)) {
+        ColumnPoint next;
+        if (!wrap_walk_row(layout, line, &line->rows[line->count - 1], &next)) {
+            line->complete = true;
+            break;
+        }
+
+        if (line->count == line->capacity) {
+            size_t new_capacity = line->capacity * 2;
+            ColumnPoint *grown = realloc(line->rows, new_capacity * sizeof(ColumnPoint));
+            if (!grown) {
+                line->complete = true;  /* The rest of the line stays on the last row */
+                break;
+            }
+            line->rows = grown;
+            line->capacity = new_capacity;
+        }
+        line->rows[line->count++] = next;
+    }
+}
+
+/* Buffer change listener: edits inside a line keep the rows before the edit,
+ * edits before it shift it, and anything touching a newline drops it */
+static void wrap_on_change(void *ctx, const BufferChange *change) {
+    WrapLayout *layout = ctx;
+    size_t edit_end = change->pos + change->removed;
+    bool lines_changed = change->lines_removed > 0 || change->lines_inserted > 0;
+
+    for (int i = layout->count - 1; i >= 0; i--) {
+        WrapLine *line = &layout->lines[i];
+
+        if (change->pos > line->end) continue;
+
+        if (change->pos < line->start) {
+            if (edit_end >= line->start) {
+                wrap_line_drop(layout, i);  /* Joined with the previous line */
+            } else {
+                line->start = line->start - change->removed + change->inserted;
+                line->end = line->end - change->removed + change->inserted;
+            }
+            continue;
+        }
+
+        if (lines_changed) {
+            wrap_line_drop(layout, i);
+            continue;
+        }
+
+        /* A row's start was decided by a character no later than the start
+         * of the row after it, plus the tail of its UTF-8 sequence */
+        size_t rel = change->pos - line->start;
+        size_t kept = 1;
+        while (kept + 1 < line->count && line->rows[kept + 1].offset + 4 <= rel) {
+            kept++;
+        }
+        line->count = kept;
+        line->complete = false;
+        line->end = line->end - change->removed + change->inserted;
+    }
+}
+
+/* Lifecycle */
+
+WrapLayout *wrap_layout_create(Buffer *buf) {
+    WrapLayout *layout = malloc(sizeof(WrapLayout));
+    if (!layout) return NULL;
+
+    layout->buffer = buf;
+    layout->width = 1;
+    layout->count = 0;
+    layout->clock = 0;
+
+    buffer_add_listener(buf, wrap_on_change, layout);
+
+    return layout;
+}
+
+void wrap_layout_destroy(WrapLayout *layout) {
+    if (layout) {
+        buffer_remove_listener(layout->buffer, wrap_on_change, layout);
+        wrap_drop_all(layout);
+        free(layout);
+    }
+}
+
+void wrap_layout_set_width(WrapLayout *layout, int width) {
+    if (!layout) return;
+    if (width < 1) width = 1;
+    if (width != layout->width) {
+        wrap_drop_all(layout);
+        layout->width = width;
+    }
+}
+
+/* Queries */
+
+size_t wrap_row_count(WrapLayout *layout, size_t line_start) {
+    WrapLine *line = layout ? wrap_line_get(layout, line_start) : NULL;
+    if (!line) return 1;
+
+    wrap_line_extend(layout, line, SIZE_MAX, SIZE_MAX);
+    return line->count;
+}
+
+size_t wrap_row_of(WrapLayout *layout, size_t line_start, size_t pos) {
+    WrapLine *line = layout ? wrap_line_get(layout, line_start) : NULL;
+    if (!line || pos <= line_start) return 0;
+
+    size_t rel = pos - line_start;
+    wrap_line_extend(layout, line, 1, rel);
+
+    /* Last row starting at or before pos */
+    size_t lo = 0, hi = line->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (line->rows[mid].offset <= rel) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool wrap_row_span(WrapLayout *layout, size_t line_start, size_t row,
+                   size_t *start, size_t *end, size_t *col) {
+    WrapLine *line = layout ? wrap_line_get(layout, line_start) : NULL;
+    if (!line) return false;
+
+    wrap_line_extend(layout, line, row + 2, 0);
+    if (row >= line->count) return false;
+
+    if (start) *start = line->start + line->rows[row].offset;
+    if (col) *col = line->rows[row].col;
+    if (end) *end = row + 1 < line->count ? line->start + line->rows[row + 1].offset : line->end;
+    return true;
+}
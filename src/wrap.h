@@ -0,0 +1,60 @@
+#ifndef WRAP_H
+#define WRAP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Forward declarations */
+typedef struct Buffer Buffer;
+
+/* Lines whose wrapped rows are remembered at once */
+#define WRAP_CACHE_LINES 256
+
+/* Bytes of printable ASCII taken per step of a row walk */
+#define WRAP_ASCII_CHUNK 256
+
+/* Visual rows of one logical line, found lazily as far as asked.
+ * A row breaks after the last blank that fits, or mid-word when a word is
+ * wider than the row; a space landing just past the end hangs off it. A line
+ * that fills its last row gets an empty row after it so the cursor at the
+ * line end stays on screen. */
+typedef struct WrapLine {
+    size_t start;           /* Offset of the line start */
+    size_t end;             /* Offset of the newline or buffer end */
+    ColumnPoint *rows;      /* Start of each row; rows[0] is always {0, 1} */
+    size_t count;
+    size_t capacity;
+    bool complete;          /* Every row of the line is known */
+    unsigned long used;     /* Last lookup, for replacement */
+} WrapLine;
+
+/* Per-buffer wrap layout for one row width. Edits inside a line keep the
+ * rows before the edit; edits that split or join lines drop the line and
+ * a width change drops everything. */
+typedef struct WrapLayout {
+    Buffer *buffer;
+    int width;
+    WrapLine lines[WRAP_CACHE_LINES];
+    int count;
+    unsigned long clock;
+} WrapLayout;
+
+/* Lifecycle */
+WrapLayout *wrap_layout_create(Buffer *buf);
+void wrap_layout_destroy(WrapLayout *layout);
+
+/* Set the row width in columns, dropping the layout when it changes */
+void wrap_layout_set_width(WrapLayout *layout, int width);
+
+/* Number of rows of the line starting at line_start */
+size_t wrap_row_count(WrapLayout *layout, size_t line_start);
+
+/* Row of the line starting at line_start that pos is drawn on */
+size_t wrap_row_of(WrapLayout *layout, size_t line_start, size_t pos);
+
+/* Bounds of a row: its first position and column, and where the next row
+ * starts (the line end for the last row). False when the line has fewer rows. */
+bool wrap_row_span(WrapLayout *layout, size_t line_start, size_t row,
+                   size_t *start, size_t *end, size_t *col);
+
+#endif /* WRAP_H */